@@ -1,13 +1,25 @@
 #ifndef _AUDIO_ENGINE_H
 #define _AUDIO_ENGINE_H
 
+#include <array>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 #include <variant>
 #include <rtaudio/RtAudio.h>
 
 #include "engine.h"
+#include "seqlock.h"
+#include "denormals.h"
+#include "threadconfig.h"
+#include "allocators.h"
+#include "audiobuffer.h"
+#include "audiokernels.h"
+#include "transport.h"
+#include "buffersizecontroller.h"
 
 namespace Devices
 {
@@ -26,6 +38,7 @@ enum class eAudioEngineState
   Stopped,
   Running,
   Start,
+  Reconfigure,
 };
 
 /** @enum eAudioEngineCommand
@@ -34,9 +47,10 @@ enum class eAudioEngineState
 enum class eAudioEngineCommand
 {
   Play,
-  Stop,
+  Close,
   SetDevice,
   SetParams,
+  SetAdaptiveBuffer,
 };
 
 /** @struct SetDevicePayload
@@ -57,6 +71,15 @@ struct SetStreamParamsPayload
   unsigned int buffer_frames;
 };
 
+/** @struct AdaptiveBufferPayload
+ *  @brief Contains the parameters for the SetAdaptiveBuffer API command
+ */
+struct AdaptiveBufferPayload
+{
+  bool enabled;
+  BufferSizeControllerConfig config;
+};
+
 /** @struct AudioMessage
  *  @brief Audio Message structure used to comminicate within AudioEngine class.
  */
@@ -66,7 +89,8 @@ struct AudioMessage
   std::variant<
     std::monostate,
     SetDevicePayload,
-    SetStreamParamsPayload> payload;
+    SetStreamParamsPayload,
+    AdaptiveBufferPayload> payload;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const AudioMessage& message)
@@ -81,6 +105,43 @@ struct AudioEngineStatistics
 {
   unsigned int tracks_playing;
   unsigned int total_frames_processed;
+  unsigned int xruns;
+  unsigned int denormals;  // Denormal output samples, counted in debug builds only
+  unsigned int latency;    // Samples the renderer delays the master bus to line up its paths
+};
+
+/** @struct StreamSwapStatistics
+ *  @brief Live device and stream parameter changes made while running.
+ */
+struct StreamSwapStatistics
+{
+  unsigned int swaps;
+  unsigned int parallel_swaps;  // Swaps where the new stream opened before the old one closed
+  double last_dropout_ms;       // Silence between the end of the fade out and the start of the fade in
+  double max_dropout_ms;
+};
+
+/** @class IAudioRenderer
+ *  @brief Renders program audio into the master bus from the audio callback.
+ */
+class IAudioRenderer
+{
+public:
+  virtual ~IAudioRenderer() = default;
+
+  /** @brief Allocate buffers for a stream configuration. Never called while render() can run.
+   */
+  virtual void prepare(const unsigned int channels, const unsigned int sample_rate,
+                       const unsigned int max_frames, std::pmr::memory_resource *resource) = 0;
+
+  /** @brief Add n_frames of audio into the bus, which is cleared before the call. Audio thread only.
+   *  The transport does not start, stop or jump within the n_frames.
+   */
+  virtual void render(AudioBuffer &bus, const TransportState &transport, const unsigned int n_frames) noexcept = 0;
+
+  /** @brief Samples the master bus lags the transport position. Not called on the audio thread.
+   */
+  virtual unsigned int get_latency() const { return 0; }
 };
 
 /** @class AudioEngine
@@ -91,6 +152,8 @@ class AudioEngine : public IEngine<AudioMessage>
   friend class Devices::DeviceManager;
 
 public:
+  static constexpr size_t kBufferPoolBytes = 4 * 1024 * 1024;
+
   static AudioEngine& instance()
   {
     static AudioEngine instance;
@@ -98,14 +161,31 @@ public:
   }
 
   AudioEngineStatistics get_statistics() const;
+  StreamSwapStatistics get_swap_statistics() const;
+
+  void set_audio_thread_config(const ThreadConfig &config);
+  ThreadReport get_audio_thread_report() const;
 
   void play();
   void stop();
+  void locate(const uint64_t position);
+  void close();
+  void render(float *output_buffer, unsigned int n_frames);
+  void set_renderer(IAudioRenderer *renderer);
   void set_output_device(const unsigned int device_id);
   void set_stream_parameters(
     const unsigned int channels,
     const unsigned int sample_rate,
     const unsigned int buffer_frames);
+  void set_adaptive_buffer_size(const bool enabled,
+                                const BufferSizeControllerConfig &config = BufferSizeControllerConfig{});
+
+  /** @brief Play position, tempo and loop. The stream stays open while the transport is stopped.
+   */
+  inline Transport &get_transport() noexcept
+  {
+    return m_transport;
+  }
 
   inline eAudioEngineState get_state() const noexcept
   {
@@ -132,9 +212,17 @@ public:
     return m_buffer_frames.load(std::memory_order_relaxed);
   }
 
+  /** @brief Page-locked memory for long-lived DSP buffers. Allocate while preparing, not on the audio thread.
+   */
+  inline std::pmr::memory_resource *get_buffer_pool() noexcept
+  {
+    return &m_buffer_pool;
+  }
+
   void stop_thread()
   {
     stop();
+    close();
     // Wait for audio to fully stop
     while (get_state() != eAudioEngineState::Idle)
     {
@@ -147,9 +235,46 @@ public:
 private:
   AudioEngine();
 
+  /** @enum eSwapPhase
+   *  @brief Output fade around a live stream swap
+   */
+  enum class eSwapPhase
+  {
+    Normal,
+    FadingOut,
+    Muted,
+    FadingIn,
+  };
+
+  /** @struct Stream
+   *  @brief One RtAudio instance and the callback data for its stream.
+   *  Only the active stream renders, any other outputs silence.
+   */
+  struct Stream
+  {
+    AudioEngine *engine;
+    std::unique_ptr<RtAudio> rtaudio;
+    unsigned int channels;
+    SeqLock<ThreadReport> thread_report;  // Written by this stream's callback thread
+  };
+
   std::vector<RtAudio::DeviceInfo> get_devices();
 
+  bool open_stream(Stream &stream, const unsigned int device_id, const unsigned int channels,
+                   const unsigned int sample_rate, unsigned int &buffer_frames);
+  void close_stream(Stream &stream);
+  void deactivate_stream();
+  void fade_out();
+  void apply_swap_fade(float *output_buffer, const unsigned int n_frames, const unsigned int channels) noexcept;
+  void apply_audio_thread_config(Stream &stream) noexcept;
+  void record_load(const unsigned int n_frames, const std::chrono::steady_clock::duration elapsed,
+                   const RtAudioStreamStatus status) noexcept;
+  AudioLoadStatistics take_load_window();
+  void update_buffer_size_controller();
+
+  void prepare_stream(const unsigned int channels, const unsigned int sample_rate, const unsigned int buffer_frames);
   void process_audio(float *output_buffer, unsigned int n_frames);
+  void render_bus(const unsigned int n_frames);
 
   void run() override;
   void handle_messages() override;
@@ -158,15 +283,71 @@ private:
   void update_state_start();
   void update_state_running();
   void update_state_stopped();
+  void update_state_reconfigure();
 
   static int audio_callback(void *output_buffer, void *input_buffer, unsigned int n_frames,
                      double stream_time, RtAudioStreamStatus status, void *user_data);
 
-  std::unique_ptr<RtAudio> p_rtaudio;
+  static constexpr double kSwapFadeSeconds = 0.01;
+  static constexpr auto kSwapTimeout = std::chrono::milliseconds(250);
+
+  // Two instances so a new stream can open while the old one still plays.
+  // m_streams[0] also enumerates devices.
+  std::array<Stream, 2> m_streams;
+  size_t m_stream_index;
+  std::atomic<const Stream *> p_active_stream;
+  std::atomic<unsigned int> m_callbacks_inside;
+  unsigned int m_stream_device_id;
+
+  // Swap fade. The gain and step belong to the audio thread while a fade runs.
+  std::atomic<eSwapPhase> m_swap_phase;
+  float m_fade_gain;
+  float m_fade_step;
+  std::atomic<int64_t> m_muted_at_ns;
+  std::atomic<int64_t> m_last_dropout_ns;
+  std::atomic<int64_t> m_max_dropout_ns;
+  std::atomic<unsigned int> m_swaps;
+  std::atomic<unsigned int> m_parallel_swaps;
+
+  // Callback load since the controller last looked, written by the audio thread
+  static constexpr auto kControllerPeriod = std::chrono::milliseconds(500);
+  std::atomic<float> m_window_peak_load;
+  std::atomic<float> m_window_load_sum;
+  std::atomic<unsigned int> m_window_callbacks;
+  std::atomic<unsigned int> m_window_xruns;
+  std::atomic<unsigned int> m_xruns;
+
+  // Scheduling for the RtAudio callback threads, applied by each thread on its
+  // first callback after a change
+  SeqLock<ThreadConfig> m_audio_thread_config;
+  std::mutex m_audio_thread_config_mutex;
+
+  // Engine thread only
+  std::optional<BufferSizeController> m_buffer_controller;
+  std::chrono::steady_clock::time_point m_controller_updated;
+
+  LockedMemoryPool m_buffer_pool;
+
+  // Planar master bus, interleaved into the device buffer once per block
+  AudioBuffer m_output_bus;
+
+  Transport m_transport;
+
+  // Stream configuration and kernels, fixed while the stream is open.
+  // Only written when the audio callback cannot run.
+  const Kernels::KernelTable *p_kernels;
+  unsigned int m_stream_sample_rate;
+
+  // Source of the master bus. m_rendering lets set_renderer() wait for a block
+  // that is still using the previous renderer.
+  mutable std::mutex m_renderer_mutex;
+  std::atomic<IAudioRenderer *> p_renderer;
+  std::atomic<bool> m_rendering;
 
   std::atomic<eAudioEngineState> m_state;
   std::atomic<unsigned int> m_tracks_playing;
   std::atomic<unsigned int> m_total_frames_processed;
+  std::atomic<unsigned int> m_denormals;
   std::atomic<unsigned int> m_device_id;
   std::atomic<unsigned int> m_channels;
   std::atomic<unsigned int> m_sample_rate;
@@ -0,0 +1,69 @@
+#ifndef __BUFFER_SIZE_CONTROLLER_H__
+#define __BUFFER_SIZE_CONTROLLER_H__
+
+#include <chrono>
+
+namespace Audio
+{
+
+/** @struct AudioLoadStatistics
+ *  @brief Callback load over one observation window.
+ *  Load is the time spent in the callback divided by the block period.
+ */
+struct AudioLoadStatistics
+{
+  float peak_load;
+  float average_load;
+  unsigned int callbacks;
+  unsigned int xruns;
+};
+
+/** @struct BufferSizeControllerConfig
+ *  @brief Limits and thresholds of the adaptive buffer size.
+ *  Halving the block roughly doubles the load, so lower_load must stay below
+ *  half of raise_load for the controller to settle.
+ */
+struct BufferSizeControllerConfig
+{
+  unsigned int min_frames = 64;
+  unsigned int max_frames = 2048;
+  float lower_load = 0.3f;  // Step down after the peak load stays under this for down_hold
+  float raise_load = 0.8f;  // Step up as soon as the peak load goes over this
+  std::chrono::milliseconds down_hold{10000};
+  std::chrono::milliseconds xrun_penalty{60000};  // How long a size that underran is avoided
+};
+
+/** @class BufferSizeController
+ *  @brief Chooses the smallest buffer size the current load runs at without underruns.
+ *
+ *  Fed one AudioLoadStatistics window at a time. Any xrun or a peak load over
+ *  raise_load doubles the buffer at once. The buffer is halved only after the
+ *  peak load has stayed under lower_load for down_hold, and never back to a
+ *  size that underran within xrun_penalty.
+ */
+class BufferSizeController
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit BufferSizeController(const BufferSizeControllerConfig &config = BufferSizeControllerConfig{});
+
+  unsigned int update(const AudioLoadStatistics &window, const unsigned int buffer_frames, const Clock::time_point now);
+  void reset();
+
+  const BufferSizeControllerConfig &get_config() const noexcept { return m_config; }
+
+private:
+  BufferSizeControllerConfig m_config;
+
+  bool m_headroom;
+  Clock::time_point m_headroom_since;
+
+  // Largest size that underran recently, and when
+  unsigned int m_failed_frames;
+  Clock::time_point m_failed_at;
+};
+
+}  // namespace Audio
+
+#endif  // __BUFFER_SIZE_CONTROLLER_H__
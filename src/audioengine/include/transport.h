@@ -0,0 +1,156 @@
+#ifndef __TRANSPORT_H__
+#define __TRANSPORT_H__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ringbuffer.h"
+#include "seqlock.h"
+#include "snapshot.h"
+
+namespace Audio
+{
+
+/** @struct TempoPoint
+ *  @brief A tempo change, in beats from the start of the timeline
+ */
+struct TempoPoint
+{
+  double beat;
+  double bpm;
+};
+
+/** @class TempoMap
+ *  @brief Piecewise-constant tempo, converting between beats and seconds.
+ *
+ *  The start time of every tempo change is computed when the map is built,
+ *  so conversions are a binary search over the changes.
+ */
+class TempoMap
+{
+public:
+  explicit TempoMap(const double bpm = 120.0);
+
+  void set_tempo(const double bpm);
+  void add_tempo_change(const double beat, const double bpm);
+
+  double get_tempo_at_beat(const double beat) const noexcept;
+  double get_tempo_at_seconds(const double seconds) const noexcept;
+  double get_seconds_at_beat(const double beat) const noexcept;
+  double get_beat_at_seconds(const double seconds) const noexcept;
+
+  const std::vector<TempoPoint> &get_points() const noexcept { return m_points; }
+
+private:
+  void rebuild();
+
+  std::vector<TempoPoint> m_points;
+  std::vector<double> m_seconds;  // Start time of each point
+};
+
+/** @enum eTransportCommand
+ *  @brief Transport commands, applied on the audio thread
+ */
+enum class eTransportCommand
+{
+  Play,
+  Stop,
+  Locate,
+  SetLoop,
+  SetLooping,
+};
+
+/** @struct TransportCommand
+ *  @brief A command due at a stream frame, or as soon as possible when at_frame is 0
+ */
+struct TransportCommand
+{
+  eTransportCommand command;
+  uint64_t at_frame;
+  uint64_t position;
+  uint64_t end;
+  bool enabled;
+};
+
+/** @struct TransportState
+ *  @brief Transport state for one rendered chunk. Positions are in samples.
+ */
+struct TransportState
+{
+  bool playing;
+  bool looping;
+  uint64_t position;    // Timeline position of the first frame of the chunk
+  uint64_t loop_start;
+  uint64_t loop_end;
+  uint64_t stream_frame;  // Frames rendered since the engine started
+  double sample_rate;
+  double tempo;
+  double beat;
+};
+
+/** @class Transport
+ *  @brief Sample-accurate play position owned by the audio thread.
+ *
+ *  Control threads queue commands, optionally stamped with the stream frame
+ *  they take effect on. The audio thread applies due commands at the start of
+ *  each chunk and ends chunks early at the next due command or loop end, so
+ *  starts, stops, locates and loop jumps land on exact samples. The state seen
+ *  by control threads is published once per block through a seqlock.
+ */
+class Transport
+{
+public:
+  static constexpr size_t kMaxPendingCommands = 64;
+
+  Transport();
+
+  // Control thread API
+  void play(const uint64_t at_frame = 0);
+  void stop(const uint64_t at_frame = 0);
+  void locate(const uint64_t position, const uint64_t at_frame = 0);
+  void set_loop(const uint64_t start, const uint64_t end);
+  void set_looping(const bool looping);
+  void set_tempo_map(const TempoMap &tempo_map);
+
+  TransportState get_state() const noexcept { return m_published.load(); }
+  bool is_playing() const noexcept { return get_state().playing; }
+  uint64_t get_position() const noexcept { return get_state().position; }
+
+  // Audio thread API
+  void prepare(const double sample_rate);
+  unsigned int begin_chunk(const unsigned int max_frames) noexcept;
+  void advance(const unsigned int n_frames) noexcept;
+  void publish() noexcept;
+
+  /** @brief State of the chunk being rendered. Audio thread only.
+   */
+  const TransportState &get_chunk_state() const noexcept { return m_state; }
+
+  uint64_t get_dropped_commands() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  void push(const TransportCommand &command);
+  void apply(const TransportCommand &command) noexcept;
+  void update_tempo() noexcept;
+
+  // Producers share the ring through a mutex, the audio thread reads it lock-free
+  std::mutex m_command_mutex;
+  RingBuffer<TransportCommand> m_commands;
+  std::atomic<uint64_t> m_dropped;
+
+  SnapshotPublisher<TempoMap> m_tempo_map;
+  SeqLock<TransportState> m_published;
+
+  // Audio thread state
+  TransportState m_state;
+  std::array<TransportCommand, kMaxPendingCommands> m_pending;
+  size_t m_pending_count;
+};
+
+}  // namespace Audio
+
+#endif  // __TRANSPORT_H__
@@ -1,7 +1,11 @@
 #include "audioengine.h"
 #include "alsa_utils.h"
+#include "realtimecheck.h"
+#include "audiokernels.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <cassert>
 #include <stdexcept>
 #include <thread>
@@ -12,13 +16,37 @@ using namespace Audio;
 /** @brief AudioEngine constructor
  */
 AudioEngine::AudioEngine() : IEngine("AudioEngine"),
+  m_stream_index(0),
+  p_active_stream(nullptr),
+  m_callbacks_inside(0),
+  m_stream_device_id(0),
+  m_swap_phase(eSwapPhase::Normal),
+  m_fade_gain(1.0f),
+  m_fade_step(0.0f),
+  m_muted_at_ns(0),
+  m_last_dropout_ns(0),
+  m_max_dropout_ns(0),
+  m_swaps(0),
+  m_parallel_swaps(0),
+  m_window_peak_load(0.0f),
+  m_window_load_sum(0.0f),
+  m_window_callbacks(0),
+  m_window_xruns(0),
+  m_xruns(0),
+  m_buffer_pool(kBufferPoolBytes),
+  m_output_bus(&m_buffer_pool),
+  p_kernels(&Kernels::generic_kernels()),
+  m_stream_sample_rate(0),
+  p_renderer(nullptr),
+  m_rendering(false),
   m_state(eAudioEngineState::Idle),
-  m_buffer_frames(512),
-  m_sample_rate(44100),
-  m_channels(2),
-  m_device_id(0),
   m_tracks_playing(0),
-  m_total_frames_processed(0)
+  m_total_frames_processed(0),
+  m_denormals(0),
+  m_device_id(0),
+  m_channels(2),
+  m_sample_rate(44100),
+  m_buffer_frames(512)
 {
   // if (!is_alsa_seq_available())
   // {
@@ -28,11 +56,25 @@ AudioEngine::AudioEngine() : IEngine("AudioEngine"),
   // }
 
   // Set up RtAudio
-  p_rtaudio = std::make_unique<RtAudio>();
-  if (!p_rtaudio)
+  for (auto &stream : m_streams)
   {
-    throw std::runtime_error("Failed to create RtAudio instance");
+    stream.engine = this;
+    stream.rtaudio = std::make_unique<RtAudio>();
+    stream.channels = 0;
+    if (!stream.rtaudio)
+    {
+      throw std::runtime_error("Failed to create RtAudio instance");
+    }
   }
+
+  if (!m_buffer_pool.is_locked())
+  {
+    LOG_INFO("AudioEngine: Could not lock DSP buffer pool into memory, continuing unlocked.");
+  }
+
+  prepare_stream(m_channels.load(std::memory_order_relaxed),
+                 m_sample_rate.load(std::memory_order_relaxed),
+                 m_buffer_frames.load(std::memory_order_relaxed));
 }
 
 /** @brief Return a copy of the AudioEngine statistics
@@ -43,24 +85,66 @@ AudioEngineStatistics AudioEngine::get_statistics() const
 
   statistics.tracks_playing = m_tracks_playing.load(std::memory_order_relaxed);
   statistics.total_frames_processed = m_total_frames_processed.load(std::memory_order_relaxed);
+  statistics.xruns = m_xruns.load(std::memory_order_relaxed);
+  statistics.denormals = m_denormals.load(std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(m_renderer_mutex);
+  IAudioRenderer *renderer = p_renderer.load(std::memory_order_acquire);
+  statistics.latency = renderer ? renderer->get_latency() : 0;
+
+  return statistics;
+}
+
+/** @brief Return a copy of the live reconfiguration statistics
+ */
+StreamSwapStatistics AudioEngine::get_swap_statistics() const
+{
+  StreamSwapStatistics statistics;
+
+  statistics.swaps = m_swaps.load(std::memory_order_relaxed);
+  statistics.parallel_swaps = m_parallel_swaps.load(std::memory_order_relaxed);
+  statistics.last_dropout_ms = static_cast<double>(m_last_dropout_ns.load(std::memory_order_relaxed)) / 1e6;
+  statistics.max_dropout_ms = static_cast<double>(m_max_dropout_ns.load(std::memory_order_relaxed)) / 1e6;
 
   return statistics;
 }
 
+/** @brief Scheduling, affinity and stack prefault for the audio callback threads - External API
+ *  Passed to RtAudio when a stream opens, so the backend can start its thread
+ *  real-time, and applied again by the callback thread itself on its next callback.
+ *  @param config What to request
+ */
+void AudioEngine::set_audio_thread_config(const ThreadConfig &config)
+{
+  std::lock_guard<std::mutex> lock(m_audio_thread_config_mutex);
+  m_audio_thread_config.store(config);
+}
+
+/** @brief What the active stream's callback thread was granted
+ */
+ThreadReport AudioEngine::get_audio_thread_report() const
+{
+  const Stream *stream = p_active_stream.load(std::memory_order_acquire);
+  if (!stream)
+    stream = &m_streams[m_stream_index];
+  return stream->thread_report.load();
+}
+
 /** @brief Get a list of available audio devices
  *  @return A vector of available audio devices
  */
 std::vector<RtAudio::DeviceInfo> AudioEngine::get_devices()
 {
-  if (!p_rtaudio)
+  RtAudio *rtaudio = m_streams[0].rtaudio.get();
+  if (!rtaudio)
   {
     throw std::runtime_error("AudioEngine: RtAudio is not initialized");
   }
 
   std::vector<RtAudio::DeviceInfo> devices;
-  for (unsigned int i = 0; i < p_rtaudio->getDeviceCount(); i++)
+  for (unsigned int i = 0; i < rtaudio->getDeviceCount(); i++)
   {
-    RtAudio::DeviceInfo info = p_rtaudio->getDeviceInfo(i);
+    RtAudio::DeviceInfo info = rtaudio->getDeviceInfo(i);
     devices.push_back(info);
   }
 
@@ -68,24 +152,89 @@ std::vector<RtAudio::DeviceInfo> AudioEngine::get_devices()
 }
 
 /** @brief Play - External API
+ *  Starts the transport, opening the device stream first if it is not open.
  */
 void AudioEngine::play()
 {
+  m_transport.play();
+
   AudioMessage msg;
   msg.command = eAudioEngineCommand::Play;
   push_message(std::move(msg));
 }
 
 /** @brief Stop - External API
+ *  Stops the transport on the next block. The device stream stays open, so
+ *  the next play() starts without reopening it.
  */
 void AudioEngine::stop()
+{
+  m_transport.stop();
+}
+
+/** @brief Locate - External API
+ *  @param position Timeline position in samples
+ */
+void AudioEngine::locate(const uint64_t position)
+{
+  m_transport.locate(position);
+}
+
+/** @brief Close - External API
+ *  Stops and closes the device stream.
+ */
+void AudioEngine::close()
 {
   AudioMessage msg;
-  msg.command = eAudioEngineCommand::Stop;
+  msg.command = eAudioEngineCommand::Close;
   push_message(std::move(msg));
 }
 
+/** @brief Render one block through the audio callback without a device stream.
+ *  Used for offline rendering and to check the render cycle in tests.
+ *  @param output_buffer Pointer to an interleaved buffer of n_frames * channels samples
+ *  @param n_frames Number of frames to render
+ */
+void AudioEngine::render(float *output_buffer, unsigned int n_frames)
+{
+  const unsigned int channels = m_channels.load(std::memory_order_relaxed);
+  const unsigned int sample_rate = m_sample_rate.load(std::memory_order_relaxed);
+  const unsigned int buffer_frames = m_buffer_frames.load(std::memory_order_relaxed);
+  if (m_output_bus.get_channels() != channels || m_output_bus.get_frames() != buffer_frames ||
+      m_stream_sample_rate != sample_rate)
+  {
+    prepare_stream(channels, sample_rate, buffer_frames);
+  }
+
+  RealtimeScope realtime_scope;
+  DenormalScope denormal_scope;
+  process_audio(output_buffer, n_frames);
+}
+
+/** @brief Set the renderer that fills the master bus - External API
+ *  The renderer is prepared for the current stream before it is used. When
+ *  replacing a renderer this waits until the audio thread has finished with the
+ *  old one, so it can be destroyed as soon as this returns.
+ *  @param renderer The renderer, or nullptr to play the test tone
+ */
+void AudioEngine::set_renderer(IAudioRenderer *renderer)
+{
+  std::lock_guard<std::mutex> lock(m_renderer_mutex);
+
+  if (renderer && m_stream_sample_rate > 0)
+  {
+    renderer->prepare(m_output_bus.get_channels(), m_stream_sample_rate, m_output_bus.get_frames(), &m_buffer_pool);
+  }
+
+  p_renderer.store(renderer, std::memory_order_seq_cst);
+  while (m_rendering.load(std::memory_order_seq_cst))
+  {
+    std::this_thread::yield();
+  }
+}
+
 /** @brief Set Audio Output Device - External API
+ *  A running stream moves to the device without stopping the transport.
  *  - Audio Output Device ID
  */
 void AudioEngine::set_output_device(const unsigned int device_id)
@@ -97,6 +246,7 @@ void AudioEngine::set_output_device(const unsigned int device_id)
 }
 
 /** @brief Set Stream Parameters - External API
+ *  A running stream is reopened with the parameters without stopping the transport.
  *  - Channels
  *  - Sample Rate
  *  - Buffer Frames
@@ -111,6 +261,20 @@ void AudioEngine::set_stream_parameters(const unsigned int channels,
   push_message(std::move(msg));
 }
 
+/** @brief Adapt the buffer size to the callback load - External API
+ *  While enabled the buffer size steps down while there is headroom and back
+ *  up after underruns, swapping the stream live each time.
+ *  @param enabled Whether the controller runs
+ *  @param config Limits and thresholds of the controller
+ */
+void AudioEngine::set_adaptive_buffer_size(const bool enabled, const BufferSizeControllerConfig &config)
+{
+  AudioMessage msg;
+  msg.command = eAudioEngineCommand::SetAdaptiveBuffer;
+  msg.payload = AdaptiveBufferPayload{enabled, config};
+  push_message(std::move(msg));
+}
+
 /** @brief Run the audio engine
  */
 void AudioEngine::run()
@@ -123,19 +287,10 @@ void AudioEngine::run()
   }
 
   // Ensure stream is closed on shutdown
-  if (p_rtaudio)
+  deactivate_stream();
+  for (auto &stream : m_streams)
   {
-    try
-    {
-      if (p_rtaudio->isStreamRunning())
-        p_rtaudio->stopStream();
-      if (p_rtaudio->isStreamOpen())
-        p_rtaudio->closeStream();
-    }
-    catch (std::exception &e)
-    {
-      LOG_ERROR("AudioEngine: Failed to stop and close stream: ", e.what());
-    }
+    close_stream(stream);
   }
 }
 
@@ -159,9 +314,10 @@ void AudioEngine::handle_messages()
           state = eAudioEngineState::Start;
         }
         break;
-      case eAudioEngineCommand::Stop:
-        LOG_INFO("AudioEngine: Received Command - Stop");
-        if (state == eAudioEngineState::Running || state == eAudioEngineState::Start)
+      case eAudioEngineCommand::Close:
+        LOG_INFO("AudioEngine: Received Command - Close");
+        if (state == eAudioEngineState::Running || state == eAudioEngineState::Start ||
+            state == eAudioEngineState::Reconfigure)
         {
           LOG_INFO("AudioEngine: Change state to Stopped");
           state = eAudioEngineState::Stopped;
@@ -172,6 +328,10 @@ void AudioEngine::handle_messages()
           LOG_INFO("AudioEngine: Received Command - SetDevice");
           auto &payload = std::get<SetDevicePayload>(message->payload);
           m_device_id.store(payload.device_id, std::memory_order_relaxed);
+
+          // An open stream is swapped to the new device
+          if (state == eAudioEngineState::Running)
+            state = eAudioEngineState::Reconfigure;
         }
         break;
       case eAudioEngineCommand::SetParams:
@@ -181,6 +341,25 @@ void AudioEngine::handle_messages()
           m_channels.store(payload.channels, std::memory_order_relaxed);
           m_sample_rate.store(payload.sample_rate, std::memory_order_relaxed);
           m_buffer_frames.store(payload.buffer_frames, std::memory_order_relaxed);
+
+          if (state == eAudioEngineState::Running)
+            state = eAudioEngineState::Reconfigure;
+        }
+        break;
+      case eAudioEngineCommand::SetAdaptiveBuffer:
+        {
+          LOG_INFO("AudioEngine: Received Command - SetAdaptiveBuffer");
+          auto &payload = std::get<AdaptiveBufferPayload>(message->payload);
+          if (payload.enabled)
+          {
+            m_buffer_controller.emplace(payload.config);
+            m_controller_updated = std::chrono::steady_clock::now();
+            take_load_window();
+          }
+          else
+          {
+            m_buffer_controller.reset();
+          }
         }
         break;
       default:
@@ -214,6 +393,9 @@ void AudioEngine::update_state()
     case eAudioEngineState::Running:
       update_state_running();
       break;
+    case eAudioEngineState::Reconfigure:
+      update_state_reconfigure();
+      break;
     default:
       throw std::runtime_error("Unknown Audio Engine state");
   }
@@ -223,22 +405,10 @@ void AudioEngine::update_state()
  */
 void AudioEngine::update_state_start()
 {
-  if (!p_rtaudio)
-    return;
-  
-  try
+  deactivate_stream();
+  for (auto &stream : m_streams)
   {
-    if (p_rtaudio->isStreamRunning())
-      p_rtaudio->stopStream();
-  
-    if (p_rtaudio->isStreamOpen())
-      p_rtaudio->closeStream();
-  }
-  catch (const std::exception &e)
-  {
-    LOG_ERROR("AudioEngine: Failed to stop and close stream: ", e.what());
-    m_state.store(eAudioEngineState::Idle, std::memory_order_release);
-    return;
+    close_stream(stream);
   }
 
   try
@@ -249,13 +419,23 @@ void AudioEngine::update_state_start()
     unsigned int buffer_frames = m_buffer_frames.load(std::memory_order_relaxed);
 
     LOG_INFO("AudioEngine: Open stream on device: ", device_id, ", with channels: ", channels, ", sample rate: ", sample_rate, ", buffer frames: ", buffer_frames);
-    RtAudio::StreamParameters params{device_id, channels, 0};
 
-    p_rtaudio->openStream(&params, nullptr, RTAUDIO_FLOAT32, sample_rate, &buffer_frames, &audio_callback, this);
+    Stream &stream = m_streams[m_stream_index];
+    if (!open_stream(stream, device_id, channels, sample_rate, buffer_frames))
+    {
+      throw std::runtime_error("Could not open device " + std::to_string(device_id));
+    }
     m_buffer_frames.store(buffer_frames, std::memory_order_relaxed);
 
+    prepare_stream(channels, sample_rate, buffer_frames);
+    m_stream_device_id = device_id;
+
+    m_fade_gain = 1.0f;
+    m_swap_phase.store(eSwapPhase::Normal, std::memory_order_release);
+    p_active_stream.store(&stream, std::memory_order_seq_cst);
+
     LOG_INFO("AudioEngine: Start stream...");
-    p_rtaudio->startStream();
+    stream.rtaudio->startStream();
 
     LOG_INFO("AudioEngine: Playing audio... Change state to Running.");
     m_state.store(eAudioEngineState::Running, std::memory_order_release);
@@ -263,6 +443,7 @@ void AudioEngine::update_state_start()
   catch (const std::exception &e)
   {
     LOG_ERROR("AudioEngine: Failed to open and start stream: ", e.what());
+    deactivate_stream();
     m_state.store(eAudioEngineState::Idle, std::memory_order_release);
   }
 }
@@ -271,70 +452,456 @@ void AudioEngine::update_state_start()
  */
 void AudioEngine::update_state_running()
 {
-  if (!p_rtaudio->isStreamRunning())
+  if (!m_streams[m_stream_index].rtaudio->isStreamRunning())
   {
     LOG_INFO("AudioEngine: Finished playing audio... Change state to Stopped.");
     m_state.store(eAudioEngineState::Stopped, std::memory_order_release);
+    return;
   }
+
+  update_buffer_size_controller();
+}
+
+/** @brief Let the adaptive controller look at the load once per kControllerPeriod,
+ *  and reconfigure the stream when it picks another buffer size.
+ */
+void AudioEngine::update_buffer_size_controller()
+{
+  if (!m_buffer_controller)
+    return;
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - m_controller_updated < kControllerPeriod)
+    return;
+  m_controller_updated = now;
+
+  const AudioLoadStatistics window = take_load_window();
+  const unsigned int buffer_frames = m_output_bus.get_frames();
+  const unsigned int next_frames = m_buffer_controller->update(window, buffer_frames, now);
+  if (next_frames == buffer_frames)
+    return;
+
+  LOG_INFO("AudioEngine: Adaptive buffer size ", buffer_frames, " -> ", next_frames,
+           ", peak load: ", window.peak_load, ", xruns: ", window.xruns);
+
+  m_buffer_frames.store(next_frames, std::memory_order_relaxed);
+  m_state.store(eAudioEngineState::Reconfigure, std::memory_order_release);
+}
+
+/** @brief Take the load statistics gathered since the previous call.
+ */
+AudioLoadStatistics AudioEngine::take_load_window()
+{
+  AudioLoadStatistics window;
+
+  window.callbacks = m_window_callbacks.exchange(0, std::memory_order_relaxed);
+  window.xruns = m_window_xruns.exchange(0, std::memory_order_relaxed);
+  window.peak_load = m_window_peak_load.exchange(0.0f, std::memory_order_relaxed);
+  const float load_sum = m_window_load_sum.exchange(0.0f, std::memory_order_relaxed);
+  window.average_load = window.callbacks > 0 ? load_sum / static_cast<float>(window.callbacks) : 0.0f;
+
+  return window;
 }
 
 /** @brief Update State - Stopped
  */
 void AudioEngine::update_state_stopped()
 {
-  if (!p_rtaudio || !p_rtaudio->isStreamOpen())
+  deactivate_stream();
+  for (auto &stream : m_streams)
+  {
+    close_stream(stream);
+  }
+
+  m_tracks_playing.store(0, std::memory_order_relaxed);
+
+  LOG_INFO("AudioEngine: Stopped playing audio... Change state to Idle.");
+  m_state.store(eAudioEngineState::Idle, std::memory_order_release);
+}
+
+/** @brief Update State - Reconfigure
+ *  Moves a running stream to the requested device and parameters while the
+ *  transport keeps its position. The output fades out and the transport holds
+ *  still. Where the backend allows it, the new stream is opened on the second
+ *  RtAudio instance before the old one closes. Otherwise the old stream is
+ *  closed first. The output then fades back in on the new stream. The silent
+ *  gap between the two fades is measured by the audio thread.
+ */
+void AudioEngine::update_state_reconfigure()
+{
+  const unsigned int device_id = m_device_id.load(std::memory_order_relaxed);
+  const unsigned int channels = m_channels.load(std::memory_order_relaxed);
+  const unsigned int sample_rate = m_sample_rate.load(std::memory_order_relaxed);
+  unsigned int buffer_frames = m_buffer_frames.load(std::memory_order_relaxed);
+
+  if (device_id == m_stream_device_id && channels == m_output_bus.get_channels() &&
+      sample_rate == m_stream_sample_rate && buffer_frames == m_output_bus.get_frames())
+  {
+    m_state.store(eAudioEngineState::Running, std::memory_order_release);
     return;
+  }
+
+  LOG_INFO("AudioEngine: Reconfigure stream on device: ", device_id, ", with channels: ", channels, ", sample rate: ", sample_rate, ", buffer frames: ", buffer_frames);
+
+  fade_out();
+
+  Stream &current = m_streams[m_stream_index];
+  Stream &next = m_streams[1 - m_stream_index];
 
+  bool parallel = false;
   try
   {
-    if (p_rtaudio->isStreamRunning())
-      p_rtaudio->stopStream();
-    p_rtaudio->closeStream();
+    parallel = open_stream(next, device_id, channels, sample_rate, buffer_frames);
+  }
+  catch (const std::exception &e)
+  {
+    LOG_INFO("AudioEngine: Could not open a second stream: ", e.what());
+  }
+
+  deactivate_stream();
+
+  try
+  {
+    if (!parallel)
+    {
+      LOG_INFO("AudioEngine: Backend cannot run two streams, closing the old stream first");
+      close_stream(current);
+      buffer_frames = m_buffer_frames.load(std::memory_order_relaxed);
+      if (!open_stream(next, device_id, channels, sample_rate, buffer_frames))
+      {
+        throw std::runtime_error("Could not open device " + std::to_string(device_id));
+      }
+    }
+    m_buffer_frames.store(buffer_frames, std::memory_order_relaxed);
+
+    prepare_stream(channels, sample_rate, buffer_frames);
+    m_stream_device_id = device_id;
+    m_stream_index = 1 - m_stream_index;
+
+    m_fade_gain = 0.0f;
+    m_fade_step = 1.0f / std::max(1.0f, static_cast<float>(kSwapFadeSeconds * sample_rate));
+    m_swap_phase.store(eSwapPhase::FadingIn, std::memory_order_release);
+    p_active_stream.store(&next, std::memory_order_seq_cst);
+    next.rtaudio->startStream();
+
+    close_stream(current);
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("AudioEngine: Failed to reconfigure stream: ", e.what());
+    deactivate_stream();
+    close_stream(current);
+    close_stream(next);
+    m_swap_phase.store(eSwapPhase::Normal, std::memory_order_release);
+    m_state.store(eAudioEngineState::Idle, std::memory_order_release);
+    return;
+  }
+
+  m_swaps.fetch_add(1, std::memory_order_relaxed);
+  if (parallel)
+    m_parallel_swaps.fetch_add(1, std::memory_order_relaxed);
+
+  // Load measured at the old size says nothing about the new one
+  take_load_window();
+  m_controller_updated = std::chrono::steady_clock::now();
+
+  m_state.store(eAudioEngineState::Running, std::memory_order_release);
+
+  // Report once the fade in has finished and the gap is measured
+  const auto deadline = std::chrono::steady_clock::now() + kSwapTimeout;
+  while (m_swap_phase.load(std::memory_order_acquire) == eSwapPhase::FadingIn &&
+         std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+
+  LOG_INFO("AudioEngine: Stream reconfigured", parallel ? " in parallel" : " in place",
+           ", dropout: ", get_swap_statistics().last_dropout_ms, " ms");
+}
+
+/** @brief Open an output stream on one of the RtAudio instances, without starting it.
+ *  @param buffer_frames Requested block size, updated to the size the backend chose
+ *  @return True if the stream is open
+ */
+bool AudioEngine::open_stream(Stream &stream, const unsigned int device_id, const unsigned int channels,
+                              const unsigned int sample_rate, unsigned int &buffer_frames)
+{
+  close_stream(stream);
+
+  stream.channels = channels;
+  RtAudio::StreamParameters params{device_id, channels, 0};
+
+  RtAudio::StreamOptions options;
+  const ThreadConfig thread_config = m_audio_thread_config.load();
+  if (thread_config.policy != eSchedulingPolicy::Normal)
+  {
+    options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+    options.priority = thread_config.priority;
+  }
+
+  if (stream.rtaudio->openStream(&params, nullptr, RTAUDIO_FLOAT32, sample_rate, &buffer_frames,
+                                 &audio_callback, &stream, &options) != RTAUDIO_NO_ERROR)
+  {
+    return false;
+  }
+
+  return stream.rtaudio->isStreamOpen();
+}
+
+/** @brief Stop and close a stream if it is open.
+ */
+void AudioEngine::close_stream(Stream &stream)
+{
+  if (!stream.rtaudio)
+    return;
+
+  try
+  {
+    if (stream.rtaudio->isStreamRunning())
+      stream.rtaudio->stopStream();
+    if (stream.rtaudio->isStreamOpen())
+      stream.rtaudio->closeStream();
   }
   catch (const std::exception &e)
   {
     LOG_ERROR("AudioEngine: Failed to stop and close stream: ", e.what());
   }
+}
 
-  m_tracks_playing.store(0, std::memory_order_relaxed);
+/** @brief Stop every stream from rendering, and wait for a callback that is still rendering.
+ *  Afterwards the stream configuration can change while streams keep running.
+ */
+void AudioEngine::deactivate_stream()
+{
+  p_active_stream.store(nullptr, std::memory_order_seq_cst);
+  while (m_callbacks_inside.load(std::memory_order_seq_cst) > 0)
+  {
+    std::this_thread::yield();
+  }
+}
 
-  LOG_INFO("AudioEngine: Stopped playing audio... Change state to Idle.");
-  m_state.store(eAudioEngineState::Idle, std::memory_order_release);
+/** @brief Fade the active stream to silence and hold the transport.
+ *  Gives up waiting after kSwapTimeout, for a stream that no longer calls back.
+ */
+void AudioEngine::fade_out()
+{
+  const auto deadline = std::chrono::steady_clock::now() + kSwapTimeout;
+
+  m_fade_step = 1.0f / std::max(1.0f, static_cast<float>(kSwapFadeSeconds * m_stream_sample_rate));
+  m_swap_phase.store(eSwapPhase::FadingOut, std::memory_order_release);
+
+  while (m_swap_phase.load(std::memory_order_acquire) != eSwapPhase::Muted)
+  {
+    if (std::chrono::steady_clock::now() >= deadline)
+    {
+      LOG_INFO("AudioEngine: Stream did not finish fading out, swapping anyway");
+      deactivate_stream();
+      m_muted_at_ns.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+      m_swap_phase.store(eSwapPhase::Muted, std::memory_order_release);
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+}
+
+/** @brief Allocate the planar buses and select the channel kernels for a stream.
+ *  Must not be called while the audio callback can run.
+ *  @param channels Number of output channels
+ *  @param sample_rate Stream sample rate
+ *  @param buffer_frames Maximum number of frames per block
+ */
+void AudioEngine::prepare_stream(const unsigned int channels, const unsigned int sample_rate,
+                                 const unsigned int buffer_frames)
+{
+  std::lock_guard<std::mutex> lock(m_renderer_mutex);
+
+  m_output_bus.resize(channels, buffer_frames);
+  p_kernels = &Kernels::select_kernels(channels);
+  m_stream_sample_rate = sample_rate;
+  m_transport.prepare(static_cast<double>(sample_rate));
+
+  if (IAudioRenderer *renderer = p_renderer.load(std::memory_order_acquire))
+  {
+    renderer->prepare(channels, sample_rate, buffer_frames, &m_buffer_pool);
+  }
 }
 
 /** @brief Process audio for the current tracks in the Track Manager
- *  @param output_buffer Pointer to the output audio buffer
+ *  Audio is rendered into the planar output bus and interleaved into the
+ *  device buffer once per chunk.
+ *  @param output_buffer Pointer to the interleaved output audio buffer
  *  @param n_frames Number of frames to process
  */
 void AudioEngine::process_audio(float *output_buffer, unsigned int n_frames)
 {
-  unsigned int channels = m_channels.load(std::memory_order_acquire);
-  size_t count = static_cast<size_t>(n_frames) * channels;
+  const unsigned int channels = m_output_bus.get_channels();
+  const unsigned int bus_frames = m_output_bus.get_frames();
+  if (channels == 0 || bus_frames == 0)
+    return;
+
+  // The device may ask for more frames than the bus holds, and the transport
+  // splits chunks where it starts, stops, locates or loops
+  unsigned int offset = 0;
+  while (offset < n_frames)
+  {
+    const unsigned int chunk = m_transport.begin_chunk(std::min(n_frames - offset, bus_frames));
+
+    render_bus(chunk);
+    p_kernels->interleave(m_output_bus.get_channel_pointers(), output_buffer + static_cast<size_t>(offset) * channels,
+                          channels, chunk);
+
+    m_transport.advance(chunk);
+    offset += chunk;
+  }
+  m_transport.publish();
+
+  apply_swap_fade(output_buffer, n_frames, channels);
+
+#ifndef NDEBUG
+  // Should stay at zero while denormals are flushed
+  const size_t denormals = count_denormals(output_buffer, static_cast<size_t>(n_frames) * channels);
+  if (denormals > 0)
+    m_denormals.fetch_add(static_cast<unsigned int>(denormals), std::memory_order_relaxed);
+#endif
+
+  // Update statistics
+  m_tracks_playing.store(1, std::memory_order_relaxed);
+  m_total_frames_processed.fetch_add(n_frames, std::memory_order_relaxed);
+}
+
+/** @brief Ramp the device buffer around a stream swap. Audio thread only.
+ *  The last block of a fade out marks the stream muted, after which the callback
+ *  outputs silence without advancing the transport until the fade in starts.
+ */
+void AudioEngine::apply_swap_fade(float *output_buffer, const unsigned int n_frames,
+                                  const unsigned int channels) noexcept
+{
+  const eSwapPhase phase = m_swap_phase.load(std::memory_order_acquire);
+  if (phase != eSwapPhase::FadingOut && phase != eSwapPhase::FadingIn)
+    return;
+
+  const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+
+  if (phase == eSwapPhase::FadingIn && m_fade_gain == 0.0f)
+  {
+    const int64_t dropout = now - m_muted_at_ns.load(std::memory_order_relaxed);
+    m_last_dropout_ns.store(dropout, std::memory_order_relaxed);
+    if (dropout > m_max_dropout_ns.load(std::memory_order_relaxed))
+      m_max_dropout_ns.store(dropout, std::memory_order_relaxed);
+  }
+
+  const float step = phase == eSwapPhase::FadingOut ? -m_fade_step : m_fade_step;
+  float gain = m_fade_gain;
+  for (unsigned int frame = 0; frame < n_frames; ++frame)
+  {
+    gain = std::clamp(gain + step, 0.0f, 1.0f);
+    float *samples = output_buffer + static_cast<size_t>(frame) * channels;
+    for (unsigned int ch = 0; ch < channels; ++ch)
+      samples[ch] *= gain;
+  }
+  m_fade_gain = gain;
+
+  if (phase == eSwapPhase::FadingOut && gain == 0.0f)
+  {
+    m_muted_at_ns.store(now, std::memory_order_relaxed);
+    m_swap_phase.store(eSwapPhase::Muted, std::memory_order_release);
+  }
+  else if (phase == eSwapPhase::FadingIn && gain == 1.0f)
+  {
+    m_swap_phase.store(eSwapPhase::Normal, std::memory_order_release);
+  }
+}
+
+/** @brief Apply the audio thread config on the calling callback thread if it changed
+ *  since this thread last applied it. Costs one compare on other callbacks.
+ */
+void AudioEngine::apply_audio_thread_config(Stream &stream) noexcept
+{
+  static thread_local uint64_t t_applied_version = 0;
+
+  const uint64_t version = m_audio_thread_config.get_version();
+  if (version == t_applied_version)
+    return;
+  t_applied_version = version;
+
+  stream.thread_report.store(apply_thread_config(m_audio_thread_config.load()));
+}
+
+/** @brief Add one callback to the load window. Audio thread only.
+ *  @param n_frames Frames the callback produced
+ *  @param elapsed Time spent producing them
+ *  @param status Stream status passed to the callback
+ */
+void AudioEngine::record_load(const unsigned int n_frames, const std::chrono::steady_clock::duration elapsed,
+                              const RtAudioStreamStatus status) noexcept
+{
+  if (status & RTAUDIO_OUTPUT_UNDERFLOW)
+  {
+    m_xruns.fetch_add(1, std::memory_order_relaxed);
+    m_window_xruns.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (n_frames == 0 || m_stream_sample_rate == 0)
+    return;
+
+  const double period_ns = static_cast<double>(n_frames) * 1e9 / static_cast<double>(m_stream_sample_rate);
+  const float load = static_cast<float>(
+    static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / period_ns);
+
+  float peak = m_window_peak_load.load(std::memory_order_relaxed);
+  while (load > peak && !m_window_peak_load.compare_exchange_weak(peak, load, std::memory_order_relaxed))
+  {
+  }
+  m_window_load_sum.fetch_add(load, std::memory_order_relaxed);
+  m_window_callbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+/** @brief Render one chunk into the planar output bus
+ *  Plays a test tone when no renderer is set.
+ *  @param n_frames Number of frames to render, at most the bus size
+ */
+void AudioEngine::render_bus(const unsigned int n_frames)
+{
+  const TransportState &transport = m_transport.get_chunk_state();
+
+  m_rendering.store(true, std::memory_order_seq_cst);
+  if (IAudioRenderer *renderer = p_renderer.load(std::memory_order_seq_cst))
+  {
+    m_output_bus.clear(n_frames);
+    renderer->render(m_output_bus, transport, n_frames);
+    m_rendering.store(false, std::memory_order_release);
+    return;
+  }
+  m_rendering.store(false, std::memory_order_release);
+
+  // The test tone follows the transport
+  if (!transport.playing)
+  {
+    m_output_bus.clear(n_frames);
+    return;
+  }
 
   // Parameters for test tone
   static double phase = 0.0;
   const double frequency = 440.0; // A4
-  const double sampleRate = static_cast<double>(m_sample_rate.load(std::memory_order_relaxed));
+  const double sampleRate = static_cast<double>(m_stream_sample_rate);
   const double phaseIncrement = (2.0 * M_PI * frequency) / sampleRate;
   const float amplitude = 0.2f; // Safe volume
 
+  float *first_channel = m_output_bus.get_channel(0);
   for (unsigned int frame = 0; frame < n_frames; ++frame)
   {
-    float sample = amplitude * std::sin(phase);
+    first_channel[frame] = amplitude * std::sin(phase);
     phase += phaseIncrement;
     if (phase >= 2.0 * M_PI)
       phase -= 2.0 * M_PI;
-
-    // Write the same sample to all channels (interleaved)
-    for (unsigned int ch = 0; ch < channels; ++ch)
-    {
-      output_buffer[frame * channels + ch] = sample;
-    }
   }
 
-  // Update statistics
-  m_tracks_playing.store(1, std::memory_order_relaxed);
-  m_total_frames_processed.fetch_add(n_frames, std::memory_order_relaxed);
+  // Write the same signal to all channels
+  for (unsigned int ch = 1; ch < m_output_bus.get_channels(); ++ch)
+  {
+    std::memcpy(m_output_bus.get_channel(ch), first_channel, n_frames * sizeof(float));
+  }
 }
 
 /** @brief Audio callback function
@@ -343,18 +910,40 @@ void AudioEngine::process_audio(float *output_buffer, unsigned int n_frames)
  *  @param n_frames Number of frames to process
  *  @param stream_time Current stream time
  *  @param status Stream status
- *  @param user_data User data pointer (should be AudioEngine instance)
+ *  @param user_data The Stream the callback belongs to
  *  @return 0 on success, non-zero on error
  */
 int AudioEngine::audio_callback(void *output_buffer, void *input_buffer, unsigned int n_frames,
                                  double stream_time, RtAudioStreamStatus status, void *user_data)
 {
-  AudioEngine *engine = static_cast<AudioEngine*>(user_data);
-  if (!engine)
+  Stream *stream = static_cast<Stream *>(user_data);
+  if (!stream || !stream->engine)
   {
     return 1; // Error code
   }
 
-  engine->process_audio(static_cast<float*>(output_buffer), n_frames);
+  // Outside the realtime scope, the kernel calls only happen once per change
+  stream->engine->apply_audio_thread_config(*stream);
+
+  RealtimeScope realtime_scope;
+  DenormalScope denormal_scope;
+
+  // Only the active stream renders. A stream being swapped in or out, or one
+  // muted for a swap, plays silence and leaves the transport where it is.
+  AudioEngine *engine = stream->engine;
+  engine->m_callbacks_inside.fetch_add(1, std::memory_order_seq_cst);
+  if (engine->p_active_stream.load(std::memory_order_seq_cst) == stream &&
+      engine->m_swap_phase.load(std::memory_order_acquire) != eSwapPhase::Muted)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    engine->process_audio(static_cast<float*>(output_buffer), n_frames);
+    engine->record_load(n_frames, std::chrono::steady_clock::now() - start, status);
+  }
+  else
+  {
+    std::memset(output_buffer, 0, static_cast<size_t>(n_frames) * stream->channels * sizeof(float));
+  }
+  engine->m_callbacks_inside.fetch_sub(1, std::memory_order_release);
+
   return 0;
 }
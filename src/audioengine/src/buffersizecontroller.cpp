@@ -0,0 +1,76 @@
+#include "buffersizecontroller.h"
+
+#include <algorithm>
+
+using namespace Audio;
+
+/** @brief BufferSizeController constructor
+ */
+BufferSizeController::BufferSizeController(const BufferSizeControllerConfig &config):
+  m_config(config)
+{
+  reset();
+}
+
+/** @brief Forget the load history, as after the controller is enabled.
+ */
+void BufferSizeController::reset()
+{
+  m_headroom = false;
+  m_headroom_since = Clock::time_point{};
+  m_failed_frames = 0;
+  m_failed_at = Clock::time_point{};
+}
+
+/** @brief Feed one observation window.
+ *  @param window Load and xruns since the previous update
+ *  @param buffer_frames The buffer size the window ran at
+ *  @param now Time of the update
+ *  @return The buffer size to run at next, buffer_frames to stay
+ */
+unsigned int BufferSizeController::update(const AudioLoadStatistics &window, const unsigned int buffer_frames,
+                                          const Clock::time_point now)
+{
+  const unsigned int min_frames = std::max(1u, m_config.min_frames);
+  const unsigned int max_frames = std::max(min_frames, m_config.max_frames);
+
+  if (m_failed_frames > 0 && now - m_failed_at >= m_config.xrun_penalty)
+    m_failed_frames = 0;
+
+  if (window.xruns > 0 || window.peak_load > m_config.raise_load)
+  {
+    if (window.xruns > 0 && (m_failed_frames == 0 || buffer_frames >= m_failed_frames))
+    {
+      m_failed_frames = buffer_frames;
+      m_failed_at = now;
+    }
+
+    // Never shrink on an xrun, even if the device opened above max_frames
+    m_headroom = false;
+    return std::max(buffer_frames, std::min(max_frames, buffer_frames * 2));
+  }
+
+  if (window.callbacks == 0 || window.peak_load >= m_config.lower_load)
+  {
+    m_headroom = false;
+    return buffer_frames;
+  }
+
+  if (!m_headroom)
+  {
+    m_headroom = true;
+    m_headroom_since = now;
+    return buffer_frames;
+  }
+
+  const unsigned int smaller = std::max(min_frames, buffer_frames / 2);
+  if (smaller == buffer_frames || now - m_headroom_since < m_config.down_hold)
+    return buffer_frames;
+
+  if (m_failed_frames > 0 && smaller <= m_failed_frames)
+    return buffer_frames;
+
+  // Restart the hold at the new size
+  m_headroom = false;
+  return smaller;
+}
@@ -0,0 +1,284 @@
+#include "transport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace Audio;
+
+static constexpr size_t kCommandCapacity = 256;
+
+/** @brief TempoMap constructor
+ *  @param bpm Tempo from the start of the timeline
+ */
+TempoMap::TempoMap(const double bpm)
+{
+  set_tempo(bpm);
+}
+
+/** @brief Replace the map with a single tempo
+ *  @throws std::invalid_argument if the tempo is not positive.
+ */
+void TempoMap::set_tempo(const double bpm)
+{
+  if (!(bpm > 0.0))
+  {
+    throw std::invalid_argument("TempoMap: Tempo must be positive");
+  }
+
+  m_points = {TempoPoint{0.0, bpm}};
+  rebuild();
+}
+
+/** @brief Change tempo at a beat, replacing any change already at that beat
+ *  @throws std::invalid_argument if the tempo is not positive or the beat is negative.
+ */
+void TempoMap::add_tempo_change(const double beat, const double bpm)
+{
+  if (!(bpm > 0.0) || beat < 0.0)
+  {
+    throw std::invalid_argument("TempoMap: Tempo must be positive and beat not negative");
+  }
+
+  auto it = std::lower_bound(m_points.begin(), m_points.end(), beat, [](const TempoPoint &point, const double value)
+  {
+    return point.beat < value;
+  });
+
+  if (it != m_points.end() && it->beat == beat)
+    it->bpm = bpm;
+  else
+    m_points.insert(it, TempoPoint{beat, bpm});
+
+  rebuild();
+}
+
+void TempoMap::rebuild()
+{
+  m_seconds.resize(m_points.size());
+  m_seconds[0] = 0.0;
+  for (size_t i = 1; i < m_points.size(); ++i)
+  {
+    m_seconds[i] = m_seconds[i - 1] + (m_points[i].beat - m_points[i - 1].beat) * 60.0 / m_points[i - 1].bpm;
+  }
+}
+
+double TempoMap::get_tempo_at_beat(const double beat) const noexcept
+{
+  auto it = std::upper_bound(m_points.begin() + 1, m_points.end(), beat, [](const double value, const TempoPoint &point)
+  {
+    return value < point.beat;
+  });
+  return (it - 1)->bpm;
+}
+
+double TempoMap::get_tempo_at_seconds(const double seconds) const noexcept
+{
+  const size_t index = std::upper_bound(m_seconds.begin() + 1, m_seconds.end(), seconds) - m_seconds.begin() - 1;
+  return m_points[index].bpm;
+}
+
+double TempoMap::get_seconds_at_beat(const double beat) const noexcept
+{
+  auto it = std::upper_bound(m_points.begin() + 1, m_points.end(), beat, [](const double value, const TempoPoint &point)
+  {
+    return value < point.beat;
+  });
+  const size_t index = (it - m_points.begin()) - 1;
+  return m_seconds[index] + (beat - m_points[index].beat) * 60.0 / m_points[index].bpm;
+}
+
+double TempoMap::get_beat_at_seconds(const double seconds) const noexcept
+{
+  const size_t index = std::upper_bound(m_seconds.begin() + 1, m_seconds.end(), seconds) - m_seconds.begin() - 1;
+  return m_points[index].beat + (seconds - m_seconds[index]) * m_points[index].bpm / 60.0;
+}
+
+/** @brief Transport constructor
+ */
+Transport::Transport():
+  m_commands(kCommandCapacity),
+  m_dropped(0),
+  m_state{},
+  m_pending_count(0)
+{
+  m_state.tempo = 120.0;
+  m_tempo_map.publish(std::make_unique<TempoMap>());
+  publish();
+}
+
+/** @brief Start playing - External API
+ *  @param at_frame Stream frame to start on, 0 for the next block
+ */
+void Transport::play(const uint64_t at_frame)
+{
+  push(TransportCommand{eTransportCommand::Play, at_frame, 0, 0, false});
+}
+
+/** @brief Stop playing, keeping the position - External API
+ *  @param at_frame Stream frame to stop on, 0 for the next block
+ */
+void Transport::stop(const uint64_t at_frame)
+{
+  push(TransportCommand{eTransportCommand::Stop, at_frame, 0, 0, false});
+}
+
+/** @brief Move the play position - External API
+ *  @param position Timeline position in samples
+ *  @param at_frame Stream frame to jump on, 0 for the next block
+ */
+void Transport::locate(const uint64_t position, const uint64_t at_frame)
+{
+  push(TransportCommand{eTransportCommand::Locate, at_frame, position, 0, false});
+}
+
+/** @brief Set the loop region - External API
+ *  @throws std::invalid_argument if the region is empty.
+ */
+void Transport::set_loop(const uint64_t start, const uint64_t end)
+{
+  if (end <= start)
+  {
+    throw std::invalid_argument("Transport: Loop end must be after loop start");
+  }
+
+  push(TransportCommand{eTransportCommand::SetLoop, 0, start, end, false});
+}
+
+/** @brief Enable or disable looping - External API
+ */
+void Transport::set_looping(const bool looping)
+{
+  push(TransportCommand{eTransportCommand::SetLooping, 0, 0, 0, looping});
+}
+
+/** @brief Replace the tempo map - External API
+ */
+void Transport::set_tempo_map(const TempoMap &tempo_map)
+{
+  m_tempo_map.publish(std::make_unique<TempoMap>(tempo_map));
+}
+
+/** @brief Set the stream sample rate. Never called while the audio callback can run.
+ *  Positions are rescaled when the rate changes, so the playhead and loop keep their time.
+ */
+void Transport::prepare(const double sample_rate)
+{
+  if (m_state.sample_rate > 0.0 && sample_rate > 0.0 && sample_rate != m_state.sample_rate)
+  {
+    const double ratio = sample_rate / m_state.sample_rate;
+    m_state.position = static_cast<uint64_t>(std::llround(static_cast<double>(m_state.position) * ratio));
+    m_state.loop_start = static_cast<uint64_t>(std::llround(static_cast<double>(m_state.loop_start) * ratio));
+    m_state.loop_end = static_cast<uint64_t>(std::llround(static_cast<double>(m_state.loop_end) * ratio));
+  }
+
+  m_state.sample_rate = sample_rate;
+  update_tempo();
+  publish();
+}
+
+/** @brief Apply due commands and size the next chunk. Audio thread only.
+ *  @param max_frames Largest chunk the caller can render
+ *  @return Frames to render before the next command or loop jump, at least 1
+ */
+unsigned int Transport::begin_chunk(const unsigned int max_frames) noexcept
+{
+  while (m_pending_count < kMaxPendingCommands && m_commands.read(&m_pending[m_pending_count], 1) == 1)
+  {
+    ++m_pending_count;
+  }
+
+  // Apply due commands in the order they were queued, keep the rest
+  size_t kept = 0;
+  for (size_t i = 0; i < m_pending_count; ++i)
+  {
+    if (m_pending[i].at_frame <= m_state.stream_frame)
+      apply(m_pending[i]);
+    else
+      m_pending[kept++] = m_pending[i];
+  }
+  m_pending_count = kept;
+
+  uint64_t frames = max_frames;
+  for (size_t i = 0; i < m_pending_count; ++i)
+  {
+    frames = std::min(frames, m_pending[i].at_frame - m_state.stream_frame);
+  }
+
+  if (m_state.playing && m_state.looping && m_state.position < m_state.loop_end)
+  {
+    frames = std::min(frames, m_state.loop_end - m_state.position);
+  }
+
+  update_tempo();
+  return static_cast<unsigned int>(std::max<uint64_t>(frames, 1));
+}
+
+/** @brief Move past a rendered chunk, wrapping at the loop end. Audio thread only.
+ */
+void Transport::advance(const unsigned int n_frames) noexcept
+{
+  m_state.stream_frame += n_frames;
+  if (!m_state.playing)
+    return;
+
+  m_state.position += n_frames;
+  if (m_state.looping && m_state.position == m_state.loop_end)
+  {
+    m_state.position = m_state.loop_start;
+  }
+}
+
+/** @brief Make the state after the current block visible to control threads. Audio thread only.
+ */
+void Transport::publish() noexcept
+{
+  update_tempo();
+  m_published.store(m_state);
+}
+
+void Transport::push(const TransportCommand &command)
+{
+  std::lock_guard<std::mutex> lock(m_command_mutex);
+  if (m_commands.write(&command, 1) != 1)
+  {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Transport::apply(const TransportCommand &command) noexcept
+{
+  switch (command.command)
+  {
+    case eTransportCommand::Play:
+      m_state.playing = true;
+      break;
+    case eTransportCommand::Stop:
+      m_state.playing = false;
+      break;
+    case eTransportCommand::Locate:
+      m_state.position = command.position;
+      break;
+    case eTransportCommand::SetLoop:
+      m_state.loop_start = command.position;
+      m_state.loop_end = command.end;
+      break;
+    case eTransportCommand::SetLooping:
+      m_state.looping = command.enabled;
+      break;
+  }
+}
+
+void Transport::update_tempo() noexcept
+{
+  if (m_state.sample_rate <= 0.0)
+    return;
+
+  auto tempo_map = m_tempo_map.read();
+  if (!tempo_map)
+    return;
+
+  const double seconds = static_cast<double>(m_state.position) / m_state.sample_rate;
+  m_state.tempo = tempo_map->get_tempo_at_seconds(seconds);
+  m_state.beat = tempo_map->get_beat_at_seconds(seconds);
+}
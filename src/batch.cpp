@@ -0,0 +1,96 @@
+#include "batchprocessor.h"
+
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+/** @brief Print the command line usage.
+ */
+void print_usage(const char *program)
+{
+  std::cout << "Usage: " << program << " <input directory> <output directory> [options]\n"
+            << "\n"
+            << "Processes every WAV file in the input directory into the output directory.\n"
+            << "\n"
+            << "Options:\n"
+            << "  --chain <steps>    Comma separated steps, run in order:\n"
+            << "                       gain=<dB>, highpass=<Hz>, lowpass=<Hz>, compressor[=<threshold dB>],\n"
+            << "                       normalize[=<peak dBFS>], resample=<Hz>\n"
+            << "  --format <format>  pcm16, pcm24, float or keep (default keep)\n"
+            << "  --threads <n>      Files processed at once (default: every hardware thread)\n"
+            << "  --block <frames>   Frames read and written at a time (default 4096)\n"
+            << "\n"
+            << "Example: " << program << " raw/ out/ --chain highpass=40,normalize=-1,resample=44100 --format pcm24\n";
+}
+
+/** @brief Batch processing tool for directories of WAV files.
+ *  @return 0 if every file was processed, 1 if any failed, 2 for invalid arguments.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 3)
+  {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  const std::string input = argv[1];
+  const std::string output = argv[2];
+  Batch::BatchOptions options;
+
+  try
+  {
+    for (int i = 3; i < argc; ++i)
+    {
+      const std::string option = argv[i];
+      if (i + 1 >= argc)
+        throw std::invalid_argument("Missing value for " + option);
+
+      const std::string value = argv[++i];
+      if (option == "--chain")
+        options.chain = Batch::parse_chain(value);
+      else if (option == "--format")
+        options.format = Batch::parse_format(value);
+      else if (option == "--threads")
+        options.threads = static_cast<unsigned int>(std::stoul(value));
+      else if (option == "--block")
+        options.block_frames = static_cast<unsigned int>(std::stoul(value));
+      else
+        throw std::invalid_argument("Unknown option: " + option);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << "Error: " << e.what() << "\n\n";
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  Batch::BatchReport report;
+  try
+  {
+    Batch::BatchProcessor processor(options);
+    report = processor.run(input, output);
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 2;
+  }
+
+  for (const auto &file : report.files)
+  {
+    if (!file.succeeded)
+      std::cerr << "Failed: " << file.input.filename().string() << ": " << file.error << std::endl;
+  }
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "Processed " << report.files.size() - report.get_failed_count() << " of " << report.files.size()
+            << " files in " << report.seconds << " s on " << report.threads << " threads: "
+            << report.get_files_per_second() << " files/s, "
+            << report.get_megabytes_per_second() << " MB/s" << std::endl;
+
+  return report.get_failed_count() == 0 ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+#ifndef __BATCH_PROCESSOR_H__
+#define __BATCH_PROCESSOR_H__
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "wavwriter.h"
+
+namespace Batch
+{
+
+/** @enum eBatchOp
+ *  @brief One processing step applied to every file
+ */
+enum class eBatchOp
+{
+  Gain,        // value: gain in dB
+  HighPass,    // value: cutoff in Hz
+  LowPass,     // value: cutoff in Hz
+  Compressor,  // value: threshold in dBFS
+  Normalize,   // value: target peak in dBFS
+  Resample,    // value: output sample rate in Hz
+};
+
+/** @struct BatchStep
+ *  @brief An operation and its argument
+ */
+struct BatchStep
+{
+  eBatchOp op;
+  double value;
+};
+
+/** @struct BatchOptions
+ *  @brief The processing chain and how to run it
+ */
+struct BatchOptions
+{
+  std::vector<BatchStep> chain;
+  std::optional<Files::eWavSampleFormat> format;  // Keeps each file's own format when empty
+  unsigned int threads = 0;                       // 0 uses every hardware thread
+  unsigned int block_frames = 4096;               // Frames read and written at a time
+};
+
+/** @struct BatchFileResult
+ *  @brief The outcome for one file
+ */
+struct BatchFileResult
+{
+  std::filesystem::path input;
+  std::filesystem::path output;
+  bool succeeded = false;
+  std::string error;
+  uint64_t frames_in = 0;
+  uint64_t frames_out = 0;
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+};
+
+/** @struct BatchReport
+ *  @brief Every file's outcome and the overall throughput
+ */
+struct BatchReport
+{
+  std::vector<BatchFileResult> files;
+  unsigned int threads = 0;
+  double seconds = 0.0;
+
+  size_t get_failed_count() const;
+  uint64_t get_bytes_in() const;
+  double get_files_per_second() const;
+  double get_megabytes_per_second() const;
+};
+
+std::vector<BatchStep> parse_chain(const std::string &text);
+std::optional<Files::eWavSampleFormat> parse_format(const std::string &text);
+
+/** @class BatchProcessor
+ *  @brief Runs a processing chain over every WAV file in a directory.
+ *
+ *  Files are shared out between a fixed number of threads, one file per thread
+ *  at a time. Each file is streamed through the chain a block at a time, so
+ *  memory use does not grow with file length. A chain with a normalize step
+ *  reads the file twice: once to find the peak after the steps before it, and
+ *  once to write the output.
+ */
+class BatchProcessor
+{
+public:
+  explicit BatchProcessor(const BatchOptions &options);
+
+  BatchReport run(const std::filesystem::path &input_directory, const std::filesystem::path &output_directory) const;
+  BatchFileResult process_file(const std::filesystem::path &input, const std::filesystem::path &output) const;
+
+  const BatchOptions &get_options() const noexcept { return m_options; }
+
+private:
+  BatchOptions m_options;
+};
+
+}  // namespace Batch
+
+#endif  // __BATCH_PROCESSOR_H__
@@ -0,0 +1,478 @@
+#include "batchprocessor.h"
+
+#include "audiobuffer.h"
+#include "audiokernels.h"
+#include "biquad.h"
+#include "compressor.h"
+#include "denormals.h"
+#include "filemanager.h"
+#include "logger.h"
+#include "resampler.h"
+#include "wavfile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+using namespace Batch;
+
+namespace
+{
+
+static constexpr double kDefaultNormalizeDb = -1.0;
+static constexpr double kDefaultCompressorDb = -18.0;
+
+float db_to_linear(const double db)
+{
+  return static_cast<float>(std::pow(10.0, db / 20.0));
+}
+
+/** @struct Stage
+ *  @brief One step of the chain, prepared for one file
+ */
+struct Stage
+{
+  eBatchOp op;
+  float gain = 1.0f;
+  std::unique_ptr<Dsp::IProcessor> processor;
+  std::unique_ptr<Dsp::Resampler> resampler;
+  AudioBuffer output;
+};
+
+/** @class Pipeline
+ *  @brief The chain prepared for a file's format. Buffers are sized once, so
+ *  streaming a file allocates nothing per block.
+ */
+class Pipeline
+{
+public:
+  Pipeline(const std::vector<BatchStep> &chain, const unsigned int channels, const unsigned int sample_rate,
+           const unsigned int block_frames):
+    m_channels(channels),
+    m_output_rate(sample_rate),
+    m_max_frames(block_frames),
+    m_kernels(Kernels::select_kernels(channels))
+  {
+    for (const BatchStep &step : chain)
+    {
+      Stage stage;
+      stage.op = step.op;
+      const Dsp::ProcessSpec spec{static_cast<double>(m_output_rate), channels, m_max_frames,
+                                  std::pmr::get_default_resource()};
+
+      switch (step.op)
+      {
+        case eBatchOp::Gain:
+          stage.gain = db_to_linear(step.value);
+          break;
+        case eBatchOp::HighPass:
+          stage.processor = std::make_unique<Dsp::Biquad>(Dsp::eBiquadType::HighPass, static_cast<float>(step.value));
+          break;
+        case eBatchOp::LowPass:
+          stage.processor = std::make_unique<Dsp::Biquad>(Dsp::eBiquadType::LowPass, static_cast<float>(step.value));
+          break;
+        case eBatchOp::Compressor:
+        {
+          auto compressor = std::make_unique<Dsp::Compressor>();
+          compressor->set_threshold_db(static_cast<float>(step.value));
+          stage.processor = std::move(compressor);
+          break;
+        }
+        case eBatchOp::Normalize:
+          break;
+        case eBatchOp::Resample:
+        {
+          const unsigned int rate = static_cast<unsigned int>(step.value);
+          stage.resampler = std::make_unique<Dsp::Resampler>();
+          stage.resampler->prepare(channels, m_output_rate, rate, m_max_frames);
+          m_max_frames = stage.resampler->get_max_output_frames(m_max_frames);
+          stage.output = AudioBuffer(channels, m_max_frames);
+          m_output_rate = rate;
+          break;
+        }
+      }
+
+      if (stage.processor)
+        stage.processor->prepare(spec);
+
+      m_stages.push_back(std::move(stage));
+    }
+  }
+
+  unsigned int get_output_rate() const noexcept { return m_output_rate; }
+  unsigned int get_max_frames() const noexcept { return m_max_frames; }
+  size_t size() const noexcept { return m_stages.size(); }
+
+  void set_gain(const size_t stage, const float gain) noexcept { m_stages[stage].gain = gain; }
+
+  /** @brief Run stages [first, last) on a block and hand the result to sink.
+   */
+  template <typename Sink>
+  void run(const size_t first, const size_t last, AudioBuffer *buffer, unsigned int n_frames, Sink &&sink)
+  {
+    for (size_t s = first; s < last && n_frames > 0; ++s)
+    {
+      Stage &stage = m_stages[s];
+      switch (stage.op)
+      {
+        case eBatchOp::Gain:
+        case eBatchOp::Normalize:
+          m_kernels.apply_gain(buffer->get_channel_pointers(), stage.gain, m_channels, n_frames);
+          break;
+        case eBatchOp::Resample:
+          n_frames = stage.resampler->process(*buffer, n_frames, stage.output);
+          buffer = &stage.output;
+          break;
+        default:
+          stage.processor->process(*buffer, n_frames);
+          break;
+      }
+    }
+
+    if (n_frames > 0)
+      sink(*buffer, n_frames);
+  }
+
+  /** @brief Flush the resamplers among stages [0, last) through the stages after them.
+   */
+  template <typename Sink>
+  void finish(const size_t last, Sink &&sink)
+  {
+    for (size_t s = 0; s < last; ++s)
+    {
+      Stage &stage = m_stages[s];
+      if (stage.op != eBatchOp::Resample)
+        continue;
+
+      const unsigned int n_frames = stage.resampler->flush(stage.output);
+      run(s + 1, last, &stage.output, n_frames, sink);
+    }
+  }
+
+  void reset() noexcept
+  {
+    for (Stage &stage : m_stages)
+    {
+      if (stage.processor)
+        stage.processor->reset();
+      if (stage.resampler)
+        stage.resampler->reset();
+    }
+  }
+
+private:
+  unsigned int m_channels;
+  unsigned int m_output_rate;
+  unsigned int m_max_frames;
+  const Kernels::KernelTable &m_kernels;
+  std::vector<Stage> m_stages;
+};
+
+Files::eWavSampleFormat format_of(const Files::WavFile &file)
+{
+  switch (file.get_format() & SF_FORMAT_SUBMASK)
+  {
+    case SF_FORMAT_PCM_S8:
+    case SF_FORMAT_PCM_U8:
+    case SF_FORMAT_PCM_16:
+      return Files::eWavSampleFormat::Pcm16;
+    case SF_FORMAT_PCM_24:
+      return Files::eWavSampleFormat::Pcm24;
+    default:
+      return Files::eWavSampleFormat::Float32;
+  }
+}
+
+std::string trim(const std::string &text)
+{
+  const size_t begin = text.find_first_not_of(" \t");
+  if (begin == std::string::npos)
+    return "";
+  const size_t end = text.find_last_not_of(" \t");
+  return text.substr(begin, end - begin + 1);
+}
+
+}  // namespace
+
+/** @brief Parse a chain such as "highpass=80,gain=-3,resample=44100,normalize=-1".
+ *  Steps run in the order given. normalize and compressor may leave out their value.
+ *  @throws std::invalid_argument for an unknown step, a missing or invalid value,
+ *          or more than one normalize step
+ */
+std::vector<BatchStep> Batch::parse_chain(const std::string &text)
+{
+  std::vector<BatchStep> chain;
+  bool normalized = false;
+
+  size_t begin = 0;
+  while (begin <= text.size())
+  {
+    const size_t end = std::min(text.find(',', begin), text.size());
+    const std::string item = trim(text.substr(begin, end - begin));
+    begin = end + 1;
+    if (item.empty())
+      continue;
+
+    const size_t equals = item.find('=');
+    const std::string name = trim(item.substr(0, equals));
+    const std::string argument = equals == std::string::npos ? "" : trim(item.substr(equals + 1));
+
+    BatchStep step;
+    if (name == "gain")
+      step.op = eBatchOp::Gain;
+    else if (name == "highpass")
+      step.op = eBatchOp::HighPass;
+    else if (name == "lowpass")
+      step.op = eBatchOp::LowPass;
+    else if (name == "compressor")
+      step.op = eBatchOp::Compressor;
+    else if (name == "normalize")
+      step.op = eBatchOp::Normalize;
+    else if (name == "resample")
+      step.op = eBatchOp::Resample;
+    else
+      throw std::invalid_argument("Unknown processing step: " + name);
+
+    if (argument.empty())
+    {
+      if (step.op == eBatchOp::Normalize)
+        step.value = kDefaultNormalizeDb;
+      else if (step.op == eBatchOp::Compressor)
+        step.value = kDefaultCompressorDb;
+      else
+        throw std::invalid_argument("Processing step needs a value: " + name);
+    }
+    else
+    {
+      size_t parsed = 0;
+      try
+      {
+        step.value = std::stod(argument, &parsed);
+      }
+      catch (const std::exception &)
+      {
+        parsed = 0;
+      }
+      if (parsed != argument.size())
+        throw std::invalid_argument("Invalid value for " + name + ": " + argument);
+    }
+
+    if ((step.op == eBatchOp::HighPass || step.op == eBatchOp::LowPass || step.op == eBatchOp::Resample) &&
+        step.value <= 0.0)
+    {
+      throw std::invalid_argument("Value for " + name + " must be positive: " + argument);
+    }
+
+    if (step.op == eBatchOp::Normalize)
+    {
+      if (normalized)
+        throw std::invalid_argument("Only one normalize step is allowed");
+      normalized = true;
+    }
+
+    chain.push_back(step);
+  }
+
+  return chain;
+}
+
+/** @brief Parse an output format: pcm16, pcm24, float, or keep for each file's own format.
+ *  @throws std::invalid_argument for anything else
+ */
+std::optional<Files::eWavSampleFormat> Batch::parse_format(const std::string &text)
+{
+  if (text == "pcm16")
+    return Files::eWavSampleFormat::Pcm16;
+  if (text == "pcm24")
+    return Files::eWavSampleFormat::Pcm24;
+  if (text == "float")
+    return Files::eWavSampleFormat::Float32;
+  if (text == "keep")
+    return std::nullopt;
+
+  throw std::invalid_argument("Unknown output format: " + text);
+}
+
+size_t BatchReport::get_failed_count() const
+{
+  return static_cast<size_t>(std::count_if(files.begin(), files.end(),
+                                           [](const BatchFileResult &file) { return !file.succeeded; }));
+}
+
+uint64_t BatchReport::get_bytes_in() const
+{
+  uint64_t bytes = 0;
+  for (const auto &file : files)
+    bytes += file.bytes_in;
+  return bytes;
+}
+
+double BatchReport::get_files_per_second() const
+{
+  return seconds > 0.0 ? static_cast<double>(files.size()) / seconds : 0.0;
+}
+
+double BatchReport::get_megabytes_per_second() const
+{
+  return seconds > 0.0 ? static_cast<double>(get_bytes_in()) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+/** @brief BatchProcessor constructor
+ *  @throws std::invalid_argument if the block size is zero
+ */
+BatchProcessor::BatchProcessor(const BatchOptions &options):
+  m_options(options)
+{
+  if (m_options.block_frames == 0)
+  {
+    throw std::invalid_argument("BatchProcessor: Block size must be greater than 0");
+  }
+}
+
+/** @brief Process every WAV file in a directory into another directory, under the same names.
+ *  A file that fails is reported and does not stop the others.
+ *  @throws std::invalid_argument if the directories are the same
+ *  @throws std::runtime_error if the input directory does not exist
+ */
+BatchReport BatchProcessor::run(const std::filesystem::path &input_directory,
+                                const std::filesystem::path &output_directory) const
+{
+  auto &file_manager = Files::FileManager::instance();
+  const auto input_path = file_manager.convert_to_absolute(input_directory);
+  const auto output_path = file_manager.convert_to_absolute(output_directory);
+
+  const std::vector<std::filesystem::path> inputs = file_manager.list_wav_files_in_directory(input_path);
+
+  std::filesystem::create_directories(output_path);
+  if (std::filesystem::equivalent(input_path, output_path))
+  {
+    throw std::invalid_argument("BatchProcessor: Output directory must differ from the input directory");
+  }
+
+  BatchReport report;
+  report.files.resize(inputs.size());
+
+  unsigned int threads = m_options.threads > 0 ? m_options.threads : std::thread::hardware_concurrency();
+  threads = std::clamp<unsigned int>(threads, 1, static_cast<unsigned int>(std::max<size_t>(inputs.size(), 1)));
+  report.threads = threads;
+
+  LOG_INFO("BatchProcessor: ", inputs.size(), " files from ", input_path.string(), " on ", threads, " threads");
+
+  const auto started = std::chrono::steady_clock::now();
+
+  std::atomic<size_t> next_file{0};
+  auto work = [&]()
+  {
+    size_t i;
+    while ((i = next_file.fetch_add(1, std::memory_order_relaxed)) < inputs.size())
+    {
+      report.files[i] = process_file(inputs[i], output_path / inputs[i].filename());
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int i = 1; i < threads; ++i)
+  {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  return report;
+}
+
+/** @brief Process one file. Never throws, errors are returned in the result.
+ *  @param input The WAV file to read
+ *  @param output The WAV file to write
+ */
+BatchFileResult BatchProcessor::process_file(const std::filesystem::path &input,
+                                             const std::filesystem::path &output) const
+{
+  BatchFileResult result;
+  result.input = input;
+  result.output = output;
+
+  DenormalScope denormal_scope;
+
+  try
+  {
+    auto file = Files::FileManager::instance().read_wav_file(input);
+    result.bytes_in = std::filesystem::file_size(file->get_filepath());
+
+    const unsigned int channels = file->get_channels();
+    const unsigned int block_frames = m_options.block_frames;
+    Pipeline pipeline(m_options.chain, channels, file->get_sample_rate(), block_frames);
+    AudioBuffer block(channels, block_frames);
+
+    // Measure the peak going into the normalize step, then read the file again
+    const auto normalize = std::find_if(m_options.chain.begin(), m_options.chain.end(),
+                                        [](const BatchStep &step) { return step.op == eBatchOp::Normalize; });
+    if (normalize != m_options.chain.end())
+    {
+      const size_t stage = static_cast<size_t>(normalize - m_options.chain.begin());
+
+      float peak = 0.0f;
+      auto measure = [&](const AudioBuffer &buffer, const unsigned int n_frames)
+      {
+        for (unsigned int ch = 0; ch < channels; ++ch)
+        {
+          float channel_peak = 0.0f;
+          float sum_squares = 0.0f;
+          Kernels::peak_and_energy(buffer.get_channel(ch), n_frames, channel_peak, sum_squares);
+          peak = std::max(peak, channel_peak);
+        }
+      };
+
+      unsigned int frames;
+      while ((frames = file->read(block, block_frames)) > 0)
+      {
+        pipeline.run(0, stage, &block, frames, measure);
+      }
+      pipeline.finish(stage, measure);
+
+      pipeline.set_gain(stage, peak > 0.0f ? db_to_linear(normalize->value) / peak : 1.0f);
+      pipeline.reset();
+      file->seek(0);
+    }
+
+    Files::WavWriter writer(output, channels, pipeline.get_output_rate(),
+                            m_options.format.value_or(format_of(*file)));
+    std::vector<float> interleaved(static_cast<size_t>(pipeline.get_max_frames()) * channels);
+    const Kernels::KernelTable &kernels = Kernels::select_kernels(channels);
+
+    auto write = [&](const AudioBuffer &buffer, const unsigned int n_frames)
+    {
+      kernels.interleave(buffer.get_channel_pointers(), interleaved.data(), channels, n_frames);
+      writer.write(interleaved.data(), n_frames);
+    };
+
+    unsigned int frames;
+    while ((frames = file->read(block, block_frames)) > 0)
+    {
+      result.frames_in += frames;
+      pipeline.run(0, pipeline.size(), &block, frames, write);
+    }
+    pipeline.finish(pipeline.size(), write);
+
+    result.frames_out = static_cast<uint64_t>(writer.get_frames_written());
+    writer.close();
+
+    result.bytes_out = std::filesystem::file_size(output);
+    result.succeeded = true;
+  }
+  catch (const std::exception &e)
+  {
+    result.error = e.what();
+    LOG_ERROR("BatchProcessor: ", input.string(), ": ", e.what());
+  }
+
+  return result;
+}
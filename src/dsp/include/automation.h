@@ -0,0 +1,49 @@
+#ifndef __AUTOMATION_H__
+#define __AUTOMATION_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Dsp
+{
+
+/** @struct AutomationPoint
+ *  @brief A breakpoint, in samples from the start of the timeline
+ */
+struct AutomationPoint
+{
+  uint64_t position;
+  float value;
+};
+
+/** @class AutomationLane
+ *  @brief Breakpoint envelope with linear segments.
+ *
+ *  A lane is built on a control thread and not modified once it is handed to
+ *  the ParameterStore. Playback evaluates it with a cursor that only moves
+ *  forward while time does, so each block costs O(1) instead of a search.
+ */
+class AutomationLane
+{
+public:
+  AutomationLane() = default;
+  explicit AutomationLane(std::vector<AutomationPoint> points);
+
+  void add_point(const uint64_t position, const float value);
+  void clear() noexcept { m_points.clear(); }
+
+  const std::vector<AutomationPoint> &get_points() const noexcept { return m_points; }
+  size_t size() const noexcept { return m_points.size(); }
+  bool empty() const noexcept { return m_points.empty(); }
+
+  float value_at(const uint64_t position) const noexcept;
+  float value_at(const uint64_t position, size_t &cursor) const noexcept;
+
+private:
+  std::vector<AutomationPoint> m_points;
+};
+
+}  // namespace Dsp
+
+#endif  // __AUTOMATION_H__
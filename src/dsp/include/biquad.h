@@ -0,0 +1,89 @@
+#ifndef __BIQUAD_H__
+#define __BIQUAD_H__
+
+#include <atomic>
+
+#include "processor.h"
+
+namespace Dsp
+{
+
+/** @enum eBiquadType
+ *  @brief Filter responses supported by Biquad
+ */
+enum class eBiquadType
+{
+  LowPass,
+  HighPass,
+  BandPass,
+  Notch,
+  Peak,
+  LowShelf,
+  HighShelf,
+};
+
+/** @struct BiquadCoefficients
+ *  @brief Normalized coefficients, a0 == 1
+ */
+struct BiquadCoefficients
+{
+  float b0;
+  float b1;
+  float b2;
+  float a1;
+  float a2;
+};
+
+BiquadCoefficients make_biquad_coefficients(const eBiquadType type, const double sample_rate,
+                                            const double frequency, const double q, const double gain_db);
+
+/** @class Biquad
+ *  @brief Second-order IIR filter for EQ, transposed direct form II.
+ *
+ *  Coefficients are recomputed on the audio thread only when a parameter has
+ *  changed since the last block. Filter state is stored as one contiguous
+ *  array per delay element, indexed by channel, in memory from the spec's
+ *  resource.
+ */
+class Biquad : public IProcessor
+{
+public:
+  Biquad(const eBiquadType type = eBiquadType::Peak, const float frequency = 1000.0f,
+         const float q = 0.707f, const float gain_db = 0.0f);
+
+  void set_type(const eBiquadType type) noexcept;
+  void set_frequency(const float frequency) noexcept;
+  void set_q(const float q) noexcept;
+  void set_gain_db(const float gain_db) noexcept;
+
+  eBiquadType get_type() const noexcept { return m_type.load(std::memory_order_relaxed); }
+  float get_frequency() const noexcept { return m_frequency.load(std::memory_order_relaxed); }
+  float get_q() const noexcept { return m_q.load(std::memory_order_relaxed); }
+  float get_gain_db() const noexcept { return m_gain_db.load(std::memory_order_relaxed); }
+
+  unsigned int get_tail_frames() const noexcept override;
+
+  void reset() noexcept override;
+
+protected:
+  void do_prepare(const ProcessSpec &spec) override;
+  void do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept override;
+
+private:
+  void update_coefficients() noexcept;
+
+  std::atomic<eBiquadType> m_type;
+  std::atomic<float> m_frequency;
+  std::atomic<float> m_q;
+  std::atomic<float> m_gain_db;
+  std::atomic<unsigned int> m_version;
+
+  // Audio thread state
+  unsigned int m_applied_version;
+  BiquadCoefficients m_coefficients;
+  AudioBuffer m_state;  // Channel 0 holds z1 and channel 1 holds z2 for every audio channel
+};
+
+}  // namespace Dsp
+
+#endif  // __BIQUAD_H__
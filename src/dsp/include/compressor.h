@@ -0,0 +1,62 @@
+#ifndef __COMPRESSOR_H__
+#define __COMPRESSOR_H__
+
+#include <atomic>
+
+#include "processor.h"
+
+namespace Dsp
+{
+
+/** @class Compressor
+ *  @brief Feed-forward peak compressor with a stereo-linked detector.
+ *
+ *  The detector runs once per frame across all channels and writes a gain
+ *  curve into a scratch array. The curve is then applied to each channel in a
+ *  separate loop that vectorizes.
+ */
+class Compressor : public IProcessor
+{
+public:
+  Compressor();
+
+  void set_threshold_db(const float threshold_db) noexcept { m_threshold_db.store(threshold_db, std::memory_order_relaxed); }
+  void set_ratio(const float ratio) noexcept { m_ratio.store(ratio, std::memory_order_relaxed); }
+  void set_attack_ms(const float attack_ms) noexcept { m_attack_ms.store(attack_ms, std::memory_order_relaxed); }
+  void set_release_ms(const float release_ms) noexcept { m_release_ms.store(release_ms, std::memory_order_relaxed); }
+  void set_makeup_db(const float makeup_db) noexcept { m_makeup_db.store(makeup_db, std::memory_order_relaxed); }
+
+  float get_threshold_db() const noexcept { return m_threshold_db.load(std::memory_order_relaxed); }
+  float get_ratio() const noexcept { return m_ratio.load(std::memory_order_relaxed); }
+  float get_attack_ms() const noexcept { return m_attack_ms.load(std::memory_order_relaxed); }
+  float get_release_ms() const noexcept { return m_release_ms.load(std::memory_order_relaxed); }
+  float get_makeup_db() const noexcept { return m_makeup_db.load(std::memory_order_relaxed); }
+
+  /** @brief Largest gain reduction in the last block, in dB (<= 0)
+   */
+  float get_gain_reduction_db() const noexcept { return m_gain_reduction_db.load(std::memory_order_relaxed); }
+
+  unsigned int get_tail_frames() const noexcept override { return 0; }
+
+  void reset() noexcept override;
+
+protected:
+  void do_prepare(const ProcessSpec &spec) override;
+  void do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept override;
+
+private:
+  std::atomic<float> m_threshold_db;
+  std::atomic<float> m_ratio;
+  std::atomic<float> m_attack_ms;
+  std::atomic<float> m_release_ms;
+  std::atomic<float> m_makeup_db;
+  std::atomic<float> m_gain_reduction_db;
+
+  // Audio thread state
+  float m_envelope_db;
+  AudioBuffer m_gain_curve;
+};
+
+}  // namespace Dsp
+
+#endif  // __COMPRESSOR_H__
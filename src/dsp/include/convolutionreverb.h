@@ -0,0 +1,73 @@
+#ifndef __CONVOLUTION_REVERB_H__
+#define __CONVOLUTION_REVERB_H__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "processor.h"
+#include "convolver.h"
+#include "snapshot.h"
+
+namespace Dsp
+{
+
+/** @class ConvolutionReverb
+ *  @brief Convolution reverb built on partitioned FFT convolution.
+ *
+ *  Each audio channel is convolved with impulse response channel
+ *  (channel % impulse channels). The partition size is the prepared block size
+ *  rounded up to a power of two, so each block runs at most one partition per
+ *  channel. Loading a new impulse response builds new convolvers off the audio
+ *  thread and swaps them in at the next block.
+ *
+ *  Defaults to fully wet, for use on a send bus.
+ */
+class ConvolutionReverb : public IProcessor
+{
+public:
+  ConvolutionReverb();
+
+  void set_impulse_response(const AudioBuffer &impulse_response, const unsigned int n_frames, const double sample_rate);
+
+  void set_mix(const float mix) noexcept { m_mix.store(mix, std::memory_order_relaxed); }
+  float get_mix() const noexcept { return m_mix.load(std::memory_order_relaxed); }
+
+  size_t get_impulse_length() const;
+  unsigned int get_latency() const noexcept override;
+  unsigned int get_tail_frames() const noexcept override;
+
+  void reset() noexcept override;
+
+protected:
+  void do_prepare(const ProcessSpec &spec) override;
+  void do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept override;
+
+private:
+  /** @struct Kernel
+   *  @brief Convolvers for one impulse response and stream configuration
+   */
+  struct Kernel
+  {
+    std::vector<std::unique_ptr<Convolver>> convolvers;
+    mutable AudioBuffer wet;  // Audio thread scratch
+    unsigned int latency;
+  };
+
+  void build_locked();
+
+  std::atomic<float> m_mix;
+  std::atomic<unsigned int> m_latency;
+  std::atomic<unsigned int> m_tail;
+
+  mutable std::mutex m_mutex;
+  std::vector<std::vector<float>> m_impulse_response;
+  double m_impulse_sample_rate;
+
+  SnapshotPublisher<Kernel> m_kernel;
+};
+
+}  // namespace Dsp
+
+#endif  // __CONVOLUTION_REVERB_H__
@@ -0,0 +1,64 @@
+#ifndef __CONVOLVER_H__
+#define __CONVOLVER_H__
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include "audiobuffer.h"
+#include "fft.h"
+
+namespace Dsp
+{
+
+/** @class Convolver
+ *  @brief Uniformly partitioned overlap-save convolution of one channel.
+ *
+ *  The impulse response is cut into partitions of B samples, each transformed
+ *  once with a 2B point FFT when the convolver is prepared. Every B input
+ *  samples the newest input spectrum enters a frequency-domain delay line and
+ *  is multiplied against all partitions, so each block costs one forward FFT,
+ *  one inverse FFT and one complex multiply-accumulate per partition.
+ *
+ *  Input is collected into whole partitions, so the output is delayed by
+ *  get_latency() == B samples.
+ */
+class Convolver
+{
+public:
+  Convolver();
+
+  void prepare(const float *impulse_response, const size_t length, const unsigned int partition_size,
+               std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+  void reset() noexcept;
+  void process(const float *input, float *output, const unsigned int n_frames) noexcept;
+
+  unsigned int get_latency() const noexcept { return m_partition_size; }
+  unsigned int get_partition_size() const noexcept { return m_partition_size; }
+  unsigned int get_partition_count() const noexcept { return m_partition_count; }
+
+private:
+  void process_partition() noexcept;
+
+  unsigned int m_partition_size;
+  unsigned int m_partition_count;
+  unsigned int m_bins;
+
+  std::unique_ptr<FftPlan> p_fft;
+
+  // Each row of these buffers is one spectrum of m_bins values
+  AudioBuffer m_filter_re;
+  AudioBuffer m_filter_im;
+  AudioBuffer m_history_re;
+  AudioBuffer m_history_im;
+  unsigned int m_history_head;
+
+  // Row 0 input window, row 1 inverse transform, row 2 output block,
+  // rows 3 and 4 the accumulated spectrum
+  AudioBuffer m_work;
+  unsigned int m_position;
+};
+
+}  // namespace Dsp
+
+#endif  // __CONVOLVER_H__
@@ -0,0 +1,54 @@
+#ifndef __DELAY_H__
+#define __DELAY_H__
+
+#include <atomic>
+
+#include "processor.h"
+
+namespace Dsp
+{
+
+/** @class Delay
+ *  @brief Feedback delay with a dry/wet mix.
+ *
+ *  The delay lines are allocated in prepare() for the maximum delay time and
+ *  sized to a power of two, so the read and write positions wrap with a mask.
+ */
+class Delay : public IProcessor
+{
+public:
+  explicit Delay(const float max_delay_ms = 2000.0f);
+
+  void set_time_ms(const float time_ms) noexcept { m_time_ms.store(time_ms, std::memory_order_relaxed); }
+  void set_feedback(const float feedback) noexcept { m_feedback.store(feedback, std::memory_order_relaxed); }
+  void set_mix(const float mix) noexcept { m_mix.store(mix, std::memory_order_relaxed); }
+
+  float get_time_ms() const noexcept { return m_time_ms.load(std::memory_order_relaxed); }
+  float get_feedback() const noexcept { return m_feedback.load(std::memory_order_relaxed); }
+  float get_mix() const noexcept { return m_mix.load(std::memory_order_relaxed); }
+  float get_max_delay_ms() const noexcept { return m_max_delay_ms; }
+
+  unsigned int get_tail_frames() const noexcept override;
+
+  void reset() noexcept override;
+
+protected:
+  void do_prepare(const ProcessSpec &spec) override;
+  void do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept override;
+
+private:
+  const float m_max_delay_ms;
+
+  std::atomic<float> m_time_ms;
+  std::atomic<float> m_feedback;
+  std::atomic<float> m_mix;
+
+  // Audio thread state
+  AudioBuffer m_lines;
+  unsigned int m_mask;
+  unsigned int m_write_position;
+};
+
+}  // namespace Dsp
+
+#endif  // __DELAY_H__
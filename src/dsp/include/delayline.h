@@ -0,0 +1,50 @@
+#ifndef __DELAY_LINE_H__
+#define __DELAY_LINE_H__
+
+#include <cstdint>
+#include <memory_resource>
+
+#include "audiobuffer.h"
+
+namespace Dsp
+{
+
+/** @class DelayLine
+ *  @brief Fixed whole-sample delay used to line up signal paths of different latency.
+ *
+ *  The line is allocated once for its delay plus the largest block, sized to a
+ *  power of two, and copies blocks in and out in at most two runs per channel.
+ *  Once the whole line holds silent blocks, further silent blocks skip it.
+ */
+class DelayLine
+{
+public:
+  DelayLine(const unsigned int channels, const unsigned int delay, const unsigned int max_frames,
+            std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  DelayLine(DelayLine &&other) noexcept = default;
+  DelayLine &operator=(DelayLine &&other) noexcept = default;
+  DelayLine(const DelayLine &) = delete;
+  DelayLine &operator=(const DelayLine &) = delete;
+
+  unsigned int get_delay() const noexcept { return m_delay; }
+  size_t get_bytes() const noexcept;
+
+  void reset() noexcept;
+  bool process(AudioBuffer &buffer, const unsigned int n_frames, const bool silent = false) noexcept;
+  bool mix(const AudioBuffer &source, AudioBuffer &destination, const float gain,
+           const unsigned int n_frames, const bool silent = false) noexcept;
+
+private:
+  bool write(const AudioBuffer &source, const unsigned int n_frames, const bool silent) noexcept;
+
+  AudioBuffer m_line;
+  unsigned int m_delay;
+  unsigned int m_mask;
+  unsigned int m_write_position;
+  uint64_t m_silent_frames;  // Silent frames written since the last signal
+};
+
+}  // namespace Dsp
+
+#endif  // __DELAY_LINE_H__
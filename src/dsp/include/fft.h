@@ -0,0 +1,47 @@
+#ifndef __FFT_H__
+#define __FFT_H__
+
+#include <cstddef>
+#include <vector>
+
+namespace Dsp
+{
+
+/** @class FftPlan
+ *  @brief Precomputed real FFT of a fixed power-of-two size.
+ *
+ *  Spectra are stored split, with separate real and imaginary arrays of
+ *  size / 2 + 1 bins, so complex multiply-accumulate loops vectorize. The plan
+ *  holds its own scratch memory, so it is not shared between threads. After
+ *  construction forward() and inverse() do not allocate.
+ */
+class FftPlan
+{
+public:
+  explicit FftPlan(const size_t size);
+
+  size_t get_size() const noexcept { return m_size; }
+  size_t get_bins() const noexcept { return m_size / 2 + 1; }
+
+  void forward(const float *input, float *out_re, float *out_im) noexcept;
+  void inverse(const float *in_re, const float *in_im, float *output) noexcept;
+
+private:
+  void transform(float *re, float *im) const noexcept;
+
+  size_t m_size;
+  size_t m_half;
+
+  std::vector<unsigned int> m_bit_reverse;
+  std::vector<float> m_stage_re;  // Butterfly twiddles, one contiguous run per stage
+  std::vector<float> m_stage_im;
+  std::vector<float> m_real_re;   // Twiddles that split the half-size complex FFT into a real FFT
+  std::vector<float> m_real_im;
+
+  std::vector<float> m_scratch_re;
+  std::vector<float> m_scratch_im;
+};
+
+}  // namespace Dsp
+
+#endif  // __FFT_H__
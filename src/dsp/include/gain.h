@@ -0,0 +1,52 @@
+#ifndef __GAIN_H__
+#define __GAIN_H__
+
+#include "processor.h"
+#include "parameterstore.h"
+#include "smoothedvalue.h"
+
+namespace Dsp
+{
+
+/** @class Gain
+ *  @brief Level and constant-power pan, as parameters in the ParameterStore.
+ *  Changes are smoothed per sample.
+ */
+class Gain : public IProcessor
+{
+public:
+  Gain();
+  ~Gain() override;
+
+  void set_gain_db(const float gain_db);
+  float get_gain_db() const noexcept { return ParameterStore::instance().get(m_gain_parameter); }
+
+  void set_pan(const float pan);
+  float get_pan() const noexcept { return ParameterStore::instance().get(m_pan_parameter); }
+
+  ParameterId get_gain_parameter() const noexcept { return m_gain_parameter; }
+  ParameterId get_pan_parameter() const noexcept { return m_pan_parameter; }
+
+  unsigned int get_tail_frames() const noexcept override { return 0; }
+
+  void reset() noexcept override;
+
+protected:
+  void do_prepare(const ProcessSpec &spec) override;
+  void do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept override;
+
+private:
+  void update_targets(const unsigned int channels) noexcept;
+
+  ParameterId m_gain_parameter;
+  ParameterId m_pan_parameter;
+
+  // Audio thread state, the gains of the first channel pair and of any further channels
+  SmoothedValue m_left_gain;
+  SmoothedValue m_right_gain;
+  SmoothedValue m_level;
+};
+
+}  // namespace Dsp
+
+#endif  // __GAIN_H__
@@ -0,0 +1,73 @@
+#ifndef __METER_ANALYZER_H__
+#define __METER_ANALYZER_H__
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "engine.h"
+#include "metertap.h"
+
+namespace Dsp
+{
+
+/** @enum eMeterCommand
+ *  @brief MeterAnalyzer thread API commands
+ */
+enum class eMeterCommand
+{
+  AddTap,
+  RemoveTap,
+};
+
+/** @struct MeterMessage
+ *  @brief Message used to communicate with the MeterAnalyzer thread.
+ */
+struct MeterMessage
+{
+  eMeterCommand command;
+  std::shared_ptr<MeterTap> tap;
+};
+
+/** @class MeterAnalyzer
+ *  @brief Low-priority thread that turns meter taps into levels and spectra.
+ *
+ *  Taps are registered through the message queue, so the analyzer owns its
+ *  list of taps and never shares it with the audio thread.
+ */
+class MeterAnalyzer : public IEngine<MeterMessage>
+{
+public:
+  static MeterAnalyzer& instance()
+  {
+    static MeterAnalyzer instance;
+    return instance;
+  }
+
+  void add_tap(const std::shared_ptr<MeterTap> &tap);
+  void remove_tap(const std::shared_ptr<MeterTap> &tap);
+
+  void process();
+
+  /** @brief Time between analysis passes, around a display refresh
+   */
+  void set_period(const std::chrono::milliseconds period) noexcept { m_period_ms.store(period.count()); }
+  std::chrono::milliseconds get_period() const noexcept { return std::chrono::milliseconds(m_period_ms.load()); }
+
+  size_t get_tap_count() const noexcept { return m_tap_count.load(std::memory_order_relaxed); }
+
+private:
+  MeterAnalyzer();
+
+  void run() override;
+  void handle_messages() override;
+
+  std::vector<std::shared_ptr<MeterTap>> m_taps;
+  std::atomic<size_t> m_tap_count;
+  std::atomic<long> m_period_ms;
+};
+
+}  // namespace Dsp
+
+#endif  // __METER_ANALYZER_H__
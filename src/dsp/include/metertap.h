@@ -0,0 +1,117 @@
+#ifndef __METER_TAP_H__
+#define __METER_TAP_H__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "audiobuffer.h"
+#include "fft.h"
+#include "processor.h"
+#include "ringbuffer.h"
+#include "seqlock.h"
+
+namespace Dsp
+{
+
+static constexpr unsigned int kMaxMeterChannels = 8;
+static constexpr size_t kSpectrumFftSize = 1024;
+static constexpr size_t kSpectrumBins = kSpectrumFftSize / 2 + 1;
+
+/** @struct MeterLevels
+ *  @brief Peak and RMS level of each channel in dBFS.
+ */
+struct MeterLevels
+{
+  unsigned int channels;
+  std::array<float, kMaxMeterChannels> peak_db;
+  std::array<float, kMaxMeterChannels> rms_db;
+};
+
+/** @struct SpectrumFrame
+ *  @brief Magnitude spectrum of the channel sum in dBFS, kSpectrumBins bins from 0 Hz to Nyquist.
+ */
+struct SpectrumFrame
+{
+  float sample_rate;
+  std::array<float, kSpectrumBins> magnitude_db;
+};
+
+/** @class MeterTap
+ *  @brief Metering point on a track or bus.
+ *
+ *  The audio thread calls push() once per block. It only accumulates the peak
+ *  and sum of squares of each channel and copies the channel sum into a
+ *  lock-free ring. The MeterAnalyzer thread drains the rings, applies meter
+ *  ballistics and the windowed FFT, and publishes the results through seqlocks
+ *  that any thread can read.
+ */
+class MeterTap
+{
+public:
+  explicit MeterTap(const std::string &name);
+
+  const std::string &get_name() const noexcept { return m_name; }
+
+  void prepare(const ProcessSpec &spec);
+  void push(const AudioBuffer &buffer, const unsigned int n_frames) noexcept;
+  void push_silence(const unsigned int n_frames) noexcept;
+
+  void analyze();
+
+  MeterLevels get_levels() const noexcept { return m_levels.load(); }
+  SpectrumFrame get_spectrum() const noexcept { return m_spectrum.load(); }
+  uint64_t get_spectrum_version() const noexcept { return m_spectrum.get_version(); }
+
+  /** @brief Blocks whose samples did not fit in the ring, because the analyzer fell behind
+   */
+  uint64_t get_overrun_count() const noexcept { return m_overruns.load(std::memory_order_relaxed); }
+
+private:
+  /** @brief Per-block accumulation passed from the audio thread to the analyzer
+   */
+  struct BlockLevels
+  {
+    unsigned int frames;
+    std::array<float, kMaxMeterChannels> peak;
+    std::array<float, kMaxMeterChannels> sum_squares;
+  };
+
+  void analyze_levels(const BlockLevels &block);
+  void analyze_spectrum();
+
+  std::string m_name;
+
+  // Serializes prepare() against the analyzer, never taken on the audio thread
+  std::mutex m_mutex;
+  double m_sample_rate;
+  unsigned int m_channels;
+
+  // Audio thread side
+  AudioBuffer m_mixdown;
+  RingBuffer<BlockLevels> m_level_ring;
+  RingBuffer<float> m_sample_ring;
+  std::atomic<uint64_t> m_overruns;
+
+  // Analyzer side
+  std::array<float, kMaxMeterChannels> m_peak;
+  std::array<float, kMaxMeterChannels> m_mean_square;
+  std::vector<float> m_history;
+  std::vector<float> m_window;
+  std::vector<float> m_windowed;
+  std::vector<float> m_spectrum_re;
+  std::vector<float> m_spectrum_im;
+  size_t m_new_samples;
+  std::unique_ptr<FftPlan> p_fft;
+
+  SeqLock<MeterLevels> m_levels;
+  SeqLock<SpectrumFrame> m_spectrum;
+};
+
+}  // namespace Dsp
+
+#endif  // __METER_TAP_H__
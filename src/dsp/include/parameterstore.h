@@ -0,0 +1,145 @@
+#ifndef __PARAMETER_STORE_H__
+#define __PARAMETER_STORE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "automation.h"
+#include "smoothedvalue.h"
+#include "snapshot.h"
+
+namespace Dsp
+{
+
+using ParameterId = uint32_t;
+static constexpr ParameterId kInvalidParameter = std::numeric_limits<ParameterId>::max();
+
+/** @struct ParameterInfo
+ *  @brief Range and smoothing of a parameter, fixed when it is added.
+ */
+struct ParameterInfo
+{
+  std::string name;
+  float min_value;
+  float max_value;
+  float default_value;
+  eSmoothing smoothing = eSmoothing::Linear;
+  float smoothing_ms = 20.0f;
+};
+
+/** @class ParameterStore
+ *  @brief Registry of every automatable parameter in the engine.
+ *
+ *  Parameters live in a fixed array of atomic slots, so a ParameterId stays
+ *  valid until the parameter is removed and the slots never move. Control
+ *  threads write values lock-free and the audio thread reads each one once per
+ *  block, smoothing it per sample with a SmoothedValue. Adding and removing
+ *  parameters, and changing automation, lock a mutex on the control side only.
+ *
+ *  Automation lanes are published as a snapshot and evaluated once per block by
+ *  process_automation(), which writes the lane value as the parameter value.
+ *  Offline renders evaluate an OfflineAutomation captured when they start, so
+ *  they never share cursors with the audio thread.
+ */
+class ParameterStore
+{
+public:
+  static constexpr size_t kMaxParameters = 16384;
+
+  class OfflineAutomation;
+
+  static ParameterStore& instance()
+  {
+    static ParameterStore instance;
+    return instance;
+  }
+
+  ParameterId add(const ParameterInfo &info);
+  void remove(const ParameterId id);
+
+  void set(const ParameterId id, const float value);
+  void set_normalized(const ParameterId id, const float normalized);
+  void reset_to_default(const ParameterId id);
+
+  /** @brief Current value. Lock-free, safe on the audio thread. Unknown IDs read as 0.
+   */
+  inline float get(const ParameterId id) const noexcept
+  {
+    return id < kMaxParameters ? p_slots[id].value.load(std::memory_order_relaxed) : 0.0f;
+  }
+
+  ParameterInfo get_info(const ParameterId id) const;
+  bool contains(const ParameterId id) const noexcept;
+  size_t get_count() const;
+
+  void set_automation(const ParameterId id, std::shared_ptr<const AutomationLane> lane);
+  void clear_automation(const ParameterId id);
+  bool has_automation(const ParameterId id) const;
+
+  void process_automation(const uint64_t position) noexcept;
+
+  OfflineAutomation capture_automation() const;
+  void process_automation(const uint64_t position, OfflineAutomation &automation) noexcept;
+
+private:
+  ParameterStore();
+
+  /** @struct Slot
+   *  @brief Value and range of one parameter
+   */
+  struct alignas(16) Slot
+  {
+    std::atomic<float> value;
+    std::atomic<float> min_value;
+    std::atomic<float> max_value;
+    std::atomic<bool> active;
+  };
+
+  struct AutomationEntry
+  {
+    ParameterId id;
+    std::shared_ptr<const AutomationLane> lane;
+    mutable size_t cursor;
+  };
+
+  struct AutomationSet
+  {
+    std::vector<AutomationEntry> entries;
+  };
+
+  void check_locked(const ParameterId id) const;
+  void store_clamped(const ParameterId id, const float value) noexcept;
+  void publish_automation_locked();
+  void apply_automation(const std::vector<AutomationEntry> &entries, const uint64_t position) noexcept;
+
+  std::unique_ptr<Slot[]> p_slots;
+
+  mutable std::mutex m_mutex;
+  std::vector<ParameterInfo> m_info;
+  std::vector<ParameterId> m_free_ids;
+  ParameterId m_next_id;
+  size_t m_count;
+
+  std::vector<AutomationEntry> m_automation;
+  SnapshotPublisher<AutomationSet> m_automation_set;
+};
+
+/** @class ParameterStore::OfflineAutomation
+ *  @brief The automation lanes as they were when captured, with cursors of their own.
+ */
+class ParameterStore::OfflineAutomation
+{
+private:
+  friend class ParameterStore;
+
+  std::vector<AutomationEntry> m_entries;
+};
+
+}  // namespace Dsp
+
+#endif  // __PARAMETER_STORE_H__
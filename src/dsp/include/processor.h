@@ -0,0 +1,105 @@
+#ifndef __PROCESSOR_H__
+#define __PROCESSOR_H__
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <string>
+
+#include "audiobuffer.h"
+
+namespace Dsp
+{
+
+/** @struct ProcessSpec
+ *  @brief Stream configuration a processor is prepared for.
+ */
+struct ProcessSpec
+{
+  double sample_rate;
+  unsigned int channels;
+  unsigned int max_frames;
+  std::pmr::memory_resource *resource;  // Where long-lived DSP buffers are allocated
+};
+
+/** @struct ProcessorStatistics
+ *  @brief Time spent in a processor on the audio thread.
+ */
+struct ProcessorStatistics
+{
+  std::string name;
+  bool bypassed;
+  uint64_t blocks_processed;
+  uint64_t last_ns;
+  uint64_t peak_ns;
+  double average_ns;
+  double dsp_load;  // Processing time as a fraction of the audio it processed
+};
+
+/** @class IProcessor
+ *  @brief Common block-processing interface for insert effects.
+ *
+ *  prepare() runs off the audio thread and may allocate. process() runs on the
+ *  audio thread and must not allocate, lock or block: it handles bypass and
+ *  timing, then calls the implementation's do_process(). Parameters are atomics
+ *  written by control threads and read once per block.
+ */
+class IProcessor
+{
+public:
+  explicit IProcessor(const std::string &name);
+  virtual ~IProcessor() = default;
+
+  IProcessor(const IProcessor &) = delete;
+  IProcessor &operator=(const IProcessor &) = delete;
+
+  void prepare(const ProcessSpec &spec);
+  void process(AudioBuffer &buffer, const unsigned int n_frames) noexcept;
+
+  virtual void reset() noexcept = 0;
+
+  /** @brief Delay the processor adds to its output, in samples
+   */
+  virtual unsigned int get_latency() const noexcept { return 0; }
+
+  static constexpr unsigned int kInfiniteTail = std::numeric_limits<unsigned int>::max();
+
+  /** @brief Samples of output that can follow silent input before the output is silent too, after the latency.
+   *  Processors that do not know their tail keep the default and are never skipped.
+   */
+  virtual unsigned int get_tail_frames() const noexcept { return kInfiniteTail; }
+
+  const std::string &get_name() const noexcept { return m_name; }
+  const ProcessSpec &get_spec() const noexcept { return m_spec; }
+
+  void set_bypassed(const bool bypassed) noexcept;
+
+  inline bool is_bypassed() const noexcept
+  {
+    return m_bypassed.load(std::memory_order_relaxed);
+  }
+
+  ProcessorStatistics get_statistics() const;
+  void reset_statistics() noexcept;
+
+protected:
+  virtual void do_prepare(const ProcessSpec &spec) = 0;
+  virtual void do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept = 0;
+
+private:
+  std::string m_name;
+  ProcessSpec m_spec;
+  std::atomic<bool> m_bypassed;
+  std::atomic<bool> m_reset_pending;
+
+  std::atomic<uint64_t> m_blocks_processed;
+  std::atomic<uint64_t> m_frames_processed;
+  std::atomic<uint64_t> m_total_ns;
+  std::atomic<uint64_t> m_last_ns;
+  std::atomic<uint64_t> m_peak_ns;
+};
+
+}  // namespace Dsp
+
+#endif  // __PROCESSOR_H__
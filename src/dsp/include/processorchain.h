@@ -0,0 +1,74 @@
+#ifndef __PROCESSOR_CHAIN_H__
+#define __PROCESSOR_CHAIN_H__
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "processor.h"
+#include "snapshot.h"
+
+namespace Dsp
+{
+
+/** @class ProcessorChain
+ *  @brief Ordered list of insert processors run in place on one buffer.
+ *
+ *  Edits happen on control threads, which prepare new processors and publish
+ *  an immutable snapshot of the list. process() reads the latest snapshot
+ *  without locking or allocating. Removed processors are released on a
+ *  control thread once the audio thread has moved on.
+ *
+ *  Blocks can be flagged silent. Once silent input has run past the tails and
+ *  latencies of the processors, the chain stops processing until the input
+ *  has signal again. A processor with an unknown tail keeps the chain running.
+ */
+class ProcessorChain
+{
+public:
+  ProcessorChain() = default;
+
+  ProcessorChain(const ProcessorChain &) = delete;
+  ProcessorChain &operator=(const ProcessorChain &) = delete;
+
+  void prepare(const ProcessSpec &spec);
+
+  size_t add(std::shared_ptr<IProcessor> processor);
+  void insert(const size_t index, std::shared_ptr<IProcessor> processor);
+  void remove(const size_t index);
+  void move(const size_t from, const size_t to);
+  void clear();
+
+  std::shared_ptr<IProcessor> get(const size_t index) const;
+  size_t size() const;
+
+  bool process(AudioBuffer &buffer, const unsigned int n_frames, const bool silent = false) noexcept;
+
+  std::vector<ProcessorStatistics> get_statistics() const;
+  double get_dsp_load() const;
+
+  unsigned int get_latency() const;
+
+private:
+  struct Snapshot
+  {
+    std::vector<IProcessor *> processors;
+    std::vector<std::shared_ptr<IProcessor>> owners;
+  };
+
+  void publish_locked();
+
+  mutable std::mutex m_mutex;
+  std::vector<std::shared_ptr<IProcessor>> m_processors;
+  std::optional<ProcessSpec> m_spec;
+
+  // Audio thread state, frames of silent input processed since the last signal
+  uint64_t m_idle_frames = 0;
+
+  SnapshotPublisher<Snapshot> m_snapshot;
+};
+
+}  // namespace Dsp
+
+#endif  // __PROCESSOR_CHAIN_H__
@@ -0,0 +1,70 @@
+#ifndef __RESAMPLER_H__
+#define __RESAMPLER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "audiobuffer.h"
+
+namespace Dsp
+{
+
+/** @class Resampler
+ *  @brief Streaming sample-rate converter with a windowed-sinc kernel.
+ *
+ *  Each output sample is a 32 tap Blackman-windowed sinc, taken from a table of
+ *  kernel phases and interpolated between the two nearest. The cutoff follows
+ *  the lower of the two rates, so downsampling does not alias. The read
+ *  position is kept as an exact fraction of the input rate, so long streams do
+ *  not drift. Input is given in blocks of any size; flush() emits the last
+ *  output samples held back by the kernel, after which the output holds
+ *  ceil(input * output_rate / input_rate) frames.
+ */
+class Resampler
+{
+public:
+  static constexpr unsigned int kHalfTaps = 16;
+  static constexpr unsigned int kTaps = 2 * kHalfTaps;
+  static constexpr unsigned int kPhases = 256;
+
+  Resampler();
+
+  void prepare(const unsigned int channels, const unsigned int input_rate, const unsigned int output_rate,
+               const unsigned int max_input_frames);
+  void reset() noexcept;
+
+  unsigned int process(const AudioBuffer &input, const unsigned int n_frames, AudioBuffer &output) noexcept;
+  unsigned int flush(AudioBuffer &output) noexcept;
+
+  unsigned int get_max_output_frames(const unsigned int n_input_frames) const noexcept;
+  unsigned int get_input_rate() const noexcept { return m_input_rate; }
+  unsigned int get_output_rate() const noexcept { return m_output_rate; }
+
+private:
+  unsigned int append(const AudioBuffer &input, const unsigned int offset, const unsigned int n_frames) noexcept;
+  unsigned int render(AudioBuffer &output, unsigned int written, const uint64_t limit) noexcept;
+  void discard_consumed() noexcept;
+
+  unsigned int m_channels;
+  unsigned int m_input_rate;
+  unsigned int m_output_rate;
+
+  // Input frames advanced per output frame, as whole + fraction / m_denominator
+  uint64_t m_step_whole;
+  uint64_t m_step_fraction;
+  uint64_t m_denominator;
+
+  std::vector<float> m_table;  // (kPhases + 1) rows of kTaps weights
+
+  AudioBuffer m_history;
+  unsigned int m_buffered;
+  uint64_t m_index;
+  uint64_t m_fraction;
+
+  uint64_t m_frames_in;
+  uint64_t m_frames_out;
+};
+
+}  // namespace Dsp
+
+#endif  // __RESAMPLER_H__
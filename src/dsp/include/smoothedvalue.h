@@ -0,0 +1,146 @@
+#ifndef __SMOOTHED_VALUE_H__
+#define __SMOOTHED_VALUE_H__
+
+#include <cmath>
+
+namespace Dsp
+{
+
+/** @enum eSmoothing
+ *  @brief How a parameter moves towards a new value
+ */
+enum class eSmoothing
+{
+  None,
+  Linear,
+  Exponential,
+};
+
+/** @class SmoothedValue
+ *  @brief Per-sample ramp towards a target that changes at most once per block.
+ *
+ *  Linear smoothing reaches the target in exactly the smoothing time.
+ *  Exponential smoothing follows a one-pole curve and snaps to the target at
+ *  the end of the smoothing time. Audio thread only.
+ */
+class SmoothedValue
+{
+public:
+  SmoothedValue(): m_type(eSmoothing::Linear), m_length(0), m_coefficient(0.0f),
+                   m_current(0.0f), m_target(0.0f), m_step(0.0f), m_remaining(0)
+  {
+  }
+
+  /** @brief Set the smoothing curve and time. Jumps to the current target.
+   */
+  void prepare(const double sample_rate, const float smoothing_ms, const eSmoothing type) noexcept
+  {
+    m_type = type;
+    m_length = type == eSmoothing::None ? 0 : static_cast<unsigned int>(sample_rate * smoothing_ms / 1000.0);
+
+    // Time constant of a fifth of the length, so the curve is within 1% when it snaps
+    m_coefficient = m_length > 0 ? 1.0f - std::exp(-5.0f / static_cast<float>(m_length)) : 1.0f;
+    reset(m_target);
+  }
+
+  /** @brief Jump to a value without smoothing
+   */
+  void reset(const float value) noexcept
+  {
+    m_current = m_target = value;
+    m_step = 0.0f;
+    m_remaining = 0;
+  }
+
+  /** @brief Start moving towards a new target
+   */
+  void set_target(const float target) noexcept
+  {
+    if (target == m_target)
+      return;
+
+    m_target = target;
+    if (m_length == 0)
+    {
+      reset(target);
+      return;
+    }
+
+    m_remaining = m_length;
+    m_step = (m_target - m_current) / static_cast<float>(m_length);
+  }
+
+  /** @brief Advance one sample
+   */
+  inline float next() noexcept
+  {
+    if (m_remaining == 0)
+      return m_target;
+
+    if (--m_remaining == 0)
+      m_current = m_target;
+    else if (m_type == eSmoothing::Linear)
+      m_current += m_step;
+    else
+      m_current += (m_target - m_current) * m_coefficient;
+
+    return m_current;
+  }
+
+  /** @brief Advance n samples without reading them
+   */
+  void skip(const unsigned int n_frames) noexcept
+  {
+    if (m_remaining == 0)
+      return;
+
+    if (n_frames >= m_remaining)
+    {
+      reset(m_target);
+    }
+    else if (m_type == eSmoothing::Linear)
+    {
+      m_current += m_step * static_cast<float>(n_frames);
+      m_remaining -= n_frames;
+    }
+    else
+    {
+      m_current = m_target + (m_current - m_target) * std::pow(1.0f - m_coefficient, static_cast<float>(n_frames));
+      m_remaining -= n_frames;
+    }
+  }
+
+  /** @brief Multiply a block by the smoothed value
+   */
+  void apply(float *data, const unsigned int n_frames) noexcept
+  {
+    if (m_remaining == 0)
+    {
+      const float gain = m_target;
+      for (unsigned int frame = 0; frame < n_frames; ++frame)
+        data[frame] *= gain;
+      return;
+    }
+
+    for (unsigned int frame = 0; frame < n_frames; ++frame)
+      data[frame] *= next();
+  }
+
+  inline bool is_smoothing() const noexcept { return m_remaining > 0; }
+  inline float get_current() const noexcept { return m_remaining > 0 ? m_current : m_target; }
+  inline float get_target() const noexcept { return m_target; }
+
+private:
+  eSmoothing m_type;
+  unsigned int m_length;
+  float m_coefficient;
+
+  float m_current;
+  float m_target;
+  float m_step;
+  unsigned int m_remaining;
+};
+
+}  // namespace Dsp
+
+#endif  // __SMOOTHED_VALUE_H__
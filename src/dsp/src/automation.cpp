@@ -0,0 +1,83 @@
+#include "automation.h"
+
+#include <algorithm>
+
+using namespace Dsp;
+
+static constexpr unsigned int kMaxLinearSteps = 8;
+
+static bool before(const uint64_t position, const AutomationPoint &point)
+{
+  return position < point.position;
+}
+
+/** @brief AutomationLane constructor
+ *  @param points Breakpoints in any order. Points at the same position keep their order.
+ */
+AutomationLane::AutomationLane(std::vector<AutomationPoint> points):
+  m_points(std::move(points))
+{
+  std::stable_sort(m_points.begin(), m_points.end(), [](const AutomationPoint &a, const AutomationPoint &b)
+  {
+    return a.position < b.position;
+  });
+}
+
+/** @brief Add a breakpoint after any existing points at the same position
+ */
+void AutomationLane::add_point(const uint64_t position, const float value)
+{
+  auto it = std::upper_bound(m_points.begin(), m_points.end(), position, before);
+  m_points.insert(it, AutomationPoint{position, value});
+}
+
+/** @brief Evaluate the lane with a binary search
+ */
+float AutomationLane::value_at(const uint64_t position) const noexcept
+{
+  size_t cursor = 0;
+  return value_at(position, cursor);
+}
+
+/** @brief Evaluate the lane incrementally. Audio thread safe.
+ *  @param position Timeline position in samples
+ *  @param cursor Index of the first point after the previous position, kept by the caller between calls
+ *  @return The interpolated value, or 0 for an empty lane
+ */
+float AutomationLane::value_at(const uint64_t position, size_t &cursor) const noexcept
+{
+  const size_t count = m_points.size();
+  if (count == 0)
+    return 0.0f;
+
+  cursor = std::min(cursor, count);
+  if (cursor > 0 && m_points[cursor - 1].position > position)
+  {
+    // Time moved backwards, after a seek or loop
+    cursor = std::upper_bound(m_points.begin(), m_points.end(), position, before) - m_points.begin();
+  }
+  else
+  {
+    // Playback passes a few points per block at most, a seek forward falls back to a search
+    unsigned int steps = 0;
+    while (cursor < count && m_points[cursor].position <= position)
+    {
+      if (++steps > kMaxLinearSteps)
+      {
+        cursor = std::upper_bound(m_points.begin() + cursor, m_points.end(), position, before) - m_points.begin();
+        break;
+      }
+      ++cursor;
+    }
+  }
+
+  if (cursor == 0)
+    return m_points.front().value;
+  if (cursor == count)
+    return m_points.back().value;
+
+  const AutomationPoint &a = m_points[cursor - 1];
+  const AutomationPoint &b = m_points[cursor];
+  const float t = static_cast<float>(position - a.position) / static_cast<float>(b.position - a.position);
+  return a.value + (b.value - a.value) * t;
+}
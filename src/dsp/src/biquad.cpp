@@ -0,0 +1,206 @@
+#include "biquad.h"
+#include "audiokernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Dsp;
+
+/** @brief Compute normalized coefficients from the RBJ audio EQ cookbook.
+ *  @param type Filter response
+ *  @param sample_rate Stream sample rate
+ *  @param frequency Centre or corner frequency in Hz, clamped below Nyquist
+ *  @param q Quality factor
+ *  @param gain_db Gain for peak and shelf filters
+ */
+BiquadCoefficients Dsp::make_biquad_coefficients(const eBiquadType type, const double sample_rate,
+                                                 const double frequency, const double q, const double gain_db)
+{
+  const double nyquist = sample_rate * 0.5;
+  const double f0 = std::clamp(frequency, 1.0, nyquist * 0.99);
+  const double w0 = 2.0 * M_PI * f0 / sample_rate;
+  const double cos_w0 = std::cos(w0);
+  const double sin_w0 = std::sin(w0);
+  const double alpha = sin_w0 / (2.0 * std::max(q, 1e-3));
+  const double a = std::pow(10.0, gain_db / 40.0);
+
+  double b0 = 1.0, b1 = 0.0, b2 = 0.0, a0 = 1.0, a1 = 0.0, a2 = 0.0;
+
+  switch (type)
+  {
+    case eBiquadType::LowPass:
+      b0 = (1.0 - cos_w0) / 2.0;
+      b1 = 1.0 - cos_w0;
+      b2 = (1.0 - cos_w0) / 2.0;
+      a0 = 1.0 + alpha;
+      a1 = -2.0 * cos_w0;
+      a2 = 1.0 - alpha;
+      break;
+    case eBiquadType::HighPass:
+      b0 = (1.0 + cos_w0) / 2.0;
+      b1 = -(1.0 + cos_w0);
+      b2 = (1.0 + cos_w0) / 2.0;
+      a0 = 1.0 + alpha;
+      a1 = -2.0 * cos_w0;
+      a2 = 1.0 - alpha;
+      break;
+    case eBiquadType::BandPass:
+      b0 = alpha;
+      b1 = 0.0;
+      b2 = -alpha;
+      a0 = 1.0 + alpha;
+      a1 = -2.0 * cos_w0;
+      a2 = 1.0 - alpha;
+      break;
+    case eBiquadType::Notch:
+      b0 = 1.0;
+      b1 = -2.0 * cos_w0;
+      b2 = 1.0;
+      a0 = 1.0 + alpha;
+      a1 = -2.0 * cos_w0;
+      a2 = 1.0 - alpha;
+      break;
+    case eBiquadType::Peak:
+      b0 = 1.0 + alpha * a;
+      b1 = -2.0 * cos_w0;
+      b2 = 1.0 - alpha * a;
+      a0 = 1.0 + alpha / a;
+      a1 = -2.0 * cos_w0;
+      a2 = 1.0 - alpha / a;
+      break;
+    case eBiquadType::LowShelf:
+      {
+        const double sqrt_a = 2.0 * std::sqrt(a) * alpha;
+        b0 = a * ((a + 1.0) - (a - 1.0) * cos_w0 + sqrt_a);
+        b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cos_w0);
+        b2 = a * ((a + 1.0) - (a - 1.0) * cos_w0 - sqrt_a);
+        a0 = (a + 1.0) + (a - 1.0) * cos_w0 + sqrt_a;
+        a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cos_w0);
+        a2 = (a + 1.0) + (a - 1.0) * cos_w0 - sqrt_a;
+      }
+      break;
+    case eBiquadType::HighShelf:
+      {
+        const double sqrt_a = 2.0 * std::sqrt(a) * alpha;
+        b0 = a * ((a + 1.0) + (a - 1.0) * cos_w0 + sqrt_a);
+        b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cos_w0);
+        b2 = a * ((a + 1.0) + (a - 1.0) * cos_w0 - sqrt_a);
+        a0 = (a + 1.0) - (a - 1.0) * cos_w0 + sqrt_a;
+        a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cos_w0);
+        a2 = (a + 1.0) - (a - 1.0) * cos_w0 - sqrt_a;
+      }
+      break;
+  }
+
+  return BiquadCoefficients{
+    static_cast<float>(b0 / a0),
+    static_cast<float>(b1 / a0),
+    static_cast<float>(b2 / a0),
+    static_cast<float>(a1 / a0),
+    static_cast<float>(a2 / a0),
+  };
+}
+
+/** @brief Biquad constructor
+ */
+Biquad::Biquad(const eBiquadType type, const float frequency, const float q, const float gain_db):
+  IProcessor("Biquad"),
+  m_type(type),
+  m_frequency(frequency),
+  m_q(q),
+  m_gain_db(gain_db),
+  m_version(0),
+  m_applied_version(0),
+  m_coefficients{1.0f, 0.0f, 0.0f, 0.0f, 0.0f}
+{
+}
+
+void Biquad::set_type(const eBiquadType type) noexcept
+{
+  m_type.store(type, std::memory_order_relaxed);
+  m_version.fetch_add(1, std::memory_order_release);
+}
+
+void Biquad::set_frequency(const float frequency) noexcept
+{
+  m_frequency.store(frequency, std::memory_order_relaxed);
+  m_version.fetch_add(1, std::memory_order_release);
+}
+
+void Biquad::set_q(const float q) noexcept
+{
+  m_q.store(q, std::memory_order_relaxed);
+  m_version.fetch_add(1, std::memory_order_release);
+}
+
+void Biquad::set_gain_db(const float gain_db) noexcept
+{
+  m_gain_db.store(gain_db, std::memory_order_relaxed);
+  m_version.fetch_add(1, std::memory_order_release);
+}
+
+void Biquad::do_prepare(const ProcessSpec &spec)
+{
+  m_state = AudioBuffer(2, spec.channels, spec.resource);
+}
+
+/** @brief Time for the filter's ringing to decay below silence.
+ *  A resonance at f with quality Q decays as exp(-pi f t / Q). Q is floored at
+ *  0.5, where the poles stop ringing.
+ */
+unsigned int Biquad::get_tail_frames() const noexcept
+{
+  const double sample_rate = get_spec().sample_rate;
+  const double frequency = std::max(1.0f, get_frequency());
+  const double q = std::max(0.5f, get_q());
+  const double seconds = -std::log(static_cast<double>(Kernels::kSilenceThreshold)) * q / (M_PI * frequency);
+  return static_cast<unsigned int>(std::ceil(seconds * sample_rate)) + 2;
+}
+
+/** @brief Clear the filter state and pick up the current parameters
+ */
+void Biquad::reset() noexcept
+{
+  m_state.clear();
+  update_coefficients();
+}
+
+void Biquad::update_coefficients() noexcept
+{
+  m_applied_version = m_version.load(std::memory_order_acquire);
+  m_coefficients = make_biquad_coefficients(m_type.load(std::memory_order_relaxed),
+                                            get_spec().sample_rate,
+                                            m_frequency.load(std::memory_order_relaxed),
+                                            m_q.load(std::memory_order_relaxed),
+                                            m_gain_db.load(std::memory_order_relaxed));
+}
+
+void Biquad::do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept
+{
+  if (m_version.load(std::memory_order_acquire) != m_applied_version)
+    update_coefficients();
+
+  const BiquadCoefficients c = m_coefficients;
+  const unsigned int channels = std::min(buffer.get_channels(), m_state.get_frames());
+  float *__restrict state_z1 = m_state.get_channel(0);
+  float *__restrict state_z2 = m_state.get_channel(1);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    float *__restrict data = buffer.get_channel(ch);
+
+    // Keep the state in registers for the whole block
+    float z1 = state_z1[ch];
+    float z2 = state_z2[ch];
+    for (unsigned int frame = 0; frame < n_frames; ++frame)
+    {
+      const float x = data[frame];
+      const float y = c.b0 * x + z1;
+      z1 = c.b1 * x - c.a1 * y + z2;
+      z2 = c.b2 * x - c.a2 * y;
+      data[frame] = y;
+    }
+    state_z1[ch] = z1;
+    state_z2[ch] = z2;
+  }
+}
@@ -0,0 +1,91 @@
+#include "compressor.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Dsp;
+
+/** @brief One-pole smoothing coefficient for a time constant
+ */
+static float time_coefficient(const float time_ms, const double sample_rate)
+{
+  const double samples = std::max(1e-3, static_cast<double>(time_ms)) * 0.001 * sample_rate;
+  return static_cast<float>(std::exp(-1.0 / samples));
+}
+
+/** @brief Compressor constructor
+ */
+Compressor::Compressor():
+  IProcessor("Compressor"),
+  m_threshold_db(-18.0f),
+  m_ratio(4.0f),
+  m_attack_ms(5.0f),
+  m_release_ms(100.0f),
+  m_makeup_db(0.0f),
+  m_gain_reduction_db(0.0f),
+  m_envelope_db(0.0f)
+{
+}
+
+void Compressor::do_prepare(const ProcessSpec &spec)
+{
+  m_gain_curve = AudioBuffer(1, spec.max_frames, spec.resource);
+}
+
+/** @brief Release any gain reduction
+ */
+void Compressor::reset() noexcept
+{
+  m_envelope_db = 0.0f;
+  m_gain_reduction_db.store(0.0f, std::memory_order_relaxed);
+}
+
+void Compressor::do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept
+{
+  const unsigned int channels = buffer.get_channels();
+  const unsigned int count = std::min(n_frames, m_gain_curve.get_frames());
+  if (channels == 0 || count == 0)
+    return;
+
+  const double sample_rate = get_spec().sample_rate;
+  const float threshold = m_threshold_db.load(std::memory_order_relaxed);
+  const float slope = 1.0f - 1.0f / std::max(1.0f, m_ratio.load(std::memory_order_relaxed));
+  const float attack = time_coefficient(m_attack_ms.load(std::memory_order_relaxed), sample_rate);
+  const float release = time_coefficient(m_release_ms.load(std::memory_order_relaxed), sample_rate);
+  const float makeup_db = m_makeup_db.load(std::memory_order_relaxed);
+
+  float *__restrict gain = m_gain_curve.get_channel(0);
+  float envelope = m_envelope_db;
+  float max_reduction = 0.0f;
+
+  // Detector and gain computer, once per frame across all channels
+  for (unsigned int frame = 0; frame < count; ++frame)
+  {
+    float peak = 0.0f;
+    for (unsigned int ch = 0; ch < channels; ++ch)
+      peak = std::max(peak, std::fabs(buffer.get_channel(ch)[frame]));
+
+    const float level_db = 20.0f * std::log10(std::max(peak, 1e-6f));
+    const float target_db = level_db > threshold ? (threshold - level_db) * slope : 0.0f;
+
+    // Attack when reduction increases, release when it recovers
+    const float coefficient = target_db < envelope ? attack : release;
+    envelope = target_db + coefficient * (envelope - target_db);
+
+    max_reduction = std::min(max_reduction, envelope);
+    gain[frame] = envelope + makeup_db;
+  }
+
+  for (unsigned int frame = 0; frame < count; ++frame)
+    gain[frame] = std::pow(10.0f, gain[frame] * 0.05f);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    float *__restrict data = buffer.get_channel(ch);
+    for (unsigned int frame = 0; frame < count; ++frame)
+      data[frame] *= gain[frame];
+  }
+
+  m_envelope_db = envelope;
+  m_gain_reduction_db.store(max_reduction, std::memory_order_relaxed);
+}
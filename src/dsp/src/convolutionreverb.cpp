@@ -0,0 +1,174 @@
+#include "convolutionreverb.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Dsp;
+
+static constexpr unsigned int kMinPartitionSize = 64;
+
+/** @brief Linear interpolation to the stream sample rate
+ */
+static std::vector<float> resample(const std::vector<float> &input, const double ratio)
+{
+  if (ratio == 1.0 || input.empty())
+    return input;
+
+  const size_t length = static_cast<size_t>(std::ceil(static_cast<double>(input.size()) * ratio));
+  std::vector<float> output(length, 0.0f);
+  for (size_t i = 0; i < length; ++i)
+  {
+    const double position = static_cast<double>(i) / ratio;
+    const size_t index = static_cast<size_t>(position);
+    const float fraction = static_cast<float>(position - static_cast<double>(index));
+    const float a = input[std::min(index, input.size() - 1)];
+    const float b = input[std::min(index + 1, input.size() - 1)];
+    output[i] = a + (b - a) * fraction;
+  }
+
+  return output;
+}
+
+/** @brief ConvolutionReverb constructor
+ */
+ConvolutionReverb::ConvolutionReverb():
+  IProcessor("Convolution Reverb"),
+  m_mix(1.0f),
+  m_latency(0),
+  m_tail(0),
+  m_impulse_sample_rate(0.0)
+{
+}
+
+/** @brief Load an impulse response. Not on the audio thread.
+ *  @param impulse_response Planar impulse response, one or more channels
+ *  @param n_frames Number of frames to use from the buffer
+ *  @param sample_rate Sample rate of the impulse response, resampled to the stream rate if different
+ */
+void ConvolutionReverb::set_impulse_response(const AudioBuffer &impulse_response, const unsigned int n_frames,
+                                             const double sample_rate)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const unsigned int frames = std::min(n_frames, impulse_response.get_frames());
+  m_impulse_response.clear();
+  for (unsigned int ch = 0; ch < impulse_response.get_channels(); ++ch)
+  {
+    const float *data = impulse_response.get_channel(ch);
+    m_impulse_response.emplace_back(data, data + frames);
+  }
+  m_impulse_sample_rate = sample_rate;
+
+  if (get_spec().max_frames > 0)
+    build_locked();
+}
+
+size_t ConvolutionReverb::get_impulse_length() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_impulse_response.empty() ? 0 : m_impulse_response.front().size();
+}
+
+unsigned int ConvolutionReverb::get_latency() const noexcept
+{
+  return m_latency.load(std::memory_order_relaxed);
+}
+
+/** @brief The length of the impulse response at the stream's sample rate
+ */
+unsigned int ConvolutionReverb::get_tail_frames() const noexcept
+{
+  return m_tail.load(std::memory_order_relaxed);
+}
+
+void ConvolutionReverb::do_prepare(const ProcessSpec &spec)
+{
+  (void)spec;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  build_locked();
+}
+
+/** @brief Clear the convolution tails
+ */
+void ConvolutionReverb::reset() noexcept
+{
+  auto kernel = m_kernel.read();
+  if (!kernel)
+    return;
+
+  for (const auto &convolver : kernel->convolvers)
+  {
+    convolver->reset();
+  }
+}
+
+void ConvolutionReverb::build_locked()
+{
+  const ProcessSpec &spec = get_spec();
+  if (m_impulse_response.empty() || spec.channels == 0)
+  {
+    m_kernel.publish(nullptr);
+    m_latency.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    return;
+  }
+
+  unsigned int partition_size = kMinPartitionSize;
+  while (partition_size < spec.max_frames)
+    partition_size <<= 1;
+
+  const double ratio = m_impulse_sample_rate > 0.0 ? spec.sample_rate / m_impulse_sample_rate : 1.0;
+
+  std::vector<std::vector<float>> resampled;
+  size_t tail = 0;
+  for (const auto &channel : m_impulse_response)
+  {
+    resampled.push_back(resample(channel, ratio));
+    tail = std::max(tail, resampled.back().size());
+  }
+
+  // Spectra grow with the impulse length rather than the block size, so they
+  // come from the heap instead of the stream's fixed buffer pool
+  auto kernel = std::make_unique<Kernel>();
+  for (unsigned int ch = 0; ch < spec.channels; ++ch)
+  {
+    const auto &impulse = resampled[ch % resampled.size()];
+    auto convolver = std::make_unique<Convolver>();
+    convolver->prepare(impulse.data(), impulse.size(), partition_size);
+    kernel->convolvers.push_back(std::move(convolver));
+  }
+  kernel->wet = AudioBuffer(1, spec.max_frames, spec.resource);
+  kernel->latency = partition_size;
+
+  m_latency.store(partition_size, std::memory_order_relaxed);
+  m_tail.store(static_cast<unsigned int>(tail), std::memory_order_relaxed);
+  m_kernel.publish(std::move(kernel));
+}
+
+void ConvolutionReverb::do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept
+{
+  auto kernel = m_kernel.read();
+  if (!kernel)
+    return;
+
+  const float wet = std::clamp(m_mix.load(std::memory_order_relaxed), 0.0f, 1.0f);
+  const float dry = 1.0f - wet;
+  const unsigned int channels = std::min(buffer.get_channels(), static_cast<unsigned int>(kernel->convolvers.size()));
+  const unsigned int frames = std::min(n_frames, kernel->wet.get_frames());
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    float *__restrict data = buffer.get_channel(ch);
+
+    if (wet == 1.0f)
+    {
+      kernel->convolvers[ch]->process(data, data, frames);
+      continue;
+    }
+
+    float *__restrict convolved = kernel->wet.get_channel(0);
+    kernel->convolvers[ch]->process(data, convolved, frames);
+    for (unsigned int frame = 0; frame < frames; ++frame)
+      data[frame] = dry * data[frame] + wet * convolved[frame];
+  }
+}
@@ -0,0 +1,161 @@
+#include "convolver.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace Dsp;
+
+enum eConvolverRow : unsigned int
+{
+  InputWindow,
+  TimeDomain,
+  OutputBlock,
+  AccumulatorRe,
+  AccumulatorIm,
+  Rows,
+};
+
+/** @brief Convolver constructor
+ */
+Convolver::Convolver():
+  m_partition_size(0),
+  m_partition_count(0),
+  m_bins(0),
+  m_history_head(0),
+  m_position(0)
+{
+}
+
+/** @brief Transform the impulse response into partitions. Not on the audio thread.
+ *  @param impulse_response Impulse response samples
+ *  @param length Number of samples in the impulse response
+ *  @param partition_size Partition size B, a power of two of at least 2
+ *  @param resource Memory resource for the spectra and delay line
+ *  @throws std::invalid_argument if the partition size is not a power of two of at least 2
+ */
+void Convolver::prepare(const float *impulse_response, const size_t length, const unsigned int partition_size,
+                        std::pmr::memory_resource *resource)
+{
+  if (partition_size < 2 || (partition_size & (partition_size - 1)) != 0)
+  {
+    throw std::invalid_argument("Convolver: Partition size must be a power of two of at least 2");
+  }
+
+  const size_t fft_size = static_cast<size_t>(partition_size) * 2;
+
+  m_partition_size = partition_size;
+  m_partition_count = static_cast<unsigned int>(std::max<size_t>(1, (length + partition_size - 1) / partition_size));
+  m_bins = partition_size + 1;
+  p_fft = std::make_unique<FftPlan>(fft_size);
+
+  m_filter_re = AudioBuffer(m_partition_count, m_bins, resource);
+  m_filter_im = AudioBuffer(m_partition_count, m_bins, resource);
+  m_history_re = AudioBuffer(m_partition_count, m_bins, resource);
+  m_history_im = AudioBuffer(m_partition_count, m_bins, resource);
+  m_work = AudioBuffer(Rows, static_cast<unsigned int>(fft_size), resource);
+
+  // Each partition is zero padded to the FFT size
+  std::vector<float> padded(fft_size, 0.0f);
+  for (unsigned int p = 0; p < m_partition_count; ++p)
+  {
+    std::fill(padded.begin(), padded.end(), 0.0f);
+    const size_t start = static_cast<size_t>(p) * partition_size;
+    const size_t count = start < length ? std::min<size_t>(partition_size, length - start) : 0;
+    if (count > 0)
+      std::memcpy(padded.data(), impulse_response + start, count * sizeof(float));
+
+    p_fft->forward(padded.data(), m_filter_re.get_channel(p), m_filter_im.get_channel(p));
+  }
+
+  reset();
+}
+
+/** @brief Clear the delay line and buffered input
+ */
+void Convolver::reset() noexcept
+{
+  m_history_re.clear();
+  m_history_im.clear();
+  m_work.clear();
+  m_history_head = 0;
+  m_position = 0;
+}
+
+/** @brief Convolve n_frames of input. Input and output may be the same buffer.
+ *  The output is the convolution delayed by get_latency() samples.
+ */
+void Convolver::process(const float *input, float *output, const unsigned int n_frames) noexcept
+{
+  if (m_partition_size == 0)
+  {
+    std::memset(output, 0, n_frames * sizeof(float));
+    return;
+  }
+
+  float *window = m_work.get_channel(InputWindow);
+  const float *block = m_work.get_channel(OutputBlock);
+
+  unsigned int offset = 0;
+  while (offset < n_frames)
+  {
+    const unsigned int count = std::min(n_frames - offset, m_partition_size - m_position);
+
+    // The second half of the window collects the current partition of input,
+    // while the previous partition's output is played out
+    std::memcpy(window + m_partition_size + m_position, input + offset, count * sizeof(float));
+    std::memcpy(output + offset, block + m_position, count * sizeof(float));
+
+    m_position += count;
+    offset += count;
+
+    if (m_position == m_partition_size)
+    {
+      process_partition();
+      m_position = 0;
+    }
+  }
+}
+
+void Convolver::process_partition() noexcept
+{
+  const unsigned int bins = m_bins;
+  float *window = m_work.get_channel(InputWindow);
+
+  // Newest input spectrum goes into the head of the frequency-domain delay line
+  m_history_head = m_history_head == 0 ? m_partition_count - 1 : m_history_head - 1;
+  p_fft->forward(window, m_history_re.get_channel(m_history_head), m_history_im.get_channel(m_history_head));
+
+  float *__restrict acc_re = m_work.get_channel(AccumulatorRe);
+  float *__restrict acc_im = m_work.get_channel(AccumulatorIm);
+  std::memset(acc_re, 0, bins * sizeof(float));
+  std::memset(acc_im, 0, bins * sizeof(float));
+
+  for (unsigned int p = 0; p < m_partition_count; ++p)
+  {
+    unsigned int slot = m_history_head + p;
+    if (slot >= m_partition_count)
+      slot -= m_partition_count;
+
+    const float *__restrict x_re = m_history_re.get_channel(slot);
+    const float *__restrict x_im = m_history_im.get_channel(slot);
+    const float *__restrict h_re = m_filter_re.get_channel(p);
+    const float *__restrict h_im = m_filter_im.get_channel(p);
+
+    for (unsigned int k = 0; k < bins; ++k)
+    {
+      acc_re[k] += x_re[k] * h_re[k] - x_im[k] * h_im[k];
+      acc_im[k] += x_re[k] * h_im[k] + x_im[k] * h_re[k];
+    }
+  }
+
+  float *time_domain = m_work.get_channel(TimeDomain);
+  p_fft->inverse(acc_re, acc_im, time_domain);
+
+  // Overlap-save: the second half is the valid linear convolution
+  std::memcpy(m_work.get_channel(OutputBlock), time_domain + m_partition_size, m_partition_size * sizeof(float));
+
+  // Slide the input window by one partition
+  std::memcpy(window, window + m_partition_size, m_partition_size * sizeof(float));
+}
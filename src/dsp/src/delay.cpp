@@ -0,0 +1,87 @@
+#include "delay.h"
+#include "audiokernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Dsp;
+
+/** @brief Delay constructor
+ *  @param max_delay_ms Longest delay time the lines are allocated for
+ */
+Delay::Delay(const float max_delay_ms):
+  IProcessor("Delay"),
+  m_max_delay_ms(max_delay_ms),
+  m_time_ms(250.0f),
+  m_feedback(0.35f),
+  m_mix(0.25f),
+  m_mask(0),
+  m_write_position(0)
+{
+}
+
+void Delay::do_prepare(const ProcessSpec &spec)
+{
+  const double max_samples = std::ceil(static_cast<double>(m_max_delay_ms) * 0.001 * spec.sample_rate);
+
+  unsigned int length = 1;
+  while (length < static_cast<unsigned int>(max_samples) + 1)
+    length <<= 1;
+
+  m_lines = AudioBuffer(spec.channels, length, spec.resource);
+  m_mask = length - 1;
+}
+
+/** @brief Time for the echoes to die away below silence, one delay time per repeat
+ */
+unsigned int Delay::get_tail_frames() const noexcept
+{
+  const double time_samples = std::ceil(static_cast<double>(get_time_ms()) * 0.001 * get_spec().sample_rate);
+  const double feedback = std::clamp(get_feedback(), 0.0f, 0.99f);
+
+  double repeats = 1.0;
+  if (feedback > 0.0)
+    repeats += std::ceil(std::log(static_cast<double>(Kernels::kSilenceThreshold)) / std::log(feedback));
+
+  return static_cast<unsigned int>(std::min(time_samples * repeats, static_cast<double>(kInfiniteTail - 1)));
+}
+
+/** @brief Clear the delay lines
+ */
+void Delay::reset() noexcept
+{
+  m_lines.clear();
+  m_write_position = 0;
+}
+
+void Delay::do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept
+{
+  const unsigned int channels = std::min(buffer.get_channels(), m_lines.get_channels());
+  if (channels == 0 || n_frames == 0)
+    return;
+
+  const double time_samples = static_cast<double>(m_time_ms.load(std::memory_order_relaxed)) * 0.001 * get_spec().sample_rate;
+  const unsigned int delay = std::clamp(static_cast<unsigned int>(std::lround(time_samples)), 1u, m_mask);
+  const float feedback = std::clamp(m_feedback.load(std::memory_order_relaxed), 0.0f, 0.99f);
+  const float wet = std::clamp(m_mix.load(std::memory_order_relaxed), 0.0f, 1.0f);
+  const float dry = 1.0f - wet;
+  const unsigned int mask = m_mask;
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    float *__restrict data = buffer.get_channel(ch);
+    float *__restrict line = m_lines.get_channel(ch);
+
+    unsigned int write = m_write_position;
+    for (unsigned int frame = 0; frame < n_frames; ++frame)
+    {
+      const float input = data[frame];
+      const float delayed = line[(write - delay) & mask];
+      line[write] = input + delayed * feedback;
+      data[frame] = input * dry + delayed * wet;
+      write = (write + 1) & mask;
+    }
+  }
+
+  m_write_position = (m_write_position + n_frames) & mask;
+}
@@ -0,0 +1,137 @@
+#include "delayline.h"
+
+#include <algorithm>
+
+using namespace Dsp;
+
+/** @brief DelayLine constructor. Allocates, so not on the audio thread.
+ *  @param channels Channels delayed
+ *  @param delay Delay in samples
+ *  @param max_frames Largest block passed through at once
+ *  @param resource Where the line is allocated
+ */
+DelayLine::DelayLine(const unsigned int channels, const unsigned int delay, const unsigned int max_frames,
+                     std::pmr::memory_resource *resource):
+  m_line(resource),
+  m_delay(delay),
+  m_mask(0),
+  m_write_position(0),
+  m_silent_frames(0)
+{
+  unsigned int length = 1;
+  while (length < delay + max_frames)
+    length <<= 1;
+
+  m_line.resize(channels, length);
+  m_line.clear();
+  m_mask = length - 1;
+}
+
+/** @brief Memory held by the line
+ */
+size_t DelayLine::get_bytes() const noexcept
+{
+  return static_cast<size_t>(m_line.get_channels()) * m_line.get_frames() * sizeof(float);
+}
+
+/** @brief Fill the line with silence
+ */
+void DelayLine::reset() noexcept
+{
+  m_line.clear();
+  m_write_position = 0;
+  m_silent_frames = 0;
+}
+
+/** @brief Delay a block in place. Audio thread only.
+ *  @param buffer Planar buffer with at least the line's channels
+ *  @param n_frames Number of frames, at most the max_frames the line was made for
+ *  @param silent Whether the block is known to be silent
+ *  @return Whether the delayed block is silent. A silent block may be left as it was.
+ */
+bool DelayLine::process(AudioBuffer &buffer, const unsigned int n_frames, const bool silent) noexcept
+{
+  if (!write(buffer, n_frames, silent))
+    return true;
+
+  const unsigned int channels = std::min(buffer.get_channels(), m_line.get_channels());
+  const unsigned int read = (m_write_position - m_delay - n_frames) & m_mask;
+  const unsigned int first = std::min(n_frames, m_mask + 1 - read);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    const float *line = m_line.get_channel(ch);
+    float *data = buffer.get_channel(ch);
+    std::copy_n(line + read, first, data);
+    std::copy_n(line, n_frames - first, data + first);
+  }
+
+  return m_silent_frames >= static_cast<uint64_t>(m_delay) + n_frames;
+}
+
+/** @brief Delay a block and add it to another buffer. The source is not modified. Audio thread only.
+ *  @param source Block to delay
+ *  @param destination Buffer the delayed block is added to
+ *  @param gain Gain applied to the delayed block, 0 only keeps the line current
+ *  @param n_frames Number of frames, at most the max_frames the line was made for
+ *  @param silent Whether the source block is known to be silent
+ *  @return Whether the delayed block was silent, and so not added
+ */
+bool DelayLine::mix(const AudioBuffer &source, AudioBuffer &destination, const float gain,
+                    const unsigned int n_frames, const bool silent) noexcept
+{
+  if (!write(source, n_frames, silent))
+    return true;
+
+  const bool delayed_silent = m_silent_frames >= static_cast<uint64_t>(m_delay) + n_frames;
+  if (gain == 0.0f || delayed_silent)
+    return delayed_silent;
+
+  const unsigned int channels = std::min(destination.get_channels(), m_line.get_channels());
+  const unsigned int read = (m_write_position - m_delay - n_frames) & m_mask;
+  const unsigned int first = std::min(n_frames, m_mask + 1 - read);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    const float *__restrict line = m_line.get_channel(ch);
+    float *__restrict out = destination.get_channel(ch);
+    for (unsigned int frame = 0; frame < first; ++frame)
+      out[frame] += gain * line[read + frame];
+    for (unsigned int frame = first; frame < n_frames; ++frame)
+      out[frame] += gain * line[frame - first];
+  }
+
+  return false;
+}
+
+/** @brief Append a block to the line.
+ *  @return False if the block was silent and the line already held nothing else, so it was skipped
+ */
+bool DelayLine::write(const AudioBuffer &source, const unsigned int n_frames, const bool silent) noexcept
+{
+  if (!silent)
+  {
+    m_silent_frames = 0;
+  }
+  else
+  {
+    if (m_silent_frames > m_mask)
+      return false;
+    m_silent_frames += n_frames;
+  }
+
+  const unsigned int channels = std::min(source.get_channels(), m_line.get_channels());
+  const unsigned int position = m_write_position;
+  const unsigned int first = std::min(n_frames, m_mask + 1 - position);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    const float *data = source.get_channel(ch);
+    float *line = m_line.get_channel(ch);
+    std::copy_n(data, first, line + position);
+    std::copy_n(data + first, n_frames - first, line);
+  }
+
+  m_write_position = (position + n_frames) & m_mask;
+  return true;
+}
@@ -0,0 +1,218 @@
+#include "fft.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+using namespace Dsp;
+
+/** @brief FftPlan constructor
+ *  @param size Transform size, a power of two of at least 4
+ *  @throws std::invalid_argument if size is not a power of two of at least 4
+ */
+FftPlan::FftPlan(const size_t size):
+  m_size(size),
+  m_half(size / 2)
+{
+  if (size < 4 || (size & (size - 1)) != 0)
+  {
+    throw std::invalid_argument("FftPlan: Size must be a power of two of at least 4");
+  }
+
+  // Bit reversal permutation of the half-size complex transform
+  unsigned int bits = 0;
+  while ((static_cast<size_t>(1) << bits) < m_half)
+    ++bits;
+
+  m_bit_reverse.resize(m_half);
+  for (size_t i = 0; i < m_half; ++i)
+  {
+    unsigned int reversed = 0;
+    for (unsigned int b = 0; b < bits; ++b)
+    {
+      if (i & (static_cast<size_t>(1) << b))
+        reversed |= 1u << (bits - 1 - b);
+    }
+    m_bit_reverse[i] = reversed;
+  }
+
+  // Stage with span `half` uses twiddles exp(-2*pi*i*k / (2 * half)), stored at [half - 1, 2 * half - 1)
+  m_stage_re.resize(m_half);
+  m_stage_im.resize(m_half);
+  for (size_t half = 1; half < m_half; half <<= 1)
+  {
+    for (size_t k = 0; k < half; ++k)
+    {
+      const double angle = -M_PI * static_cast<double>(k) / static_cast<double>(half);
+      m_stage_re[half - 1 + k] = static_cast<float>(std::cos(angle));
+      m_stage_im[half - 1 + k] = static_cast<float>(std::sin(angle));
+    }
+  }
+
+  m_real_re.resize(m_half);
+  m_real_im.resize(m_half);
+  for (size_t k = 0; k < m_half; ++k)
+  {
+    const double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(m_size);
+    m_real_re[k] = static_cast<float>(std::cos(angle));
+    m_real_im[k] = static_cast<float>(std::sin(angle));
+  }
+
+  m_scratch_re.resize(m_half);
+  m_scratch_im.resize(m_half);
+}
+
+/** @brief One span of radix-2 butterflies, kept separate so the loop vectorizes
+ */
+static void butterfly(float *__restrict a_re, float *__restrict a_im, float *__restrict b_re, float *__restrict b_im,
+                      const float *__restrict wr, const float *__restrict wi, const size_t half) noexcept
+{
+  for (size_t k = 0; k < half; ++k)
+  {
+    const float t_re = wr[k] * b_re[k] - wi[k] * b_im[k];
+    const float t_im = wr[k] * b_im[k] + wi[k] * b_re[k];
+    b_re[k] = a_re[k] - t_re;
+    b_im[k] = a_im[k] - t_im;
+    a_re[k] += t_re;
+    a_im[k] += t_im;
+  }
+}
+
+/** @brief In-place radix-2 complex FFT of size / 2 points, unnormalized.
+ *  Swapping the re and im arguments computes the inverse transform.
+ */
+void FftPlan::transform(float *re, float *im) const noexcept
+{
+  const size_t n = m_half;
+  const unsigned int *bit_reverse = m_bit_reverse.data();
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    const size_t j = bit_reverse[i];
+    if (i < j)
+    {
+      std::swap(re[i], re[j]);
+      std::swap(im[i], im[j]);
+    }
+  }
+
+  if (n == 2)
+  {
+    const float b_re = re[1];
+    const float b_im = im[1];
+    re[1] = re[0] - b_re;
+    im[1] = im[0] - b_im;
+    re[0] += b_re;
+    im[0] += b_im;
+    return;
+  }
+
+  // First two stages as one radix-4 pass, their twiddles are 1 and -i
+  for (size_t start = 0; start + 4 <= n; start += 4)
+  {
+    const float a_re = re[start] + re[start + 1];
+    const float a_im = im[start] + im[start + 1];
+    const float b_re = re[start] - re[start + 1];
+    const float b_im = im[start] - im[start + 1];
+    const float c_re = re[start + 2] + re[start + 3];
+    const float c_im = im[start + 2] + im[start + 3];
+    const float d_re = re[start + 2] - re[start + 3];
+    const float d_im = im[start + 2] - im[start + 3];
+
+    re[start] = a_re + c_re;
+    im[start] = a_im + c_im;
+    re[start + 2] = a_re - c_re;
+    im[start + 2] = a_im - c_im;
+    re[start + 1] = b_re + d_im;
+    im[start + 1] = b_im - d_re;
+    re[start + 3] = b_re - d_im;
+    im[start + 3] = b_im + d_re;
+  }
+
+  for (size_t half = 4; half < n; half <<= 1)
+  {
+    const float *__restrict wr = m_stage_re.data() + half - 1;
+    const float *__restrict wi = m_stage_im.data() + half - 1;
+
+    for (size_t start = 0; start < n; start += 2 * half)
+    {
+      butterfly(re + start, im + start, re + start + half, im + start + half, wr, wi, half);
+    }
+  }
+}
+
+/** @brief Forward real FFT, unnormalized.
+ *  @param input size real samples
+ *  @param out_re Real part of size / 2 + 1 bins
+ *  @param out_im Imaginary part of size / 2 + 1 bins
+ */
+void FftPlan::forward(const float *input, float *out_re, float *out_im) noexcept
+{
+  float *__restrict z_re = m_scratch_re.data();
+  float *__restrict z_im = m_scratch_im.data();
+
+  // Pack even samples into the real part and odd samples into the imaginary part
+  for (size_t n = 0; n < m_half; ++n)
+  {
+    z_re[n] = input[2 * n];
+    z_im[n] = input[2 * n + 1];
+  }
+
+  transform(z_re, z_im);
+
+  out_re[0] = z_re[0] + z_im[0];
+  out_im[0] = 0.0f;
+  out_re[m_half] = z_re[0] - z_im[0];
+  out_im[m_half] = 0.0f;
+
+  for (size_t k = 1; k < m_half; ++k)
+  {
+    // Separate the even and odd spectra, then combine them with one twiddle
+    const float c_re = z_re[m_half - k];
+    const float c_im = -z_im[m_half - k];
+    const float even_re = 0.5f * (z_re[k] + c_re);
+    const float even_im = 0.5f * (z_im[k] + c_im);
+    const float odd_re = 0.5f * (z_im[k] - c_im);
+    const float odd_im = -0.5f * (z_re[k] - c_re);
+
+    out_re[k] = even_re + m_real_re[k] * odd_re - m_real_im[k] * odd_im;
+    out_im[k] = even_im + m_real_re[k] * odd_im + m_real_im[k] * odd_re;
+  }
+}
+
+/** @brief Inverse real FFT, normalized so inverse(forward(x)) == x.
+ *  @param in_re Real part of size / 2 + 1 bins
+ *  @param in_im Imaginary part of size / 2 + 1 bins
+ *  @param output size real samples
+ */
+void FftPlan::inverse(const float *in_re, const float *in_im, float *output) noexcept
+{
+  float *__restrict z_re = m_scratch_re.data();
+  float *__restrict z_im = m_scratch_im.data();
+
+  for (size_t k = 0; k < m_half; ++k)
+  {
+    const float c_re = in_re[m_half - k];
+    const float c_im = -in_im[m_half - k];
+    const float even_re = 0.5f * (in_re[k] + c_re);
+    const float even_im = 0.5f * (in_im[k] + c_im);
+    const float diff_re = 0.5f * (in_re[k] - c_re);
+    const float diff_im = 0.5f * (in_im[k] - c_im);
+
+    // Multiply by the conjugate twiddle to recover the odd spectrum
+    const float odd_re = diff_re * m_real_re[k] + diff_im * m_real_im[k];
+    const float odd_im = diff_im * m_real_re[k] - diff_re * m_real_im[k];
+
+    z_re[k] = even_re - odd_im;
+    z_im[k] = even_im + odd_re;
+  }
+
+  transform(z_im, z_re);
+
+  const float scale = 1.0f / static_cast<float>(m_half);
+  for (size_t n = 0; n < m_half; ++n)
+  {
+    output[2 * n] = z_re[n] * scale;
+    output[2 * n + 1] = z_im[n] * scale;
+  }
+}
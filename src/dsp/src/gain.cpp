@@ -0,0 +1,113 @@
+#include "gain.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Dsp;
+
+static constexpr float kGainSmoothingMs = 5.0f;
+
+/** @brief Constant-power gains for the first channel pair, scaled by a linear level.
+ */
+static void pan_gains(const float level, const float pan, float &left, float &right)
+{
+  const float angle = (std::clamp(pan, -1.0f, 1.0f) + 1.0f) * 0.25f * static_cast<float>(M_PI);
+  left = level * std::cos(angle) * static_cast<float>(M_SQRT2);
+  right = level * std::sin(angle) * static_cast<float>(M_SQRT2);
+}
+
+/** @brief Gain constructor
+ *  Registers the gain and pan parameters.
+ */
+Gain::Gain():
+  IProcessor("Gain")
+{
+  ParameterStore &store = ParameterStore::instance();
+  m_gain_parameter = store.add(ParameterInfo{"Gain", -96.0f, 24.0f, 0.0f, eSmoothing::Linear, kGainSmoothingMs});
+  m_pan_parameter = store.add(ParameterInfo{"Pan", -1.0f, 1.0f, 0.0f, eSmoothing::Linear, kGainSmoothingMs});
+}
+
+/** @brief Gain destructor
+ */
+Gain::~Gain()
+{
+  ParameterStore &store = ParameterStore::instance();
+  if (store.contains(m_gain_parameter))
+    store.remove(m_gain_parameter);
+  if (store.contains(m_pan_parameter))
+    store.remove(m_pan_parameter);
+}
+
+/** @brief Set the level in dB, clamped to -96 to +24
+ */
+void Gain::set_gain_db(const float gain_db)
+{
+  ParameterStore::instance().set(m_gain_parameter, gain_db);
+}
+
+/** @brief Set the pan from -1 (left) to 1 (right)
+ */
+void Gain::set_pan(const float pan)
+{
+  ParameterStore::instance().set(m_pan_parameter, pan);
+}
+
+void Gain::do_prepare(const ProcessSpec &spec)
+{
+  m_left_gain.prepare(spec.sample_rate, kGainSmoothingMs, eSmoothing::Linear);
+  m_right_gain.prepare(spec.sample_rate, kGainSmoothingMs, eSmoothing::Linear);
+  m_level.prepare(spec.sample_rate, kGainSmoothingMs, eSmoothing::Linear);
+}
+
+/** @brief Jump straight to the current targets
+ */
+void Gain::reset() noexcept
+{
+  update_targets(get_spec().channels);
+  m_left_gain.reset(m_left_gain.get_target());
+  m_right_gain.reset(m_right_gain.get_target());
+  m_level.reset(m_level.get_target());
+}
+
+void Gain::update_targets(const unsigned int channels) noexcept
+{
+  const ParameterStore &store = ParameterStore::instance();
+  const float level = std::pow(10.0f, store.get(m_gain_parameter) / 20.0f);
+
+  float left = level;
+  float right = level;
+  if (channels >= 2)
+    pan_gains(level, store.get(m_pan_parameter), left, right);
+
+  m_left_gain.set_target(left);
+  m_right_gain.set_target(right);
+  m_level.set_target(level);
+}
+
+/** @brief Apply gain and pan, smoothing towards this block's parameter values
+ */
+void Gain::do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept
+{
+  const unsigned int channels = buffer.get_channels();
+  if (channels == 0 || n_frames == 0)
+    return;
+
+  update_targets(channels);
+
+  m_left_gain.apply(buffer.get_channel(0), n_frames);
+  if (channels >= 2)
+    m_right_gain.apply(buffer.get_channel(1), n_frames);
+  else
+    m_right_gain.skip(n_frames);
+
+  // Channels past the first pair follow the level only, each from the same ramp
+  if (channels > 2)
+  {
+    for (unsigned int ch = 2; ch < channels; ++ch)
+    {
+      SmoothedValue level = m_level;
+      level.apply(buffer.get_channel(ch), n_frames);
+    }
+  }
+  m_level.skip(n_frames);
+}
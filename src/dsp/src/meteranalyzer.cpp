@@ -0,0 +1,99 @@
+#include "meteranalyzer.h"
+#include "denormals.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace Dsp;
+
+/** @brief MeterAnalyzer constructor
+ */
+MeterAnalyzer::MeterAnalyzer() : IEngine("MeterAnalyzer"),
+  m_tap_count(0),
+  m_period_ms(30)
+{
+}
+
+/** @brief Start analyzing a tap - External API
+ */
+void MeterAnalyzer::add_tap(const std::shared_ptr<MeterTap> &tap)
+{
+  if (!tap)
+  {
+    throw std::invalid_argument("MeterAnalyzer: Tap is null");
+  }
+
+  push_message(MeterMessage{eMeterCommand::AddTap, tap});
+}
+
+/** @brief Stop analyzing a tap - External API
+ */
+void MeterAnalyzer::remove_tap(const std::shared_ptr<MeterTap> &tap)
+{
+  push_message(MeterMessage{eMeterCommand::RemoveTap, tap});
+}
+
+/** @brief Apply pending commands and analyze every tap once.
+ *  Called by the analyzer thread, or directly when the thread is not running.
+ */
+void MeterAnalyzer::process()
+{
+  handle_messages();
+
+  for (const auto &tap : m_taps)
+  {
+    tap->analyze();
+  }
+}
+
+/** @brief Run the analyzer below normal priority, so it only uses idle CPU time
+ */
+void MeterAnalyzer::run()
+{
+#ifdef __linux__
+  sched_param param{};
+  param.sched_priority = 0;
+  if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0)
+  {
+    LOG_INFO("MeterAnalyzer: Could not lower thread priority, continuing at normal priority.");
+  }
+#endif
+
+  // Peak fall-off and the spectrum of a fading tail decay towards zero
+  DenormalScope denormal_scope;
+
+  while (is_running())
+  {
+    process();
+    std::this_thread::sleep_for(get_period());
+  }
+}
+
+/** @brief Handle incoming messages for the MeterAnalyzer thread.
+ */
+void MeterAnalyzer::handle_messages()
+{
+  while (auto message = try_pop_message())
+  {
+    switch (message->command)
+    {
+      case eMeterCommand::AddTap:
+        if (std::find(m_taps.begin(), m_taps.end(), message->tap) == m_taps.end())
+          m_taps.push_back(message->tap);
+        break;
+      case eMeterCommand::RemoveTap:
+        m_taps.erase(std::remove(m_taps.begin(), m_taps.end(), message->tap), m_taps.end());
+        break;
+      default:
+        throw std::runtime_error("MeterAnalyzer: Invalid command received");
+    }
+
+    m_tap_count.store(m_taps.size(), std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,234 @@
+#include "metertap.h"
+#include "audiokernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Dsp;
+
+static constexpr float kSilenceDb = -120.0f;
+static constexpr double kRmsWindowSeconds = 0.3;
+static constexpr double kPeakFallDbPerSecond = 20.0;
+static constexpr double kRingSeconds = 0.5;
+static constexpr size_t kSpectrumHop = kSpectrumFftSize / 2;
+
+static float to_db(const float amplitude)
+{
+  return amplitude > 1e-6f ? 20.0f * std::log10(amplitude) : kSilenceDb;
+}
+
+static float power_to_db(const float power)
+{
+  return power > 1e-12f ? 10.0f * std::log10(power) : kSilenceDb;
+}
+
+/** @brief MeterTap constructor
+ */
+MeterTap::MeterTap(const std::string &name):
+  m_name(name),
+  m_sample_rate(0.0),
+  m_channels(0),
+  m_overruns(0),
+  m_new_samples(0)
+{
+  m_peak.fill(0.0f);
+  m_mean_square.fill(0.0f);
+
+  m_history.assign(kSpectrumFftSize, 0.0f);
+  m_windowed.assign(kSpectrumFftSize, 0.0f);
+  m_spectrum_re.assign(kSpectrumBins, 0.0f);
+  m_spectrum_im.assign(kSpectrumBins, 0.0f);
+  p_fft = std::make_unique<FftPlan>(kSpectrumFftSize);
+
+  // Hann window
+  m_window.resize(kSpectrumFftSize);
+  for (size_t n = 0; n < kSpectrumFftSize; ++n)
+  {
+    m_window[n] = 0.5f - 0.5f * static_cast<float>(std::cos(2.0 * M_PI * n / kSpectrumFftSize));
+  }
+
+  MeterLevels levels{};
+  levels.peak_db.fill(kSilenceDb);
+  levels.rms_db.fill(kSilenceDb);
+  m_levels.store(levels);
+
+  SpectrumFrame spectrum{};
+  spectrum.magnitude_db.fill(kSilenceDb);
+  m_spectrum.store(spectrum);
+}
+
+/** @brief Size the rings for a stream configuration. Never called while push() can run.
+ */
+void MeterTap::prepare(const ProcessSpec &spec)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_sample_rate = spec.sample_rate;
+  m_channels = std::min(spec.channels, kMaxMeterChannels);
+
+  const size_t ring_frames = static_cast<size_t>(spec.sample_rate * kRingSeconds);
+  m_mixdown = AudioBuffer(1, spec.max_frames, spec.resource);
+  m_sample_ring.resize(std::max(ring_frames, kSpectrumFftSize));
+  m_level_ring.resize(std::max<size_t>(ring_frames / std::max(spec.max_frames, 1u), 16));
+
+  m_peak.fill(0.0f);
+  m_mean_square.fill(0.0f);
+  std::fill(m_history.begin(), m_history.end(), 0.0f);
+  m_new_samples = 0;
+}
+
+/** @brief Record one block. Audio thread only, does not lock or allocate.
+ *  @param buffer Planar block to meter
+ *  @param n_frames Number of frames in the block
+ */
+void MeterTap::push(const AudioBuffer &buffer, const unsigned int n_frames) noexcept
+{
+  const unsigned int frames = std::min(n_frames, m_mixdown.get_frames());
+  const unsigned int channels = std::min(m_channels, buffer.get_channels());
+  if (frames == 0 || channels == 0)
+    return;
+
+  BlockLevels block;
+  block.frames = frames;
+  block.peak.fill(0.0f);
+  block.sum_squares.fill(0.0f);
+
+  float *__restrict mixdown = m_mixdown.get_channel(0);
+  const float scale = 1.0f / static_cast<float>(channels);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    const float *__restrict data = buffer.get_channel(ch);
+
+    Kernels::peak_and_energy(data, frames, block.peak[ch], block.sum_squares[ch]);
+
+    if (ch == 0)
+    {
+      for (unsigned int frame = 0; frame < frames; ++frame)
+        mixdown[frame] = data[frame] * scale;
+    }
+    else
+    {
+      for (unsigned int frame = 0; frame < frames; ++frame)
+        mixdown[frame] += data[frame] * scale;
+    }
+  }
+
+  const bool levels_written = m_level_ring.write(&block, 1) == 1;
+  const bool samples_written = m_sample_ring.write(mixdown, frames) == frames;
+  if (!levels_written || !samples_written)
+  {
+    m_overruns.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+/** @brief Record a silent block without reading it. Audio thread only.
+ *  @param n_frames Number of frames in the block
+ */
+void MeterTap::push_silence(const unsigned int n_frames) noexcept
+{
+  const unsigned int frames = std::min(n_frames, m_mixdown.get_frames());
+  if (frames == 0 || m_channels == 0)
+    return;
+
+  BlockLevels block;
+  block.frames = frames;
+  block.peak.fill(0.0f);
+  block.sum_squares.fill(0.0f);
+
+  m_mixdown.clear(frames);
+  const bool levels_written = m_level_ring.write(&block, 1) == 1;
+  const bool samples_written = m_sample_ring.write(m_mixdown.get_channel(0), frames) == frames;
+  if (!levels_written || !samples_written)
+  {
+    m_overruns.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+/** @brief Drain the rings and publish new levels and spectra. MeterAnalyzer thread only.
+ */
+void MeterTap::analyze()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_sample_rate <= 0.0)
+    return;
+
+  bool levels_changed = false;
+  BlockLevels block;
+  while (m_level_ring.read(&block, 1) == 1)
+  {
+    analyze_levels(block);
+    levels_changed = true;
+  }
+
+  if (levels_changed)
+  {
+    MeterLevels levels{};
+    levels.channels = m_channels;
+    levels.peak_db.fill(kSilenceDb);
+    levels.rms_db.fill(kSilenceDb);
+    for (unsigned int ch = 0; ch < m_channels; ++ch)
+    {
+      levels.peak_db[ch] = to_db(m_peak[ch]);
+      levels.rms_db[ch] = to_db(std::sqrt(m_mean_square[ch]));
+    }
+    m_levels.store(levels);
+  }
+
+  analyze_spectrum();
+}
+
+void MeterTap::analyze_levels(const BlockLevels &block)
+{
+  const double seconds = block.frames / m_sample_rate;
+  const float fall = static_cast<float>(std::pow(10.0, -kPeakFallDbPerSecond * seconds / 20.0));
+  const float alpha = static_cast<float>(1.0 - std::exp(-seconds / kRmsWindowSeconds));
+
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+  {
+    m_peak[ch] = std::max(m_peak[ch] * fall, block.peak[ch]);
+
+    const float mean_square = block.sum_squares[ch] / static_cast<float>(block.frames);
+    m_mean_square[ch] += alpha * (mean_square - m_mean_square[ch]);
+  }
+}
+
+void MeterTap::analyze_spectrum()
+{
+  // Slide new samples into the history and transform every half window
+  while (true)
+  {
+    const size_t wanted = kSpectrumHop - m_new_samples;
+    const size_t available = m_sample_ring.get_read_available();
+    if (available == 0)
+      return;
+
+    const size_t count = std::min(wanted, available);
+    std::copy(m_history.begin() + count, m_history.end(), m_history.begin());
+    m_sample_ring.read(m_history.data() + kSpectrumFftSize - count, count);
+    m_new_samples += count;
+
+    if (m_new_samples < kSpectrumHop)
+      return;
+    m_new_samples = 0;
+
+    for (size_t n = 0; n < kSpectrumFftSize; ++n)
+      m_windowed[n] = m_history[n] * m_window[n];
+
+    p_fft->forward(m_windowed.data(), m_spectrum_re.data(), m_spectrum_im.data());
+
+    // A full-scale sine reads 0 dBFS: the Hann window has a coherent gain of 0.5
+    const float scale = 4.0f / static_cast<float>(kSpectrumFftSize);
+    const float power_scale = scale * scale;
+
+    SpectrumFrame spectrum;
+    spectrum.sample_rate = static_cast<float>(m_sample_rate);
+    for (size_t k = 0; k < kSpectrumBins; ++k)
+    {
+      const float power = m_spectrum_re[k] * m_spectrum_re[k] + m_spectrum_im[k] * m_spectrum_im[k];
+      spectrum.magnitude_db[k] = power_to_db(power * power_scale);
+    }
+    m_spectrum.store(spectrum);
+  }
+}
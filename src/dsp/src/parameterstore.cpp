@@ -0,0 +1,271 @@
+#include "parameterstore.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Dsp;
+
+/** @brief ParameterStore constructor
+ *  Reserves every slot up front so the audio thread never sees them move.
+ */
+ParameterStore::ParameterStore():
+  p_slots(std::make_unique<Slot[]>(kMaxParameters)),
+  m_next_id(0),
+  m_count(0)
+{
+  for (size_t i = 0; i < kMaxParameters; ++i)
+  {
+    p_slots[i].value.store(0.0f, std::memory_order_relaxed);
+    p_slots[i].min_value.store(0.0f, std::memory_order_relaxed);
+    p_slots[i].max_value.store(0.0f, std::memory_order_relaxed);
+    p_slots[i].active.store(false, std::memory_order_relaxed);
+  }
+}
+
+/** @brief Register a parameter, starting at its default value.
+ *  @param info Name, range and smoothing of the parameter
+ *  @return The parameter's ID, stable until it is removed
+ *  @throws std::invalid_argument if the range is empty or the default is outside it.
+ *  @throws std::length_error if kMaxParameters parameters already exist.
+ */
+ParameterId ParameterStore::add(const ParameterInfo &info)
+{
+  if (!(info.min_value <= info.max_value) || info.default_value < info.min_value ||
+      info.default_value > info.max_value)
+  {
+    throw std::invalid_argument("ParameterStore: Invalid range for parameter " + info.name);
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  ParameterId id;
+  if (!m_free_ids.empty())
+  {
+    id = m_free_ids.back();
+    m_free_ids.pop_back();
+  }
+  else if (m_next_id < kMaxParameters)
+  {
+    id = m_next_id++;
+    m_info.resize(m_next_id);
+  }
+  else
+  {
+    throw std::length_error("ParameterStore: Too many parameters");
+  }
+
+  m_info[id] = info;
+
+  Slot &slot = p_slots[id];
+  slot.min_value.store(info.min_value, std::memory_order_relaxed);
+  slot.max_value.store(info.max_value, std::memory_order_relaxed);
+  slot.value.store(info.default_value, std::memory_order_relaxed);
+  slot.active.store(true, std::memory_order_release);
+  ++m_count;
+
+  return id;
+}
+
+/** @brief Remove a parameter and its automation. The ID may be reused by a later add().
+ *  @throws std::out_of_range if the ID is not a registered parameter.
+ */
+void ParameterStore::remove(const ParameterId id)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  check_locked(id);
+
+  auto it = std::find_if(m_automation.begin(), m_automation.end(), [id](const AutomationEntry &entry)
+  {
+    return entry.id == id;
+  });
+  if (it != m_automation.end())
+  {
+    m_automation.erase(it);
+    publish_automation_locked();
+  }
+
+  p_slots[id].active.store(false, std::memory_order_release);
+  m_free_ids.push_back(id);
+  --m_count;
+}
+
+/** @brief Set a parameter, clamped to its range. Lock-free.
+ *  @throws std::out_of_range if the ID is not a registered parameter.
+ */
+void ParameterStore::set(const ParameterId id, const float value)
+{
+  if (!contains(id))
+  {
+    throw std::out_of_range("Parameter ID out of range");
+  }
+
+  store_clamped(id, value);
+}
+
+/** @brief Set a parameter from 0 to 1 across its range. Lock-free.
+ */
+void ParameterStore::set_normalized(const ParameterId id, const float normalized)
+{
+  if (!contains(id))
+  {
+    throw std::out_of_range("Parameter ID out of range");
+  }
+
+  const float min_value = p_slots[id].min_value.load(std::memory_order_relaxed);
+  const float max_value = p_slots[id].max_value.load(std::memory_order_relaxed);
+  store_clamped(id, min_value + (max_value - min_value) * normalized);
+}
+
+void ParameterStore::reset_to_default(const ParameterId id)
+{
+  set(id, get_info(id).default_value);
+}
+
+/** @brief Range, smoothing and name of a parameter.
+ *  @throws std::out_of_range if the ID is not a registered parameter.
+ */
+ParameterInfo ParameterStore::get_info(const ParameterId id) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  check_locked(id);
+  return m_info[id];
+}
+
+bool ParameterStore::contains(const ParameterId id) const noexcept
+{
+  return id < kMaxParameters && p_slots[id].active.load(std::memory_order_acquire);
+}
+
+size_t ParameterStore::get_count() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_count;
+}
+
+/** @brief Drive a parameter from an automation lane, replacing any previous lane.
+ *  @param id The parameter
+ *  @param lane The lane, which must not be modified afterwards
+ *  @throws std::out_of_range if the ID is not a registered parameter.
+ */
+void ParameterStore::set_automation(const ParameterId id, std::shared_ptr<const AutomationLane> lane)
+{
+  if (!lane)
+  {
+    throw std::invalid_argument("ParameterStore: Automation lane is null");
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  check_locked(id);
+
+  auto it = std::find_if(m_automation.begin(), m_automation.end(), [id](const AutomationEntry &entry)
+  {
+    return entry.id == id;
+  });
+
+  if (it != m_automation.end())
+    it->lane = std::move(lane);
+  else
+    m_automation.push_back(AutomationEntry{id, std::move(lane), 0});
+
+  publish_automation_locked();
+}
+
+/** @brief Stop automating a parameter. It keeps its last value.
+ */
+void ParameterStore::clear_automation(const ParameterId id)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = std::find_if(m_automation.begin(), m_automation.end(), [id](const AutomationEntry &entry)
+  {
+    return entry.id == id;
+  });
+  if (it == m_automation.end())
+    return;
+
+  m_automation.erase(it);
+  publish_automation_locked();
+}
+
+bool ParameterStore::has_automation(const ParameterId id) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return std::any_of(m_automation.begin(), m_automation.end(), [id](const AutomationEntry &entry)
+  {
+    return entry.id == id;
+  });
+}
+
+/** @brief Write every automated parameter's value for a timeline position.
+ *  Called once per block from the audio thread, before the block is rendered.
+ *  @param position Timeline position of the start of the block, in samples
+ */
+void ParameterStore::process_automation(const uint64_t position) noexcept
+{
+  auto automation = m_automation_set.read();
+  if (!automation)
+    return;
+
+  apply_automation(automation->entries, position);
+}
+
+/** @brief Copy the automation lanes for an offline render, with cursors of its own.
+ *  Lanes set or cleared afterwards do not change the copy.
+ */
+ParameterStore::OfflineAutomation ParameterStore::capture_automation() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  OfflineAutomation automation;
+  automation.m_entries = m_automation;
+  for (AutomationEntry &entry : automation.m_entries)
+  {
+    entry.cursor = 0;
+  }
+  return automation;
+}
+
+/** @brief Write every automated parameter's value for a position of an offline render.
+ *  The audio thread must not be processing automation at the same time, as
+ *  both write the same parameters.
+ *  @param position Timeline position of the start of the block, in samples
+ *  @param automation The lanes captured for the render, whose cursors are moved
+ */
+void ParameterStore::process_automation(const uint64_t position, OfflineAutomation &automation) noexcept
+{
+  apply_automation(automation.m_entries, position);
+}
+
+void ParameterStore::check_locked(const ParameterId id) const
+{
+  if (id >= m_info.size() || !p_slots[id].active.load(std::memory_order_relaxed))
+  {
+    throw std::out_of_range("Parameter ID out of range");
+  }
+}
+
+void ParameterStore::store_clamped(const ParameterId id, const float value) noexcept
+{
+  Slot &slot = p_slots[id];
+  const float min_value = slot.min_value.load(std::memory_order_relaxed);
+  const float max_value = slot.max_value.load(std::memory_order_relaxed);
+  slot.value.store(std::clamp(value, min_value, max_value), std::memory_order_relaxed);
+}
+
+void ParameterStore::publish_automation_locked()
+{
+  auto automation = std::make_unique<AutomationSet>();
+  automation->entries = m_automation;
+  m_automation_set.publish(std::move(automation));
+}
+
+void ParameterStore::apply_automation(const std::vector<AutomationEntry> &entries, const uint64_t position) noexcept
+{
+  for (const AutomationEntry &entry : entries)
+  {
+    if (entry.lane->empty())
+      continue;
+
+    store_clamped(entry.id, entry.lane->value_at(position, entry.cursor));
+  }
+}
@@ -0,0 +1,104 @@
+#include "processor.h"
+
+#include <chrono>
+
+using namespace Dsp;
+
+/** @brief IProcessor constructor
+ *  @param name Display name used in statistics
+ */
+IProcessor::IProcessor(const std::string &name):
+  m_name(name),
+  m_spec{0.0, 0, 0, std::pmr::get_default_resource()},
+  m_bypassed(false),
+  m_reset_pending(false),
+  m_blocks_processed(0),
+  m_frames_processed(0),
+  m_total_ns(0),
+  m_last_ns(0),
+  m_peak_ns(0)
+{
+}
+
+/** @brief Bypass or re-enable the processor.
+ *  A bypassed processor is skipped entirely. Its state is cleared on the audio
+ *  thread before the next block it processes, so old tails do not replay.
+ */
+void IProcessor::set_bypassed(const bool bypassed) noexcept
+{
+  if (!bypassed && m_bypassed.load(std::memory_order_relaxed))
+    m_reset_pending.store(true, std::memory_order_relaxed);
+
+  m_bypassed.store(bypassed, std::memory_order_relaxed);
+}
+
+/** @brief Allocate state for a stream configuration. Not on the audio thread.
+ *  @param spec The stream configuration
+ */
+void IProcessor::prepare(const ProcessSpec &spec)
+{
+  m_spec = spec;
+  do_prepare(spec);
+  reset();
+}
+
+/** @brief Process one block in place and record the time spent.
+ *  @param buffer Planar buffer processed in place
+ *  @param n_frames Number of frames to process, at most the prepared max_frames
+ */
+void IProcessor::process(AudioBuffer &buffer, const unsigned int n_frames) noexcept
+{
+  if (m_bypassed.load(std::memory_order_relaxed))
+    return;
+
+  if (m_reset_pending.exchange(false, std::memory_order_relaxed))
+    reset();
+
+  const auto start = std::chrono::steady_clock::now();
+  do_process(buffer, n_frames);
+  const auto end = std::chrono::steady_clock::now();
+
+  // Only the audio thread writes these, so plain load/store pairs are enough
+  const uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  m_last_ns.store(ns, std::memory_order_relaxed);
+  m_total_ns.store(m_total_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+  m_frames_processed.store(m_frames_processed.load(std::memory_order_relaxed) + n_frames, std::memory_order_relaxed);
+  m_blocks_processed.store(m_blocks_processed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (ns > m_peak_ns.load(std::memory_order_relaxed))
+    m_peak_ns.store(ns, std::memory_order_relaxed);
+}
+
+/** @brief Return a copy of the processor statistics
+ */
+ProcessorStatistics IProcessor::get_statistics() const
+{
+  ProcessorStatistics statistics;
+
+  statistics.name = m_name;
+  statistics.bypassed = is_bypassed();
+  statistics.blocks_processed = m_blocks_processed.load(std::memory_order_relaxed);
+  statistics.last_ns = m_last_ns.load(std::memory_order_relaxed);
+  statistics.peak_ns = m_peak_ns.load(std::memory_order_relaxed);
+
+  const uint64_t total_ns = m_total_ns.load(std::memory_order_relaxed);
+  const uint64_t frames = m_frames_processed.load(std::memory_order_relaxed);
+
+  statistics.average_ns = statistics.blocks_processed > 0 ?
+    static_cast<double>(total_ns) / static_cast<double>(statistics.blocks_processed) : 0.0;
+
+  const double audio_ns = m_spec.sample_rate > 0.0 ? static_cast<double>(frames) / m_spec.sample_rate * 1e9 : 0.0;
+  statistics.dsp_load = audio_ns > 0.0 ? static_cast<double>(total_ns) / audio_ns : 0.0;
+
+  return statistics;
+}
+
+/** @brief Clear the timing statistics. Not synchronized with a running block.
+ */
+void IProcessor::reset_statistics() noexcept
+{
+  m_blocks_processed.store(0, std::memory_order_relaxed);
+  m_frames_processed.store(0, std::memory_order_relaxed);
+  m_total_ns.store(0, std::memory_order_relaxed);
+  m_last_ns.store(0, std::memory_order_relaxed);
+  m_peak_ns.store(0, std::memory_order_relaxed);
+}
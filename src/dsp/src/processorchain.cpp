@@ -0,0 +1,239 @@
+#include "processorchain.h"
+#include "audiokernels.h"
+
+#include <stdexcept>
+
+using namespace Dsp;
+
+/** @brief Prepare every processor for a stream configuration.
+ *  Must not be called while process() can run on the audio thread.
+ *  @param spec The stream configuration
+ */
+void ProcessorChain::prepare(const ProcessSpec &spec)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_spec = spec;
+  m_idle_frames = 0;
+  for (auto &processor : m_processors)
+  {
+    processor->prepare(spec);
+  }
+}
+
+/** @brief Append a processor to the end of the chain.
+ *  @param processor The processor, prepared here if the chain has a stream configuration
+ *  @return The index of the processor in the chain
+ */
+size_t ProcessorChain::add(std::shared_ptr<IProcessor> processor)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (!processor)
+  {
+    throw std::invalid_argument("ProcessorChain: Processor is null");
+  }
+
+  if (m_spec)
+    processor->prepare(*m_spec);
+
+  m_processors.push_back(std::move(processor));
+  publish_locked();
+
+  return m_processors.size() - 1;
+}
+
+/** @brief Insert a processor before an index.
+ *  @throws std::out_of_range if the index is past the end of the chain.
+ */
+void ProcessorChain::insert(const size_t index, std::shared_ptr<IProcessor> processor)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (index > m_processors.size())
+  {
+    throw std::out_of_range("Processor index out of range");
+  }
+
+  if (!processor)
+  {
+    throw std::invalid_argument("ProcessorChain: Processor is null");
+  }
+
+  if (m_spec)
+    processor->prepare(*m_spec);
+
+  m_processors.insert(m_processors.begin() + index, std::move(processor));
+  publish_locked();
+}
+
+/** @brief Remove a processor by index.
+ *  @throws std::out_of_range if the index is invalid.
+ */
+void ProcessorChain::remove(const size_t index)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (index >= m_processors.size())
+  {
+    throw std::out_of_range("Processor index out of range");
+  }
+
+  m_processors.erase(m_processors.begin() + index);
+  publish_locked();
+}
+
+/** @brief Move a processor to a new position in the chain.
+ *  @throws std::out_of_range if either index is invalid.
+ */
+void ProcessorChain::move(const size_t from, const size_t to)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (from >= m_processors.size() || to >= m_processors.size())
+  {
+    throw std::out_of_range("Processor index out of range");
+  }
+
+  auto processor = m_processors[from];
+  m_processors.erase(m_processors.begin() + from);
+  m_processors.insert(m_processors.begin() + to, std::move(processor));
+  publish_locked();
+}
+
+/** @brief Remove every processor from the chain.
+ */
+void ProcessorChain::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_processors.clear();
+  publish_locked();
+}
+
+/** @brief Get a processor by index.
+ *  @throws std::out_of_range if the index is invalid.
+ */
+std::shared_ptr<IProcessor> ProcessorChain::get(const size_t index) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (index >= m_processors.size())
+  {
+    throw std::out_of_range("Processor index out of range");
+  }
+
+  return m_processors[index];
+}
+
+size_t ProcessorChain::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_processors.size();
+}
+
+/** @brief Run every processor in order on the buffer. Audio thread only.
+ *  @param buffer Planar buffer processed in place
+ *  @param n_frames Number of frames to process
+ *  @param silent Whether the buffer is known to be silent
+ *  @return Whether the output is silent. A silent buffer that is not processed is left as it was.
+ */
+bool ProcessorChain::process(AudioBuffer &buffer, const unsigned int n_frames, const bool silent) noexcept
+{
+  auto snapshot = m_snapshot.read();
+  if (!snapshot)
+    return silent;
+
+  if (silent)
+  {
+    uint64_t tail = 0;
+    for (const IProcessor *processor : snapshot->processors)
+    {
+      if (processor->is_bypassed())
+        continue;
+
+      const unsigned int frames = processor->get_tail_frames();
+      if (frames == IProcessor::kInfiniteTail)
+      {
+        tail = UINT64_MAX;
+        break;
+      }
+      tail += static_cast<uint64_t>(frames) + processor->get_latency();
+    }
+
+    if (m_idle_frames >= tail)
+      return true;
+
+    m_idle_frames += n_frames;
+  }
+  else
+  {
+    m_idle_frames = 0;
+  }
+
+  for (IProcessor *processor : snapshot->processors)
+  {
+    processor->process(buffer, n_frames);
+  }
+
+  // A tail that has already died away needs no mixing
+  return silent && Kernels::is_silent(buffer.get_channel_pointers(), buffer.get_channels(), n_frames);
+}
+
+/** @brief Return the statistics of every processor, in chain order
+ */
+std::vector<ProcessorStatistics> ProcessorChain::get_statistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::vector<ProcessorStatistics> statistics;
+  statistics.reserve(m_processors.size());
+  for (const auto &processor : m_processors)
+  {
+    statistics.push_back(processor->get_statistics());
+  }
+
+  return statistics;
+}
+
+/** @brief Total DSP load of the chain, as a fraction of real time
+ */
+double ProcessorChain::get_dsp_load() const
+{
+  double load = 0.0;
+  for (const auto &statistics : get_statistics())
+  {
+    load += statistics.dsp_load;
+  }
+
+  return load;
+}
+
+/** @brief Total latency of the processors that are not bypassed, in samples
+ */
+unsigned int ProcessorChain::get_latency() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  unsigned int latency = 0;
+  for (const auto &processor : m_processors)
+  {
+    if (!processor->is_bypassed())
+      latency += processor->get_latency();
+  }
+
+  return latency;
+}
+
+void ProcessorChain::publish_locked()
+{
+  auto snapshot = std::make_unique<Snapshot>();
+  snapshot->owners = m_processors;
+  snapshot->processors.reserve(m_processors.size());
+  for (const auto &processor : m_processors)
+  {
+    snapshot->processors.push_back(processor.get());
+  }
+
+  m_snapshot.publish(std::move(snapshot));
+}
@@ -0,0 +1,230 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+using namespace Dsp;
+
+namespace
+{
+
+// Keeps the transition band below the new Nyquist frequency
+static constexpr double kCutoffScale = 0.95;
+
+double blackman(const double x)
+{
+  if (std::abs(x) >= 1.0)
+    return 0.0;
+  return 0.42 + 0.5 * std::cos(M_PI * x) + 0.08 * std::cos(2.0 * M_PI * x);
+}
+
+double sinc(const double x)
+{
+  if (x == 0.0)
+    return 1.0;
+  return std::sin(M_PI * x) / (M_PI * x);
+}
+
+}  // namespace
+
+/** @brief Resampler constructor
+ */
+Resampler::Resampler():
+  m_channels(0),
+  m_input_rate(0),
+  m_output_rate(0),
+  m_step_whole(1),
+  m_step_fraction(0),
+  m_denominator(1),
+  m_buffered(0),
+  m_index(0),
+  m_fraction(0),
+  m_frames_in(0),
+  m_frames_out(0)
+{
+}
+
+/** @brief Build the kernel table and history for a rate pair. Allocates.
+ *  @param channels Channels per frame
+ *  @param input_rate Sample rate of the input in Hz
+ *  @param output_rate Sample rate of the output in Hz
+ *  @param max_input_frames Largest block passed to process()
+ *  @throws std::invalid_argument if a rate or the channel count is zero
+ */
+void Resampler::prepare(const unsigned int channels, const unsigned int input_rate, const unsigned int output_rate,
+                        const unsigned int max_input_frames)
+{
+  if (channels == 0 || input_rate == 0 || output_rate == 0)
+  {
+    throw std::invalid_argument("Resampler: Invalid format");
+  }
+
+  m_channels = channels;
+  m_input_rate = input_rate;
+  m_output_rate = output_rate;
+
+  const uint64_t divisor = std::gcd(input_rate, output_rate);
+  m_denominator = output_rate / divisor;
+  m_step_whole = (input_rate / divisor) / m_denominator;
+  m_step_fraction = (input_rate / divisor) % m_denominator;
+
+  const double cutoff = std::min(1.0, static_cast<double>(output_rate) / input_rate) * kCutoffScale;
+  m_table.assign(static_cast<size_t>(kPhases + 1) * kTaps, 0.0f);
+  for (unsigned int phase = 0; phase <= kPhases; ++phase)
+  {
+    float *row = &m_table[static_cast<size_t>(phase) * kTaps];
+    double sum = 0.0;
+    for (unsigned int tap = 0; tap < kTaps; ++tap)
+    {
+      const double distance = static_cast<double>(tap) - (kHalfTaps - 1) - static_cast<double>(phase) / kPhases;
+      const double weight = cutoff * sinc(cutoff * distance) * blackman(distance / kHalfTaps);
+      row[tap] = static_cast<float>(weight);
+      sum += weight;
+    }
+
+    // Unity gain at DC for every phase
+    for (unsigned int tap = 0; tap < kTaps; ++tap)
+      row[tap] = static_cast<float>(row[tap] / sum);
+  }
+
+  m_history = AudioBuffer(channels, kTaps * 2 + std::max(max_input_frames, kTaps));
+  reset();
+}
+
+/** @brief Forget the stream, as before the first block.
+ */
+void Resampler::reset() noexcept
+{
+  m_history.clear(m_history.get_frames());
+
+  // The kernel is centred on the first input sample
+  m_buffered = kHalfTaps - 1;
+  m_index = kHalfTaps - 1;
+  m_fraction = 0;
+  m_frames_in = 0;
+  m_frames_out = 0;
+}
+
+/** @brief Upper bound on the frames process() or flush() writes for a block.
+ */
+unsigned int Resampler::get_max_output_frames(const unsigned int n_input_frames) const noexcept
+{
+  const uint64_t frames = std::max<uint64_t>(n_input_frames, kTaps);
+  return static_cast<unsigned int>((frames * m_output_rate + m_input_rate - 1) / m_input_rate + 2);
+}
+
+/** @brief Convert one block.
+ *  @param input Planar input with the prepared channel count
+ *  @param n_frames Input frames, at most the prepared maximum
+ *  @param output Planar output with room for get_max_output_frames(n_frames)
+ *  @return Output frames written
+ */
+unsigned int Resampler::process(const AudioBuffer &input, const unsigned int n_frames, AudioBuffer &output) noexcept
+{
+  unsigned int written = 0;
+  unsigned int offset = 0;
+  while (offset < n_frames)
+  {
+    const unsigned int appended = append(input, offset, n_frames - offset);
+    offset += appended;
+    m_frames_in += appended;
+
+    written = render(output, written, UINT64_MAX);
+    discard_consumed();
+
+    if (appended == 0)
+      break;
+  }
+  return written;
+}
+
+/** @brief Emit the output still held back by the kernel at the end of the stream.
+ *  @param output Planar output with room for get_max_output_frames(0)
+ *  @return Output frames written
+ */
+unsigned int Resampler::flush(AudioBuffer &output) noexcept
+{
+  const uint64_t total = (m_frames_in * m_output_rate + m_input_rate - 1) / m_input_rate;
+
+  // Zeros after the last input let the kernel reach the final samples
+  const unsigned int room = m_history.get_frames() - m_buffered;
+  const unsigned int zeros = std::min(room, kHalfTaps + 1);
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+    std::memset(m_history.get_channel(ch) + m_buffered, 0, zeros * sizeof(float));
+  m_buffered += zeros;
+
+  const unsigned int written = render(output, 0, total);
+  discard_consumed();
+  return written;
+}
+
+unsigned int Resampler::append(const AudioBuffer &input, const unsigned int offset, const unsigned int n_frames) noexcept
+{
+  const unsigned int frames = std::min(n_frames, m_history.get_frames() - m_buffered);
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+  {
+    std::memcpy(m_history.get_channel(ch) + m_buffered, input.get_channel(ch) + offset, frames * sizeof(float));
+  }
+  m_buffered += frames;
+  return frames;
+}
+
+unsigned int Resampler::render(AudioBuffer &output, unsigned int written, const uint64_t limit) noexcept
+{
+  const unsigned int capacity = output.get_frames();
+  while (m_index + kHalfTaps < m_buffered && written < capacity && m_frames_out < limit)
+  {
+    const double position = static_cast<double>(m_fraction) * kPhases / static_cast<double>(m_denominator);
+    const unsigned int phase = std::min(static_cast<unsigned int>(position), kPhases - 1);
+    const float blend = static_cast<float>(position - phase);
+    const float *row = &m_table[static_cast<size_t>(phase) * kTaps];
+    const float *next_row = row + kTaps;
+    const size_t first = m_index + 1 - kHalfTaps;
+
+    for (unsigned int ch = 0; ch < m_channels; ++ch)
+    {
+      const float *in = m_history.get_channel(ch) + first;
+      float a = 0.0f;
+      float b = 0.0f;
+      for (unsigned int tap = 0; tap < kTaps; ++tap)
+      {
+        a += in[tap] * row[tap];
+        b += in[tap] * next_row[tap];
+      }
+      output.get_channel(ch)[written] = a + (b - a) * blend;
+    }
+
+    ++written;
+    ++m_frames_out;
+
+    m_index += m_step_whole;
+    m_fraction += m_step_fraction;
+    if (m_fraction >= m_denominator)
+    {
+      m_fraction -= m_denominator;
+      ++m_index;
+    }
+  }
+  return written;
+}
+
+/** @brief Drop input the kernel will not read again.
+ */
+void Resampler::discard_consumed() noexcept
+{
+  const uint64_t keep_from = m_index + 1 - kHalfTaps;
+  const unsigned int drop = static_cast<unsigned int>(std::min<uint64_t>(keep_from, m_buffered));
+  if (drop == 0)
+    return;
+
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+  {
+    float *history = m_history.get_channel(ch);
+    std::memmove(history, history + drop, (m_buffered - drop) * sizeof(float));
+  }
+  m_buffered -= drop;
+  m_index -= drop;
+}
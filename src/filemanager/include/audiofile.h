@@ -0,0 +1,65 @@
+#ifndef __AUDIO_FILE_H__
+#define __AUDIO_FILE_H__
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sndfile.h>
+
+#include "filemanager.h"
+#include "audiobuffer.h"
+
+namespace Files
+{
+
+/** @class AudioFile
+ *  @brief Reads any format libsndfile decodes: WAV, AIFF, FLAC, Ogg Vorbis, Opus and MP3.
+ *  Compressed formats decode on the calling thread, see AudioStream for playback.
+ */
+class AudioFile : public File
+{
+friend class FileManager;
+
+public:
+  virtual ~AudioFile() = default;
+
+  unsigned int get_sample_rate() const
+  {
+    return (unsigned int)m_sfinfo.samplerate;
+  }
+
+  unsigned int get_channels() const
+  {
+    return (unsigned int)m_sfinfo.channels;
+  }
+
+  unsigned int get_format() const
+  {
+    return (unsigned int)m_sfinfo.format;
+  }
+
+  sf_count_t get_frames() const
+  {
+    return m_sfinfo.frames;
+  }
+
+  bool is_compressed() const;
+
+  unsigned int read(AudioBuffer &buffer, const unsigned int n_frames);
+  void seek(const sf_count_t frame);
+
+protected:
+  AudioFile(const std::filesystem::path &path);
+
+private:
+  SF_INFO m_sfinfo;
+  std::shared_ptr<SNDFILE> m_sndfile;
+
+  // Interleaved staging buffer, split into planar channels after each read
+  std::vector<float> m_read_buffer;
+};
+
+}  // namespace Files
+
+#endif  // __AUDIO_FILE_H__
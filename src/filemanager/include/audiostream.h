@@ -0,0 +1,209 @@
+#ifndef __AUDIO_STREAM_H__
+#define __AUDIO_STREAM_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "audiobuffer.h"
+#include "ringbuffer.h"
+
+namespace Files
+{
+
+class AudioFile;
+
+/** @struct AudioStreamConfig
+ *  @brief Read-ahead of one stream
+ */
+struct AudioStreamConfig
+{
+  unsigned int block_frames = 4096;     // Frames decoded at a time
+  unsigned int blocks = 24;             // Blocks decoded ahead of the audio thread
+  unsigned int preload_frames = 48000;  // Decoded at open from the cue frame, so playback starts there at once
+};
+
+/** @struct AudioStreamStatistics
+ *  @brief Decoding cost and health of one stream
+ */
+struct AudioStreamStatistics
+{
+  uint64_t frames_decoded;
+  double decode_seconds;  // Decoder thread CPU time
+  double cpu_load;        // Decode time per second of audio decoded, 0.01 is 1% of a core during playback
+  uint64_t underruns;     // Audio thread reads that found nothing decoded yet
+  uint64_t seeks;         // Jumps the decoder had to make
+  size_t buffered_frames;
+};
+
+/** @class AudioStream
+ *  @brief Plays an AudioFile of any format without decoding on the audio thread.
+ *
+ *  A StreamDecoder thread decodes ahead into a pool of blocks. Filled blocks
+ *  pass to the audio thread and come back empty through two lock-free rings,
+ *  so neither side waits for the other. The audio thread asks for frames by
+ *  position. A read that does not follow on from the last one posts a seek,
+ *  which the decoder picks up on its next pass.
+ *
+ *  Seeking compressed formats is slow, so the frames from the cue frame
+ *  (a clip's offset) are decoded once at open and held in memory. Starting
+ *  at the cue plays from there while the decoder seeks past it. Each stream
+ *  is read by one clip.
+ */
+class AudioStream
+{
+  friend class StreamDecoder;
+
+public:
+  static std::shared_ptr<AudioStream> open(const std::filesystem::path &path, const uint64_t cue_frame = 0,
+                                           const AudioStreamConfig &config = AudioStreamConfig{});
+  ~AudioStream();
+
+  AudioStream(const AudioStream&) = delete;
+  AudioStream& operator=(const AudioStream&) = delete;
+
+  unsigned int mix(AudioBuffer &output, const unsigned int destination, const uint64_t frame,
+                   const unsigned int n_frames, const float gain) noexcept;
+
+  unsigned int get_channels() const noexcept { return m_channels; }
+  unsigned int get_sample_rate() const noexcept { return m_sample_rate; }
+  uint64_t get_frames() const noexcept { return m_frames; }
+  uint64_t get_cue_frame() const noexcept { return m_cue_frame; }
+  bool is_compressed() const noexcept { return m_compressed; }
+  std::filesystem::path get_filepath() const;
+
+  size_t get_buffered_frames() const noexcept;
+  AudioStreamStatistics get_statistics() const noexcept;
+
+private:
+  /** @struct Block
+   *  @brief Decoded frames from start, written by the decoder before the block is passed on
+   */
+  struct Block
+  {
+    AudioBuffer audio;
+    uint64_t start = 0;
+    unsigned int frames = 0;
+    uint32_t generation = 0;
+  };
+
+  AudioStream(std::shared_ptr<AudioFile> file, const uint64_t cue_frame, const AudioStreamConfig &config);
+
+  // Audio thread
+  bool acquire_block(const uint64_t frame) noexcept;
+  void release_block() noexcept;
+  void request(const uint64_t frame) noexcept;
+
+  // Decoder thread
+  bool service();
+
+  std::shared_ptr<AudioFile> p_file;
+  unsigned int m_channels;
+  unsigned int m_sample_rate;
+  uint64_t m_frames;
+  bool m_compressed;
+  AudioStreamConfig m_config;
+
+  uint64_t m_cue_frame;
+  AudioBuffer m_preload;
+  uint64_t m_preload_end;
+
+  std::vector<Block> m_blocks;
+  RingBuffer<uint32_t> m_filled;  // Decoder to audio thread
+  RingBuffer<uint32_t> m_free;    // Audio thread to decoder
+
+  // Generation in the top 16 bits, frame in the rest
+  std::atomic<uint64_t> m_request;
+
+  // Audio thread state
+  static constexpr uint32_t kNoBlock = UINT32_MAX;
+  uint32_t m_current;
+  uint32_t m_generation;
+  uint64_t m_request_frame;
+  uint64_t m_next_frame;  // Where the decoder's next block for m_generation starts
+
+  // Decoder state, one decoder thread at a time
+  std::mutex m_service_mutex;
+  uint32_t m_decoder_generation;
+  uint64_t m_decoder_position;
+  uint32_t m_held;
+
+  std::atomic<uint64_t> m_frames_decoded;
+  std::atomic<uint64_t> m_decode_ns;
+  std::atomic<uint64_t> m_underruns;
+  std::atomic<uint64_t> m_seeks;
+};
+
+/** @class StreamDecoder
+ *  @brief The background threads that decode ahead for every open AudioStream.
+ *
+ *  Workers visit the streams in turn and fill whatever blocks the audio
+ *  thread has returned, sleeping briefly when there is nothing to do. The
+ *  audio thread never signals them, so it never makes a system call.
+ *
+ *  While offline, as during a bounce, a stream read waits for the decoder
+ *  instead of playing silence.
+ */
+class StreamDecoder
+{
+public:
+  static StreamDecoder& instance()
+  {
+    static StreamDecoder instance;
+    return instance;
+  }
+
+  void set_thread_count(const unsigned int threads);
+  unsigned int get_thread_count() const;
+
+  void set_offline(const bool offline) noexcept { m_offline.store(offline, std::memory_order_relaxed); }
+  bool is_offline() const noexcept { return m_offline.load(std::memory_order_relaxed); }
+
+  size_t get_stream_count() const;
+
+private:
+  friend class AudioStream;
+
+  StreamDecoder();
+  virtual ~StreamDecoder();
+
+  StreamDecoder(const StreamDecoder&) = delete;
+  StreamDecoder& operator=(const StreamDecoder&) = delete;
+
+  void add(const std::shared_ptr<AudioStream> &stream);
+  void start_locked(const unsigned int threads);
+  void stop_locked();
+  void run();
+
+  // Held while workers start and stop
+  mutable std::mutex m_control_mutex;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::vector<std::weak_ptr<AudioStream>> m_streams;
+  std::vector<std::thread> m_workers;
+  bool m_stopping;
+  std::atomic<bool> m_offline;
+};
+
+/** @class OfflineScope
+ *  @brief Makes streamed clips wait for their decoder instead of playing silence, for the scope's lifetime
+ */
+class OfflineScope
+{
+public:
+  OfflineScope() { StreamDecoder::instance().set_offline(true); }
+  ~OfflineScope() { StreamDecoder::instance().set_offline(false); }
+
+  OfflineScope(const OfflineScope&) = delete;
+  OfflineScope& operator=(const OfflineScope&) = delete;
+};
+
+}  // namespace Files
+
+#endif  // __AUDIO_STREAM_H__
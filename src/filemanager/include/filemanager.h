@@ -12,6 +12,7 @@ namespace Files
 {
 
 // Forward declaration
+class AudioFile;
 class WavFile;
 class MidiFile;
 
@@ -68,6 +69,7 @@ public:
 	std::vector<std::filesystem::path> list_directory(const std::filesystem::path &path, PathType type = PathType::All);
   std::vector<std::filesystem::path> list_wav_files_in_directory(const std::filesystem::path &path);
   std::vector<std::filesystem::path> list_midi_files_in_directory(const std::filesystem::path &path);
+  std::vector<std::filesystem::path> list_audio_files_in_directory(const std::filesystem::path &path);
 
   /** @brief Checks if a specified path exists.
    *  @param path The path to check.
@@ -96,6 +98,17 @@ public:
     return (path_exists(path) && std::filesystem::is_regular_file(path) && path.extension() == ".wav");
   }
 
+  /** @brief Checks if a specified path is an audio file in a format AudioFile reads.
+   *  @param path The path to check.
+   *  @return True if the path is a file with a WAV, AIFF, FLAC, Ogg, Opus or MP3 extension, false otherwise.
+   */
+  inline bool is_audio_file(const std::filesystem::path &path) const
+  {
+    return (path_exists(path) && std::filesystem::is_regular_file(path) && has_audio_extension(path));
+  }
+
+  bool has_audio_extension(const std::filesystem::path &path) const;
+
   /** @brief Checks if a specified path is a MIDI file.
    *  @param path The path to check.
    *  @return True if the path is a MIDI file, false otherwise.
@@ -123,8 +136,10 @@ public:
     return path.is_relative() ? std::filesystem::current_path() / path.lexically_normal() : path;
   }
 
-	void save_to_wav_file(std::vector<float> audio_buffer, const std::filesystem::path &path);
+  void save_to_wav_file(const std::vector<float> &audio_buffer, const std::filesystem::path &path,
+                        const unsigned int channels = 1, const unsigned int sample_rate = 48000);
   std::shared_ptr<WavFile> read_wav_file(const std::filesystem::path &path);
+  std::shared_ptr<AudioFile> read_audio_file(const std::filesystem::path &path);
 
   MidiFile read_midi_file(const std::filesystem::path &path);
 
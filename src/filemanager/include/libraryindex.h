@@ -0,0 +1,101 @@
+#ifndef __LIBRARY_INDEX_H__
+#define __LIBRARY_INDEX_H__
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Files
+{
+
+/** @enum eAudioContainer
+ *  @brief File format a sample was found in
+ */
+enum class eAudioContainer : uint8_t
+{
+  Unknown,
+  Wav,
+  Rf64,
+  Aiff,
+  Other,  // Any other format libsndfile reads
+};
+
+/** @enum eSampleEncoding
+ *  @brief How the samples of a file are stored
+ */
+enum class eSampleEncoding : uint8_t
+{
+  Unknown,
+  Pcm8,
+  Pcm16,
+  Pcm24,
+  Pcm32,
+  Float32,
+  Float64,
+  Compressed,
+};
+
+const char *to_string(const eAudioContainer container) noexcept;
+const char *to_string(const eSampleEncoding encoding) noexcept;
+
+/** @struct SampleInfo
+ *  @brief What a library scan knows about one audio file.
+ *  size and modified_ns are the file's as of the probe, and tell whether it has changed since.
+ */
+struct SampleInfo
+{
+  std::string path;
+  uint64_t size = 0;
+  int64_t modified_ns = 0;
+
+  eAudioContainer container = eAudioContainer::Unknown;
+  eSampleEncoding encoding = eSampleEncoding::Unknown;
+  unsigned int sample_rate = 0;
+  unsigned int channels = 0;
+  uint64_t frames = 0;
+
+  /** @brief Whether the header was read, false for files that are not audio or are damaged
+   */
+  bool is_readable() const noexcept { return container != eAudioContainer::Unknown; }
+
+  double get_seconds() const noexcept
+  {
+    return sample_rate > 0 ? static_cast<double>(frames) / sample_rate : 0.0;
+  }
+};
+
+/** @class LibraryIndex
+ *  @brief Sample metadata keyed by absolute path, saved between runs.
+ *
+ *  Filled by LibraryScanner. The on-disk form is a compact binary file that
+ *  is replaced atomically on save, so a crash mid-save leaves the previous
+ *  index intact. A missing, truncated or foreign file loads as empty and the
+ *  next scan rebuilds it.
+ */
+class LibraryIndex
+{
+public:
+  LibraryIndex() = default;
+
+  bool load(const std::filesystem::path &path);
+  void save(const std::filesystem::path &path) const;
+
+  const SampleInfo *find(const std::string &path) const;
+  void insert(SampleInfo info);
+  size_t replace_under(const std::string &root, std::vector<SampleInfo> entries);
+  void clear() { m_entries.clear(); }
+
+  size_t size() const noexcept { return m_entries.size(); }
+  bool empty() const noexcept { return m_entries.empty(); }
+
+  std::vector<const SampleInfo*> get_entries() const;
+
+private:
+  std::unordered_map<std::string, SampleInfo> m_entries;
+};
+
+}  // namespace Files
+
+#endif  // __LIBRARY_INDEX_H__
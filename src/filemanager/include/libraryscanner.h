@@ -0,0 +1,64 @@
+#ifndef __LIBRARY_SCANNER_H__
+#define __LIBRARY_SCANNER_H__
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "libraryindex.h"
+
+namespace Files
+{
+
+/** @struct LibraryScanOptions
+ *  @brief What a library scan looks at and how many threads it uses
+ */
+struct LibraryScanOptions
+{
+  unsigned int threads = 0;  // 0 for every hardware thread
+  std::vector<std::string> extensions = {".wav", ".wave", ".aif", ".aiff", ".aifc", ".flac", ".ogg"};
+};
+
+/** @struct LibraryScanReport
+ *  @brief What one scan found and how much of it had to be read
+ */
+struct LibraryScanReport
+{
+  size_t directories = 0;
+  size_t files = 0;       // Audio files found
+  size_t probed = 0;      // New or changed files whose header was read
+  size_t unchanged = 0;   // Files taken from the index without opening them
+  size_t removed = 0;     // Indexed files that are gone
+  size_t unreadable = 0;  // Audio files whose header could not be read
+  unsigned int threads = 0;
+  double seconds = 0.0;
+};
+
+/** @class LibraryScanner
+ *  @brief Recursive, parallel scan of a sample library into a LibraryIndex.
+ *
+ *  Subdirectories are walked by a pool of threads sharing a queue. The entry
+ *  type comes from the directory listing, so directories and files with other
+ *  extensions cost no stat, and each audio file costs exactly one for its
+ *  size and modification time. Files whose size and time match the index are
+ *  kept as they are; the rest have their header read, again in parallel.
+ *  Symbolic links are not followed.
+ */
+class LibraryScanner
+{
+public:
+  explicit LibraryScanner(const LibraryScanOptions &options = LibraryScanOptions{});
+
+  LibraryScanReport scan(const std::filesystem::path &root, LibraryIndex &index) const;
+
+  static bool probe(const std::string &path, SampleInfo &info);
+
+private:
+  bool is_audio_file(const char *name) const;
+
+  LibraryScanOptions m_options;
+};
+
+}  // namespace Files
+
+#endif  // __LIBRARY_SCANNER_H__
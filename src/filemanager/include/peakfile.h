@@ -0,0 +1,96 @@
+#ifndef __PEAK_FILE_H__
+#define __PEAK_FILE_H__
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace Files
+{
+
+/** @struct PeakValue
+ *  @brief Minimum, maximum and RMS of one channel over one peak, as stored: full scale is 32767
+ */
+struct PeakValue
+{
+  int16_t min;
+  int16_t max;
+  int16_t rms;
+};
+
+/** @struct WaveformPoint
+ *  @brief Minimum, maximum and RMS of one channel over the frames one pixel covers
+ */
+struct WaveformPoint
+{
+  float min;
+  float max;
+  float rms;
+};
+
+/** @struct PeakLevel
+ *  @brief One zoom level of a peak file: count peaks of frames_per_peak frames, channels interleaved
+ */
+struct PeakLevel
+{
+  uint64_t frames_per_peak;
+  uint64_t count;
+  const PeakValue *peaks;
+};
+
+/** @class PeakFile
+ *  @brief Mipmapped waveform summary of an audio file, read by memory mapping.
+ *
+ *  Level 0 holds one PeakValue per channel for every kBaseFramesPerPeak frames
+ *  of the source and each level above covers kLevelFactor peaks of the one
+ *  below, up to a single peak for the whole file. Drawing a range picks the
+ *  coarsest level with at least one peak per pixel, so it reads a few peaks per
+ *  pixel however long the file is.
+ *
+ *  The file records the size and modification time of its source, see is_current().
+ */
+class PeakFile
+{
+public:
+  static constexpr uint64_t kBaseFramesPerPeak = 256;
+  static constexpr uint64_t kLevelFactor = 4;
+
+  static std::filesystem::path get_path(const std::filesystem::path &source,
+                                        const std::filesystem::path &cache_directory = {});
+  static void build(const std::filesystem::path &source, const std::filesystem::path &destination);
+  static std::unique_ptr<PeakFile> open(const std::filesystem::path &path);
+
+  ~PeakFile();
+
+  PeakFile(const PeakFile&) = delete;
+  PeakFile& operator=(const PeakFile&) = delete;
+
+  bool is_current(const std::filesystem::path &source) const;
+
+  unsigned int get_channels() const noexcept { return m_channels; }
+  unsigned int get_sample_rate() const noexcept { return m_sample_rate; }
+  uint64_t get_frames() const noexcept { return m_frames; }
+  size_t get_level_count() const noexcept { return m_level_count; }
+  PeakLevel get_level(const size_t level) const noexcept;
+
+  size_t read(const unsigned int channel, const uint64_t start, const uint64_t end,
+              std::span<WaveformPoint> points) const noexcept;
+
+private:
+  PeakFile() = default;
+
+  const unsigned char *p_data = nullptr;
+  size_t m_size = 0;
+
+  unsigned int m_channels = 0;
+  unsigned int m_sample_rate = 0;
+  uint64_t m_frames = 0;
+  uint64_t m_source_size = 0;
+  int64_t m_source_modified_ns = 0;
+  size_t m_level_count = 0;
+};
+
+}  // namespace Files
+
+#endif  // __PEAK_FILE_H__
@@ -0,0 +1,61 @@
+#ifndef __PEAK_GENERATOR_H__
+#define __PEAK_GENERATOR_H__
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Files
+{
+
+/** @class PeakGenerator
+ *  @brief Builds peak files on a pool of background threads.
+ *
+ *  request() returns at once with a future for the peak file's path. A peak
+ *  file that is already current is not rebuilt, and requests for a source that
+ *  is already queued share one build. Requests still queued when the generator
+ *  is destroyed are abandoned and their futures report a broken promise.
+ */
+class PeakGenerator
+{
+public:
+  explicit PeakGenerator(const unsigned int threads = 0, const std::filesystem::path &cache_directory = {});
+  ~PeakGenerator();
+
+  PeakGenerator(const PeakGenerator&) = delete;
+  PeakGenerator& operator=(const PeakGenerator&) = delete;
+
+  std::shared_future<std::filesystem::path> request(const std::filesystem::path &source);
+
+  size_t get_pending_count() const;
+  unsigned int get_thread_count() const noexcept { return static_cast<unsigned int>(m_workers.size()); }
+
+private:
+  struct Job
+  {
+    std::filesystem::path source;
+    std::filesystem::path destination;
+    std::promise<std::filesystem::path> promise;
+  };
+
+  void run();
+
+  std::filesystem::path m_cache_directory;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<Job> m_jobs;
+  std::map<std::filesystem::path, std::shared_future<std::filesystem::path>> m_in_flight;
+  bool m_stopping;
+
+  std::vector<std::thread> m_workers;
+};
+
+}  // namespace Files
+
+#endif  // __PEAK_GENERATOR_H__
@@ -0,0 +1,53 @@
+#ifndef __WAV_WRITER_H__
+#define __WAV_WRITER_H__
+
+#include <filesystem>
+#include <memory>
+#include <sndfile.h>
+
+namespace Files
+{
+
+/** @enum eWavSampleFormat
+ *  @brief Sample encoding of a written WAV file
+ */
+enum class eWavSampleFormat
+{
+  Pcm16,
+  Pcm24,
+  Float32,
+};
+
+/** @class WavWriter
+ *  @brief Writes interleaved float frames to a new WAV file.
+ *  The header is finalised when the writer is closed or destroyed.
+ */
+class WavWriter
+{
+public:
+  WavWriter(const std::filesystem::path &path, const unsigned int channels, const unsigned int sample_rate,
+            const eWavSampleFormat format = eWavSampleFormat::Float32);
+  ~WavWriter();
+
+  WavWriter(const WavWriter&) = delete;
+  WavWriter& operator=(const WavWriter&) = delete;
+
+  void write(const float *interleaved, const sf_count_t n_frames);
+  void close();
+
+  unsigned int get_channels() const { return m_channels; }
+  unsigned int get_sample_rate() const { return m_sample_rate; }
+  sf_count_t get_frames_written() const { return m_frames_written; }
+  std::filesystem::path get_filepath() const { return m_filepath; }
+
+private:
+  std::filesystem::path m_filepath;
+  unsigned int m_channels;
+  unsigned int m_sample_rate;
+  sf_count_t m_frames_written;
+  SNDFILE *p_sndfile;
+};
+
+}  // namespace Files
+
+#endif  // __WAV_WRITER_H__
@@ -0,0 +1,78 @@
+#include "audiofile.h"
+#include "audiokernels.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Files;
+
+/** @brief Constructs an AudioFile object and opens the specified file.
+ *  @param path The path to the audio file to open.
+ *  @throws std::runtime_error if the file cannot be opened.
+ */
+AudioFile::AudioFile(const std::filesystem::path &path):
+  File(path, eInputType::AudioFile)
+{
+  m_sndfile = std::shared_ptr<SNDFILE>(
+      sf_open(path.string().c_str(), SFM_READ, &m_sfinfo),
+      [](SNDFILE *f)
+      { if (f) sf_close(f); });
+
+  if (!m_sndfile)
+  {
+    throw std::runtime_error("Failed to open audio file: " + path.string());
+  }
+}
+
+/** @brief Whether the samples are stored compressed, so reading them costs decoding time.
+ */
+bool AudioFile::is_compressed() const
+{
+  switch (m_sfinfo.format & SF_FORMAT_SUBMASK)
+  {
+    case SF_FORMAT_VORBIS:
+    case SF_FORMAT_OPUS:
+    case SF_FORMAT_MPEG_LAYER_III:
+      return true;
+    default:
+      return (m_sfinfo.format & SF_FORMAT_TYPEMASK) == SF_FORMAT_FLAC;
+  }
+}
+
+/** @brief Reads the next frames from the file into a planar buffer.
+ *  @param buffer Destination buffer, with at least as many channels as the file.
+ *  @param n_frames Maximum number of frames to read.
+ *  @return The number of frames read. Less than n_frames at the end of the file.
+ *  @throws std::invalid_argument if the buffer has fewer channels than the file.
+ */
+unsigned int AudioFile::read(AudioBuffer &buffer, const unsigned int n_frames)
+{
+  const unsigned int channels = get_channels();
+  if (buffer.get_channels() < channels)
+  {
+    throw std::invalid_argument("Buffer has fewer channels than audio file: " + get_filename());
+  }
+
+  const unsigned int frames = std::min(n_frames, buffer.get_frames());
+  m_read_buffer.resize(static_cast<size_t>(frames) * channels);
+
+  const sf_count_t frames_read = sf_readf_float(m_sndfile.get(), m_read_buffer.data(), frames);
+  if (frames_read <= 0)
+    return 0;
+
+  Kernels::deinterleave(m_read_buffer.data(), buffer.get_channel_pointers(), channels,
+                        static_cast<unsigned int>(frames_read));
+  return static_cast<unsigned int>(frames_read);
+}
+
+/** @brief Moves the read position to a frame.
+ *  @param frame The frame to read from next.
+ *  @throws std::out_of_range if the frame is past the end of the file.
+ */
+void AudioFile::seek(const sf_count_t frame)
+{
+  if (sf_seek(m_sndfile.get(), frame, SEEK_SET) < 0)
+  {
+    throw std::out_of_range("Seek past end of audio file: " + get_filename());
+  }
+}
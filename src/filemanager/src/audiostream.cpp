@@ -0,0 +1,501 @@
+#include "audiostream.h"
+#include "audiofile.h"
+#include "filemanager.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+
+using namespace Files;
+
+namespace
+{
+
+static constexpr unsigned int kGenerationShift = 48;
+static constexpr uint64_t kFrameMask = (uint64_t{1} << kGenerationShift) - 1;
+static constexpr uint32_t kGenerationMask = 0xFFFF;
+
+// Blocks one stream decodes before the worker moves on to the next stream
+static constexpr unsigned int kBlocksPerVisit = 4;
+
+// How long an offline read waits for the decoder before giving up
+static constexpr std::chrono::seconds kOfflineTimeout{5};
+
+static constexpr std::chrono::milliseconds kIdleWait{2};
+
+uint64_t thread_cpu_ns() noexcept
+{
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+}
+
+}  // namespace
+
+/** @brief Opens a file for streaming and decodes its preload.
+ *  @param path Any format AudioFile reads
+ *  @param cue_frame Where playback usually starts, as a clip's offset
+ *  @param config Block size and read-ahead
+ *  @return The stream, registered with the StreamDecoder
+ *  @throws std::runtime_error if the file cannot be opened
+ *  @throws std::invalid_argument if the cue frame is past the end of the file or the config is empty
+ */
+std::shared_ptr<AudioStream> AudioStream::open(const std::filesystem::path &path, const uint64_t cue_frame,
+                                               const AudioStreamConfig &config)
+{
+  auto file = FileManager::instance().read_audio_file(path);
+  auto stream = std::shared_ptr<AudioStream>(new AudioStream(std::move(file), cue_frame, config));
+  StreamDecoder::instance().add(stream);
+  return stream;
+}
+
+/** @brief AudioStream constructor
+ */
+AudioStream::AudioStream(std::shared_ptr<AudioFile> file, const uint64_t cue_frame, const AudioStreamConfig &config):
+  p_file(std::move(file)),
+  m_channels(p_file->get_channels()),
+  m_sample_rate(p_file->get_sample_rate()),
+  m_frames(static_cast<uint64_t>(std::max<sf_count_t>(p_file->get_frames(), 0))),
+  m_compressed(p_file->is_compressed()),
+  m_config(config),
+  m_cue_frame(cue_frame),
+  m_current(kNoBlock),
+  m_generation(1),
+  m_decoder_generation(kNoBlock),
+  m_decoder_position(0),
+  m_held(kNoBlock),
+  m_frames_decoded(0),
+  m_decode_ns(0),
+  m_underruns(0),
+  m_seeks(0)
+{
+  if (m_config.block_frames == 0 || m_config.blocks == 0)
+  {
+    throw std::invalid_argument("AudioStream: Block size and count must be greater than 0");
+  }
+
+  if (cue_frame >= m_frames)
+  {
+    throw std::invalid_argument("AudioStream: Cue frame is past the end of " + p_file->get_filename());
+  }
+
+  // The preload is decoded here, on the opening thread
+  const unsigned int preload_frames = static_cast<unsigned int>(
+      std::min<uint64_t>(m_config.preload_frames, m_frames - cue_frame));
+  m_preload = AudioBuffer(m_channels, std::max(preload_frames, 1u));
+  if (preload_frames > 0)
+  {
+    const uint64_t started = thread_cpu_ns();
+    p_file->seek(static_cast<sf_count_t>(cue_frame));
+
+    unsigned int frames_read = 0;
+    AudioBuffer chunk(m_channels, m_config.block_frames);
+    while (frames_read < preload_frames)
+    {
+      const unsigned int n = p_file->read(chunk, std::min(m_config.block_frames, preload_frames - frames_read));
+      if (n == 0)
+        break;
+      for (unsigned int ch = 0; ch < m_channels; ++ch)
+        std::copy_n(chunk.get_channel(ch), n, m_preload.get_channel(ch) + frames_read);
+      frames_read += n;
+    }
+
+    m_decode_ns += thread_cpu_ns() - started;
+    m_frames_decoded += frames_read;
+  }
+  m_preload_end = cue_frame + preload_frames;
+
+  m_blocks.resize(m_config.blocks);
+  for (auto &block : m_blocks)
+    block.audio = AudioBuffer(m_channels, m_config.block_frames);
+
+  m_filled.resize(m_config.blocks);
+  m_free.resize(m_config.blocks);
+  for (uint32_t i = 0; i < m_config.blocks; ++i)
+    m_free.write(&i, 1);
+
+  // The decoder starts where the preload ends
+  m_request_frame = m_preload_end;
+  m_next_frame = m_preload_end;
+  m_request.store((uint64_t{m_generation} << kGenerationShift) | m_preload_end, std::memory_order_release);
+
+  LOG_INFO("AudioStream: Opened ", p_file->get_filename(), ", ", m_frames, " frames, ",
+           m_compressed ? "compressed" : "uncompressed", ", ", preload_frames, " frames preloaded");
+}
+
+/** @brief AudioStream destructor
+ */
+AudioStream::~AudioStream() = default;
+
+std::filesystem::path AudioStream::get_filepath() const
+{
+  return p_file->get_filepath();
+}
+
+/** @brief Adds frames of the file, scaled by gain, into a buffer. Audio thread only, never blocks.
+ *  Mono files feed every channel, wider files wrap onto the buffer's channels.
+ *  Frames not yet decoded are left as they are and counted as an underrun.
+ *  @param output The buffer to add into
+ *  @param destination First frame of the buffer to add into
+ *  @param frame First frame of the file to read
+ *  @param n_frames Number of frames
+ *  @param gain Linear gain
+ *  @return The number of frames added
+ */
+unsigned int AudioStream::mix(AudioBuffer &output, const unsigned int destination, const uint64_t frame,
+                              const unsigned int n_frames, const float gain) noexcept
+{
+  const unsigned int channels = output.get_channels();
+  unsigned int done = 0;
+
+  while (done < n_frames)
+  {
+    const uint64_t position = frame + done;
+    if (position >= m_frames)
+      break;
+
+    const unsigned int wanted = static_cast<unsigned int>(std::min<uint64_t>(n_frames - done, m_frames - position));
+    const AudioBuffer *source;
+    unsigned int offset;
+    unsigned int count;
+    bool from_block = false;
+
+    if (position >= m_cue_frame && position < m_preload_end)
+    {
+      source = &m_preload;
+      offset = static_cast<unsigned int>(position - m_cue_frame);
+      count = static_cast<unsigned int>(std::min<uint64_t>(wanted, m_preload_end - position));
+
+      // Have the decoder continue where the preload ends
+      if (m_request_frame != m_preload_end)
+        request(m_preload_end);
+    }
+    else
+    {
+      if (!acquire_block(position))
+      {
+        if (!StreamDecoder::instance().is_offline())
+        {
+          m_underruns.fetch_add(1, std::memory_order_relaxed);
+          break;
+        }
+
+        // Offline renders wait for the decoder instead
+        const auto deadline = std::chrono::steady_clock::now() + kOfflineTimeout;
+        bool acquired = false;
+        while (!acquired && std::chrono::steady_clock::now() < deadline)
+        {
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+          acquired = acquire_block(position);
+        }
+        if (!acquired)
+        {
+          m_underruns.fetch_add(1, std::memory_order_relaxed);
+          break;
+        }
+      }
+
+      const Block &block = m_blocks[m_current];
+      source = &block.audio;
+      offset = static_cast<unsigned int>(position - block.start);
+      count = std::min(wanted, block.frames - offset);
+      from_block = true;
+    }
+
+    for (unsigned int ch = 0; ch < channels; ++ch)
+    {
+      const float *__restrict in = source->get_channel(ch % m_channels) + offset;
+      float *__restrict out = output.get_channel(ch) + destination + done;
+      for (unsigned int i = 0; i < count; ++i)
+        out[i] += gain * in[i];
+    }
+
+    done += count;
+    if (from_block && offset + count == m_blocks[m_current].frames)
+      release_block();
+  }
+
+  return done;
+}
+
+/** @brief Makes the block holding a frame current, taking blocks from the decoder as needed.
+ *  Asks the decoder to seek if it is not heading for the frame.
+ *  @return False if the frame is not decoded yet
+ */
+bool AudioStream::acquire_block(const uint64_t frame) noexcept
+{
+  const uint64_t read_ahead = static_cast<uint64_t>(m_config.blocks) * m_config.block_frames;
+
+  for (;;)
+  {
+    if (m_current != kNoBlock)
+    {
+      const Block &block = m_blocks[m_current];
+      if (block.generation == m_generation && frame >= block.start && frame < block.start + block.frames)
+        return true;
+
+      const bool behind = block.generation == m_generation && frame < block.start;
+      release_block();
+      if (behind)
+      {
+        request(frame);
+        return false;
+      }
+    }
+
+    uint32_t index;
+    if (m_filled.read(&index, 1) == 0)
+    {
+      // Going back, or far enough ahead that seeking beats decoding up to it
+      if (frame < m_next_frame || frame > m_next_frame + read_ahead)
+        request(frame);
+      return false;
+    }
+
+    m_current = index;
+    const Block &block = m_blocks[index];
+    if (block.generation == m_generation)
+      m_next_frame = block.start + block.frames;
+  }
+}
+
+/** @brief Hands the current block back to the decoder.
+ */
+void AudioStream::release_block() noexcept
+{
+  if (m_current == kNoBlock)
+    return;
+
+  m_free.write(&m_current, 1);
+  m_current = kNoBlock;
+}
+
+/** @brief Asks the decoder to continue from a frame. Blocks already decoded become stale.
+ */
+void AudioStream::request(const uint64_t frame) noexcept
+{
+  release_block();
+
+  m_generation = (m_generation + 1) & kGenerationMask;
+  m_request_frame = frame;
+  m_next_frame = frame;
+  m_request.store((uint64_t{m_generation} << kGenerationShift) | (frame & kFrameMask), std::memory_order_release);
+}
+
+/** @brief Decodes into the blocks the audio thread has returned. Decoder thread, under m_service_mutex.
+ *  @return True if anything was decoded
+ */
+bool AudioStream::service()
+{
+  const uint64_t request = m_request.load(std::memory_order_acquire);
+  const uint32_t generation = static_cast<uint32_t>(request >> kGenerationShift);
+
+  if (generation != m_decoder_generation)
+  {
+    m_decoder_generation = generation;
+    m_decoder_position = request & kFrameMask;
+    if (m_decoder_position < m_frames)
+    {
+      try
+      {
+        p_file->seek(static_cast<sf_count_t>(m_decoder_position));
+        m_seeks.fetch_add(1, std::memory_order_relaxed);
+      }
+      catch (const std::exception &e)
+      {
+        LOG_ERROR("AudioStream: ", e.what());
+        m_decoder_position = m_frames;
+      }
+    }
+  }
+
+  bool decoded = false;
+  for (unsigned int i = 0; i < kBlocksPerVisit && m_decoder_position < m_frames; ++i)
+  {
+    // A newer request makes whatever this pass would decode stale
+    if ((m_request.load(std::memory_order_relaxed) >> kGenerationShift) != generation)
+      break;
+
+    if (m_held == kNoBlock && m_free.read(&m_held, 1) == 0)
+      break;
+
+    Block &block = m_blocks[m_held];
+    const uint64_t started = thread_cpu_ns();
+    unsigned int frames = 0;
+    try
+    {
+      frames = p_file->read(block.audio, m_config.block_frames);
+    }
+    catch (const std::exception &e)
+    {
+      LOG_ERROR("AudioStream: ", e.what());
+    }
+    m_decode_ns.fetch_add(thread_cpu_ns() - started, std::memory_order_relaxed);
+
+    if (frames == 0)
+    {
+      // Read error or a file shorter than its header said
+      m_decoder_position = m_frames;
+      break;
+    }
+
+    block.start = m_decoder_position;
+    block.frames = frames;
+    block.generation = generation;
+    m_filled.write(&m_held, 1);
+    m_held = kNoBlock;
+
+    m_decoder_position += frames;
+    m_frames_decoded.fetch_add(frames, std::memory_order_relaxed);
+    decoded = true;
+  }
+
+  return decoded;
+}
+
+/** @brief Frames decoded ahead and waiting for the audio thread.
+ */
+size_t AudioStream::get_buffered_frames() const noexcept
+{
+  return m_filled.get_read_available() * m_config.block_frames;
+}
+
+/** @brief Decoding cost so far, for deciding which formats a deployment can afford.
+ */
+AudioStreamStatistics AudioStream::get_statistics() const noexcept
+{
+  AudioStreamStatistics statistics{};
+  statistics.frames_decoded = m_frames_decoded.load(std::memory_order_relaxed);
+  statistics.decode_seconds = static_cast<double>(m_decode_ns.load(std::memory_order_relaxed)) * 1e-9;
+  statistics.underruns = m_underruns.load(std::memory_order_relaxed);
+  statistics.seeks = m_seeks.load(std::memory_order_relaxed);
+  statistics.buffered_frames = get_buffered_frames();
+
+  const double audio_seconds = m_sample_rate > 0 ? static_cast<double>(statistics.frames_decoded) / m_sample_rate : 0.0;
+  statistics.cpu_load = audio_seconds > 0.0 ? statistics.decode_seconds / audio_seconds : 0.0;
+  return statistics;
+}
+
+/** @brief StreamDecoder constructor, starts two workers or one on a single core.
+ */
+StreamDecoder::StreamDecoder():
+  m_stopping(false),
+  m_offline(false)
+{
+  std::lock_guard<std::mutex> lock(m_control_mutex);
+  start_locked(std::clamp(std::thread::hardware_concurrency(), 1u, 2u));
+}
+
+/** @brief StreamDecoder destructor
+ */
+StreamDecoder::~StreamDecoder()
+{
+  std::lock_guard<std::mutex> lock(m_control_mutex);
+  stop_locked();
+}
+
+/** @brief Restarts the workers with a new count.
+ *  @param threads Number of decoder threads, at least 1
+ */
+void StreamDecoder::set_thread_count(const unsigned int threads)
+{
+  std::lock_guard<std::mutex> lock(m_control_mutex);
+  stop_locked();
+  start_locked(std::max(1u, threads));
+}
+
+unsigned int StreamDecoder::get_thread_count() const
+{
+  std::lock_guard<std::mutex> lock(m_control_mutex);
+  return static_cast<unsigned int>(m_workers.size());
+}
+
+/** @brief Number of open streams.
+ */
+size_t StreamDecoder::get_stream_count() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return static_cast<size_t>(std::count_if(m_streams.begin(), m_streams.end(),
+                                           [](const auto &stream) { return !stream.expired(); }));
+}
+
+void StreamDecoder::add(const std::shared_ptr<AudioStream> &stream)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_streams.push_back(stream);
+  }
+  m_condition.notify_one();
+}
+
+void StreamDecoder::start_locked(const unsigned int threads)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = false;
+  }
+
+  for (unsigned int i = 0; i < threads; ++i)
+  {
+    m_workers.emplace_back(&StreamDecoder::run, this);
+  }
+}
+
+void StreamDecoder::stop_locked()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_condition.notify_all();
+
+  for (auto &worker : m_workers)
+  {
+    worker.join();
+  }
+  m_workers.clear();
+}
+
+/** @brief Worker loop: visit every stream, sleep when none had work.
+ */
+void StreamDecoder::run()
+{
+  set_thread_name("StreamDecoder");
+
+  std::vector<std::shared_ptr<AudioStream>> streams;
+  for (;;)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_stopping)
+        return;
+
+      // Forget closed streams
+      std::erase_if(m_streams, [](const auto &stream) { return stream.expired(); });
+      for (const auto &stream : m_streams)
+      {
+        if (auto locked = stream.lock())
+          streams.push_back(std::move(locked));
+      }
+    }
+
+    bool decoded = false;
+    for (const auto &stream : streams)
+    {
+      std::unique_lock<std::mutex> lock(stream->m_service_mutex, std::try_to_lock);
+      if (lock.owns_lock())
+        decoded |= stream->service();
+    }
+
+    // A stream closed meanwhile is destroyed here, outside the lock
+    streams.clear();
+
+    if (!decoded)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait_for(lock, kIdleWait, [this]() { return m_stopping; });
+    }
+  }
+}
@@ -1,6 +1,11 @@
 #include "filemanager.h"
 #include "wavfile.h"
+#include "audiofile.h"
 #include "midifile.h"
+#include "wavwriter.h"
+
+#include <algorithm>
+#include <cctype>
 
 using namespace Files;
 
@@ -16,27 +21,28 @@ std::vector<std::filesystem::path> FileManager::list_directory(const std::filesy
 
   std::filesystem::path absolute_path = convert_to_absolute(path);
 
-  if (!path_exists(absolute_path) || !is_directory(absolute_path))
+  if (!std::filesystem::is_directory(absolute_path))
   {
     throw std::runtime_error("Path does not exist or is not a directory: " + absolute_path.string());
   }
 
+  // The entry type comes from the directory listing, so filtering costs no stat on most file systems
   for (const auto& entry : std::filesystem::directory_iterator(absolute_path))
   {
-    std::filesystem::path entry_path = entry.path().lexically_normal();
+    std::error_code error;
 
     switch (type)
     {
       case PathType::Directory:
-        if (is_directory(entry_path))
-          contents.push_back(entry_path);
+        if (entry.is_directory(error))
+          contents.push_back(entry.path().lexically_normal());
         break;
       case PathType::File:
-        if (is_file(entry_path))
-          contents.push_back(entry_path);
+        if (entry.is_regular_file(error))
+          contents.push_back(entry.path().lexically_normal());
         break;
       case PathType::All:
-        contents.push_back(entry_path);
+        contents.push_back(entry.path().lexically_normal());
         break;
       default:
         throw std::invalid_argument("Invalid PathType specified.");
@@ -58,7 +64,7 @@ std::vector<std::filesystem::path> FileManager::list_wav_files_in_directory(cons
 
   for (const auto& entry : contents)
   {
-    if (is_wav_file(entry))
+    if (entry.extension() == ".wav")
     {
       wav_files.push_back(entry);
     }
@@ -79,7 +85,7 @@ std::vector<std::filesystem::path> FileManager::list_midi_files_in_directory(con
 
   for (const auto &entry : contents)
   {
-    if (is_midi_file(entry))
+    if (entry.extension() == ".mid")
     {
       midi_files.push_back(entry);
     }
@@ -88,9 +94,68 @@ std::vector<std::filesystem::path> FileManager::list_midi_files_in_directory(con
   return midi_files;
 }
 
-void FileManager::save_to_wav_file(std::vector<float> audio_buffer, const std::filesystem::path &path)
+/** @brief Lists audio files of every format AudioFile reads in a specified directory.
+ *  @param path The path to the directory to list.
+ *  @return A vector of filemanager paths representing the audio files in the specified directory.
+ *  @throws std::runtime_error if the path does not exist or is not a directory
+ */
+std::vector<std::filesystem::path> FileManager::list_audio_files_in_directory(const std::filesystem::path &path)
+{
+  std::vector<std::filesystem::path> contents = list_directory(path, PathType::File);
+  std::vector<std::filesystem::path> audio_files;
+
+  for (const auto &entry : contents)
+  {
+    if (has_audio_extension(entry))
+    {
+      audio_files.push_back(entry);
+    }
+  }
+
+  return audio_files;
+}
+
+/** @brief Checks if a path has the extension of a format AudioFile reads, ignoring case.
+ *  @param path The path to check.
+ *  @return True for WAV, AIFF, FLAC, Ogg, Opus and MP3 extensions.
+ */
+bool FileManager::has_audio_extension(const std::filesystem::path &path) const
+{
+  static const char *const kExtensions[] = {".wav", ".aif", ".aiff", ".flac", ".ogg", ".oga", ".opus", ".mp3"};
+
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+  return std::find(std::begin(kExtensions), std::end(kExtensions), extension) != std::end(kExtensions);
+}
+
+/** @brief Saves interleaved audio to a 32-bit float WAV file.
+ *  @param audio_buffer Interleaved samples, a whole number of frames.
+ *  @param path The path of the WAV file to create.
+ *  @param channels Channels per frame.
+ *  @param sample_rate Sample rate in Hz.
+ *  @throws std::invalid_argument if the path is not a .wav file or the buffer is not whole frames.
+ *  @throws std::runtime_error if the file cannot be written.
+ */
+void FileManager::save_to_wav_file(const std::vector<float> &audio_buffer, const std::filesystem::path &path,
+                                   const unsigned int channels, const unsigned int sample_rate)
 {
+  std::filesystem::path absolute_path = convert_to_absolute(path);
+
+  if (absolute_path.extension() != ".wav")
+  {
+    throw std::invalid_argument("Not a WAV file path: " + absolute_path.string());
+  }
+
+  if (channels == 0 || audio_buffer.size() % channels != 0)
+  {
+    throw std::invalid_argument("Audio buffer is not a whole number of frames: " + absolute_path.string());
+  }
 
+  WavWriter writer(absolute_path, channels, sample_rate);
+  writer.write(audio_buffer.data(), static_cast<sf_count_t>(audio_buffer.size() / channels));
+  writer.close();
 }
 
 /** @brief Loads audio data from a WAV file.
@@ -110,6 +175,23 @@ std::shared_ptr<WavFile> FileManager::read_wav_file(const std::filesystem::path
   return std::shared_ptr<WavFile>(new WavFile(absolute_path));
 }
 
+/** @brief Opens an audio file of any format AudioFile reads, compressed ones included.
+ *  @param path The path to the audio file to open.
+ *  @return The opened file.
+ *  @throws std::runtime_error if the file does not exist, has an unknown extension or cannot be opened.
+ */
+std::shared_ptr<AudioFile> FileManager::read_audio_file(const std::filesystem::path &path)
+{
+  std::filesystem::path absolute_path = convert_to_absolute(path);
+
+  if (!is_audio_file(absolute_path))
+  {
+    throw std::runtime_error("Audio file does not exist or is not a file: " + absolute_path.string());
+  }
+
+  return std::shared_ptr<AudioFile>(new AudioFile(absolute_path));
+}
+
 /** @brief Loads audio data from a WAV file.
  *  @param path The path to the WAV file to load.
  *  @return An AudioFile object containing the loaded audio data.
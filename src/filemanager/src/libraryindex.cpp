@@ -0,0 +1,262 @@
+#include "libraryindex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+using namespace Files;
+
+namespace
+{
+
+static constexpr char kIndexMagic[8] = {'E', 'A', 'E', 'L', 'I', 'B', 'X', '1'};
+
+/** @brief Appends a trivially copyable value to the output in host byte order
+ */
+template <typename T>
+void put(std::string &out, const T value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/** @class Reader
+ *  @brief Bounds checked reads over a loaded index file
+ */
+class Reader
+{
+public:
+  Reader(const std::vector<char> &data): m_data(data), m_offset(0) {}
+
+  template <typename T>
+  bool get(T &value)
+  {
+    if (m_data.size() - m_offset < sizeof(T))
+      return false;
+
+    std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+    m_offset += sizeof(T);
+    return true;
+  }
+
+  bool get(std::string &value, const size_t length)
+  {
+    if (m_data.size() - m_offset < length)
+      return false;
+
+    value.assign(m_data.data() + m_offset, length);
+    m_offset += length;
+    return true;
+  }
+
+private:
+  const std::vector<char> &m_data;
+  size_t m_offset;
+};
+
+/** @brief Whether a path is the root or lies below it
+ */
+bool is_under(const std::string &path, const std::string &root)
+{
+  if (path.compare(0, root.size(), root) != 0)
+    return false;
+
+  return path.size() == root.size() || path[root.size()] == '/' || (!root.empty() && root.back() == '/');
+}
+
+}  // namespace
+
+/** @brief Name of a container, for reports
+ */
+const char *Files::to_string(const eAudioContainer container) noexcept
+{
+  switch (container)
+  {
+    case eAudioContainer::Wav: return "WAV";
+    case eAudioContainer::Rf64: return "RF64";
+    case eAudioContainer::Aiff: return "AIFF";
+    case eAudioContainer::Other: return "Other";
+    default: return "Unknown";
+  }
+}
+
+/** @brief Name of a sample encoding, for reports
+ */
+const char *Files::to_string(const eSampleEncoding encoding) noexcept
+{
+  switch (encoding)
+  {
+    case eSampleEncoding::Pcm8: return "PCM 8";
+    case eSampleEncoding::Pcm16: return "PCM 16";
+    case eSampleEncoding::Pcm24: return "PCM 24";
+    case eSampleEncoding::Pcm32: return "PCM 32";
+    case eSampleEncoding::Float32: return "Float 32";
+    case eSampleEncoding::Float64: return "Float 64";
+    case eSampleEncoding::Compressed: return "Compressed";
+    default: return "Unknown";
+  }
+}
+
+/** @brief Replaces the contents with a saved index.
+ *  @param path The index file
+ *  @return True if the file was read, false if it is missing or not a valid index, leaving the index empty
+ */
+bool LibraryIndex::load(const std::filesystem::path &path)
+{
+  m_entries.clear();
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+
+  const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  Reader reader(data);
+
+  std::string magic;
+  uint64_t count = 0;
+  if (!reader.get(magic, sizeof(kIndexMagic)) || magic != std::string(kIndexMagic, sizeof(kIndexMagic)) ||
+      !reader.get(count))
+    return false;
+
+  m_entries.reserve(static_cast<size_t>(std::min<uint64_t>(count, data.size())));
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    SampleInfo info;
+    uint32_t length = 0;
+    uint8_t container = 0;
+    uint8_t encoding = 0;
+    uint32_t sample_rate = 0;
+    uint32_t channels = 0;
+
+    if (!reader.get(length) || !reader.get(info.path, length) || !reader.get(info.size) ||
+        !reader.get(info.modified_ns) || !reader.get(container) || !reader.get(encoding) ||
+        !reader.get(sample_rate) || !reader.get(channels) || !reader.get(info.frames) ||
+        container > static_cast<uint8_t>(eAudioContainer::Other) ||
+        encoding > static_cast<uint8_t>(eSampleEncoding::Compressed))
+    {
+      m_entries.clear();
+      return false;
+    }
+
+    info.container = static_cast<eAudioContainer>(container);
+    info.encoding = static_cast<eSampleEncoding>(encoding);
+    info.sample_rate = sample_rate;
+    info.channels = channels;
+
+    std::string key = info.path;
+    m_entries.insert_or_assign(std::move(key), std::move(info));
+  }
+
+  return true;
+}
+
+/** @brief Writes the index, replacing the file only once the new one is complete.
+ *  @param path The index file
+ *  @throws std::runtime_error if the file cannot be written
+ */
+void LibraryIndex::save(const std::filesystem::path &path) const
+{
+  std::string out;
+  out.reserve(16 + m_entries.size() * 96);
+  out.append(kIndexMagic, sizeof(kIndexMagic));
+  put<uint64_t>(out, m_entries.size());
+
+  for (const auto &[key, info] : m_entries)
+  {
+    put<uint32_t>(out, static_cast<uint32_t>(info.path.size()));
+    out.append(info.path);
+    put<uint64_t>(out, info.size);
+    put<int64_t>(out, info.modified_ns);
+    put<uint8_t>(out, static_cast<uint8_t>(info.container));
+    put<uint8_t>(out, static_cast<uint8_t>(info.encoding));
+    put<uint32_t>(out, info.sample_rate);
+    put<uint32_t>(out, info.channels);
+    put<uint64_t>(out, info.frames);
+  }
+
+  std::filesystem::path temporary = path;
+  temporary += ".tmp";
+
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.write(out.data(), static_cast<std::streamsize>(out.size())) || !file.flush())
+    {
+      throw std::runtime_error("Failed to write library index: " + temporary.string());
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error)
+  {
+    std::filesystem::remove(temporary, error);
+    throw std::runtime_error("Failed to replace library index: " + path.string());
+  }
+}
+
+/** @brief Looks up a file by absolute path.
+ *  @return The entry, or nullptr if the file is not indexed
+ */
+const SampleInfo *LibraryIndex::find(const std::string &path) const
+{
+  auto it = m_entries.find(path);
+  return it == m_entries.end() ? nullptr : &it->second;
+}
+
+/** @brief Adds or replaces the entry for info.path.
+ */
+void LibraryIndex::insert(SampleInfo info)
+{
+  std::string key = info.path;
+  m_entries.insert_or_assign(std::move(key), std::move(info));
+}
+
+/** @brief Replaces everything indexed under a directory with the result of a scan of it.
+ *  @param root Absolute path of the scanned directory
+ *  @param entries Every file found under root
+ *  @return The number of indexed files under root that were not found again
+ */
+size_t LibraryIndex::replace_under(const std::string &root, std::vector<SampleInfo> entries)
+{
+  std::unordered_set<std::string_view> found;
+  found.reserve(entries.size());
+  for (const auto &info : entries)
+    found.insert(info.path);
+
+  size_t removed = 0;
+  for (auto it = m_entries.begin(); it != m_entries.end();)
+  {
+    if (!is_under(it->first, root))
+    {
+      ++it;
+      continue;
+    }
+
+    if (!found.contains(it->first))
+      ++removed;
+    it = m_entries.erase(it);
+  }
+
+  m_entries.reserve(m_entries.size() + entries.size());
+  for (auto &info : entries)
+    insert(std::move(info));
+
+  return removed;
+}
+
+/** @brief Every entry, sorted by path.
+ */
+std::vector<const SampleInfo*> LibraryIndex::get_entries() const
+{
+  std::vector<const SampleInfo*> entries;
+  entries.reserve(m_entries.size());
+  for (const auto &[key, info] : m_entries)
+    entries.push_back(&info);
+
+  std::sort(entries.begin(), entries.end(),
+            [](const SampleInfo *a, const SampleInfo *b) { return a->path < b->path; });
+  return entries;
+}
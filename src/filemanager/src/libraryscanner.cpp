@@ -0,0 +1,550 @@
+#include "libraryscanner.h"
+#include "filemanager.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sndfile.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Files;
+
+namespace
+{
+
+/** @class FileDescriptor
+ *  @brief Closes a POSIX file descriptor when it goes out of scope
+ */
+class FileDescriptor
+{
+public:
+  explicit FileDescriptor(const int fd): m_fd(fd) {}
+  ~FileDescriptor() { if (m_fd >= 0) ::close(m_fd); }
+
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+  int get() const { return m_fd; }
+
+private:
+  int m_fd;
+};
+
+/** @brief Reads exactly n bytes at an offset.
+ */
+bool read_at(const int fd, void *data, const size_t n, const uint64_t offset)
+{
+  size_t done = 0;
+  while (done < n)
+  {
+    const ssize_t result = ::pread(fd, static_cast<char*>(data) + done, n - done, static_cast<off_t>(offset + done));
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result <= 0)
+      return false;
+    done += static_cast<size_t>(result);
+  }
+  return true;
+}
+
+uint16_t le16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t le32(const uint8_t *p) { return static_cast<uint32_t>(le16(p)) | (static_cast<uint32_t>(le16(p + 2)) << 16); }
+uint64_t le64(const uint8_t *p) { return static_cast<uint64_t>(le32(p)) | (static_cast<uint64_t>(le32(p + 4)) << 32); }
+uint16_t be16(const uint8_t *p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+uint32_t be32(const uint8_t *p) { return (static_cast<uint32_t>(be16(p)) << 16) | be16(p + 2); }
+
+/** @brief Decodes the 80-bit extended float AIFF stores its sample rate in.
+ */
+double extended_to_double(const uint8_t *p)
+{
+  const int exponent = ((p[0] & 0x7F) << 8) | p[1];
+  const uint64_t mantissa = (static_cast<uint64_t>(be32(p + 2)) << 32) | be32(p + 6);
+  if (exponent == 0 && mantissa == 0)
+    return 0.0;
+
+  const double value = std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+  return (p[0] & 0x80) ? -value : value;
+}
+
+eSampleEncoding pcm_encoding(const unsigned int bits)
+{
+  switch (bits)
+  {
+    case 8: return eSampleEncoding::Pcm8;
+    case 16: return eSampleEncoding::Pcm16;
+    case 24: return eSampleEncoding::Pcm24;
+    case 32: return eSampleEncoding::Pcm32;
+    default: return eSampleEncoding::Unknown;
+  }
+}
+
+/** @brief Reads the fmt, ds64, fact and data chunk headers of a RIFF or RF64 WAVE file.
+ */
+bool probe_wav(const int fd, const uint64_t file_size, const bool rf64, SampleInfo &info)
+{
+  static constexpr uint16_t kFormatPcm = 0x0001;
+  static constexpr uint16_t kFormatFloat = 0x0003;
+  static constexpr uint16_t kFormatExtensible = 0xFFFE;
+  static constexpr size_t kMaxChunks = 256;
+
+  bool have_format = false;
+  uint16_t tag = 0;
+  uint16_t block_align = 0;
+  uint16_t bits = 0;
+  uint64_t ds64_data_size = 0;
+  uint64_t fact_frames = 0;
+
+  uint64_t offset = 12;
+  for (size_t chunk = 0; chunk < kMaxChunks && offset + 8 <= file_size; ++chunk)
+  {
+    uint8_t header[8];
+    if (!read_at(fd, header, sizeof(header), offset))
+      return false;
+
+    uint64_t size = le32(header + 4);
+    const uint64_t body = offset + 8;
+
+    if (std::memcmp(header, "fmt ", 4) == 0 && size >= 16)
+    {
+      uint8_t format[40] = {};
+      if (!read_at(fd, format, std::min<uint64_t>(size, sizeof(format)), body))
+        return false;
+
+      tag = le16(format);
+      info.channels = le16(format + 2);
+      info.sample_rate = le32(format + 4);
+      block_align = le16(format + 12);
+      bits = le16(format + 14);
+      if (tag == kFormatExtensible && size >= 40)
+        tag = le16(format + 24);
+      have_format = true;
+    }
+    else if (std::memcmp(header, "ds64", 4) == 0 && size >= 24)
+    {
+      uint8_t ds64[24];
+      if (!read_at(fd, ds64, sizeof(ds64), body))
+        return false;
+      ds64_data_size = le64(ds64 + 8);
+    }
+    else if (std::memcmp(header, "fact", 4) == 0 && size >= 4)
+    {
+      uint8_t fact[4];
+      if (!read_at(fd, fact, sizeof(fact), body))
+        return false;
+      fact_frames = le32(fact);
+    }
+    else if (std::memcmp(header, "data", 4) == 0)
+    {
+      if (rf64 && size == 0xFFFFFFFF)
+        size = ds64_data_size;
+
+      // Truncated files still report what they hold
+      size = std::min(size, file_size - body);
+      if (!have_format)
+        return false;
+
+      info.container = rf64 ? eAudioContainer::Rf64 : eAudioContainer::Wav;
+      if (tag == kFormatPcm)
+        info.encoding = pcm_encoding(bits);
+      else if (tag == kFormatFloat)
+        info.encoding = bits == 64 ? eSampleEncoding::Float64 : eSampleEncoding::Float32;
+      else
+        info.encoding = eSampleEncoding::Compressed;
+
+      if (info.encoding == eSampleEncoding::Compressed)
+        info.frames = fact_frames;
+      else
+        info.frames = block_align > 0 ? size / block_align : 0;
+      return info.channels > 0 && info.sample_rate > 0;
+    }
+
+    offset = body + size + (size & 1);
+  }
+
+  return false;
+}
+
+/** @brief Reads the COMM chunk of an AIFF or AIFF-C file.
+ */
+bool probe_aiff(const int fd, const uint64_t file_size, const bool compressed, SampleInfo &info)
+{
+  static constexpr size_t kMaxChunks = 256;
+
+  uint64_t offset = 12;
+  for (size_t chunk = 0; chunk < kMaxChunks && offset + 8 <= file_size; ++chunk)
+  {
+    uint8_t header[8];
+    if (!read_at(fd, header, sizeof(header), offset))
+      return false;
+
+    const uint64_t size = be32(header + 4);
+    const uint64_t body = offset + 8;
+
+    if (std::memcmp(header, "COMM", 4) == 0 && size >= 18)
+    {
+      uint8_t comm[22] = {};
+      if (!read_at(fd, comm, std::min<uint64_t>(size, compressed ? 22 : 18), body))
+        return false;
+
+      info.container = eAudioContainer::Aiff;
+      info.channels = be16(comm);
+      info.frames = be32(comm + 2);
+      info.encoding = pcm_encoding(be16(comm + 6));
+      info.sample_rate = static_cast<unsigned int>(std::lround(extended_to_double(comm + 8)));
+
+      if (compressed && size >= 22)
+      {
+        const char *type = reinterpret_cast<const char*>(comm + 18);
+        if (std::memcmp(type, "fl32", 4) == 0 || std::memcmp(type, "FL32", 4) == 0)
+          info.encoding = eSampleEncoding::Float32;
+        else if (std::memcmp(type, "fl64", 4) == 0 || std::memcmp(type, "FL64", 4) == 0)
+          info.encoding = eSampleEncoding::Float64;
+        else if (std::memcmp(type, "NONE", 4) != 0 && std::memcmp(type, "twos", 4) != 0 &&
+                 std::memcmp(type, "sowt", 4) != 0)
+          info.encoding = eSampleEncoding::Compressed;
+      }
+      return info.channels > 0 && info.sample_rate > 0;
+    }
+
+    offset = body + size + (size & 1);
+  }
+
+  return false;
+}
+
+/** @brief Any other format, through libsndfile's own header parser.
+ */
+bool probe_sndfile(const std::string &path, SampleInfo &info)
+{
+  SF_INFO sfinfo{};
+  SNDFILE *file = sf_open(path.c_str(), SFM_READ, &sfinfo);
+  if (!file)
+    return false;
+  sf_close(file);
+
+  info.container = eAudioContainer::Other;
+  info.channels = static_cast<unsigned int>(sfinfo.channels);
+  info.sample_rate = static_cast<unsigned int>(sfinfo.samplerate);
+  info.frames = sfinfo.frames > 0 ? static_cast<uint64_t>(sfinfo.frames) : 0;
+
+  switch (sfinfo.format & SF_FORMAT_SUBMASK)
+  {
+    case SF_FORMAT_PCM_S8:
+    case SF_FORMAT_PCM_U8: info.encoding = eSampleEncoding::Pcm8; break;
+    case SF_FORMAT_PCM_16: info.encoding = eSampleEncoding::Pcm16; break;
+    case SF_FORMAT_PCM_24: info.encoding = eSampleEncoding::Pcm24; break;
+    case SF_FORMAT_PCM_32: info.encoding = eSampleEncoding::Pcm32; break;
+    case SF_FORMAT_FLOAT: info.encoding = eSampleEncoding::Float32; break;
+    case SF_FORMAT_DOUBLE: info.encoding = eSampleEncoding::Float64; break;
+    default: info.encoding = eSampleEncoding::Compressed; break;
+  }
+  return true;
+}
+
+int64_t modified_ns(const struct stat &st)
+{
+  return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+/** @struct Candidate
+ *  @brief An audio file found by the walk, before its index entry is checked
+ */
+struct Candidate
+{
+  std::string path;
+  uint64_t size;
+  int64_t modified_ns;
+};
+
+/** @class DirectoryQueue
+ *  @brief Directories waiting to be listed, shared by the walking threads.
+ *  pop() returns false once the queue is empty and no thread is listing a directory that could add more.
+ */
+class DirectoryQueue
+{
+public:
+  void push(std::string directory)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_directories.push_back(std::move(directory));
+    }
+    m_condition.notify_one();
+  }
+
+  bool pop(std::string &directory)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return !m_directories.empty() || m_busy == 0; });
+    if (m_directories.empty())
+      return false;
+
+    directory = std::move(m_directories.front());
+    m_directories.pop_front();
+    ++m_busy;
+    return true;
+  }
+
+  void done()
+  {
+    bool finished;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      finished = --m_busy == 0 && m_directories.empty();
+    }
+    if (finished)
+      m_condition.notify_all();
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<std::string> m_directories;
+  size_t m_busy = 0;
+};
+
+}  // namespace
+
+/** @brief LibraryScanner constructor
+ */
+LibraryScanner::LibraryScanner(const LibraryScanOptions &options):
+  m_options(options)
+{
+  for (auto &extension : m_options.extensions)
+  {
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  }
+}
+
+/** @brief Whether a file name has one of the scanned extensions, ignoring case.
+ */
+bool LibraryScanner::is_audio_file(const char *name) const
+{
+  const char *dot = std::strrchr(name, '.');
+  if (!dot)
+    return false;
+
+  const size_t length = std::strlen(dot);
+  for (const auto &extension : m_options.extensions)
+  {
+    if (extension.size() == length && strncasecmp(dot, extension.c_str(), length) == 0)
+      return true;
+  }
+  return false;
+}
+
+/** @brief Reads the format of an audio file from its header, without reading any samples.
+ *  WAV, RF64 and AIFF headers are parsed directly; anything else goes through libsndfile.
+ *  @param path The file
+ *  @param info Receives the container, encoding, sample rate, channels and length
+ *  @return False if the file is not audio in a format that could be read
+ */
+bool LibraryScanner::probe(const std::string &path, SampleInfo &info)
+{
+  info.container = eAudioContainer::Unknown;
+  info.encoding = eSampleEncoding::Unknown;
+  info.sample_rate = 0;
+  info.channels = 0;
+  info.frames = 0;
+
+  FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() < 0)
+    return false;
+
+  struct stat st;
+  uint8_t header[12];
+  if (::fstat(fd.get(), &st) != 0 || !read_at(fd.get(), header, sizeof(header), 0))
+    return false;
+
+  const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+  bool found = false;
+  if ((std::memcmp(header, "RIFF", 4) == 0 || std::memcmp(header, "RF64", 4) == 0) &&
+      std::memcmp(header + 8, "WAVE", 4) == 0)
+    found = probe_wav(fd.get(), file_size, header[1] == 'F', info);
+  else if (std::memcmp(header, "FORM", 4) == 0 &&
+           (std::memcmp(header + 8, "AIFF", 4) == 0 || std::memcmp(header + 8, "AIFC", 4) == 0))
+    found = probe_aiff(fd.get(), file_size, header[11] == 'C', info);
+  else
+    found = probe_sndfile(path, info);
+
+  if (!found)
+  {
+    info.container = eAudioContainer::Unknown;
+    info.encoding = eSampleEncoding::Unknown;
+  }
+  return found;
+}
+
+/** @brief Scans a directory tree and brings the index up to date with it.
+ *  Entries under root for files that no longer exist are dropped; entries elsewhere are left alone.
+ *  @param root The directory to scan
+ *  @param index The index to check against and update
+ *  @return What was found and how much of it had to be read
+ *  @throws std::runtime_error if root is not a directory
+ */
+LibraryScanReport LibraryScanner::scan(const std::filesystem::path &root, LibraryIndex &index) const
+{
+  const auto started = std::chrono::steady_clock::now();
+
+  std::string root_path = FileManager::instance().convert_to_absolute(root).lexically_normal().string();
+  while (root_path.size() > 1 && root_path.back() == '/')
+    root_path.pop_back();
+
+  struct stat root_stat;
+  if (::stat(root_path.c_str(), &root_stat) != 0 || !S_ISDIR(root_stat.st_mode))
+  {
+    throw std::runtime_error("Path does not exist or is not a directory: " + root_path);
+  }
+
+  LibraryScanReport report;
+  unsigned int threads = m_options.threads > 0 ? m_options.threads : std::thread::hardware_concurrency();
+  threads = std::max(1u, threads);
+  report.threads = threads;
+
+  std::vector<std::vector<Candidate>> found(threads);
+  std::atomic<size_t> directories{0};
+
+  // Walk: one listing per directory, one stat per audio file
+  DirectoryQueue queue;
+  queue.push(root_path);
+
+  auto walk = [&](const unsigned int worker)
+  {
+    std::string directory;
+    while (queue.pop(directory))
+    {
+      DIR *dir = ::opendir(directory.c_str());
+      if (!dir)
+      {
+        LOG_ERROR("LibraryScanner: Cannot open ", directory, ": ", std::strerror(errno));
+        queue.done();
+        continue;
+      }
+      directories.fetch_add(1, std::memory_order_relaxed);
+
+      const int dir_fd = ::dirfd(dir);
+      while (const struct dirent *entry = ::readdir(dir))
+      {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+          continue;
+
+        unsigned char type = entry->d_type;
+        const bool audio = is_audio_file(name);
+        struct stat st;
+        bool have_stat = false;
+
+        // Only file systems that do not fill in d_type cost a stat for non-audio entries
+        if (type == DT_UNKNOWN || (type == DT_REG && audio))
+        {
+          if (::fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+          have_stat = true;
+          type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+
+        std::string path = directory;
+        if (path.back() != '/')
+          path += '/';
+        path += name;
+
+        if (type == DT_DIR)
+          queue.push(std::move(path));
+        else if (type == DT_REG && audio && have_stat)
+          found[worker].push_back(Candidate{std::move(path), static_cast<uint64_t>(st.st_size), modified_ns(st)});
+      }
+
+      ::closedir(dir);
+      queue.done();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int i = 1; i < threads; ++i)
+  {
+    workers.emplace_back(walk, i);
+  }
+  walk(0);
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+  workers.clear();
+
+  std::vector<Candidate> candidates;
+  for (auto &list : found)
+  {
+    std::move(list.begin(), list.end(), std::back_inserter(candidates));
+  }
+  report.directories = directories.load();
+  report.files = candidates.size();
+
+  // Probe: only what is new or changed since the index was written
+  std::vector<SampleInfo> entries(candidates.size());
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> probed{0};
+  std::atomic<size_t> unreadable{0};
+
+  auto check = [&]()
+  {
+    size_t i;
+    while ((i = next.fetch_add(1, std::memory_order_relaxed)) < candidates.size())
+    {
+      Candidate &candidate = candidates[i];
+      const SampleInfo *known = index.find(candidate.path);
+      if (known && known->size == candidate.size && known->modified_ns == candidate.modified_ns)
+      {
+        entries[i] = *known;
+      }
+      else
+      {
+        SampleInfo &info = entries[i];
+        info.path = std::move(candidate.path);
+        info.size = candidate.size;
+        info.modified_ns = candidate.modified_ns;
+        probe(info.path, info);
+        probed.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      if (!entries[i].is_readable())
+        unreadable.fetch_add(1, std::memory_order_relaxed);
+    }
+  };
+
+  const unsigned int probe_threads = static_cast<unsigned int>(std::clamp<size_t>(candidates.size(), 1, threads));
+  for (unsigned int i = 1; i < probe_threads; ++i)
+  {
+    workers.emplace_back(check);
+  }
+  check();
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+
+  report.probed = probed.load();
+  report.unchanged = report.files - report.probed;
+  report.unreadable = unreadable.load();
+  report.removed = index.replace_under(root_path, std::move(entries));
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  LOG_INFO("LibraryScanner: ", report.files, " files in ", report.directories, " directories under ", root_path,
+           ", ", report.probed, " probed, ", report.removed, " removed, in ", report.seconds, " s");
+  return report;
+}
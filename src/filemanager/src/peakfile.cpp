@@ -0,0 +1,451 @@
+#include "peakfile.h"
+#include "filemanager.h"
+#include "wavfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Files;
+
+namespace
+{
+
+static constexpr char kPeakMagic[8] = {'E', 'A', 'E', 'P', 'E', 'A', 'K', '1'};
+static constexpr unsigned int kReadFrames = 256 * 256;
+
+/** @struct FileHeader
+ *  @brief Start of a peak file, followed by one LevelHeader per level and the peaks
+ */
+struct FileHeader
+{
+  char magic[8];
+  uint32_t channels;
+  uint32_t sample_rate;
+  uint64_t frames;
+  uint64_t source_size;
+  int64_t source_modified_ns;
+  uint32_t level_count;
+  uint32_t reserved;
+};
+
+struct LevelHeader
+{
+  uint64_t frames_per_peak;
+  uint64_t count;
+  uint64_t offset;  // From the start of the file
+};
+
+static_assert(sizeof(FileHeader) == 48 && sizeof(LevelHeader) == 24 && sizeof(PeakValue) == 6);
+
+/** @struct Accumulator
+ *  @brief One channel of the peak being built at one level
+ */
+struct Accumulator
+{
+  float min = std::numeric_limits<float>::max();
+  float max = std::numeric_limits<float>::lowest();
+  double sum_of_squares = 0.0;
+  uint64_t frames = 0;
+
+  void merge(const Accumulator &other)
+  {
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum_of_squares += other.sum_of_squares;
+    frames += other.frames;
+  }
+};
+
+int16_t quantize(const float value)
+{
+  return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+PeakValue to_peak(const Accumulator &accumulator)
+{
+  if (accumulator.frames == 0)
+    return PeakValue{0, 0, 0};
+
+  const float rms = static_cast<float>(std::sqrt(accumulator.sum_of_squares / static_cast<double>(accumulator.frames)));
+  return PeakValue{quantize(accumulator.min), quantize(accumulator.max), quantize(rms)};
+}
+
+/** @class PeakBuilder
+ *  @brief Streams planar blocks into every level at once.
+ *  Level 0 accumulates samples; each completed peak is stored and merged into
+ *  the level above, which completes after kLevelFactor of them.
+ */
+class PeakBuilder
+{
+public:
+  PeakBuilder(const unsigned int channels, const uint64_t frames):
+    m_channels(channels)
+  {
+    uint64_t frames_per_peak = PeakFile::kBaseFramesPerPeak;
+    for (;;)
+    {
+      const uint64_t count = (frames + frames_per_peak - 1) / frames_per_peak;
+      Level level;
+      level.frames_per_peak = frames_per_peak;
+      level.peaks.reserve(count * channels);
+      level.current.resize(channels);
+      m_levels.push_back(std::move(level));
+
+      if (count <= 1)
+        break;
+      frames_per_peak *= PeakFile::kLevelFactor;
+    }
+  }
+
+  void add(const AudioBuffer &buffer, const unsigned int n_frames)
+  {
+    Level &base = m_levels.front();
+    unsigned int frame = 0;
+    while (frame < n_frames)
+    {
+      const uint64_t room = base.frames_per_peak - base.current.front().frames;
+      const unsigned int frames = static_cast<unsigned int>(std::min<uint64_t>(room, n_frames - frame));
+
+      for (unsigned int channel = 0; channel < m_channels; ++channel)
+      {
+        const float *samples = buffer.get_channel(channel) + frame;
+        Accumulator &accumulator = base.current[channel];
+        float min = accumulator.min;
+        float max = accumulator.max;
+        double sum_of_squares = 0.0;
+        for (unsigned int i = 0; i < frames; ++i)
+        {
+          min = std::min(min, samples[i]);
+          max = std::max(max, samples[i]);
+          sum_of_squares += static_cast<double>(samples[i]) * samples[i];
+        }
+        accumulator.min = min;
+        accumulator.max = max;
+        accumulator.sum_of_squares += sum_of_squares;
+        accumulator.frames += frames;
+      }
+
+      frame += frames;
+      if (base.current.front().frames == base.frames_per_peak)
+        complete(0);
+    }
+  }
+
+  /** @brief Stores the partial peaks at the end of the file, lowest level first.
+   */
+  void finish()
+  {
+    for (size_t level = 0; level < m_levels.size(); ++level)
+    {
+      if (m_levels[level].current.front().frames > 0)
+        complete(level);
+    }
+  }
+
+  std::vector<PeakLevel> get_levels() const
+  {
+    std::vector<PeakLevel> levels;
+    for (const auto &level : m_levels)
+      levels.push_back(PeakLevel{level.frames_per_peak, level.peaks.size() / m_channels, level.peaks.data()});
+    return levels;
+  }
+
+private:
+  struct Level
+  {
+    uint64_t frames_per_peak;
+    std::vector<PeakValue> peaks;
+    std::vector<Accumulator> current;
+    uint64_t children = 0;
+  };
+
+  void complete(const size_t index)
+  {
+    Level &level = m_levels[index];
+    for (unsigned int channel = 0; channel < m_channels; ++channel)
+    {
+      level.peaks.push_back(to_peak(level.current[channel]));
+      if (index + 1 < m_levels.size())
+        m_levels[index + 1].current[channel].merge(level.current[channel]);
+      level.current[channel] = Accumulator{};
+    }
+
+    if (index + 1 < m_levels.size() && ++m_levels[index + 1].children == PeakFile::kLevelFactor)
+    {
+      complete(index + 1);
+      m_levels[index + 1].children = 0;
+    }
+  }
+
+  unsigned int m_channels;
+  std::vector<Level> m_levels;
+};
+
+int64_t modified_ns(const struct stat &st)
+{
+  return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+}  // namespace
+
+/** @brief Where the peak file of a source lives.
+ *  @param source The audio file
+ *  @param cache_directory Directory holding peak files, or empty to keep them next to their sources
+ *  @return source.peaks, or a name in the cache directory unique to the source's absolute path
+ */
+std::filesystem::path PeakFile::get_path(const std::filesystem::path &source,
+                                         const std::filesystem::path &cache_directory)
+{
+  const std::filesystem::path absolute = FileManager::instance().convert_to_absolute(source).lexically_normal();
+  if (cache_directory.empty())
+  {
+    std::filesystem::path path = absolute;
+    path += ".peaks";
+    return path;
+  }
+
+  // FNV-1a, stable across runs so the cache survives restarts
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const char c : absolute.string())
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ull;
+  }
+
+  char suffix[24];
+  std::snprintf(suffix, sizeof(suffix), "-%016llx.peaks", static_cast<unsigned long long>(hash));
+  return cache_directory / (absolute.filename().string() + suffix);
+}
+
+/** @brief Reads a whole WAV file once and writes its peak file.
+ *  The destination is replaced only once the new file is complete.
+ *  @param source The WAV file to summarise
+ *  @param destination The peak file to write
+ *  @throws std::runtime_error if the source cannot be read or the destination written
+ */
+void PeakFile::build(const std::filesystem::path &source, const std::filesystem::path &destination)
+{
+  auto file = FileManager::instance().read_wav_file(source);
+
+  struct stat st;
+  if (::stat(file->get_filepath().c_str(), &st) != 0)
+  {
+    throw std::runtime_error("Failed to stat audio file: " + file->get_filepath().string());
+  }
+
+  const unsigned int channels = file->get_channels();
+  const uint64_t frames = static_cast<uint64_t>(std::max<sf_count_t>(file->get_frames(), 0));
+
+  PeakBuilder builder(channels, frames);
+  AudioBuffer block(channels, kReadFrames);
+  uint64_t frames_read = 0;
+  while (const unsigned int n_frames = file->read(block, kReadFrames))
+  {
+    builder.add(block, n_frames);
+    frames_read += n_frames;
+  }
+  builder.finish();
+
+  const std::vector<PeakLevel> levels = builder.get_levels();
+
+  FileHeader header{};
+  std::memcpy(header.magic, kPeakMagic, sizeof(kPeakMagic));
+  header.channels = channels;
+  header.sample_rate = file->get_sample_rate();
+  header.frames = frames_read;
+  header.source_size = static_cast<uint64_t>(st.st_size);
+  header.source_modified_ns = modified_ns(st);
+  header.level_count = static_cast<uint32_t>(levels.size());
+
+  std::vector<LevelHeader> level_headers;
+  uint64_t offset = sizeof(FileHeader) + levels.size() * sizeof(LevelHeader);
+  for (const auto &level : levels)
+  {
+    level_headers.push_back(LevelHeader{level.frames_per_peak, level.count, offset});
+    offset += (level.count * channels * sizeof(PeakValue) + 7) & ~uint64_t{7};
+  }
+
+  std::filesystem::path temporary = destination;
+  temporary += ".tmp";
+
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(level_headers.data()),
+              static_cast<std::streamsize>(level_headers.size() * sizeof(LevelHeader)));
+
+    static constexpr char kPadding[8] = {};
+    for (const auto &level : levels)
+    {
+      const size_t bytes = level.count * channels * sizeof(PeakValue);
+      out.write(reinterpret_cast<const char*>(level.peaks), static_cast<std::streamsize>(bytes));
+      out.write(kPadding, static_cast<std::streamsize>(((bytes + 7) & ~size_t{7}) - bytes));
+    }
+
+    if (!out.flush())
+    {
+      throw std::runtime_error("Failed to write peak file: " + temporary.string());
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, destination, error);
+  if (error)
+  {
+    std::filesystem::remove(temporary, error);
+    throw std::runtime_error("Failed to replace peak file: " + destination.string());
+  }
+}
+
+/** @brief Maps a peak file into memory.
+ *  @param path The peak file
+ *  @return The mapped file
+ *  @throws std::runtime_error if the file cannot be mapped or is not a valid peak file
+ */
+std::unique_ptr<PeakFile> PeakFile::open(const std::filesystem::path &path)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    throw std::runtime_error("Failed to open peak file: " + path.string());
+  }
+
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(FileHeader)))
+    data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if (data == MAP_FAILED)
+  {
+    throw std::runtime_error("Failed to map peak file: " + path.string());
+  }
+
+  auto file = std::unique_ptr<PeakFile>(new PeakFile());
+  file->p_data = static_cast<const unsigned char*>(data);
+  file->m_size = static_cast<size_t>(st.st_size);
+
+  const auto *header = reinterpret_cast<const FileHeader*>(file->p_data);
+  bool valid = std::memcmp(header->magic, kPeakMagic, sizeof(kPeakMagic)) == 0 && header->channels > 0 &&
+               header->level_count > 0 &&
+               header->level_count <= (file->m_size - sizeof(FileHeader)) / sizeof(LevelHeader);
+
+  const auto *levels = reinterpret_cast<const LevelHeader*>(file->p_data + sizeof(FileHeader));
+  for (uint32_t i = 0; valid && i < header->level_count; ++i)
+  {
+    const uint64_t max_count = file->m_size / (sizeof(PeakValue) * header->channels);
+    valid = levels[i].frames_per_peak > 0 && levels[i].count <= max_count && levels[i].offset % 8 == 0 &&
+            levels[i].offset <= file->m_size &&
+            levels[i].count * header->channels * sizeof(PeakValue) <= file->m_size - levels[i].offset;
+  }
+
+  if (!valid)
+  {
+    throw std::runtime_error("Not a valid peak file: " + path.string());
+  }
+
+  file->m_channels = header->channels;
+  file->m_sample_rate = header->sample_rate;
+  file->m_frames = header->frames;
+  file->m_source_size = header->source_size;
+  file->m_source_modified_ns = header->source_modified_ns;
+  file->m_level_count = header->level_count;
+  return file;
+}
+
+/** @brief PeakFile destructor, unmaps the file
+ */
+PeakFile::~PeakFile()
+{
+  if (p_data)
+    ::munmap(const_cast<unsigned char*>(p_data), m_size);
+}
+
+/** @brief Whether the source still has the size and modification time the peaks were built from.
+ */
+bool PeakFile::is_current(const std::filesystem::path &source) const
+{
+  struct stat st;
+  return ::stat(source.c_str(), &st) == 0 && static_cast<uint64_t>(st.st_size) == m_source_size &&
+         modified_ns(st) == m_source_modified_ns;
+}
+
+/** @brief One zoom level, 0 being the finest.
+ */
+PeakLevel PeakFile::get_level(const size_t level) const noexcept
+{
+  if (level >= m_level_count)
+    return PeakLevel{0, 0, nullptr};
+
+  const auto *header = reinterpret_cast<const LevelHeader*>(p_data + sizeof(FileHeader)) + level;
+  return PeakLevel{header->frames_per_peak, header->count, reinterpret_cast<const PeakValue*>(p_data + header->offset)};
+}
+
+/** @brief Summarises a frame range of one channel into one point per pixel.
+ *  Reads from the coarsest level that still has a peak per pixel, so the cost follows
+ *  the number of points rather than the length of the range.
+ *  @param channel The channel to draw
+ *  @param start First frame of the range
+ *  @param end One past the last frame of the range
+ *  @param points One point per pixel, filled from left to right
+ *  @return The number of points that cover audio; points past the end of the file are zero
+ */
+size_t PeakFile::read(const unsigned int channel, const uint64_t start, const uint64_t end,
+                      std::span<WaveformPoint> points) const noexcept
+{
+  std::fill(points.begin(), points.end(), WaveformPoint{0.0f, 0.0f, 0.0f});
+  if (channel >= m_channels || points.empty() || end <= start || start >= m_frames)
+    return 0;
+
+  const uint64_t span = end - start;
+  const uint64_t frames_per_point = std::max<uint64_t>(1, span / points.size());
+
+  size_t level_index = 0;
+  while (level_index + 1 < m_level_count && get_level(level_index + 1).frames_per_peak <= frames_per_point)
+    ++level_index;
+  const PeakLevel level = get_level(level_index);
+
+  static constexpr float kScale = 1.0f / 32767.0f;
+  size_t filled = 0;
+  for (size_t point = 0; point < points.size(); ++point)
+  {
+    const uint64_t from = start + span * point / points.size();
+    const uint64_t to = std::max(from + 1, start + span * (point + 1) / points.size());
+    if (from >= m_frames)
+      break;
+
+    const uint64_t first = from / level.frames_per_peak;
+    const uint64_t last = std::min(level.count, (std::min(to, m_frames) + level.frames_per_peak - 1) / level.frames_per_peak);
+
+    int min = std::numeric_limits<int16_t>::max();
+    int max = std::numeric_limits<int16_t>::min();
+    double sum_of_squares = 0.0;
+    for (uint64_t peak = first; peak < last; ++peak)
+    {
+      const PeakValue &value = level.peaks[peak * m_channels + channel];
+      min = std::min<int>(min, value.min);
+      max = std::max<int>(max, value.max);
+      sum_of_squares += static_cast<double>(value.rms) * value.rms;
+    }
+
+    if (last > first)
+    {
+      const float rms = static_cast<float>(std::sqrt(sum_of_squares / static_cast<double>(last - first)));
+      points[point] = WaveformPoint{min * kScale, max * kScale, rms * kScale};
+    }
+    filled = point + 1;
+  }
+
+  return filled;
+}
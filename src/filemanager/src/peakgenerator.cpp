@@ -0,0 +1,134 @@
+#include "peakgenerator.h"
+#include "filemanager.h"
+#include "peakfile.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <exception>
+
+using namespace Files;
+
+/** @brief PeakGenerator constructor, starts the worker threads.
+ *  @param threads Number of workers, 0 for every hardware thread
+ *  @param cache_directory Directory for peak files, created if missing, or empty to keep them next to their sources
+ */
+PeakGenerator::PeakGenerator(const unsigned int threads, const std::filesystem::path &cache_directory):
+  m_cache_directory(cache_directory),
+  m_stopping(false)
+{
+  if (!m_cache_directory.empty())
+    std::filesystem::create_directories(m_cache_directory);
+
+  const unsigned int count = std::max(1u, threads > 0 ? threads : std::thread::hardware_concurrency());
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    m_workers.emplace_back(&PeakGenerator::run, this);
+  }
+}
+
+/** @brief PeakGenerator destructor, finishes the builds in progress and abandons the rest.
+ */
+PeakGenerator::~PeakGenerator()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_jobs.clear();
+  }
+  m_condition.notify_all();
+
+  for (auto &worker : m_workers)
+  {
+    worker.join();
+  }
+}
+
+/** @brief Asks for the peak file of a source.
+ *  @param source The WAV file to summarise
+ *  @return The path of the peak file once it is current, or the build error
+ */
+std::shared_future<std::filesystem::path> PeakGenerator::request(const std::filesystem::path &source)
+{
+  const std::filesystem::path absolute = FileManager::instance().convert_to_absolute(source).lexically_normal();
+  const std::filesystem::path destination = PeakFile::get_path(absolute, m_cache_directory);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto in_flight = m_in_flight.find(absolute);
+  if (in_flight != m_in_flight.end())
+    return in_flight->second;
+
+  // Only the header is read to check the existing file
+  try
+  {
+    if (std::filesystem::exists(destination) && PeakFile::open(destination)->is_current(absolute))
+    {
+      std::promise<std::filesystem::path> ready;
+      ready.set_value(destination);
+      return ready.get_future().share();
+    }
+  }
+  catch (const std::exception &)
+  {
+    // Damaged peak file, build it again
+  }
+
+  Job job{absolute, destination, {}};
+  std::shared_future<std::filesystem::path> future = job.promise.get_future().share();
+  m_in_flight.emplace(absolute, future);
+  m_jobs.push_back(std::move(job));
+  m_condition.notify_one();
+  return future;
+}
+
+/** @brief Number of sources queued or being built.
+ */
+size_t PeakGenerator::get_pending_count() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_in_flight.size();
+}
+
+/** @brief Worker loop: build one queued peak file at a time until stopped.
+ */
+void PeakGenerator::run()
+{
+  set_thread_name("PeakGenerator");
+
+  for (;;)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+      if (m_stopping)
+        return;
+
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    std::exception_ptr error;
+    try
+    {
+      PeakFile::build(job.source, job.destination);
+    }
+    catch (const std::exception &e)
+    {
+      LOG_ERROR("PeakGenerator: ", e.what());
+      error = std::current_exception();
+    }
+
+    // Forget the build before announcing it, so a request made once the future
+    // is ready checks the file again instead of sharing the finished build
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_in_flight.erase(job.source);
+    }
+
+    if (error)
+      job.promise.set_exception(error);
+    else
+      job.promise.set_value(job.destination);
+  }
+}
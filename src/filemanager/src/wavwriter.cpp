@@ -0,0 +1,95 @@
+#include "wavwriter.h"
+
+#include <stdexcept>
+#include <string>
+
+using namespace Files;
+
+namespace
+{
+
+int to_sndfile_format(const eWavSampleFormat format)
+{
+  switch (format)
+  {
+    case eWavSampleFormat::Pcm16:
+      return SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    case eWavSampleFormat::Pcm24:
+      return SF_FORMAT_WAV | SF_FORMAT_PCM_24;
+    default:
+      return SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+  }
+}
+
+}  // namespace
+
+/** @brief Create a WAV file, replacing any existing file.
+ *  @param path Where to write
+ *  @param channels Channels per frame
+ *  @param sample_rate Sample rate in Hz
+ *  @param format Sample encoding, PCM formats are clipped to [-1, 1]
+ *  @throws std::invalid_argument if the format is not valid for a WAV file
+ *  @throws std::runtime_error if the file cannot be created
+ */
+WavWriter::WavWriter(const std::filesystem::path &path, const unsigned int channels,
+                     const unsigned int sample_rate, const eWavSampleFormat format):
+  m_filepath(path),
+  m_channels(channels),
+  m_sample_rate(sample_rate),
+  m_frames_written(0),
+  p_sndfile(nullptr)
+{
+  SF_INFO info{};
+  info.channels = static_cast<int>(channels);
+  info.samplerate = static_cast<int>(sample_rate);
+  info.format = to_sndfile_format(format);
+
+  if (channels == 0 || sample_rate == 0 || !sf_format_check(&info))
+  {
+    throw std::invalid_argument("Invalid WAV format for: " + path.string());
+  }
+
+  p_sndfile = sf_open(path.string().c_str(), SFM_WRITE, &info);
+  if (!p_sndfile)
+  {
+    throw std::runtime_error("Failed to create WAV file: " + path.string());
+  }
+}
+
+/** @brief WavWriter destructor, closes the file if still open
+ */
+WavWriter::~WavWriter()
+{
+  close();
+}
+
+/** @brief Append frames to the file.
+ *  @param interleaved n_frames * channels samples
+ *  @param n_frames Number of frames
+ *  @throws std::runtime_error if the writer is closed or the write fails
+ */
+void WavWriter::write(const float *interleaved, const sf_count_t n_frames)
+{
+  if (!p_sndfile)
+  {
+    throw std::runtime_error("WAV file is closed: " + m_filepath.string());
+  }
+
+  const sf_count_t written = sf_writef_float(p_sndfile, interleaved, n_frames);
+  m_frames_written += written;
+  if (written != n_frames)
+  {
+    throw std::runtime_error("Failed to write WAV file: " + m_filepath.string() + ": " + sf_strerror(p_sndfile));
+  }
+}
+
+/** @brief Finalise the header and close the file.
+ */
+void WavWriter::close()
+{
+  if (p_sndfile)
+  {
+    sf_close(p_sndfile);
+    p_sndfile = nullptr;
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef __ALLOCATORS_H__
+#define __ALLOCATORS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+
+/** @class LockedMemoryPool
+ *  @brief Preallocated, page-locked pool for long-lived DSP buffers.
+ *
+ *  The region is mapped and prefaulted at construction and locked into RAM
+ *  where the process is permitted to (see is_locked()). Buffers of any size
+ *  are carved out of it first-fit, and freed buffers go back on a free list
+ *  sorted by address and merge with their free neighbours, so the region is
+ *  reused however many times the engine is prepared. The free list lives in
+ *  the free memory itself. Allocation locks a mutex and walks the free list,
+ *  so it should happen while preparing, not on the audio thread.
+ */
+class LockedMemoryPool : public std::pmr::memory_resource
+{
+public:
+  explicit LockedMemoryPool(const size_t capacity);
+  ~LockedMemoryPool() override;
+
+  LockedMemoryPool(const LockedMemoryPool &) = delete;
+  LockedMemoryPool &operator=(const LockedMemoryPool &) = delete;
+
+  size_t get_capacity() const noexcept { return m_capacity; }
+  bool is_locked() const noexcept { return m_locked; }
+
+  size_t get_used() const;
+  size_t get_largest_free() const;
+
+protected:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+private:
+  /** @struct FreeChunk
+   *  @brief Header written at the start of every free chunk
+   */
+  struct FreeChunk
+  {
+    size_t size;
+    FreeChunk *next;
+  };
+
+  /** @struct Allocation
+   *  @brief Header written just before every buffer handed out, so it can be freed without its size
+   */
+  struct Allocation
+  {
+    std::byte *chunk;
+    size_t size;
+  };
+
+  void *p_region;
+  size_t m_capacity;
+  bool m_locked;
+
+  mutable std::mutex m_mutex;
+  FreeChunk *p_free_list;
+  size_t m_used;
+};
+
+#endif  // __ALLOCATORS_H__
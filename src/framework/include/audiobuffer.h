@@ -0,0 +1,76 @@
+#ifndef __AUDIO_BUFFER_H__
+#define __AUDIO_BUFFER_H__
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/** @class AudioBuffer
+ *  @brief Planar (non-interleaved) block of float samples.
+ *
+ *  Every channel starts on a 64-byte boundary and the per-channel stride is
+ *  padded to a whole number of cache lines, so per-channel DSP loops vectorize
+ *  cleanly. Audio is only interleaved at the device or file boundary.
+ *
+ *  Memory is taken from a std::pmr resource when the buffer is resized. Resize
+ *  while preparing, never on the audio thread.
+ */
+class AudioBuffer
+{
+public:
+  static constexpr size_t kAlignment = 64;
+
+  explicit AudioBuffer(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+  AudioBuffer(const unsigned int channels, const unsigned int frames,
+              std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+  ~AudioBuffer();
+
+  AudioBuffer(AudioBuffer &&other) noexcept;
+  AudioBuffer &operator=(AudioBuffer &&other) noexcept;
+  AudioBuffer(const AudioBuffer &) = delete;
+  AudioBuffer &operator=(const AudioBuffer &) = delete;
+
+  void resize(const unsigned int channels, const unsigned int frames);
+
+  void clear() noexcept;
+  void clear(const unsigned int n_frames) noexcept;
+  void copy_from(const AudioBuffer &other, const unsigned int n_frames) noexcept;
+
+  inline unsigned int get_channels() const noexcept { return m_channels; }
+  inline unsigned int get_frames() const noexcept { return m_frames; }
+
+  inline float *get_channel(const unsigned int channel) noexcept
+  {
+    return m_channel_pointers[channel];
+  }
+
+  inline const float *get_channel(const unsigned int channel) const noexcept
+  {
+    return m_channel_pointers[channel];
+  }
+
+  /** @brief Array of channel pointers, in the form expected by the interleave kernels.
+   */
+  inline float *const *get_channel_pointers() noexcept
+  {
+    return m_channel_pointers.data();
+  }
+
+  inline const float *const *get_channel_pointers() const noexcept
+  {
+    return m_channel_pointers.data();
+  }
+
+private:
+  void release() noexcept;
+
+  std::pmr::memory_resource *p_resource;
+  float *p_data;
+  size_t m_stride;
+  size_t m_bytes;
+  unsigned int m_channels;
+  unsigned int m_frames;
+  std::pmr::vector<float *> m_channel_pointers;
+};
+
+#endif  // __AUDIO_BUFFER_H__
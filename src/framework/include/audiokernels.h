@@ -0,0 +1,222 @@
+#ifndef __AUDIO_KERNELS_H__
+#define __AUDIO_KERNELS_H__
+
+#include <cmath>
+
+/** Block kernels for planar audio.
+ *
+ *  Each kernel is templated on the channel count so the channel loop is
+ *  unrolled and the frame loop vectorizes. ChannelKernels<0> is the generic
+ *  fallback that takes the channel count at runtime. select_kernels() is called
+ *  once when a stream opens and returns the specialization to use per block.
+ */
+namespace Kernels
+{
+
+void interleave_stereo(const float *left, const float *right, float *out, const unsigned int n_frames) noexcept;
+void deinterleave_stereo(const float *in, float *left, float *right, const unsigned int n_frames) noexcept;
+void interleave_quad(const float *const *planar, float *out, const unsigned int stride, const unsigned int n_frames) noexcept;
+void deinterleave_quad(const float *in, float *const *planar, const unsigned int stride, const unsigned int n_frames) noexcept;
+void peak_and_energy(const float *in, const unsigned int n_frames, float &peak, float &sum_squares) noexcept;
+
+// Level below which a block counts as silence, -120 dBFS
+static constexpr float kSilenceThreshold = 1.0e-6f;
+
+bool is_silent(const float *in, const unsigned int n_frames, const float threshold = kSilenceThreshold) noexcept;
+
+/** @brief Whether every channel of a planar block is within the threshold of zero.
+ */
+inline bool is_silent(const float *const *planar, const unsigned int channels, const unsigned int n_frames,
+                      const float threshold = kSilenceThreshold) noexcept
+{
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    if (!is_silent(planar[ch], n_frames, threshold))
+      return false;
+  }
+  return true;
+}
+
+/** @struct ChannelKernels
+ *  @brief Kernels for a compile-time channel count. Channels == 0 means generic.
+ *  The channels argument is only read by the generic version.
+ */
+template <unsigned int Channels>
+struct ChannelKernels
+{
+  static constexpr unsigned int count(const unsigned int channels) noexcept
+  {
+    return Channels == 0 ? channels : Channels;
+  }
+
+  /** @brief Interleave planar channels into a frame-major buffer.
+   */
+  static void interleave(const float *const *planar, float *interleaved,
+                         const unsigned int channels, const unsigned int n_frames) noexcept
+  {
+    const unsigned int n = count(channels);
+    if constexpr (Channels == 1)
+    {
+      for (unsigned int frame = 0; frame < n_frames; ++frame)
+        interleaved[frame] = planar[0][frame];
+    }
+    else if constexpr (Channels == 2)
+    {
+      interleave_stereo(planar[0], planar[1], interleaved, n_frames);
+    }
+    else if constexpr (Channels == 4)
+    {
+      interleave_quad(planar, interleaved, 4, n_frames);
+    }
+    else if constexpr (Channels == 8)
+    {
+      interleave_quad(planar, interleaved, 8, n_frames);
+      interleave_quad(planar + 4, interleaved + 4, 8, n_frames);
+    }
+    else
+    {
+      // Walk one channel at a time so the reads stay sequential
+      for (unsigned int ch = 0; ch < n; ++ch)
+      {
+        const float *in = planar[ch];
+        for (unsigned int frame = 0; frame < n_frames; ++frame)
+          interleaved[frame * n + ch] = in[frame];
+      }
+    }
+  }
+
+  /** @brief Split a frame-major buffer into planar channels.
+   */
+  static void deinterleave(const float *interleaved, float *const *planar,
+                           const unsigned int channels, const unsigned int n_frames) noexcept
+  {
+    const unsigned int n = count(channels);
+    if constexpr (Channels == 1)
+    {
+      for (unsigned int frame = 0; frame < n_frames; ++frame)
+        planar[0][frame] = interleaved[frame];
+    }
+    else if constexpr (Channels == 2)
+    {
+      deinterleave_stereo(interleaved, planar[0], planar[1], n_frames);
+    }
+    else if constexpr (Channels == 4)
+    {
+      deinterleave_quad(interleaved, planar, 4, n_frames);
+    }
+    else if constexpr (Channels == 8)
+    {
+      deinterleave_quad(interleaved, planar, 8, n_frames);
+      deinterleave_quad(interleaved + 4, planar + 4, 8, n_frames);
+    }
+    else
+    {
+      for (unsigned int ch = 0; ch < n; ++ch)
+      {
+        float *out = planar[ch];
+        for (unsigned int frame = 0; frame < n_frames; ++frame)
+          out[frame] = interleaved[frame * n + ch];
+      }
+    }
+  }
+
+  /** @brief Add gain * source into destination.
+   */
+  static void mix(const float *const *source, float *const *destination, const float gain,
+                  const unsigned int channels, const unsigned int n_frames) noexcept
+  {
+    const unsigned int n = count(channels);
+    for (unsigned int ch = 0; ch < n; ++ch)
+    {
+      const float *__restrict in = source[ch];
+      float *__restrict out = destination[ch];
+      for (unsigned int frame = 0; frame < n_frames; ++frame)
+        out[frame] += gain * in[frame];
+    }
+  }
+
+  /** @brief Multiply every sample by a gain.
+   */
+  static void apply_gain(float *const *buffer, const float gain,
+                         const unsigned int channels, const unsigned int n_frames) noexcept
+  {
+    const unsigned int n = count(channels);
+    for (unsigned int ch = 0; ch < n; ++ch)
+    {
+      float *__restrict data = buffer[ch];
+      for (unsigned int frame = 0; frame < n_frames; ++frame)
+        data[frame] *= gain;
+    }
+  }
+
+  /** @brief Constant-power pan across the first channel pair.
+   *  @param pan -1 (left) to 1 (right). Mono buffers are left unchanged.
+   */
+  static void pan(float *const *buffer, const float pan,
+                  const unsigned int channels, const unsigned int n_frames) noexcept
+  {
+    if (count(channels) < 2)
+      return;
+
+    const float angle = (pan + 1.0f) * 0.25f * static_cast<float>(M_PI);
+    const float left_gain = std::cos(angle) * static_cast<float>(M_SQRT2);
+    const float right_gain = std::sin(angle) * static_cast<float>(M_SQRT2);
+
+    float *__restrict left = buffer[0];
+    float *__restrict right = buffer[1];
+    for (unsigned int frame = 0; frame < n_frames; ++frame)
+    {
+      left[frame] *= left_gain;
+      right[frame] *= right_gain;
+    }
+  }
+};
+
+/** @struct KernelTable
+ *  @brief Kernels selected for one channel count.
+ */
+struct KernelTable
+{
+  unsigned int channels;  // 0 for the generic fallback
+  void (*interleave)(const float *const *, float *, unsigned int, unsigned int) noexcept;
+  void (*deinterleave)(const float *, float *const *, unsigned int, unsigned int) noexcept;
+  void (*mix)(const float *const *, float *const *, float, unsigned int, unsigned int) noexcept;
+  void (*apply_gain)(float *const *, float, unsigned int, unsigned int) noexcept;
+  void (*pan)(float *const *, float, unsigned int, unsigned int) noexcept;
+};
+
+template <unsigned int Channels>
+constexpr KernelTable make_kernel_table() noexcept
+{
+  return KernelTable{
+    Channels,
+    &ChannelKernels<Channels>::interleave,
+    &ChannelKernels<Channels>::deinterleave,
+    &ChannelKernels<Channels>::mix,
+    &ChannelKernels<Channels>::apply_gain,
+    &ChannelKernels<Channels>::pan,
+  };
+}
+
+const KernelTable &select_kernels(const unsigned int channels) noexcept;
+const KernelTable &generic_kernels() noexcept;
+
+/** @brief Interleave with a one-off dispatch. Prefer a cached KernelTable per block.
+ */
+inline void interleave(const float *const *planar, float *interleaved,
+                       const unsigned int channels, const unsigned int n_frames) noexcept
+{
+  select_kernels(channels).interleave(planar, interleaved, channels, n_frames);
+}
+
+/** @brief Deinterleave with a one-off dispatch. Prefer a cached KernelTable per block.
+ */
+inline void deinterleave(const float *interleaved, float *const *planar,
+                         const unsigned int channels, const unsigned int n_frames) noexcept
+{
+  select_kernels(channels).deinterleave(interleaved, planar, channels, n_frames);
+}
+
+}  // namespace Kernels
+
+#endif  // __AUDIO_KERNELS_H__
@@ -0,0 +1,34 @@
+#ifndef __DENORMALS_H__
+#define __DENORMALS_H__
+
+#include <cstddef>
+#include <cstdint>
+
+/** @class DenormalScope
+ *  @brief Flushes denormal floats to zero on the calling thread while in scope.
+ *
+ *  Feedback paths such as filter state, delay lines and reverb tails decay
+ *  into denormals, which are many times slower to compute on most CPUs. On
+ *  x86 this sets FTZ and DAZ in MXCSR, on ARM the FZ bit of FPCR/FPSCR. The
+ *  previous mode is restored on exit, so scopes nest. On other targets it
+ *  does nothing.
+ */
+class DenormalScope
+{
+public:
+  DenormalScope() noexcept;
+  ~DenormalScope() noexcept;
+
+  DenormalScope(const DenormalScope &) = delete;
+  DenormalScope &operator=(const DenormalScope &) = delete;
+
+  static bool is_supported() noexcept;
+  static bool is_active() noexcept;
+
+private:
+  uintptr_t m_saved;
+};
+
+size_t count_denormals(const float *samples, const size_t n_samples) noexcept;
+
+#endif  // __DENORMALS_H__
@@ -8,6 +8,7 @@
 
 #include "messagequeue.h"
 #include "logger.h"
+#include "threadconfig.h"
 
 /** @class IEngine
  @  @brief A base class for engines that can process messages in a separate thread.
@@ -43,6 +44,23 @@ public:
     }
   }
 
+  /** @brief Scheduling, affinity and stack prefault for the engine thread.
+   *  Takes effect the next time the thread starts.
+   */
+  void set_thread_config(const ThreadConfig &config)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_thread_config = config;
+  }
+
+  /** @brief What the engine thread was granted when it last started
+   */
+  ThreadReport get_thread_report()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_thread_report;
+  }
+
   void push_message(const T& msg) { m_message_queue.push(msg); }
   std::optional<T> try_pop_message() { return m_message_queue.try_pop(); }
   bool pop_message(T& out) { return m_message_queue.pop(out); }
@@ -57,16 +75,17 @@ protected:
 
   void _run()
   { 
-    // Set the thread name
+    // Set the thread name and scheduling
     {
       std::lock_guard<std::mutex> lock(m_mutex);
       set_thread_name(m_thread_name);
+      m_thread_report = apply_thread_config(m_thread_config);
     }
 
     // Signal that the thread is ready
     m_running.store(true, std::memory_order_release);
 
-    LOG_INFO("Thread Started");
+    LOG_INFO("Thread Started: ", thread_report_to_string(get_thread_report()));
 
     run();
 
@@ -82,6 +101,8 @@ private:
   std::thread m_thread;
   std::atomic<bool> m_running{false};
   std::mutex m_mutex;
+  ThreadConfig m_thread_config;
+  ThreadReport m_thread_report{};
 };
 
 #endif  // ___ENGINE_H_
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef __REALTIME_CHECK_H__
+#define __REALTIME_CHECK_H__
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+/** @enum eRealtimeViolation
+ *  @brief Kinds of calls that are not real-time safe on the audio thread
+ */
+enum class eRealtimeViolation : unsigned int
+{
+  Malloc,
+  Free,
+  OperatorNew,
+  OperatorDelete,
+  MutexLock,
+  BlockingCall,
+  FileIo,
+  Count,
+};
+
+/** @enum eRealtimeViolationPolicy
+ *  @brief What the RealtimeChecker does when a violation is detected
+ */
+enum class eRealtimeViolationPolicy
+{
+  Record,
+  Abort,
+};
+
+constexpr size_t kRealtimeViolationKinds = static_cast<size_t>(eRealtimeViolation::Count);
+
+/** @struct RealtimeViolationReport
+ *  @brief Snapshot of the violations recorded since the last reset.
+ */
+struct RealtimeViolationReport
+{
+  unsigned int total_violations;
+  std::array<unsigned int, kRealtimeViolationKinds> violations;
+  eRealtimeViolation first_violation;
+  std::vector<std::string> first_stack_trace;
+
+  bool is_clean() const { return total_violations == 0; }
+};
+
+const char *realtime_violation_to_string(eRealtimeViolation violation) noexcept;
+
+/** @class RealtimeChecker
+ *  @brief Detects allocations, mutex locks, blocking waits and file or device I/O made while a thread
+ *         is inside a RealtimeScope (i.e. the audio callback).
+ *
+ *  The checker itself only keeps counters. The calls are intercepted by the
+ *  realtimecheck_hooks object library, which is linked into the unit tests and
+ *  into the application when ENABLE_REALTIME_CHECKS is set.
+ */
+class RealtimeChecker
+{
+public:
+  static RealtimeChecker &instance()
+  {
+    static RealtimeChecker instance;
+    return instance;
+  }
+
+  static bool hooks_installed() noexcept;
+  static bool in_realtime_section() noexcept;
+
+  void set_policy(const eRealtimeViolationPolicy policy) noexcept
+  {
+    m_policy.store(policy, std::memory_order_relaxed);
+  }
+
+  eRealtimeViolationPolicy get_policy() const noexcept
+  {
+    return m_policy.load(std::memory_order_relaxed);
+  }
+
+  void reset() noexcept;
+  RealtimeViolationReport get_report() const;
+
+  void report_violation(const eRealtimeViolation violation) noexcept;
+
+private:
+  static constexpr int kMaxStackFrames = 32;
+
+  RealtimeChecker();
+  ~RealtimeChecker() = default;
+  RealtimeChecker(const RealtimeChecker &) = delete;
+  RealtimeChecker &operator=(const RealtimeChecker &) = delete;
+
+  std::atomic<eRealtimeViolationPolicy> m_policy{eRealtimeViolationPolicy::Record};
+  std::atomic<unsigned int> m_total_violations{0};
+  std::array<std::atomic<unsigned int>, kRealtimeViolationKinds> m_violations{};
+
+  // Stack trace of the first violation, written once by the offending thread
+  std::atomic<bool> m_first_captured{false};
+  eRealtimeViolation m_first_violation = eRealtimeViolation::Malloc;
+  std::array<void *, kMaxStackFrames> m_first_frames{};
+  int m_first_frame_count = 0;
+};
+
+/** @class RealtimeScope
+ *  @brief Marks the calling thread as real-time for the lifetime of the scope.
+ *         Scopes may be nested.
+ */
+class RealtimeScope
+{
+public:
+  RealtimeScope() noexcept;
+  ~RealtimeScope() noexcept;
+
+  RealtimeScope(const RealtimeScope &) = delete;
+  RealtimeScope &operator=(const RealtimeScope &) = delete;
+};
+
+#endif  // __REALTIME_CHECK_H__
@@ -0,0 +1,115 @@
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/** @class RingBuffer
+ *  @brief Lock-free single-producer, single-consumer ring of trivially copyable values.
+ *
+ *  One thread writes and one other thread reads. Neither side locks or
+ *  allocates, so either side may be the audio thread. The capacity is rounded
+ *  up to a power of two. A write that does not fit is truncated, never blocks.
+ */
+template <typename T>
+class RingBuffer
+{
+  static_assert(std::is_trivially_copyable_v<T>, "RingBuffer values must be trivially copyable");
+
+public:
+  explicit RingBuffer(const size_t capacity = 0): m_mask(0), m_write_index(0), m_read_index(0)
+  {
+    resize(capacity);
+  }
+
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  /** @brief Reallocate and empty the ring. Neither side may be active.
+   *  @param capacity Minimum number of values, rounded up to a power of two
+   */
+  void resize(const size_t capacity)
+  {
+    size_t size = capacity > 0 ? 1 : 0;
+    while (size < capacity)
+      size <<= 1;
+
+    m_buffer.assign(size, T{});
+    m_mask = size > 0 ? size - 1 : 0;
+    reset();
+  }
+
+  /** @brief Empty the ring. Neither side may be active.
+   */
+  void reset() noexcept
+  {
+    m_write_index.store(0, std::memory_order_relaxed);
+    m_read_index.store(0, std::memory_order_relaxed);
+  }
+
+  /** @brief Append values. Producer only.
+   *  @return The number of values written, less than count if the ring is full
+   */
+  size_t write(const T *data, const size_t count) noexcept
+  {
+    const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+    const size_t read_index = m_read_index.load(std::memory_order_acquire);
+    const size_t n = std::min(count, get_capacity() - (write_index - read_index));
+    if (n == 0)
+      return 0;
+
+    const size_t start = write_index & m_mask;
+    const size_t first = std::min(n, get_capacity() - start);
+    std::memcpy(m_buffer.data() + start, data, first * sizeof(T));
+    std::memcpy(m_buffer.data(), data + first, (n - first) * sizeof(T));
+
+    m_write_index.store(write_index + n, std::memory_order_release);
+    return n;
+  }
+
+  /** @brief Remove the oldest values. Consumer only.
+   *  @return The number of values read
+   */
+  size_t read(T *data, const size_t count) noexcept
+  {
+    const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+    const size_t write_index = m_write_index.load(std::memory_order_acquire);
+    const size_t n = std::min(count, write_index - read_index);
+    if (n == 0)
+      return 0;
+
+    const size_t start = read_index & m_mask;
+    const size_t first = std::min(n, get_capacity() - start);
+    std::memcpy(data, m_buffer.data() + start, first * sizeof(T));
+    std::memcpy(data + first, m_buffer.data(), (n - first) * sizeof(T));
+
+    m_read_index.store(read_index + n, std::memory_order_release);
+    return n;
+  }
+
+  size_t get_read_available() const noexcept
+  {
+    return m_write_index.load(std::memory_order_acquire) - m_read_index.load(std::memory_order_acquire);
+  }
+
+  size_t get_write_available() const noexcept
+  {
+    return get_capacity() - get_read_available();
+  }
+
+  size_t get_capacity() const noexcept { return m_buffer.size(); }
+
+private:
+  std::vector<T> m_buffer;
+  size_t m_mask;
+
+  // Separate cache lines so the producer and consumer do not false-share
+  alignas(64) std::atomic<size_t> m_write_index;
+  alignas(64) std::atomic<size_t> m_read_index;
+};
+
+#endif  // __RING_BUFFER_H__
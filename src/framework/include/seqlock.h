@@ -0,0 +1,95 @@
+#ifndef __SEQLOCK_H__
+#define __SEQLOCK_H__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+/** @class SeqLock
+ *  @brief Single-writer sequence lock for publishing small values to many readers.
+ *
+ *  The writer never waits. Readers copy the value and retry if a write
+ *  overlapped the copy, so a reader always sees one complete value. The value
+ *  is stored as atomic words, so a torn copy is discarded rather than being a
+ *  data race. Suited to meter and telemetry values that are written often and
+ *  read from UI threads.
+ */
+template <typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock values must be trivially copyable");
+
+public:
+  SeqLock(): m_sequence(0)
+  {
+    store(T{});
+    m_sequence.store(0, std::memory_order_relaxed);
+  }
+
+  SeqLock(const SeqLock &) = delete;
+  SeqLock &operator=(const SeqLock &) = delete;
+
+  /** @brief Publish a new value. One writer thread only.
+   */
+  void store(const T &value) noexcept
+  {
+    Words words{};
+    std::memcpy(words.data(), static_cast<const void *>(&value), sizeof(T));
+
+    const uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < kWords; ++i)
+      m_words[i].store(words[i], std::memory_order_relaxed);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  /** @brief Copy the latest complete value. Any thread.
+   */
+  T load() const noexcept
+  {
+    Words words;
+    while (true)
+    {
+      const uint64_t before = m_sequence.load(std::memory_order_acquire);
+      if (before & 1)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      for (size_t i = 0; i < kWords; ++i)
+        words[i] = m_words[i].load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (m_sequence.load(std::memory_order_relaxed) == before)
+        break;
+    }
+
+    // T may have default member initializers, it is still trivially copyable
+    T value;
+    std::memcpy(static_cast<void *>(&value), words.data(), sizeof(T));
+    return value;
+  }
+
+  /** @brief Number of values stored, so readers can skip unchanged values.
+   */
+  uint64_t get_version() const noexcept
+  {
+    return m_sequence.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  using Words = std::array<uint64_t, kWords>;
+
+  std::atomic<uint64_t> m_sequence;
+  std::array<std::atomic<uint64_t>, kWords> m_words;
+};
+
+#endif  // __SEQLOCK_H__
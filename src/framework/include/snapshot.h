@@ -0,0 +1,188 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/** @class SnapshotPublisher
+ *  @brief Publishes immutable snapshots from control threads to real-time readers.
+ *
+ *  Writers build a new snapshot off the audio thread and publish() it. Readers
+ *  take a ReadGuard, which pins the current snapshot with a hazard slot, and
+ *  never lock, allocate or free. Replaced snapshots are retired and deleted by
+ *  a later publish() or collect() on a control thread once no reader holds them.
+ *
+ *  At most kMaxReaders guards can be held at the same time. A read() that finds
+ *  every slot taken returns an empty guard.
+ */
+template <typename T>
+class SnapshotPublisher
+{
+public:
+  static constexpr size_t kMaxReaders = 8;
+
+  /** @class ReadGuard
+   *  @brief Keeps one snapshot alive while it is in scope.
+   */
+  class ReadGuard
+  {
+  public:
+    ReadGuard() noexcept: p_slot(nullptr), p_claimed(nullptr), p_snapshot(nullptr) {}
+
+    ReadGuard(std::atomic<const T *> *slot, std::atomic<bool> *claimed, const T *snapshot) noexcept:
+      p_slot(slot),
+      p_claimed(claimed),
+      p_snapshot(snapshot)
+    {
+    }
+
+    ~ReadGuard()
+    {
+      if (p_slot)
+      {
+        p_slot->store(nullptr, std::memory_order_release);
+        p_claimed->store(false, std::memory_order_release);
+      }
+    }
+
+    ReadGuard(ReadGuard &&other) noexcept:
+      p_slot(std::exchange(other.p_slot, nullptr)),
+      p_claimed(std::exchange(other.p_claimed, nullptr)),
+      p_snapshot(std::exchange(other.p_snapshot, nullptr))
+    {
+    }
+
+    ReadGuard(const ReadGuard &) = delete;
+    ReadGuard &operator=(const ReadGuard &) = delete;
+    ReadGuard &operator=(ReadGuard &&) = delete;
+
+    inline const T *get() const noexcept { return p_snapshot; }
+    inline const T *operator->() const noexcept { return p_snapshot; }
+    inline const T &operator*() const noexcept { return *p_snapshot; }
+    inline explicit operator bool() const noexcept { return p_snapshot != nullptr; }
+
+  private:
+    std::atomic<const T *> *p_slot;
+    std::atomic<bool> *p_claimed;
+    const T *p_snapshot;
+  };
+
+  SnapshotPublisher(): m_current(nullptr)
+  {
+    for (auto &slot : m_hazards)
+      slot.store(nullptr, std::memory_order_relaxed);
+    for (auto &claimed : m_claimed)
+      claimed.store(false, std::memory_order_relaxed);
+  }
+
+  ~SnapshotPublisher()
+  {
+    delete m_current.load(std::memory_order_acquire);
+    for (const T *snapshot : m_retired)
+      delete snapshot;
+  }
+
+  SnapshotPublisher(const SnapshotPublisher &) = delete;
+  SnapshotPublisher &operator=(const SnapshotPublisher &) = delete;
+
+  /** @brief Replace the current snapshot. Control threads only.
+   *  @param snapshot The new snapshot, may be null
+   */
+  void publish(std::unique_ptr<T> snapshot)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const T *previous = m_current.exchange(snapshot.release(), std::memory_order_seq_cst);
+    if (previous)
+      m_retired.push_back(previous);
+
+    collect_locked();
+  }
+
+  /** @brief Pin the current snapshot. Lock-free and allocation-free, safe on the audio thread.
+   */
+  ReadGuard read() noexcept
+  {
+    for (size_t i = 0; i < kMaxReaders; ++i)
+    {
+      if (m_claimed[i].load(std::memory_order_relaxed) || m_claimed[i].exchange(true, std::memory_order_acquire))
+        continue;
+
+      // Publish the hazard, then confirm it is still current, so a writer that
+      // retired it in between is guaranteed to see the hazard and keep it alive
+      const T *snapshot = m_current.load(std::memory_order_seq_cst);
+      while (true)
+      {
+        m_hazards[i].store(snapshot, std::memory_order_seq_cst);
+        const T *confirmed = m_current.load(std::memory_order_seq_cst);
+        if (confirmed == snapshot)
+          break;
+        snapshot = confirmed;
+      }
+
+      return ReadGuard(&m_hazards[i], &m_claimed[i], snapshot);
+    }
+
+    return ReadGuard();
+  }
+
+  /** @brief Current snapshot for writers, who never race with retirement. Control threads only.
+   */
+  const T *peek() const noexcept
+  {
+    return m_current.load(std::memory_order_acquire);
+  }
+
+  /** @brief Delete retired snapshots that no reader holds. Control threads only.
+   */
+  void collect()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    collect_locked();
+  }
+
+  /** @brief Number of retired snapshots waiting for readers to release them.
+   */
+  size_t get_retired_count()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_retired.size();
+  }
+
+private:
+  void collect_locked()
+  {
+    std::vector<const T *> still_held;
+    for (const T *snapshot : m_retired)
+    {
+      bool held = false;
+      for (const auto &slot : m_hazards)
+      {
+        if (slot.load(std::memory_order_seq_cst) == snapshot)
+        {
+          held = true;
+          break;
+        }
+      }
+
+      if (held)
+        still_held.push_back(snapshot);
+      else
+        delete snapshot;
+    }
+    m_retired.swap(still_held);
+  }
+
+  std::atomic<const T *> m_current;
+  std::array<std::atomic<const T *>, kMaxReaders> m_hazards;
+  std::array<std::atomic<bool>, kMaxReaders> m_claimed;
+
+  std::mutex m_mutex;
+  std::vector<const T *> m_retired;
+};
+
+#endif  // __SNAPSHOT_H__
@@ -0,0 +1,63 @@
+#ifndef __THREAD_CONFIG_H__
+#define __THREAD_CONFIG_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/** @enum eSchedulingPolicy
+ *  @brief Kernel scheduling policy of a thread
+ */
+enum class eSchedulingPolicy : uint8_t
+{
+  Normal,      // SCHED_OTHER
+  Fifo,        // SCHED_FIFO
+  RoundRobin,  // SCHED_RR
+};
+
+/** @struct ThreadConfig
+ *  @brief How a control or audio thread should be scheduled.
+ */
+struct ThreadConfig
+{
+  eSchedulingPolicy policy = eSchedulingPolicy::Normal;
+  int priority = 0;                  // Clamped to the policy's range, ignored for Normal
+  uint64_t cpu_mask = 0;             // Bit n allows CPU n, 0 leaves the affinity alone
+  size_t prefault_stack_bytes = 0;   // Stack touched up front so the first callbacks do not page fault
+};
+
+/** @struct ThreadReport
+ *  @brief What the kernel actually granted a thread, read back after applying a ThreadConfig.
+ *  Errors are errno values, 0 when the request was granted or not made.
+ */
+struct ThreadReport
+{
+  bool applied;
+  ThreadConfig requested;
+  eSchedulingPolicy policy;
+  int priority;
+  uint64_t cpu_mask;
+  size_t prefaulted_bytes;
+  int scheduling_error;
+  int affinity_error;
+
+  bool is_granted() const noexcept { return applied && scheduling_error == 0 && affinity_error == 0; }
+};
+
+/** @struct MemoryLockReport
+ *  @brief Result of locking the process memory
+ */
+struct MemoryLockReport
+{
+  bool locked;
+  int error;
+};
+
+ThreadReport apply_thread_config(const ThreadConfig &config) noexcept;
+MemoryLockReport lock_process_memory() noexcept;
+void unlock_process_memory() noexcept;
+
+std::string scheduling_policy_to_string(eSchedulingPolicy policy);
+std::string thread_report_to_string(const ThreadReport &report);
+
+#endif  // __THREAD_CONFIG_H__
@@ -0,0 +1,171 @@
+#include "allocators.h"
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr size_t kCacheLineSize = 64;
+
+/** @brief Round a size up to a multiple of an alignment (power of two).
+ */
+static constexpr size_t align_up(const size_t value, const size_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/** @brief Map and prefault an anonymous region.
+ *  @throws std::bad_alloc if the region cannot be mapped.
+ */
+static void *map_region(const size_t capacity)
+{
+  void *region = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED)
+  {
+    throw std::bad_alloc();
+  }
+
+  // Touch every page now so the audio thread never takes a page fault
+  std::memset(region, 0, capacity);
+  return region;
+}
+
+/** @brief LockedMemoryPool constructor
+ *  @param capacity Number of bytes to reserve and lock
+ */
+LockedMemoryPool::LockedMemoryPool(const size_t capacity):
+  p_region(map_region(capacity)),
+  m_capacity(capacity),
+  m_locked(mlock(p_region, capacity) == 0),
+  p_free_list(nullptr),
+  m_used(0)
+{
+  // The whole region starts as one free chunk, whole cache lines only
+  const size_t usable = capacity & ~(kCacheLineSize - 1);
+  if (usable > 0)
+    p_free_list = new (p_region) FreeChunk{usable, nullptr};
+}
+
+/** @brief LockedMemoryPool destructor
+ */
+LockedMemoryPool::~LockedMemoryPool()
+{
+  if (m_locked)
+    munlock(p_region, m_capacity);
+  munmap(p_region, m_capacity);
+}
+
+/** @brief Bytes handed out, including headers and padding.
+ */
+size_t LockedMemoryPool::get_used() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_used;
+}
+
+/** @brief Size of the largest free chunk, an upper bound on the next allocation.
+ */
+size_t LockedMemoryPool::get_largest_free() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  size_t largest = 0;
+  for (const FreeChunk *chunk = p_free_list; chunk; chunk = chunk->next)
+  {
+    largest = std::max(largest, chunk->size);
+  }
+  return largest;
+}
+
+/** @brief Take the first free chunk the buffer fits in, returning what is left of it to the free list.
+ *  Chunks start on a cache line and span whole cache lines.
+ *  @throws std::bad_alloc if no free chunk is large enough.
+ */
+void *LockedMemoryPool::do_allocate(size_t bytes, size_t alignment)
+{
+  const size_t payload_alignment = std::max(alignment, kCacheLineSize);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (FreeChunk **link = &p_free_list; *link; link = &(*link)->next)
+  {
+    FreeChunk *chunk = *link;
+    std::byte *start = reinterpret_cast<std::byte *>(chunk);
+    const size_t offset = align_up(reinterpret_cast<uintptr_t>(start) + sizeof(Allocation), payload_alignment) -
+                          reinterpret_cast<uintptr_t>(start);
+    const size_t needed = align_up(offset + bytes, kCacheLineSize);
+    if (needed > chunk->size)
+      continue;
+
+    size_t size = chunk->size;
+    if (size - needed >= kCacheLineSize)
+    {
+      *link = new (start + needed) FreeChunk{size - needed, chunk->next};
+      size = needed;
+    }
+    else
+    {
+      *link = chunk->next;
+    }
+
+    std::byte *payload = start + offset;
+    new (payload - sizeof(Allocation)) Allocation{start, size};
+    m_used += size;
+    return payload;
+  }
+
+  throw std::bad_alloc();
+}
+
+/** @brief Return a buffer's chunk to the free list, merged with any free neighbour.
+ */
+void LockedMemoryPool::do_deallocate(void *ptr, size_t bytes, size_t alignment)
+{
+  (void)bytes;
+  (void)alignment;
+
+  if (!ptr)
+    return;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const Allocation allocation = *reinterpret_cast<const Allocation *>(static_cast<std::byte *>(ptr) -
+                                                                     sizeof(Allocation));
+  m_used -= allocation.size;
+
+  std::byte *start = allocation.chunk;
+  size_t size = allocation.size;
+
+  // The free list is sorted by address
+  FreeChunk *previous = nullptr;
+  FreeChunk *next = p_free_list;
+  while (next && reinterpret_cast<std::byte *>(next) < start)
+  {
+    previous = next;
+    next = next->next;
+  }
+
+  if (next && start + size == reinterpret_cast<std::byte *>(next))
+  {
+    size += next->size;
+    next = next->next;
+  }
+
+  if (previous && reinterpret_cast<std::byte *>(previous) + previous->size == start)
+  {
+    previous->size += size;
+    previous->next = next;
+    return;
+  }
+
+  FreeChunk *chunk = new (start) FreeChunk{size, next};
+  if (previous)
+    previous->next = chunk;
+  else
+    p_free_list = chunk;
+}
+
+bool LockedMemoryPool::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+  return this == &other;
+}
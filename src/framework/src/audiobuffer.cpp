@@ -0,0 +1,134 @@
+#include "audiobuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+static constexpr size_t kFloatsPerLine = AudioBuffer::kAlignment / sizeof(float);
+
+/** @brief AudioBuffer constructor - empty buffer
+ *  @param resource Memory resource used for sample storage
+ */
+AudioBuffer::AudioBuffer(std::pmr::memory_resource *resource):
+  p_resource(resource),
+  p_data(nullptr),
+  m_stride(0),
+  m_bytes(0),
+  m_channels(0),
+  m_frames(0),
+  m_channel_pointers(resource)
+{
+}
+
+/** @brief AudioBuffer constructor
+ *  @param channels Number of channels
+ *  @param frames Number of frames per channel
+ *  @param resource Memory resource used for sample storage
+ */
+AudioBuffer::AudioBuffer(const unsigned int channels, const unsigned int frames, std::pmr::memory_resource *resource):
+  AudioBuffer(resource)
+{
+  resize(channels, frames);
+}
+
+/** @brief AudioBuffer destructor
+ */
+AudioBuffer::~AudioBuffer()
+{
+  release();
+}
+
+AudioBuffer::AudioBuffer(AudioBuffer &&other) noexcept:
+  p_resource(other.p_resource),
+  p_data(std::exchange(other.p_data, nullptr)),
+  m_stride(std::exchange(other.m_stride, 0)),
+  m_bytes(std::exchange(other.m_bytes, 0)),
+  m_channels(std::exchange(other.m_channels, 0)),
+  m_frames(std::exchange(other.m_frames, 0)),
+  m_channel_pointers(std::move(other.m_channel_pointers))
+{
+}
+
+AudioBuffer &AudioBuffer::operator=(AudioBuffer &&other) noexcept
+{
+  if (this != &other)
+  {
+    release();
+    p_resource = other.p_resource;
+    p_data = std::exchange(other.p_data, nullptr);
+    m_stride = std::exchange(other.m_stride, 0);
+    m_bytes = std::exchange(other.m_bytes, 0);
+    m_channels = std::exchange(other.m_channels, 0);
+    m_frames = std::exchange(other.m_frames, 0);
+    m_channel_pointers = std::move(other.m_channel_pointers);
+  }
+  return *this;
+}
+
+/** @brief Reallocate the buffer. Contents are cleared.
+ *  @param channels Number of channels
+ *  @param frames Number of frames per channel
+ */
+void AudioBuffer::resize(const unsigned int channels, const unsigned int frames)
+{
+  release();
+
+  m_channels = channels;
+  m_frames = frames;
+  m_stride = (static_cast<size_t>(frames) + kFloatsPerLine - 1) / kFloatsPerLine * kFloatsPerLine;
+  m_bytes = m_stride * channels * sizeof(float);
+
+  if (m_bytes > 0)
+  {
+    p_data = static_cast<float *>(p_resource->allocate(m_bytes, kAlignment));
+  }
+
+  m_channel_pointers.assign(channels, nullptr);
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    m_channel_pointers[ch] = p_data + ch * m_stride;
+  }
+
+  clear();
+}
+
+/** @brief Zero every sample in the buffer.
+ */
+void AudioBuffer::clear() noexcept
+{
+  if (p_data)
+    std::memset(p_data, 0, m_bytes);
+}
+
+/** @brief Zero the first n_frames of every channel.
+ */
+void AudioBuffer::clear(const unsigned int n_frames) noexcept
+{
+  const size_t count = std::min(n_frames, m_frames);
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+  {
+    std::memset(m_channel_pointers[ch], 0, count * sizeof(float));
+  }
+}
+
+/** @brief Copy the first n_frames of every channel from another buffer.
+ *  Only the channels present in both buffers are copied.
+ */
+void AudioBuffer::copy_from(const AudioBuffer &other, const unsigned int n_frames) noexcept
+{
+  const unsigned int channels = std::min(m_channels, other.m_channels);
+  const size_t count = std::min({n_frames, m_frames, other.m_frames});
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    std::memcpy(m_channel_pointers[ch], other.m_channel_pointers[ch], count * sizeof(float));
+  }
+}
+
+void AudioBuffer::release() noexcept
+{
+  if (p_data)
+  {
+    p_resource->deallocate(p_data, m_bytes, kAlignment);
+    p_data = nullptr;
+  }
+}
@@ -0,0 +1,291 @@
+#include "audiokernels.h"
+
+#if defined(__SSE2__)
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace Kernels
+{
+
+/** @brief Stereo interleave, four frames per iteration.
+ */
+void interleave_stereo(const float *left, const float *right, float *out, const unsigned int n_frames) noexcept
+{
+  unsigned int frame = 0;
+
+#if defined(__SSE2__)
+  for (; frame + 4 <= n_frames; frame += 4)
+  {
+    const __m128 l = _mm_loadu_ps(left + frame);
+    const __m128 r = _mm_loadu_ps(right + frame);
+    _mm_storeu_ps(out + 2 * frame, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(out + 2 * frame + 4, _mm_unpackhi_ps(l, r));
+  }
+#elif defined(__ARM_NEON)
+  for (; frame + 4 <= n_frames; frame += 4)
+  {
+    float32x4x2_t lr;
+    lr.val[0] = vld1q_f32(left + frame);
+    lr.val[1] = vld1q_f32(right + frame);
+    vst2q_f32(out + 2 * frame, lr);
+  }
+#endif
+
+  for (; frame < n_frames; ++frame)
+  {
+    out[2 * frame] = left[frame];
+    out[2 * frame + 1] = right[frame];
+  }
+}
+
+/** @brief Stereo deinterleave, four frames per iteration.
+ */
+void deinterleave_stereo(const float *in, float *left, float *right, const unsigned int n_frames) noexcept
+{
+  unsigned int frame = 0;
+
+#if defined(__SSE2__)
+  for (; frame + 4 <= n_frames; frame += 4)
+  {
+    const __m128 a = _mm_loadu_ps(in + 2 * frame);
+    const __m128 b = _mm_loadu_ps(in + 2 * frame + 4);
+    _mm_storeu_ps(left + frame, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right + frame, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+#elif defined(__ARM_NEON)
+  for (; frame + 4 <= n_frames; frame += 4)
+  {
+    const float32x4x2_t lr = vld2q_f32(in + 2 * frame);
+    vst1q_f32(left + frame, lr.val[0]);
+    vst1q_f32(right + frame, lr.val[1]);
+  }
+#endif
+
+  for (; frame < n_frames; ++frame)
+  {
+    left[frame] = in[2 * frame];
+    right[frame] = in[2 * frame + 1];
+  }
+}
+
+#if defined(__SSE2__)
+using Vec4 = __m128;
+static inline Vec4 load4(const float *p) { return _mm_loadu_ps(p); }
+static inline void store4(float *p, const Vec4 v) { _mm_storeu_ps(p, v); }
+static inline void transpose4(Vec4 &a, Vec4 &b, Vec4 &c, Vec4 &d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+#elif defined(__ARM_NEON)
+using Vec4 = float32x4_t;
+static inline Vec4 load4(const float *p) { return vld1q_f32(p); }
+static inline void store4(float *p, const Vec4 v) { vst1q_f32(p, v); }
+static inline void transpose4(Vec4 &a, Vec4 &b, Vec4 &c, Vec4 &d)
+{
+  const float32x4x2_t ab = vtrnq_f32(a, b);
+  const float32x4x2_t cd = vtrnq_f32(c, d);
+  a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+  b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+  c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+  d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+#endif
+
+/** @brief Interleave four channels into frames of `stride` samples, as a
+ *         4x4 transpose per four frames. Used for 4 and 8 channel streams.
+ */
+void interleave_quad(const float *const *planar, float *out, const unsigned int stride, const unsigned int n_frames) noexcept
+{
+  unsigned int frame = 0;
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+  for (; frame + 4 <= n_frames; frame += 4)
+  {
+    Vec4 c0 = load4(planar[0] + frame);
+    Vec4 c1 = load4(planar[1] + frame);
+    Vec4 c2 = load4(planar[2] + frame);
+    Vec4 c3 = load4(planar[3] + frame);
+    transpose4(c0, c1, c2, c3);
+    store4(out + stride * frame, c0);
+    store4(out + stride * (frame + 1), c1);
+    store4(out + stride * (frame + 2), c2);
+    store4(out + stride * (frame + 3), c3);
+  }
+#endif
+
+  for (; frame < n_frames; ++frame)
+  {
+    for (unsigned int ch = 0; ch < 4; ++ch)
+      out[stride * frame + ch] = planar[ch][frame];
+  }
+}
+
+/** @brief Split four channels out of frames of `stride` samples, as a
+ *         4x4 transpose per four frames. Used for 4 and 8 channel streams.
+ */
+void deinterleave_quad(const float *in, float *const *planar, const unsigned int stride, const unsigned int n_frames) noexcept
+{
+  unsigned int frame = 0;
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+  for (; frame + 4 <= n_frames; frame += 4)
+  {
+    Vec4 f0 = load4(in + stride * frame);
+    Vec4 f1 = load4(in + stride * (frame + 1));
+    Vec4 f2 = load4(in + stride * (frame + 2));
+    Vec4 f3 = load4(in + stride * (frame + 3));
+    transpose4(f0, f1, f2, f3);
+    store4(planar[0] + frame, f0);
+    store4(planar[1] + frame, f1);
+    store4(planar[2] + frame, f2);
+    store4(planar[3] + frame, f3);
+  }
+#endif
+
+  for (; frame < n_frames; ++frame)
+  {
+    for (unsigned int ch = 0; ch < 4; ++ch)
+      planar[ch][frame] = in[stride * frame + ch];
+  }
+}
+
+/** @brief Peak magnitude and sum of squares of one channel, eight frames per iteration.
+ */
+void peak_and_energy(const float *in, const unsigned int n_frames, float &peak, float &sum_squares) noexcept
+{
+  unsigned int frame = 0;
+  float block_peak = 0.0f;
+  float block_sum = 0.0f;
+
+#if defined(__SSE2__)
+  const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 peak_a = _mm_setzero_ps();
+  __m128 peak_b = _mm_setzero_ps();
+  __m128 sum_a = _mm_setzero_ps();
+  __m128 sum_b = _mm_setzero_ps();
+  for (; frame + 8 <= n_frames; frame += 8)
+  {
+    const __m128 a = _mm_loadu_ps(in + frame);
+    const __m128 b = _mm_loadu_ps(in + frame + 4);
+    peak_a = _mm_max_ps(peak_a, _mm_and_ps(a, sign_mask));
+    peak_b = _mm_max_ps(peak_b, _mm_and_ps(b, sign_mask));
+    sum_a = _mm_add_ps(sum_a, _mm_mul_ps(a, a));
+    sum_b = _mm_add_ps(sum_b, _mm_mul_ps(b, b));
+  }
+
+  alignas(16) float lanes[4];
+  _mm_store_ps(lanes, _mm_max_ps(peak_a, peak_b));
+  block_peak = std::fmax(std::fmax(lanes[0], lanes[1]), std::fmax(lanes[2], lanes[3]));
+  _mm_store_ps(lanes, _mm_add_ps(sum_a, sum_b));
+  block_sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__ARM_NEON)
+  float32x4_t peak_a = vdupq_n_f32(0.0f);
+  float32x4_t peak_b = vdupq_n_f32(0.0f);
+  float32x4_t sum_a = vdupq_n_f32(0.0f);
+  float32x4_t sum_b = vdupq_n_f32(0.0f);
+  for (; frame + 8 <= n_frames; frame += 8)
+  {
+    const float32x4_t a = vld1q_f32(in + frame);
+    const float32x4_t b = vld1q_f32(in + frame + 4);
+    peak_a = vmaxq_f32(peak_a, vabsq_f32(a));
+    peak_b = vmaxq_f32(peak_b, vabsq_f32(b));
+    sum_a = vmlaq_f32(sum_a, a, a);
+    sum_b = vmlaq_f32(sum_b, b, b);
+  }
+
+  float lanes[4];
+  vst1q_f32(lanes, vmaxq_f32(peak_a, peak_b));
+  block_peak = std::fmax(std::fmax(lanes[0], lanes[1]), std::fmax(lanes[2], lanes[3]));
+  vst1q_f32(lanes, vaddq_f32(sum_a, sum_b));
+  block_sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+  for (; frame < n_frames; ++frame)
+  {
+    block_peak = std::fmax(block_peak, std::fabs(in[frame]));
+    block_sum += in[frame] * in[frame];
+  }
+
+  peak = block_peak;
+  sum_squares = block_sum;
+}
+
+/** @brief Whether every sample of one channel is within the threshold of zero, sixteen frames per iteration.
+ *  Stops at the first block over the threshold. NaN counts as signal.
+ */
+bool is_silent(const float *in, const unsigned int n_frames, const float threshold) noexcept
+{
+  unsigned int frame = 0;
+
+#if defined(__SSE2__)
+  const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 limit = _mm_set1_ps(threshold);
+  for (; frame + 16 <= n_frames; frame += 16)
+  {
+    const __m128 a = _mm_cmpnle_ps(_mm_and_ps(_mm_loadu_ps(in + frame), sign_mask), limit);
+    const __m128 b = _mm_cmpnle_ps(_mm_and_ps(_mm_loadu_ps(in + frame + 4), sign_mask), limit);
+    const __m128 c = _mm_cmpnle_ps(_mm_and_ps(_mm_loadu_ps(in + frame + 8), sign_mask), limit);
+    const __m128 d = _mm_cmpnle_ps(_mm_and_ps(_mm_loadu_ps(in + frame + 12), sign_mask), limit);
+    if (_mm_movemask_ps(_mm_or_ps(_mm_or_ps(a, b), _mm_or_ps(c, d))) != 0)
+      return false;
+  }
+#elif defined(__ARM_NEON)
+  const float32x4_t limit = vdupq_n_f32(threshold);
+  for (; frame + 16 <= n_frames; frame += 16)
+  {
+    // Lanes within the threshold are all ones, NaN lanes are zero
+    const uint32x4_t a = vcleq_f32(vabsq_f32(vld1q_f32(in + frame)), limit);
+    const uint32x4_t b = vcleq_f32(vabsq_f32(vld1q_f32(in + frame + 4)), limit);
+    const uint32x4_t c = vcleq_f32(vabsq_f32(vld1q_f32(in + frame + 8)), limit);
+    const uint32x4_t d = vcleq_f32(vabsq_f32(vld1q_f32(in + frame + 12)), limit);
+    const uint32x4_t all = vandq_u32(vandq_u32(a, b), vandq_u32(c, d));
+    const uint32x2_t half = vand_u32(vget_low_u32(all), vget_high_u32(all));
+    if ((vget_lane_u32(half, 0) & vget_lane_u32(half, 1)) != 0xffffffffu)
+      return false;
+  }
+#endif
+
+  for (; frame < n_frames; ++frame)
+  {
+    if (!(std::fabs(in[frame]) <= threshold))
+      return false;
+  }
+
+  return true;
+}
+
+static constexpr KernelTable kMonoKernels = make_kernel_table<1>();
+static constexpr KernelTable kStereoKernels = make_kernel_table<2>();
+static constexpr KernelTable kQuadKernels = make_kernel_table<4>();
+static constexpr KernelTable kOctoKernels = make_kernel_table<8>();
+static constexpr KernelTable kGenericKernels = make_kernel_table<0>();
+
+/** @brief Select the kernels for a channel count.
+ *  @param channels Number of channels in the stream
+ *  @return A specialization for 1, 2, 4 or 8 channels, otherwise the generic kernels
+ */
+const KernelTable &select_kernels(const unsigned int channels) noexcept
+{
+  switch (channels)
+  {
+    case 1:
+      return kMonoKernels;
+    case 2:
+      return kStereoKernels;
+    case 4:
+      return kQuadKernels;
+    case 8:
+      return kOctoKernels;
+    default:
+      return kGenericKernels;
+  }
+}
+
+/** @brief Generic kernels that take the channel count at runtime.
+ */
+const KernelTable &generic_kernels() noexcept
+{
+  return kGenericKernels;
+}
+
+}  // namespace Kernels
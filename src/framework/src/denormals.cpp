@@ -0,0 +1,102 @@
+#include "denormals.h"
+
+#include <cstring>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define DENORMALS_X86 1
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+#define DENORMALS_ARM 1
+#endif
+
+namespace
+{
+
+#if defined(DENORMALS_X86)
+static constexpr uintptr_t kFlushBits = 0x8040;  // FTZ | DAZ
+#elif defined(DENORMALS_ARM)
+static constexpr uintptr_t kFlushBits = uintptr_t{1} << 24;  // FZ
+#else
+static constexpr uintptr_t kFlushBits = 0;
+#endif
+
+uintptr_t read_mode() noexcept
+{
+#if defined(DENORMALS_X86)
+  return _mm_getcsr();
+#elif defined(__aarch64__)
+  uint64_t fpcr;
+  asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+  return static_cast<uintptr_t>(fpcr);
+#elif defined(DENORMALS_ARM)
+  uint32_t fpscr;
+  asm volatile("vmrs %0, fpscr" : "=r"(fpscr));
+  return fpscr;
+#else
+  return 0;
+#endif
+}
+
+void write_mode(const uintptr_t mode) noexcept
+{
+#if defined(DENORMALS_X86)
+  _mm_setcsr(static_cast<unsigned int>(mode));
+#elif defined(__aarch64__)
+  asm volatile("msr fpcr, %0" : : "r"(static_cast<uint64_t>(mode)));
+#elif defined(DENORMALS_ARM)
+  asm volatile("vmsr fpscr, %0" : : "r"(static_cast<uint32_t>(mode)));
+#else
+  (void)mode;
+#endif
+}
+
+}  // namespace
+
+/** @brief DenormalScope constructor - enable flush to zero, remembering the previous mode
+ */
+DenormalScope::DenormalScope() noexcept:
+  m_saved(read_mode())
+{
+  if (kFlushBits != 0 && (m_saved & kFlushBits) != kFlushBits)
+    write_mode(m_saved | kFlushBits);
+}
+
+/** @brief DenormalScope destructor - restore the previous mode
+ */
+DenormalScope::~DenormalScope() noexcept
+{
+  if (kFlushBits != 0 && (m_saved & kFlushBits) != kFlushBits)
+    write_mode(m_saved);
+}
+
+/** @brief Whether this target can flush denormals
+ */
+bool DenormalScope::is_supported() noexcept
+{
+  return kFlushBits != 0;
+}
+
+/** @brief Whether the calling thread currently flushes denormals
+ */
+bool DenormalScope::is_active() noexcept
+{
+  return kFlushBits != 0 && (read_mode() & kFlushBits) == kFlushBits;
+}
+
+/** @brief Count the denormal samples in a buffer. For debug checks on rendered output.
+ *  Looks at the bit pattern, so it finds them whether or not denormals are flushed.
+ *  @param samples The samples
+ *  @param n_samples Number of samples
+ *  @return How many are denormal
+ */
+size_t count_denormals(const float *samples, const size_t n_samples) noexcept
+{
+  size_t count = 0;
+  for (size_t i = 0; i < n_samples; ++i)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &samples[i], sizeof(bits));
+    count += ((bits & 0x7f800000u) == 0 && (bits & 0x007fffffu) != 0) ? 1 : 0;
+  }
+  return count;
+}
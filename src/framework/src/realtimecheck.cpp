@@ -0,0 +1,162 @@
+#include "realtimecheck.h"
+
+#include <execinfo.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+// Set by the realtimecheck_hooks object library when it is linked in
+std::atomic<bool> g_realtime_hooks_installed{false};
+
+// Nesting depth of RealtimeScope on the current thread
+static thread_local unsigned int t_realtime_depth = 0;
+
+// Guards against recursion while a violation is being reported
+static thread_local bool t_reporting = false;
+
+static constexpr const char *kViolationNames[] = {
+  "malloc",
+  "free",
+  "operator new",
+  "operator delete",
+  "pthread_mutex_lock",
+  "blocking call",
+  "file or device I/O",
+};
+static_assert(std::size(kViolationNames) == kRealtimeViolationKinds, "Name every eRealtimeViolation");
+
+/** @brief Convert a violation kind to a human-readable string.
+ *  Returns a static string, so it is safe to call while reporting a violation.
+ *  @param violation The violation kind.
+ */
+const char *realtime_violation_to_string(eRealtimeViolation violation) noexcept
+{
+  const size_t index = static_cast<size_t>(violation);
+  return index < kRealtimeViolationKinds ? kViolationNames[index] : "unknown";
+}
+
+/** @brief RealtimeChecker constructor
+ *  backtrace() loads its unwinder lazily on first use, which allocates.
+ *  Call it once here so reporting from the audio thread does not.
+ */
+RealtimeChecker::RealtimeChecker()
+{
+  void *frame = nullptr;
+  backtrace(&frame, 1);
+}
+
+/** @brief Check whether the interposition hooks are linked into this binary.
+ */
+bool RealtimeChecker::hooks_installed() noexcept
+{
+  return g_realtime_hooks_installed.load(std::memory_order_relaxed);
+}
+
+/** @brief Check whether the calling thread is inside a RealtimeScope.
+ */
+bool RealtimeChecker::in_realtime_section() noexcept
+{
+  return t_realtime_depth > 0 && !t_reporting;
+}
+
+/** @brief Clear all recorded violations.
+ */
+void RealtimeChecker::reset() noexcept
+{
+  for (auto &count : m_violations)
+  {
+    count.store(0, std::memory_order_relaxed);
+  }
+
+  m_first_frame_count = 0;
+  m_first_captured.store(false, std::memory_order_relaxed);
+  m_total_violations.store(0, std::memory_order_release);
+}
+
+/** @brief Return a copy of the recorded violations.
+ *  The stack trace of the first violation is symbolized here, off the audio thread.
+ */
+RealtimeViolationReport RealtimeChecker::get_report() const
+{
+  RealtimeViolationReport report;
+
+  report.total_violations = m_total_violations.load(std::memory_order_acquire);
+  for (size_t i = 0; i < kRealtimeViolationKinds; ++i)
+  {
+    report.violations[i] = m_violations[i].load(std::memory_order_relaxed);
+  }
+
+  report.first_violation = eRealtimeViolation::Malloc;
+  if (m_first_captured.load(std::memory_order_acquire))
+  {
+    report.first_violation = m_first_violation;
+
+    char **symbols = backtrace_symbols(m_first_frames.data(), m_first_frame_count);
+    if (symbols)
+    {
+      for (int i = 0; i < m_first_frame_count; ++i)
+      {
+        report.first_stack_trace.emplace_back(symbols[i]);
+      }
+      std::free(symbols);
+    }
+  }
+
+  return report;
+}
+
+/** @brief Record a violation from the calling thread.
+ *  Called by the interposition hooks. Must not allocate or lock.
+ *  @param violation The kind of call that was intercepted.
+ */
+void RealtimeChecker::report_violation(const eRealtimeViolation violation) noexcept
+{
+  if (t_reporting)
+    return;
+  t_reporting = true;
+
+  m_violations[static_cast<size_t>(violation)].fetch_add(1, std::memory_order_relaxed);
+
+  if (m_total_violations.fetch_add(1, std::memory_order_acq_rel) == 0)
+  {
+    m_first_violation = violation;
+    m_first_frame_count = backtrace(m_first_frames.data(), kMaxStackFrames);
+    m_first_captured.store(true, std::memory_order_release);
+  }
+
+  if (m_policy.load(std::memory_order_relaxed) == eRealtimeViolationPolicy::Abort)
+  {
+    static constexpr char header[] = "RealtimeChecker: non real-time safe call on the audio thread: ";
+    const char *name = realtime_violation_to_string(violation);
+
+    ssize_t result = ::write(STDERR_FILENO, header, sizeof(header) - 1);
+    result = ::write(STDERR_FILENO, name, std::strlen(name));
+    result = ::write(STDERR_FILENO, "\n", 1);
+    (void)result;
+
+    void *frames[kMaxStackFrames];
+    int frame_count = backtrace(frames, kMaxStackFrames);
+    backtrace_symbols_fd(frames, frame_count, STDERR_FILENO);
+    std::abort();
+  }
+
+  t_reporting = false;
+}
+
+/** @brief RealtimeScope constructor - enter a real-time section
+ *  The checker is constructed before entering, so it never initializes
+ *  from inside a hook.
+ */
+RealtimeScope::RealtimeScope() noexcept
+{
+  RealtimeChecker::instance();
+  ++t_realtime_depth;
+}
+
+/** @brief RealtimeScope destructor - leave a real-time section
+ */
+RealtimeScope::~RealtimeScope() noexcept
+{
+  --t_realtime_depth;
+}
@@ -0,0 +1,343 @@
+/** Interposition hooks for the RealtimeChecker.
+ *
+ *  This file is built as an object library so that every definition is linked
+ *  into the final executable and takes precedence over the C library. Each hook
+ *  reports a violation when the calling thread is inside a RealtimeScope and then
+ *  forwards to the real implementation.
+ */
+// The fortified headers define some of the hooked functions inline
+#undef _FORTIFY_SOURCE
+
+#include "realtimecheck.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/select.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <new>
+
+#if !defined(__GLIBC__)
+#error "realtimecheck_hooks requires glibc"
+#endif
+
+extern std::atomic<bool> g_realtime_hooks_installed;
+
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+namespace
+{
+
+inline void check(const eRealtimeViolation violation) noexcept
+{
+  if (RealtimeChecker::in_realtime_section())
+  {
+    RealtimeChecker::instance().report_violation(violation);
+  }
+}
+
+/** @brief Resolve the next definition of a symbol (i.e. the C library one).
+ *  Resolved lazily without a function-local static, since the static guard
+ *  itself may lock.
+ */
+template <typename Fn>
+Fn next_symbol(std::atomic<Fn> &cache, const char *name) noexcept
+{
+  Fn fn = cache.load(std::memory_order_acquire);
+  if (!fn)
+  {
+    fn = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+    cache.store(fn, std::memory_order_release);
+  }
+  return fn;
+}
+
+using MutexLockFn = int (*)(pthread_mutex_t *);
+using CondWaitFn = int (*)(pthread_cond_t *, pthread_mutex_t *);
+using CondTimedwaitFn = int (*)(pthread_cond_t *, pthread_mutex_t *, const struct timespec *);
+using CondClockwaitFn = int (*)(pthread_cond_t *, pthread_mutex_t *, clockid_t, const struct timespec *);
+using SemWaitFn = int (*)(sem_t *);
+using SemTimedwaitFn = int (*)(sem_t *, const struct timespec *);
+using NanosleepFn = int (*)(const struct timespec *, struct timespec *);
+using ClockNanosleepFn = int (*)(clockid_t, int, const struct timespec *, struct timespec *);
+using UsleepFn = int (*)(useconds_t);
+using SleepFn = unsigned int (*)(unsigned int);
+using PollFn = int (*)(struct pollfd *, nfds_t, int);
+using SelectFn = int (*)(int, fd_set *, fd_set *, fd_set *, struct timeval *);
+using OpenFn = int (*)(const char *, int, ...);
+using FopenFn = FILE *(*)(const char *, const char *);
+using ReadFn = ssize_t (*)(int, void *, size_t);
+using WriteFn = ssize_t (*)(int, const void *, size_t);
+
+std::atomic<MutexLockFn> s_pthread_mutex_lock{nullptr};
+std::atomic<CondWaitFn> s_pthread_cond_wait{nullptr};
+std::atomic<CondTimedwaitFn> s_pthread_cond_timedwait{nullptr};
+std::atomic<CondClockwaitFn> s_pthread_cond_clockwait{nullptr};
+std::atomic<SemWaitFn> s_sem_wait{nullptr};
+std::atomic<SemTimedwaitFn> s_sem_timedwait{nullptr};
+std::atomic<NanosleepFn> s_nanosleep{nullptr};
+std::atomic<ClockNanosleepFn> s_clock_nanosleep{nullptr};
+std::atomic<UsleepFn> s_usleep{nullptr};
+std::atomic<SleepFn> s_sleep{nullptr};
+std::atomic<PollFn> s_poll{nullptr};
+std::atomic<SelectFn> s_select{nullptr};
+std::atomic<OpenFn> s_open{nullptr};
+std::atomic<OpenFn> s_open64{nullptr};
+std::atomic<FopenFn> s_fopen{nullptr};
+std::atomic<FopenFn> s_fopen64{nullptr};
+std::atomic<ReadFn> s_read{nullptr};
+std::atomic<WriteFn> s_write{nullptr};
+
+/** @brief The mode argument of open(), present only when the flags create a file.
+ */
+mode_t open_mode(const int flags, va_list args) noexcept
+{
+  return (flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE ? static_cast<mode_t>(va_arg(args, int)) : 0;
+}
+
+[[maybe_unused]] const bool s_installed = []
+{
+  g_realtime_hooks_installed.store(true, std::memory_order_relaxed);
+  return true;
+}();
+
+}  // namespace
+
+extern "C"
+{
+
+void *malloc(size_t size)
+{
+  check(eRealtimeViolation::Malloc);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+  check(eRealtimeViolation::Malloc);
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  check(eRealtimeViolation::Malloc);
+  return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+  check(eRealtimeViolation::Malloc);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+  check(eRealtimeViolation::Malloc);
+  if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+    return EINVAL;
+
+  void *ptr = __libc_memalign(alignment, size);
+  if (!ptr)
+    return ENOMEM;
+
+  *memptr = ptr;
+  return 0;
+}
+
+void free(void *ptr)
+{
+  if (ptr)
+    check(eRealtimeViolation::Free);
+  __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+  check(eRealtimeViolation::MutexLock);
+  return next_symbol(s_pthread_mutex_lock, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_pthread_cond_wait, "pthread_cond_wait")(cond, mutex);
+}
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_pthread_cond_timedwait, "pthread_cond_timedwait")(cond, mutex, abstime);
+}
+
+int pthread_cond_clockwait(pthread_cond_t *cond, pthread_mutex_t *mutex, clockid_t clock_id,
+                           const struct timespec *abstime)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_pthread_cond_clockwait, "pthread_cond_clockwait")(cond, mutex, clock_id, abstime);
+}
+
+int sem_wait(sem_t *sem)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_sem_wait, "sem_wait")(sem);
+}
+
+int sem_timedwait(sem_t *sem, const struct timespec *abstime)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_sem_timedwait, "sem_timedwait")(sem, abstime);
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_poll, "poll")(fds, nfds, timeout);
+}
+
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_select, "select")(nfds, readfds, writefds, exceptfds, timeout);
+}
+
+int open(const char *path, int flags, ...)
+{
+  check(eRealtimeViolation::FileIo);
+  va_list args;
+  va_start(args, flags);
+  const mode_t mode = open_mode(flags, args);
+  va_end(args);
+  return next_symbol(s_open, "open")(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...)
+{
+  check(eRealtimeViolation::FileIo);
+  va_list args;
+  va_start(args, flags);
+  const mode_t mode = open_mode(flags, args);
+  va_end(args);
+  return next_symbol(s_open64, "open64")(path, flags, mode);
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+  check(eRealtimeViolation::FileIo);
+  return next_symbol(s_fopen, "fopen")(path, mode);
+}
+
+FILE *fopen64(const char *path, const char *mode)
+{
+  check(eRealtimeViolation::FileIo);
+  return next_symbol(s_fopen64, "fopen64")(path, mode);
+}
+
+ssize_t read(int fd, void *buffer, size_t count)
+{
+  check(eRealtimeViolation::FileIo);
+  return next_symbol(s_read, "read")(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void *buffer, size_t count)
+{
+  check(eRealtimeViolation::FileIo);
+  return next_symbol(s_write, "write")(fd, buffer, count);
+}
+
+int nanosleep(const struct timespec *request, struct timespec *remaining)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_nanosleep, "nanosleep")(request, remaining);
+}
+
+int clock_nanosleep(clockid_t clock_id, int flags, const struct timespec *request, struct timespec *remaining)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_clock_nanosleep, "clock_nanosleep")(clock_id, flags, request, remaining);
+}
+
+int usleep(useconds_t usec)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_usleep, "usleep")(usec);
+}
+
+unsigned int sleep(unsigned int seconds)
+{
+  check(eRealtimeViolation::BlockingCall);
+  return next_symbol(s_sleep, "sleep")(seconds);
+}
+
+}  // extern "C"
+
+void *operator new(std::size_t size)
+{
+  check(eRealtimeViolation::OperatorNew);
+  void *ptr = __libc_malloc(size ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+  check(eRealtimeViolation::OperatorNew);
+  void *ptr = __libc_malloc(size ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+  check(eRealtimeViolation::OperatorNew);
+  return __libc_malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+  check(eRealtimeViolation::OperatorNew);
+  return __libc_malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  if (ptr)
+    check(eRealtimeViolation::OperatorDelete);
+  __libc_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  if (ptr)
+    check(eRealtimeViolation::OperatorDelete);
+  __libc_free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+  if (ptr)
+    check(eRealtimeViolation::OperatorDelete);
+  __libc_free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+  if (ptr)
+    check(eRealtimeViolation::OperatorDelete);
+  __libc_free(ptr);
+}
@@ -0,0 +1,189 @@
+#include "threadconfig.h"
+
+#include <alloca.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace
+{
+
+// Larger requests are clamped, so a bad config cannot overflow the stack
+static constexpr size_t kMaxPrefaultStackBytes = 1024 * 1024;
+static constexpr unsigned int kMaxMaskCpus = 64;
+
+int to_native_policy(eSchedulingPolicy policy)
+{
+  switch (policy)
+  {
+    case eSchedulingPolicy::Fifo:
+      return SCHED_FIFO;
+    case eSchedulingPolicy::RoundRobin:
+      return SCHED_RR;
+    default:
+      return SCHED_OTHER;
+  }
+}
+
+eSchedulingPolicy from_native_policy(int policy)
+{
+  switch (policy)
+  {
+    case SCHED_FIFO:
+      return eSchedulingPolicy::Fifo;
+    case SCHED_RR:
+      return eSchedulingPolicy::RoundRobin;
+    default:
+      return eSchedulingPolicy::Normal;
+  }
+}
+
+/** @brief Touch the next bytes of stack so their pages are mapped, and locked if
+ *  the process memory is locked.
+ */
+__attribute__((noinline)) size_t prefault_stack(size_t bytes) noexcept
+{
+  bytes = std::min(bytes, kMaxPrefaultStackBytes);
+  if (bytes == 0)
+    return 0;
+
+  volatile unsigned char *stack = static_cast<volatile unsigned char *>(alloca(bytes));
+  for (size_t i = 0; i < bytes; i += 4096)
+  {
+    stack[i] = 0;
+  }
+  stack[bytes - 1] = 0;
+
+  return bytes;
+}
+
+}  // namespace
+
+/** @brief Apply a scheduling policy, CPU affinity and stack prefault to the calling thread.
+ *  Never throws. Anything the kernel refuses is left as it was and reported,
+ *  which is the usual case for real-time policies without CAP_SYS_NICE or an rtprio limit.
+ *  No allocations, so it may run at the start of an audio callback.
+ *  @param config What to request
+ *  @return What was granted
+ */
+ThreadReport apply_thread_config(const ThreadConfig &config) noexcept
+{
+  ThreadReport report{};
+  report.applied = true;
+  report.requested = config;
+
+  const pthread_t self = pthread_self();
+
+  const int native_policy = to_native_policy(config.policy);
+  sched_param param{};
+  if (config.policy != eSchedulingPolicy::Normal)
+  {
+    param.sched_priority = std::clamp(config.priority,
+                                      sched_get_priority_min(native_policy),
+                                      sched_get_priority_max(native_policy));
+  }
+  report.scheduling_error = pthread_setschedparam(self, native_policy, &param);
+
+  if (config.cpu_mask != 0)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (unsigned int cpu = 0; cpu < kMaxMaskCpus; ++cpu)
+    {
+      if (config.cpu_mask & (uint64_t{1} << cpu))
+        CPU_SET(cpu, &cpus);
+    }
+    report.affinity_error = pthread_setaffinity_np(self, sizeof(cpus), &cpus);
+  }
+
+  report.prefaulted_bytes = prefault_stack(config.prefault_stack_bytes);
+
+  // Read back what the thread runs with now
+  int granted_policy = SCHED_OTHER;
+  sched_param granted_param{};
+  if (pthread_getschedparam(self, &granted_policy, &granted_param) == 0)
+  {
+    report.policy = from_native_policy(granted_policy);
+    report.priority = granted_param.sched_priority;
+  }
+
+  cpu_set_t granted_cpus;
+  CPU_ZERO(&granted_cpus);
+  if (pthread_getaffinity_np(self, sizeof(granted_cpus), &granted_cpus) == 0)
+  {
+    for (unsigned int cpu = 0; cpu < kMaxMaskCpus; ++cpu)
+    {
+      if (CPU_ISSET(cpu, &granted_cpus))
+        report.cpu_mask |= uint64_t{1} << cpu;
+    }
+  }
+
+  return report;
+}
+
+/** @brief Lock all current and future pages of the process into RAM.
+ *  Stops the audio path from page faulting on memory that was swapped or
+ *  not yet touched. Usually needs CAP_IPC_LOCK or a raised memlock limit.
+ */
+MemoryLockReport lock_process_memory() noexcept
+{
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+  {
+    return MemoryLockReport{false, errno};
+  }
+  return MemoryLockReport{true, 0};
+}
+
+/** @brief Undo lock_process_memory
+ */
+void unlock_process_memory() noexcept
+{
+  munlockall();
+}
+
+std::string scheduling_policy_to_string(eSchedulingPolicy policy)
+{
+  switch (policy)
+  {
+    case eSchedulingPolicy::Fifo:
+      return "SCHED_FIFO";
+    case eSchedulingPolicy::RoundRobin:
+      return "SCHED_RR";
+    default:
+      return "SCHED_OTHER";
+  }
+}
+
+/** @brief One line summary of a ThreadReport for the log
+ */
+std::string thread_report_to_string(const ThreadReport &report)
+{
+  if (!report.applied)
+    return "not applied";
+
+  std::string text = scheduling_policy_to_string(report.policy) + " priority " + std::to_string(report.priority);
+  if (report.scheduling_error != 0)
+  {
+    text += " (requested " + scheduling_policy_to_string(report.requested.policy) + " priority " +
+            std::to_string(report.requested.priority) + ": " + std::strerror(report.scheduling_error) + ")";
+  }
+
+  char mask[19];
+  std::snprintf(mask, sizeof(mask), "0x%llx", static_cast<unsigned long long>(report.cpu_mask));
+  text += ", cpus " + std::string(mask);
+  if (report.affinity_error != 0)
+  {
+    text += " (affinity refused: " + std::string(std::strerror(report.affinity_error)) + ")";
+  }
+
+  if (report.prefaulted_bytes > 0)
+  {
+    text += ", stack prefaulted " + std::to_string(report.prefaulted_bytes / 1024) + " KB";
+  }
+
+  return text;
+}
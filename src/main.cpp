@@ -1,10 +1,13 @@
 #include "audioengine.h"
 #include "midiengine.h"
 #include "trackmanager.h"
+#include "meteranalyzer.h"
 #include "track.h"
+#include "threadconfig.h"
 
 #include <iostream>
 #include <csignal>
+#include <cstring>
 #include <thread>
 #include <chrono>
 #include <vector>
@@ -21,29 +24,64 @@ static bool app_running = false;
 class Application
 {
 public:
-  Application()
+  /** @param realtime Whether to lock memory and run the audio threads at real-time priority
+   */
+  explicit Application(const bool realtime)
   {
+    if (realtime)
+      configure_realtime();
+
     AudioEngine::instance().start_thread();
     MidiEngine::instance().start_thread();
+    Dsp::MeterAnalyzer::instance().start_thread();
+
+    std::cout << "Audio engine thread: " << thread_report_to_string(AudioEngine::instance().get_thread_report()) << std::endl;
+    std::cout << "MIDI engine thread: " << thread_report_to_string(MidiEngine::instance().get_thread_report()) << std::endl;
   }
 
   ~Application()
   {
+    Dsp::MeterAnalyzer::instance().stop_thread();
     MidiEngine::instance().stop_thread();
     AudioEngine::instance().stop_thread();
   }
 
+  /** @brief Lock memory and ask for real-time scheduling of the audio engine threads.
+   *  Without the privileges for it the engine keeps running at normal priority.
+   *  The MIDI engine thread polls without blocking, so it stays at normal priority.
+   */
+  void configure_realtime()
+  {
+    const MemoryLockReport memory = lock_process_memory();
+    if (memory.locked)
+      std::cout << "Memory locked" << std::endl;
+    else
+      std::cout << "Memory not locked: " << std::strerror(memory.error) << std::endl;
+
+    ThreadConfig audio_config;
+    audio_config.policy = eSchedulingPolicy::Fifo;
+    audio_config.priority = 80;
+    audio_config.prefault_stack_bytes = 256 * 1024;
+    AudioEngine::instance().set_audio_thread_config(audio_config);
+
+    ThreadConfig control_config;
+    control_config.policy = eSchedulingPolicy::Fifo;
+    control_config.priority = 70;
+    control_config.prefault_stack_bytes = 64 * 1024;
+    AudioEngine::instance().set_thread_config(control_config);
+  }
+
   void run()
   {
-    size_t track_index = TrackManager::instance().add_track();
-    auto track = TrackManager::instance().get_track(track_index);
+    TrackHandle track_handle = TrackManager::instance().add_track();
+    auto track = TrackManager::instance().get_track(track_handle);
 
     // Attach track as observer to both engines
     MidiEngine::instance().attach(track);
 
     while (app_running)
     {
-      track->handle_midi_message();
+      track->handle_midi_messages();
 
       // Wait for the signal handler to set app_running to false
       std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -102,17 +140,32 @@ bool open_midi_device()
 }
 
 /** @brief Main function for the Digital Audio Workstation application.
+ *  Pass --realtime to lock memory and run the audio threads at real-time priority.
  *  @return Exit status of the application (0 for success, non-zero for failure).
  */
-int main()
+int main(int argc, char *argv[])
 {
+  bool realtime = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--realtime") == 0)
+    {
+      realtime = true;
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--realtime]" << std::endl;
+      return 1;
+    }
+  }
+
   std::cout << "Embedded Audio Engine" << std::endl;
   std::cout << "---------------------" << std::endl;
 
   std::signal(SIGINT, signal_handler);
   app_running = true;
 
-  Application app;
+  Application app(realtime);
   app.run();
 
   return 0;
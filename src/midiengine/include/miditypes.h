@@ -77,6 +77,19 @@ struct MidiMessage
   std::string type_name; // Human-readable name of the MIDI message type
 };
 
+/** @struct MidiEvent
+  *  @brief A MidiMessage without its type name, trivially copyable so it can pass through a RingBuffer.
+  */
+struct MidiEvent
+{
+  double deltatime;
+  unsigned char status;
+  eMidiMessageType type;
+  unsigned char channel;
+  unsigned char data1;
+  unsigned char data2;
+};
+
 inline std::ostream& operator<<(std::ostream& os, const MidiMessage& msg)
 {
   os << "MidiMessage { "
@@ -0,0 +1,52 @@
+#ifndef __BOUNCE_H__
+#define __BOUNCE_H__
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "wavwriter.h"
+
+namespace Tracks
+{
+
+class Track;
+class Bus;
+
+/** @struct BounceOptions
+ *  @brief How a session is rendered to a file
+ */
+struct BounceOptions
+{
+  unsigned int sample_rate = 48000;
+  unsigned int channels = 2;
+  unsigned int block_frames = 1024;
+  unsigned int threads = 0;         // 0 uses every hardware thread
+  uint64_t start = 0;               // First timeline frame
+  uint64_t length = 0;              // Frames to render, 0 renders to the end of the last clip
+  uint64_t tail_frames = 0;         // Extra frames after the last clip for reverb and delay tails
+  Files::eWavSampleFormat format = Files::eWavSampleFormat::Float32;
+  std::function<void(double)> progress;  // Called with 0 to 1 from the rendering threads
+};
+
+/** @struct BounceResult
+ *  @brief What a bounce wrote and how long it took
+ */
+struct BounceResult
+{
+  uint64_t frames;
+  unsigned int threads;
+  double seconds;
+  double realtime_factor;  // Audio duration divided by render time
+};
+
+BounceResult bounce_session(const std::vector<std::shared_ptr<Track>> &tracks,
+                            const std::vector<std::shared_ptr<Bus>> &buses,
+                            const std::filesystem::path &path,
+                            const BounceOptions &options = BounceOptions{});
+
+}  // namespace Tracks
+
+#endif  // __BOUNCE_H__
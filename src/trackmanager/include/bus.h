@@ -0,0 +1,47 @@
+#ifndef __BUS_H__
+#define __BUS_H__
+
+#include <atomic>
+#include <string>
+
+#include "audiobuffer.h"
+#include "processorchain.h"
+
+namespace Tracks
+{
+
+/** @class Bus
+ *  @brief A send/return bus. Tracks send into it, its effect chain runs once
+ *         per block on the sum, and the result returns to the master bus.
+ */
+class Bus
+{
+public:
+  explicit Bus(const std::string &name);
+
+  const std::string &get_name() const noexcept { return m_name; }
+
+  void set_return_level(const float level) noexcept { m_return_level.store(level, std::memory_order_relaxed); }
+  float get_return_level() const noexcept { return m_return_level.load(std::memory_order_relaxed); }
+
+  void prepare(const Dsp::ProcessSpec &spec);
+
+  bool process(AudioBuffer &buffer, const unsigned int n_frames, const bool silent = false) noexcept;
+
+  Dsp::ProcessorChain &get_effect_chain() noexcept { return m_effect_chain; }
+  std::vector<Dsp::ProcessorStatistics> get_effect_statistics() const { return m_effect_chain.get_statistics(); }
+
+  /** @brief Samples the bus output lags its input
+   */
+  unsigned int get_latency() const { return m_effect_chain.get_latency(); }
+
+private:
+  std::string m_name;
+  std::atomic<float> m_return_level;
+
+  Dsp::ProcessorChain m_effect_chain;
+};
+
+}  // namespace Tracks
+
+#endif  // __BUS_H__
@@ -0,0 +1,195 @@
+#ifndef __CLIP_TIMELINE_H__
+#define __CLIP_TIMELINE_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audiobuffer.h"
+#include "snapshot.h"
+
+namespace Files
+{
+  class WavFile;
+  class MidiFile;
+  class AudioStream;
+}
+
+namespace Tracks
+{
+
+using ClipId = uint32_t;
+
+static constexpr ClipId kInvalidClip = 0;
+
+/** @enum eClipType
+ *  @brief Kind of source a clip plays
+ */
+enum class eClipType
+{
+  Audio,
+  Midi,
+};
+
+/** @struct Clip
+ *  @brief A region of a source placed on a track's timeline. Positions are in frames.
+ */
+struct Clip
+{
+  ClipId id = kInvalidClip;
+  eClipType type = eClipType::Audio;
+  uint64_t start = 0;   // Timeline frame the clip starts on
+  uint64_t length = 0;  // Frames played from the source
+  uint64_t offset = 0;  // First source frame played
+  float gain = 1.0f;
+
+  std::shared_ptr<const AudioBuffer> audio;  // Decoded source, shared by clips of the same file
+  std::shared_ptr<Files::AudioStream> stream;  // Or a source decoded while it plays, one per clip
+  std::shared_ptr<Files::WavFile> wav_file;
+  std::shared_ptr<const Files::MidiFile> midi_file;
+
+  uint64_t get_end() const noexcept { return start + length; }
+};
+
+/** @class ClipIndex
+ *  @brief Immutable interval index over the clips of one timeline.
+ *
+ *  Clips are sorted by start and laid out as an implicit binary search tree:
+ *  the node at level k sits at an index whose lowest k bits are all set, and
+ *  each node stores the latest end in its subtree. A query descends only into
+ *  subtrees whose latest end is past the query start, so finding the clips
+ *  overlapping a block costs O(log n + k) however many clips the timeline has.
+ */
+class ClipIndex
+{
+public:
+  explicit ClipIndex(std::vector<Clip> clips);
+
+  /** @brief Call fn for every clip overlapping [begin, end), in start order.
+   *  Does not allocate, safe on the audio thread.
+   */
+  template <typename Fn>
+  void for_each_overlapping(const uint64_t begin, const uint64_t end, Fn &&fn) const noexcept;
+
+  size_t size() const noexcept { return m_clips.size(); }
+  const std::vector<Clip> &get_clips() const noexcept { return m_clips; }
+
+private:
+  std::vector<Clip> m_clips;
+  std::vector<uint64_t> m_max_end;
+  int m_max_level;
+};
+
+/** @class ClipTimeline
+ *  @brief The audio and MIDI clips of one track.
+ *
+ *  Edits happen on control threads against an editable copy, then a new
+ *  ClipIndex is built and published as an immutable snapshot. The audio thread
+ *  reads the current snapshot without locking.
+ */
+class ClipTimeline
+{
+public:
+  ClipTimeline();
+
+  ClipId add_audio_clip(const std::shared_ptr<Files::WavFile> &wav_file, const uint64_t start,
+                        const uint64_t offset = 0, const uint64_t length = 0);
+  ClipId add_streamed_clip(const std::filesystem::path &path, const uint64_t start,
+                           const uint64_t offset = 0, const uint64_t length = 0);
+  ClipId add_midi_clip(const std::shared_ptr<const Files::MidiFile> &midi_file, const uint64_t start,
+                       const uint64_t length);
+  ClipId add_clip(Clip clip);
+  std::vector<ClipId> add_clips(std::vector<Clip> clips);
+
+  void remove_clip(const ClipId id);
+  void move_clip(const ClipId id, const uint64_t start);
+  void set_clip_gain(const ClipId id, const float gain);
+  void clear();
+
+  Clip get_clip(const ClipId id) const;
+  std::vector<ClipId> find_clips(const uint64_t begin, const uint64_t end) const;
+  uint64_t get_end() const;
+
+  size_t get_clip_count() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_clips.size();
+  }
+
+  /** @brief Pin the current index. Audio thread.
+   */
+  SnapshotPublisher<ClipIndex>::ReadGuard read() noexcept { return m_index.read(); }
+
+private:
+  ClipId insert_locked(Clip clip);
+  Clip &find_locked(const ClipId id);
+  std::shared_ptr<const AudioBuffer> decode_locked(const std::shared_ptr<Files::WavFile> &wav_file);
+  void publish_locked();
+
+  mutable std::mutex m_mutex;
+  std::vector<Clip> m_clips;
+  ClipId m_next_id;
+
+  // Decoded sources, kept while any clip still uses them
+  std::map<const Files::WavFile *, std::weak_ptr<const AudioBuffer>> m_decoded;
+
+  SnapshotPublisher<ClipIndex> m_index;
+};
+
+template <typename Fn>
+void ClipIndex::for_each_overlapping(const uint64_t begin, const uint64_t end, Fn &&fn) const noexcept
+{
+  struct Node
+  {
+    int level;
+    size_t index;
+    bool left_done;
+  };
+
+  const size_t n = m_clips.size();
+  if (n == 0 || begin >= end)
+    return;
+
+  // One level per bit of the index, each level pushes at most two nodes
+  Node stack[128];
+  int top = 0;
+  stack[top++] = Node{m_max_level, (static_cast<size_t>(1) << m_max_level) - 1, false};
+
+  while (top > 0)
+  {
+    const Node node = stack[--top];
+
+    if (node.level <= 3)
+    {
+      // Small subtrees are scanned in order
+      const size_t first = node.index >> node.level << node.level;
+      const size_t last = std::min(n, first + (static_cast<size_t>(1) << (node.level + 1)) - 1);
+      for (size_t i = first; i < last && m_clips[i].start < end; ++i)
+      {
+        if (begin < m_clips[i].get_end())
+          fn(m_clips[i]);
+      }
+    }
+    else if (!node.left_done)
+    {
+      const size_t left = node.index - (static_cast<size_t>(1) << (node.level - 1));
+      stack[top++] = Node{node.level, node.index, true};
+      if (left >= n || m_max_end[left] > begin)
+        stack[top++] = Node{node.level - 1, left, false};
+    }
+    else if (node.index < n && m_clips[node.index].start < end)
+    {
+      if (begin < m_clips[node.index].get_end())
+        fn(m_clips[node.index]);
+      stack[top++] = Node{node.level - 1, node.index + (static_cast<size_t>(1) << (node.level - 1)), false};
+    }
+  }
+}
+
+}  // namespace Tracks
+
+#endif  // __CLIP_TIMELINE_H__
@@ -0,0 +1,140 @@
+#ifndef __RENDER_PLAN_H__
+#define __RENDER_PLAN_H__
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "audiobuffer.h"
+#include "audiokernels.h"
+#include "delayline.h"
+#include "processor.h"
+#include "trackslots.h"
+
+namespace Audio
+{
+  struct TransportState;
+}
+
+namespace Tracks
+{
+
+class Track;
+class Bus;
+
+/** @enum eRenderOp
+ *  @brief What one step of a render plan does
+ */
+enum class eRenderOp : uint8_t
+{
+  Clear,        // Silence the destination slot
+  RenderTrack,  // Render the source track into the destination slot
+  ProcessBus,   // Run a bus effect chain on the destination slot
+  Mix,          // Add the source slot into the destination slot
+  Delay,        // Delay the destination slot in place through a compensation line
+  DelayMix,     // Add the source slot into the destination slot through a compensation line
+};
+
+/** @enum eMixGain
+ *  @brief Where a Mix step reads its gain, once per block
+ */
+enum class eMixGain : uint8_t
+{
+  Unity,
+  Send,    // The track's send level for the bus
+  Return,  // The bus return level
+};
+
+/** @struct RenderStep
+ *  @brief One entry of the flat execution plan. The plan owns every node it points at.
+ */
+struct RenderStep
+{
+  eRenderOp op;
+  eMixGain gain;
+  uint16_t source;
+  uint16_t destination;
+  uint16_t send;
+  uint16_t line;
+  Track *track;
+  Bus *bus;
+};
+
+/** @class RenderPlan
+ *  @brief The track and bus routing compiled into a linear list of steps.
+ *
+ *  compile() turns the routing into a graph with one node per track and bus,
+ *  sorts it topologically and walks the order once, giving each node a scratch
+ *  slot from a free list for as long as its output is still to be mixed. Tracks
+ *  share one slot between them and each bus holds one while tracks send to it,
+ *  so scratch memory follows the bus count rather than the track count.
+ *
+ *  Every path reaches the master bus with the same latency. Each node's output
+ *  arrives at the latest time any of its destinations' other inputs arrive,
+ *  so compile() delays the paths that are early. A delay shared by all of a
+ *  node's outputs is applied once to its slot, and only the remainder goes on
+ *  the individual mixes. Paths already in line are mixed without a delay line.
+ *
+ *  Each slot carries a silence flag through the block. Silent tracks and bus
+ *  returns are not mixed, and buses whose sends are all silent stop their
+ *  effects once the tails have ended, so the work follows the tracks playing
+ *  rather than the track count.
+ *
+ *  A plan compiled from a TrackSlotMap starts each block with one pass over
+ *  the map's mute and solo flags, and tracks that are not heard are neither
+ *  rendered nor mixed.
+ *
+ *  The plan is immutable once published, apart from the contents of its slots
+ *  and delay lines, which only the audio thread touches. The lines start
+ *  silent, so a recompile with latency restarts the delayed paths.
+ */
+class RenderPlan
+{
+public:
+  static constexpr uint16_t kMasterSlot = std::numeric_limits<uint16_t>::max();
+
+  static std::unique_ptr<RenderPlan> compile(const std::vector<std::shared_ptr<Track>> &tracks,
+                                             const std::vector<std::shared_ptr<Bus>> &buses,
+                                             const Dsp::ProcessSpec &spec);
+  static std::unique_ptr<RenderPlan> compile(const TrackSlotMap &tracks,
+                                             const std::vector<std::shared_ptr<Bus>> &buses,
+                                             const Dsp::ProcessSpec &spec);
+
+  unsigned int run(AudioBuffer &master, const Audio::TransportState &transport,
+                   const unsigned int n_frames) const noexcept;
+
+  const std::vector<RenderStep> &get_steps() const noexcept { return m_steps; }
+  size_t get_slot_count() const noexcept { return m_slots.size(); }
+  size_t get_scratch_bytes() const noexcept;
+
+  /** @brief Samples the master bus lags the timeline, once every path is lined up
+   */
+  unsigned int get_latency() const noexcept { return m_latency; }
+  size_t get_delay_line_count() const noexcept { return m_lines.size(); }
+  bool is_latency_current() const;
+
+private:
+  RenderPlan() = default;
+
+  std::vector<RenderStep> m_steps;
+  mutable std::vector<AudioBuffer> m_slots;
+  mutable std::vector<uint8_t> m_silent;  // Per slot, whether it holds only silence this block
+  mutable std::vector<Dsp::DelayLine> m_lines;
+  unsigned int m_latency = 0;
+  std::vector<unsigned int> m_node_latencies;  // Tracks, then buses, as compiled
+  unsigned int m_channels = 0;
+  const Kernels::KernelTable *p_kernels = nullptr;
+
+  std::vector<std::shared_ptr<Track>> m_tracks;
+  std::vector<std::shared_ptr<Bus>> m_buses;
+
+  // Mute and solo, read once per block when compiled from a slot map
+  const TrackSlotMap *p_track_slots = nullptr;
+  std::vector<uint32_t> m_track_slots;  // Slot of each track, in render order
+  mutable std::vector<uint8_t> m_audible;
+};
+
+}  // namespace Tracks
+
+#endif  // __RENDER_PLAN_H__
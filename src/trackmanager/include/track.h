@@ -1,38 +1,97 @@
 #ifndef __TRACK_H__
 #define __TRACK_H__
 
-#include <queue>
+#include <array>
+#include <atomic>
+#include <filesystem>
 #include <mutex>
 #include <memory>
 #include <optional>
 
 #include "observer.h"
 #include "midiengine.h"
+#include "audiobuffer.h"
+#include "processorchain.h"
+#include "gain.h"
+#include "metertap.h"
+#include "cliptimeline.h"
+#include "ringbuffer.h"
 
 // Forward declaration
 namespace Audio
 {
   struct AudioMessage;
+  struct TransportState;
 }
 
 namespace Files
 {
   class WavFile;
   class MidiFile;
+  class AudioStream;
 }
 
 namespace Tracks
 {
 
+/** @struct FreezeOptions
+ *  @brief How a track is rendered when it is frozen
+ */
+struct FreezeOptions
+{
+  std::filesystem::path directory;  // Where the render is written, empty for the system temporary directory
+  unsigned int block_frames = 1024;
+  uint64_t tail_frames = 0;         // Extra frames after the last clip for reverb and delay tails
+};
+
+/** @struct FreezeStatistics
+ *  @brief What freezing a track cost and what it saves
+ */
+struct FreezeStatistics
+{
+  bool frozen;
+  uint64_t frames;
+  unsigned int sample_rate;  // Rate of the render, a frozen track must be played at this rate
+  double render_seconds;
+  double realtime_factor;  // Audio duration divided by render time
+  double live_load;        // Clip and effect time per second of audio, measured during the render
+  double frozen_load;      // Stream decode time per second of audio
+  double reclaimed_load;   // live_load less frozen_load, 0.01 is 1% of a core during playback
+  std::filesystem::path filepath;
+};
+
+/** @struct MidiQueueStatistics
+ *  @brief Health of a track's MIDI input queue
+ */
+struct MidiQueueStatistics
+{
+  uint64_t received;   // Events offered by the MIDI input
+  uint64_t dropped;    // Events lost because the queue was full
+  uint64_t drained;    // Events taken by the consumer
+  size_t largest_batch;
+  size_t pending;
+  size_t capacity;
+};
+
 /** @class Track
  *  @brief The Track class represents a track in the Digital Audio Workstation.
+ *
+ *  MIDI input arrives on the MIDI engine's thread and waits in a bounded
+ *  lock-free queue. One consumer takes everything pending in one batch each
+ *  time it looks, such as once per block, so a burst is limited by the
+ *  hardware rather than by how often the queue is polled. Events that do
+ *  not fit are dropped and counted, never waited for.
  */
 class Track : public Observer<Midi::MidiMessage>, 
           public Observer<Audio::AudioMessage>,
           public std::enable_shared_from_this<Track>
 {
 public:
-  Track() = default;
+  static constexpr size_t kMaxSends = 8;
+  static constexpr size_t kMidiQueueCapacity = 1024;
+
+  Track();
+  ~Track();
 
   void add_audio_input(const unsigned int device_id = 0);
   void add_audio_file_input(const std::shared_ptr<Files::WavFile> &wav_file);
@@ -55,17 +114,77 @@ public:
   void update(const Midi::MidiMessage& message) override;
   void update(const Audio::AudioMessage& message) override;
 
-  void handle_midi_message();
+  size_t drain_midi_events(Midi::MidiEvent *events, const size_t max_events) noexcept;
+  size_t handle_midi_messages();
+  MidiQueueStatistics get_midi_statistics() const noexcept;
 
+  void prepare(const Dsp::ProcessSpec &spec);
+  bool render(AudioBuffer &output, const Audio::TransportState &transport, const unsigned int n_frames) noexcept;
+  bool render_muted(AudioBuffer &output, const unsigned int n_frames) noexcept;
   void get_next_audio_frame(float *output_buffer, unsigned int n_frames);
 
+  /** @brief Audio and MIDI clips played while the transport runs
+   */
+  ClipTimeline &get_timeline() noexcept { return m_timeline; }
+
+  /** @brief Insert effects, run in order on the track's output
+   */
+  Dsp::ProcessorChain &get_effect_chain() noexcept { return m_effect_chain; }
+  std::vector<Dsp::ProcessorStatistics> get_effect_statistics() const { return m_effect_chain.get_statistics(); }
+
+  unsigned int get_latency() const;
+
+  /** @brief Volume and pan, applied after the insert effects
+   */
+  Dsp::Gain &get_fader() noexcept { return m_fader; }
+
+  /** @brief Post-fader meter, analyzed by the MeterAnalyzer thread
+   */
+  std::shared_ptr<Dsp::MeterTap> get_meter() const noexcept { return p_meter; }
+
+  void freeze(const FreezeOptions &options = FreezeOptions{});
+  void unfreeze();
+  bool is_frozen() const;
+  FreezeStatistics get_freeze_statistics() const;
+
+  void set_send_level(const size_t bus_index, const float level);
+  float get_send_level(const size_t bus_index) const;
+
+  /** @brief Send level without bounds checking. Audio thread only.
+   */
+  inline float get_send_level_unchecked(const size_t bus_index) const noexcept
+  {
+    return m_send_levels[bus_index].load(std::memory_order_relaxed);
+  }
+
 private:
-  std::queue<Midi::MidiMessage> m_message_queue;
-  std::mutex m_queue_mutex;
+  bool render_clips(AudioBuffer &output, const uint64_t position, const unsigned int n_frames) noexcept;
+  bool render_live(AudioBuffer &output, const Audio::TransportState &transport, const unsigned int n_frames) noexcept;
+  void unfreeze_locked();
+
+  // Written by the MIDI engine's thread, read by one consumer
+  RingBuffer<Midi::MidiEvent> m_midi_events;
+  std::atomic<uint64_t> m_midi_received;
+  std::atomic<uint64_t> m_midi_dropped;
+  std::atomic<uint64_t> m_midi_drained;
+  std::atomic<size_t> m_midi_largest_batch;
 
   std::optional<unsigned int> m_audio_input_device_id;
   std::optional<unsigned int> m_midi_input_device_id;
   std::optional<unsigned int> m_audio_output_device_id;
+
+  ClipTimeline m_timeline;
+  Dsp::ProcessorChain m_effect_chain;
+  Dsp::Gain m_fader;
+  std::shared_ptr<Dsp::MeterTap> p_meter;
+
+  // Set only while the track is not rendered, then read by the audio thread in place of the clips and effects
+  std::shared_ptr<Files::AudioStream> p_frozen;
+  FreezeStatistics m_freeze_statistics;
+  mutable std::mutex m_freeze_mutex;
+
+  // Post-fader send level per send bus, 0 when not sending
+  std::array<std::atomic<float>, kMaxSends> m_send_levels;
 };
 
 }  // namespace Tracks
@@ -2,8 +2,19 @@
 #define __TRACK_MANAGER_H_
 
 #include "track.h"
+#include "trackslots.h"
+#include "bus.h"
+#include "renderplan.h"
+#include "bounce.h"
+#include "audioengine.h"
+#include "snapshot.h"
+#include "metertap.h"
 
+#include <atomic>
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 namespace Tracks
@@ -11,8 +22,11 @@ namespace Tracks
 
 /** @class TrackManager
  *  @brief The TrackManager class is responsible for managing tracks in the application.
+ *         It renders every track into the AudioEngine master bus, through any
+ *         send buses the tracks feed. Tracks are named by TrackHandle, which
+ *         stays valid as other tracks are added and removed.
  */
-class TrackManager
+class TrackManager : public Audio::IAudioRenderer
 {
 public:
   static TrackManager& instance()
@@ -21,21 +35,88 @@ public:
     return instance;
   }
 
-  size_t add_track();
-  void remove_track(size_t index);
-  std::shared_ptr<Track> get_track(size_t index);
+  TrackHandle add_track();
+  void remove_track(const TrackHandle handle);
+  std::shared_ptr<Track> get_track(const TrackHandle handle);
+  bool contains_track(const TrackHandle handle) const;
 
   void clear_tracks();
 
-  size_t get_track_count() const { return m_tracks.size(); }
+  size_t get_track_count() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tracks.size();
+  }
+
+  TrackHandle get_track_handle(size_t index) const;
+  size_t get_track_index(const TrackHandle handle) const;
+
+  void set_track_mute(const TrackHandle handle, const bool mute);
+  bool is_track_muted(const TrackHandle handle) const;
+  void set_track_solo(const TrackHandle handle, const bool solo);
+  bool is_track_soloed(const TrackHandle handle) const;
+
+  /** @brief Meter on the master bus after every track and send return
+   */
+  std::shared_ptr<Dsp::MeterTap> get_master_meter() const noexcept { return p_master_meter; }
+
+  size_t add_send_bus(const std::string &name);
+  size_t add_reverb_bus(const std::filesystem::path &impulse_response);
+  std::shared_ptr<Bus> get_send_bus(size_t index);
+  void clear_send_buses();
+
+  size_t get_send_bus_count() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_buses.size();
+  }
+
+  size_t get_render_slot_count() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const RenderPlan *plan = m_plan.peek();
+    return plan ? plan->get_slot_count() : 0;
+  }
+
+  /** @brief Tracks that rendered signal in the last block, the rest were skipped as silent
+   */
+  unsigned int get_active_track_count() const noexcept { return m_active_tracks.load(std::memory_order_relaxed); }
+
+  BounceResult bounce(const std::filesystem::path &path, const BounceOptions &options = BounceOptions{});
+
+  FreezeStatistics freeze_track(const TrackHandle handle, const FreezeOptions &options = FreezeOptions{});
+  void unfreeze_track(const TrackHandle handle);
+
+  bool update_latency_compensation();
+
+  // IAudioRenderer interface
+  void prepare(const unsigned int channels, const unsigned int sample_rate,
+               const unsigned int max_frames, std::pmr::memory_resource *resource) override;
+  void render(AudioBuffer &bus, const Audio::TransportState &transport, const unsigned int n_frames) noexcept override;
+  unsigned int get_latency() const override;
 
 private:
-  TrackManager() = default;
-  virtual ~TrackManager() = default;
+  TrackManager();
+  virtual ~TrackManager();
+
+  void retire_plan_locked();
+  void prepare_locked();
+  void publish_locked();
+
+  mutable std::mutex m_mutex;
+  TrackSlotMap m_tracks;
+  std::vector<std::shared_ptr<Bus>> m_buses;
+  std::shared_ptr<Dsp::MeterTap> p_master_meter;
+  std::optional<Dsp::ProcessSpec> m_spec;
+
+  // Recompiled on every edit, run by the audio thread
+  SnapshotPublisher<RenderPlan> m_plan;
+  std::atomic<unsigned int> m_active_tracks;
 
-  std::vector<std::shared_ptr<Track>> m_tracks;
+  // Latency of the published plan, read without m_mutex while a bounce or freeze holds it
+  std::atomic<unsigned int> m_latency;
 };
 
 }  // namespace Tracks
 
-#endif  // __TRACK_MANAGER_H_
\ No newline at end of file
+#endif  // __TRACK_MANAGER_H_
@@ -0,0 +1,112 @@
+#ifndef __TRACK_SLOTS_H__
+#define __TRACK_SLOTS_H__
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace Tracks
+{
+
+class Track;
+
+/** @struct TrackHandle
+ *  @brief Stable name of a track, valid until the track is removed whatever else is added or removed.
+ *  A handle to a removed track never names the track that reuses its slot.
+ */
+struct TrackHandle
+{
+  static constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+  uint32_t index = kInvalidIndex;
+  uint32_t generation = 0;
+
+  bool is_valid() const noexcept { return index != kInvalidIndex; }
+  bool operator==(const TrackHandle &other) const noexcept = default;
+};
+
+/** @class TrackSlotMap
+ *  @brief The session's tracks, named by generation-checked handles.
+ *
+ *  A handle is a slot index and the generation the slot had when the track
+ *  was added. Removing a track bumps the generation and frees the slot for
+ *  reuse, so lookups are O(1) and stale handles are refused. The tracks are
+ *  also kept in a dense list in the order they were added, which is the
+ *  order they are rendered in. Removing a track closes the gap in that list
+ *  without changing any other track's handle.
+ *
+ *  The controls the audio thread reads for every track each block, mute and
+ *  solo, live in fixed arrays indexed by slot, reserved up front like the
+ *  ParameterStore slots so they never move. The render plan reads them with
+ *  one pass over a few contiguous bytes per track, without ever waiting for a
+ *  writer. Every other call is for the caller to serialise.
+ */
+class TrackSlotMap
+{
+public:
+  static constexpr size_t kMaxTracks = 1024;
+
+  TrackSlotMap();
+
+  TrackSlotMap(const TrackSlotMap&) = delete;
+  TrackSlotMap& operator=(const TrackSlotMap&) = delete;
+
+  TrackHandle insert(std::shared_ptr<Track> track);
+  void erase(const TrackHandle handle);
+  void clear();
+
+  bool contains(const TrackHandle handle) const noexcept;
+  const std::shared_ptr<Track> &get(const TrackHandle handle) const;
+
+  size_t size() const noexcept { return m_tracks.size(); }
+  TrackHandle get_handle(const size_t position) const;
+  size_t get_position(const TrackHandle handle) const;
+
+  /** @brief Every track, in render order
+   */
+  const std::vector<std::shared_ptr<Track>> &get_tracks() const noexcept { return m_tracks; }
+
+  /** @brief Slot of every track, in render order
+   */
+  const std::vector<uint32_t> &get_slots() const noexcept { return m_slot_of; }
+
+  void set_mute(const TrackHandle handle, const bool mute);
+  bool is_muted(const TrackHandle handle) const;
+  void set_solo(const TrackHandle handle, const bool solo);
+  bool is_soloed(const TrackHandle handle) const;
+
+  /** @brief Whether the track in a slot is heard this block. Lock-free, safe on the audio thread.
+   */
+  inline bool is_audible(const uint32_t slot) const noexcept
+  {
+    return !p_mute[slot].load(std::memory_order_relaxed) &&
+           (m_solo_count.load(std::memory_order_relaxed) == 0 || p_solo[slot].load(std::memory_order_relaxed));
+  }
+
+  std::vector<std::shared_ptr<Track>> get_audible_tracks() const;
+
+private:
+  static constexpr uint32_t kNoPosition = std::numeric_limits<uint32_t>::max();
+
+  uint32_t check(const TrackHandle handle) const;
+
+  // Control side, by position in render order
+  std::vector<std::shared_ptr<Track>> m_tracks;
+  std::vector<uint32_t> m_slot_of;
+
+  // Control side, by slot
+  std::vector<uint32_t> m_position;
+  std::vector<uint32_t> m_generations;
+  std::vector<uint32_t> m_free_slots;
+
+  // Audio thread, by slot
+  std::unique_ptr<std::atomic<uint8_t>[]> p_mute;
+  std::unique_ptr<std::atomic<uint8_t>[]> p_solo;
+  std::atomic<unsigned int> m_solo_count;
+};
+
+}  // namespace Tracks
+
+#endif  // __TRACK_SLOTS_H__
@@ -0,0 +1,394 @@
+#include "bounce.h"
+
+#include "audiobuffer.h"
+#include "audiokernels.h"
+#include "audiostream.h"
+#include "bus.h"
+#include "delayline.h"
+#include "denormals.h"
+#include "logger.h"
+#include "parameterstore.h"
+#include "ringbuffer.h"
+#include "track.h"
+#include "transport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+using namespace Tracks;
+
+namespace
+{
+
+// Blocks the renderer may run ahead of the disk
+static constexpr size_t kWriterBlocks = 64;
+static constexpr auto kWriterPoll = std::chrono::microseconds(200);
+
+/** @class StreamingWriter
+ *  @brief Hands rendered blocks to a thread that writes them to the WAV file,
+ *  so rendering does not wait on the disk.
+ */
+class StreamingWriter
+{
+public:
+  StreamingWriter(const std::filesystem::path &path, const BounceOptions &options):
+    m_writer(path, options.channels, options.sample_rate, options.format),
+    m_ring(kWriterBlocks * options.block_frames * options.channels),
+    m_finished(false),
+    m_failed(false),
+    m_thread(&StreamingWriter::run, this)
+  {
+  }
+
+  ~StreamingWriter()
+  {
+    m_finished.store(true, std::memory_order_release);
+    if (m_thread.joinable())
+      m_thread.join();
+  }
+
+  /** @brief Queue interleaved samples, waiting while the ring is full.
+   *  @return False if the writer thread has failed
+   */
+  bool push(const float *samples, size_t count)
+  {
+    while (count > 0)
+    {
+      if (m_failed.load(std::memory_order_acquire))
+        return false;
+
+      const size_t written = m_ring.write(samples, count);
+      samples += written;
+      count -= written;
+      if (count > 0)
+        std::this_thread::sleep_for(kWriterPoll);
+    }
+    return true;
+  }
+
+  /** @brief Write out what is queued and close the file.
+   *  @throws The writer thread's exception if a write failed
+   */
+  void finish()
+  {
+    m_finished.store(true, std::memory_order_release);
+    m_thread.join();
+    if (m_error)
+      std::rethrow_exception(m_error);
+    m_writer.close();
+  }
+
+private:
+  void run()
+  {
+    const size_t channels = m_writer.get_channels();
+    std::vector<float> chunk(m_ring.get_capacity() / 4);
+
+    try
+    {
+      while (true)
+      {
+        // Read the flag first, so nothing pushed before finish() is missed
+        const bool finished = m_finished.load(std::memory_order_acquire);
+        const size_t available = std::min(m_ring.get_read_available(), chunk.size());
+        const size_t count = available - available % channels;
+        if (count > 0)
+        {
+          m_ring.read(chunk.data(), count);
+          m_writer.write(chunk.data(), static_cast<sf_count_t>(count / channels));
+        }
+        else if (finished)
+        {
+          break;
+        }
+        else
+        {
+          std::this_thread::sleep_for(kWriterPoll);
+        }
+      }
+    }
+    catch (...)
+    {
+      m_error = std::current_exception();
+      m_failed.store(true, std::memory_order_release);
+    }
+  }
+
+  Files::WavWriter m_writer;
+  RingBuffer<float> m_ring;
+  std::atomic<bool> m_finished;
+  std::atomic<bool> m_failed;
+  std::exception_ptr m_error;
+  std::thread m_thread;
+};
+
+}  // namespace
+
+/** @brief Render tracks and buses to a WAV file, faster than real time.
+ *
+ *  Each block, the tracks are shared out between the threads and rendered into
+ *  a buffer each. One thread then sums them in track order, runs the buses and
+ *  streams the block to a writer thread. The sums happen in the same order as
+ *  the live RenderPlan, so the file is bit-identical whatever the thread count.
+ *  Effect latency is compensated as it is live, and the file starts at
+ *  options.start rather than that much later.
+ *
+ *  The tracks and buses are prepared for the bounce, so nothing else may render
+ *  them until it returns, and they must be prepared again for live playback.
+ *  Automation follows the bounced position, from lanes captured when the bounce
+ *  starts, and nothing else may process automation until it returns.
+ *
+ *  @param tracks The tracks, summed in this order
+ *  @param buses The send buses, indexed by track send index
+ *  @param path The WAV file to write
+ *  @param options Format, range and thread count
+ *  @return The frames written and the time taken
+ *  @throws std::invalid_argument if the options describe no valid stream, or a
+ *  frozen track was rendered at another sample rate
+ *  @throws std::runtime_error if the file cannot be written
+ */
+BounceResult Tracks::bounce_session(const std::vector<std::shared_ptr<Track>> &tracks,
+                                    const std::vector<std::shared_ptr<Bus>> &buses,
+                                    const std::filesystem::path &path,
+                                    const BounceOptions &options)
+{
+  if (options.channels == 0 || options.sample_rate == 0 || options.block_frames == 0)
+  {
+    throw std::invalid_argument("Bounce: Invalid stream format");
+  }
+
+  // Preparing a frozen track at another rate would unfreeze it and delete its render
+  for (const auto &track : tracks)
+  {
+    const FreezeStatistics freeze = track->get_freeze_statistics();
+    if (freeze.frozen && freeze.sample_rate != options.sample_rate)
+    {
+      throw std::invalid_argument("Bounce: A frozen track was rendered at another sample rate");
+    }
+  }
+
+  uint64_t length = options.length;
+  if (length == 0)
+  {
+    uint64_t end = 0;
+    for (const auto &track : tracks)
+    {
+      end = std::max(end, track->get_timeline().get_end());
+    }
+    length = (end > options.start ? end - options.start : 0) + options.tail_frames;
+  }
+
+  unsigned int threads = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+  threads = std::clamp<unsigned int>(threads, 1, static_cast<unsigned int>(std::max<size_t>(tracks.size(), 1)));
+
+  const unsigned int channels = options.channels;
+  const Dsp::ProcessSpec spec{static_cast<double>(options.sample_rate), channels, options.block_frames,
+                              std::pmr::get_default_resource()};
+  for (const auto &track : tracks)
+  {
+    track->prepare(spec);
+  }
+  for (const auto &bus : buses)
+  {
+    bus->prepare(spec);
+  }
+
+  // Line the paths up as the live RenderPlan does. Tracks are delayed to the
+  // slowest track, the direct paths to the master by the slowest bus, and the
+  // buses to the slowest bus. The latency left over is rendered and dropped,
+  // so the file starts at options.start.
+  unsigned int track_latency = 0;
+  for (const auto &track : tracks)
+  {
+    track_latency = std::max(track_latency, track->get_latency());
+  }
+  unsigned int bus_latency = 0;
+  for (const auto &bus : buses)
+  {
+    bus_latency = std::max(bus_latency, bus->get_latency());
+  }
+  const unsigned int latency = track_latency + bus_latency;
+
+  std::vector<std::optional<Dsp::DelayLine>> track_lines(tracks.size());
+  std::vector<std::optional<Dsp::DelayLine>> direct_lines(tracks.size());
+  for (size_t t = 0; t < tracks.size(); ++t)
+  {
+    const unsigned int delay = track_latency - tracks[t]->get_latency();
+    if (delay > 0)
+      track_lines[t].emplace(channels, delay, options.block_frames);
+    if (bus_latency > 0)
+      direct_lines[t].emplace(channels, bus_latency, options.block_frames);
+  }
+
+  std::vector<std::optional<Dsp::DelayLine>> bus_lines(buses.size());
+  for (size_t b = 0; b < buses.size(); ++b)
+  {
+    const unsigned int delay = bus_latency - buses[b]->get_latency();
+    if (delay > 0)
+      bus_lines[b].emplace(channels, delay, options.block_frames);
+  }
+
+  std::vector<AudioBuffer> track_buffers;
+  track_buffers.reserve(tracks.size());
+  for (size_t i = 0; i < tracks.size(); ++i)
+  {
+    track_buffers.emplace_back(channels, options.block_frames);
+  }
+
+  std::vector<AudioBuffer> bus_buffers;
+  bus_buffers.reserve(buses.size());
+  for (size_t i = 0; i < buses.size(); ++i)
+  {
+    bus_buffers.emplace_back(channels, options.block_frames);
+  }
+
+  std::vector<uint8_t> track_silent(tracks.size(), true);
+  std::vector<uint8_t> bus_silent(buses.size(), true);
+
+  AudioBuffer master(channels, options.block_frames);
+  std::vector<float> interleaved(static_cast<size_t>(options.block_frames) * channels);
+  const Kernels::KernelTable &kernels = Kernels::select_kernels(channels);
+
+  LOG_INFO("Bounce: ", tracks.size(), " tracks, ", buses.size(), " buses, ", length, " frames on ", threads,
+           " threads to ", path.string());
+
+  const auto started = std::chrono::steady_clock::now();
+  StreamingWriter writer(path, options);
+  Files::OfflineScope offline;
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+  transport.position = options.start;
+  transport.sample_rate = static_cast<double>(options.sample_rate);
+
+  uint64_t remaining = length + latency;
+  uint64_t skip = latency;
+  unsigned int frames = static_cast<unsigned int>(std::min<uint64_t>(options.block_frames, remaining));
+  bool done = remaining == 0;
+  bool failed = false;
+  std::atomic<size_t> next_track{0};
+
+  Dsp::ParameterStore &parameters = Dsp::ParameterStore::instance();
+  Dsp::ParameterStore::OfflineAutomation automation = parameters.capture_automation();
+  parameters.process_automation(transport.position, automation);
+
+  // Runs on one thread once every thread has finished its tracks for the block
+  auto reduce = [&]() noexcept
+  {
+    master.clear(frames);
+    for (size_t b = 0; b < buses.size(); ++b)
+    {
+      bus_buffers[b].clear(frames);
+      bus_silent[b] = true;
+    }
+
+    // Silent tracks and returns are skipped as in the live plan
+    for (size_t t = 0; t < tracks.size(); ++t)
+    {
+      const bool silent = track_silent[t];
+      const float *const *track_channels = track_buffers[t].get_channel_pointers();
+      if (direct_lines[t])
+        direct_lines[t]->mix(track_buffers[t], master, 1.0f, frames, silent);
+      else if (!silent)
+        kernels.mix(track_channels, master.get_channel_pointers(), 1.0f, channels, frames);
+
+      if (silent)
+        continue;
+
+      for (size_t b = 0; b < buses.size(); ++b)
+      {
+        const float gain = tracks[t]->get_send_level_unchecked(b);
+        if (gain != 0.0f)
+        {
+          kernels.mix(track_channels, bus_buffers[b].get_channel_pointers(), gain, channels, frames);
+          bus_silent[b] = false;
+        }
+      }
+    }
+
+    for (size_t b = 0; b < buses.size(); ++b)
+    {
+      bool silent = buses[b]->process(bus_buffers[b], frames, bus_silent[b]);
+      if (bus_lines[b])
+        silent = bus_lines[b]->process(bus_buffers[b], frames, silent);
+      const float gain = buses[b]->get_return_level();
+      if (gain != 0.0f && !silent)
+        kernels.mix(bus_buffers[b].get_channel_pointers(), master.get_channel_pointers(), gain, channels, frames);
+    }
+
+    const unsigned int skipped = static_cast<unsigned int>(std::min<uint64_t>(skip, frames));
+    skip -= skipped;
+    if (skipped < frames)
+    {
+      kernels.interleave(master.get_channel_pointers(), interleaved.data(), channels, frames);
+      if (!writer.push(interleaved.data() + static_cast<size_t>(skipped) * channels,
+                       static_cast<size_t>(frames - skipped) * channels))
+        failed = true;
+    }
+
+    remaining -= frames;
+    transport.position += frames;
+    if (options.progress)
+      options.progress(static_cast<double>(length + latency - remaining) / static_cast<double>(length + latency));
+
+    if (remaining == 0 || failed)
+    {
+      done = true;
+      return;
+    }
+
+    frames = static_cast<unsigned int>(std::min<uint64_t>(options.block_frames, remaining));
+    parameters.process_automation(transport.position, automation);
+    next_track.store(0, std::memory_order_relaxed);
+  };
+
+  std::barrier sync(static_cast<std::ptrdiff_t>(threads), reduce);
+
+  auto work = [&]()
+  {
+    DenormalScope denormal_scope;
+    while (!done)
+    {
+      size_t t;
+      while ((t = next_track.fetch_add(1, std::memory_order_relaxed)) < tracks.size())
+      {
+        track_silent[t] = tracks[t]->render(track_buffers[t], transport, frames);
+        if (track_lines[t])
+          track_silent[t] = track_lines[t]->process(track_buffers[t], frames, track_silent[t]);
+      }
+      sync.arrive_and_wait();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int i = 1; i < threads; ++i)
+  {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+
+  writer.finish();
+
+  BounceResult result;
+  result.frames = length;
+  result.threads = threads;
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  result.realtime_factor = result.seconds > 0.0
+                             ? static_cast<double>(length) / options.sample_rate / result.seconds
+                             : 0.0;
+
+  LOG_INFO("Bounce: Wrote ", path.string(), " in ", result.seconds, " s, ", result.realtime_factor,
+           "x real time");
+
+  return result;
+}
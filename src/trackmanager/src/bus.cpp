@@ -0,0 +1,32 @@
+#include "bus.h"
+
+using namespace Tracks;
+
+/** @brief Bus constructor
+ *  @param name Display name of the bus
+ */
+Bus::Bus(const std::string &name):
+  m_name(name),
+  m_return_level(1.0f)
+{
+}
+
+/** @brief Prepare the effect chain for a stream.
+ *  Must not be called while the bus can be rendered.
+ *  @param spec The stream configuration
+ */
+void Bus::prepare(const Dsp::ProcessSpec &spec)
+{
+  m_effect_chain.prepare(spec);
+}
+
+/** @brief Run the effect chain on the summed sends, in place. Audio thread only.
+ *  @param buffer The summed sends, replaced by the bus output
+ *  @param n_frames Number of frames to process
+ *  @param silent Whether no send reached the bus this block
+ *  @return Whether the bus output is silent, so its return need not be mixed
+ */
+bool Bus::process(AudioBuffer &buffer, const unsigned int n_frames, const bool silent) noexcept
+{
+  return m_effect_chain.process(buffer, n_frames, silent);
+}
@@ -0,0 +1,359 @@
+#include "cliptimeline.h"
+
+#include "logger.h"
+#include "audiostream.h"
+#include "wavfile.h"
+
+#include <stdexcept>
+#include <string>
+
+using namespace Tracks;
+
+/** @brief Build the index from an unordered set of clips.
+ *  @param clips The clips, sorted by start here
+ */
+ClipIndex::ClipIndex(std::vector<Clip> clips):
+  m_clips(std::move(clips)),
+  m_max_level(0)
+{
+  std::sort(m_clips.begin(), m_clips.end(), [](const Clip &a, const Clip &b)
+  {
+    return a.start != b.start ? a.start < b.start : a.id < b.id;
+  });
+
+  const size_t n = m_clips.size();
+  m_max_end.resize(n);
+  if (n == 0)
+    return;
+
+  // Leaves are the even indices
+  size_t last_index = 0;
+  uint64_t last_end = 0;
+  for (size_t i = 0; i < n; i += 2)
+  {
+    last_index = i;
+    last_end = m_max_end[i] = m_clips[i].get_end();
+  }
+
+  // Each level up takes the latest end of the node and both subtrees. A right
+  // subtree cut short by the end of the array uses the latest end seen on the
+  // rightmost path instead.
+  int level = 1;
+  for (; (static_cast<size_t>(1) << level) <= n; ++level)
+  {
+    const size_t half = static_cast<size_t>(1) << (level - 1);
+    const size_t step = half << 2;
+    for (size_t i = (half << 1) - 1; i < n; i += step)
+    {
+      const uint64_t left = m_max_end[i - half];
+      const uint64_t right = i + half < n ? m_max_end[i + half] : last_end;
+      m_max_end[i] = std::max({m_clips[i].get_end(), left, right});
+    }
+
+    last_index = ((last_index >> level) & 1) ? last_index - half : last_index + half;
+    if (last_index < n && m_max_end[last_index] > last_end)
+      last_end = m_max_end[last_index];
+  }
+
+  m_max_level = level - 1;
+}
+
+/** @brief ClipTimeline constructor
+ */
+ClipTimeline::ClipTimeline():
+  m_next_id(kInvalidClip + 1)
+{
+}
+
+/** @brief Place a region of a WAV file on the timeline.
+ *  The file is decoded into memory once and shared by every clip that uses it,
+ *  so the audio thread never reads from disk. Samples play at the stream rate.
+ *  @param wav_file The source file
+ *  @param start Timeline frame the clip starts on
+ *  @param offset First frame of the file to play
+ *  @param length Number of frames to play, 0 plays to the end of the file
+ *  @return The id of the new clip
+ *  @throws std::invalid_argument if the file is null or the offset is past its end
+ */
+ClipId ClipTimeline::add_audio_clip(const std::shared_ptr<Files::WavFile> &wav_file, const uint64_t start,
+                                    const uint64_t offset, const uint64_t length)
+{
+  if (!wav_file)
+  {
+    throw std::invalid_argument("ClipTimeline: Audio clip has no source file");
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  Clip clip;
+  clip.type = eClipType::Audio;
+  clip.start = start;
+  clip.offset = offset;
+  clip.wav_file = wav_file;
+  clip.audio = decode_locked(wav_file);
+
+  const uint64_t frames = clip.audio->get_frames();
+  if (offset >= frames)
+  {
+    throw std::invalid_argument("ClipTimeline: Clip offset is past the end of " + wav_file->get_filename());
+  }
+  clip.length = length == 0 ? frames - offset : std::min(length, frames - offset);
+
+  const ClipId id = insert_locked(std::move(clip));
+  publish_locked();
+  return id;
+}
+
+/** @brief Place a region of an audio file of any format on the timeline, decoded as it plays.
+ *  Suits long or compressed files that would take too much memory decoded. The clip gets
+ *  its own AudioStream, which preloads the frames from the offset so playback starts there at once.
+ *  @param path The source file, in any format AudioFile reads
+ *  @param start Timeline frame the clip starts on
+ *  @param offset First frame of the file to play
+ *  @param length Number of frames to play, 0 plays to the end of the file
+ *  @return The id of the new clip
+ *  @throws std::runtime_error if the file cannot be opened
+ *  @throws std::invalid_argument if the offset is past the end of the file
+ */
+ClipId ClipTimeline::add_streamed_clip(const std::filesystem::path &path, const uint64_t start,
+                                       const uint64_t offset, const uint64_t length)
+{
+  Clip clip;
+  clip.type = eClipType::Audio;
+  clip.start = start;
+  clip.offset = offset;
+  clip.stream = Files::AudioStream::open(path, offset);
+
+  const uint64_t frames = clip.stream->get_frames();
+  clip.length = length == 0 ? frames - offset : std::min(length, frames - offset);
+
+  return add_clip(std::move(clip));
+}
+
+/** @brief Place a MIDI file on the timeline.
+ *  @param midi_file The source file
+ *  @param start Timeline frame the clip starts on
+ *  @param length Number of frames the clip lasts
+ *  @return The id of the new clip
+ *  @throws std::invalid_argument if the file is null or the length is 0
+ */
+ClipId ClipTimeline::add_midi_clip(const std::shared_ptr<const Files::MidiFile> &midi_file, const uint64_t start,
+                                   const uint64_t length)
+{
+  Clip clip;
+  clip.type = eClipType::Midi;
+  clip.start = start;
+  clip.length = length;
+  clip.midi_file = midi_file;
+
+  return add_clip(std::move(clip));
+}
+
+/** @brief Add a prepared clip. Its id is assigned here.
+ *  @return The id of the new clip
+ *  @throws std::invalid_argument if the clip is empty, has no source or runs past its audio
+ */
+ClipId ClipTimeline::add_clip(Clip clip)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const ClipId id = insert_locked(std::move(clip));
+  publish_locked();
+  return id;
+}
+
+/** @brief Add many clips with a single index rebuild, as when a session is loaded.
+ *  @return The ids of the new clips, in the order given
+ *  @throws std::invalid_argument if any clip is invalid, in which case none are added
+ */
+std::vector<ClipId> ClipTimeline::add_clips(std::vector<Clip> clips)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const size_t previous_count = m_clips.size();
+  const ClipId previous_id = m_next_id;
+
+  std::vector<ClipId> ids;
+  ids.reserve(clips.size());
+  try
+  {
+    for (auto &clip : clips)
+    {
+      ids.push_back(insert_locked(std::move(clip)));
+    }
+  }
+  catch (...)
+  {
+    m_clips.resize(previous_count);
+    m_next_id = previous_id;
+    throw;
+  }
+
+  publish_locked();
+  return ids;
+}
+
+/** @brief Remove a clip.
+ *  @throws std::out_of_range if no clip has the id
+ */
+void ClipTimeline::remove_clip(const ClipId id)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  Clip &clip = find_locked(id);
+  std::swap(clip, m_clips.back());
+  m_clips.pop_back();
+
+  publish_locked();
+}
+
+/** @brief Move a clip to a new timeline position.
+ *  @throws std::out_of_range if no clip has the id
+ */
+void ClipTimeline::move_clip(const ClipId id, const uint64_t start)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  find_locked(id).start = start;
+  publish_locked();
+}
+
+/** @brief Set the linear gain a clip plays at.
+ *  @throws std::out_of_range if no clip has the id
+ */
+void ClipTimeline::set_clip_gain(const ClipId id, const float gain)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  find_locked(id).gain = gain;
+  publish_locked();
+}
+
+/** @brief Remove every clip.
+ */
+void ClipTimeline::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_clips.clear();
+  publish_locked();
+}
+
+/** @brief Get a copy of a clip.
+ *  @throws std::out_of_range if no clip has the id
+ */
+Clip ClipTimeline::get_clip(const ClipId id) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (const auto &clip : m_clips)
+  {
+    if (clip.id == id)
+      return clip;
+  }
+
+  throw std::out_of_range("ClipTimeline: Unknown clip id " + std::to_string(id));
+}
+
+/** @brief Ids of the clips overlapping [begin, end) in the published index, in start order.
+ */
+std::vector<ClipId> ClipTimeline::find_clips(const uint64_t begin, const uint64_t end) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::vector<ClipId> ids;
+  const ClipIndex *index = m_index.peek();
+  if (index)
+  {
+    index->for_each_overlapping(begin, end, [&ids](const Clip &clip) { ids.push_back(clip.id); });
+  }
+  return ids;
+}
+
+/** @brief End of the last clip on the timeline, 0 when it is empty.
+ */
+uint64_t ClipTimeline::get_end() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  uint64_t end = 0;
+  for (const auto &clip : m_clips)
+  {
+    end = std::max(end, clip.get_end());
+  }
+  return end;
+}
+
+ClipId ClipTimeline::insert_locked(Clip clip)
+{
+  if (clip.length == 0)
+  {
+    throw std::invalid_argument("ClipTimeline: Clip length must be greater than 0");
+  }
+
+  if (clip.type == eClipType::Audio)
+  {
+    if (!clip.audio && !clip.stream)
+    {
+      throw std::invalid_argument("ClipTimeline: Audio clip has no decoded source");
+    }
+
+    const uint64_t frames = clip.audio ? clip.audio->get_frames() : clip.stream->get_frames();
+    if (clip.offset + clip.length > frames)
+    {
+      throw std::invalid_argument("ClipTimeline: Audio clip runs past the end of its source");
+    }
+  }
+  else if (!clip.midi_file)
+  {
+    throw std::invalid_argument("ClipTimeline: MIDI clip has no source file");
+  }
+
+  clip.id = m_next_id++;
+  m_clips.push_back(std::move(clip));
+  return m_clips.back().id;
+}
+
+Clip &ClipTimeline::find_locked(const ClipId id)
+{
+  for (auto &clip : m_clips)
+  {
+    if (clip.id == id)
+      return clip;
+  }
+
+  throw std::out_of_range("ClipTimeline: Unknown clip id " + std::to_string(id));
+}
+
+std::shared_ptr<const AudioBuffer> ClipTimeline::decode_locked(const std::shared_ptr<Files::WavFile> &wav_file)
+{
+  auto it = m_decoded.find(wav_file.get());
+  if (it != m_decoded.end())
+  {
+    if (auto audio = it->second.lock())
+      return audio;
+  }
+
+  const unsigned int frames = static_cast<unsigned int>(wav_file->get_frames());
+  auto audio = std::make_shared<AudioBuffer>(wav_file->get_channels(), frames);
+
+  // A short read leaves the rest of the buffer silent
+  wav_file->seek(0);
+  const unsigned int frames_read = wav_file->read(*audio, frames);
+
+  LOG_INFO("ClipTimeline: Decoded ", wav_file->get_filename(), ", ", frames_read, " frames");
+
+  m_decoded[wav_file.get()] = audio;
+  return audio;
+}
+
+void ClipTimeline::publish_locked()
+{
+  // Drop cache entries whose clips are all gone
+  for (auto it = m_decoded.begin(); it != m_decoded.end();)
+  {
+    it = it->second.expired() ? m_decoded.erase(it) : std::next(it);
+  }
+
+  m_index.publish(std::make_unique<ClipIndex>(m_clips));
+}
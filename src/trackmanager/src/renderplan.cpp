@@ -0,0 +1,381 @@
+#include "renderplan.h"
+
+#include "bus.h"
+#include "track.h"
+#include "transport.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Tracks;
+
+namespace
+{
+
+static constexpr size_t kMasterNode = std::numeric_limits<size_t>::max();
+
+/** @struct Edge
+ *  @brief Audio flowing from one node into another node or the master bus
+ */
+struct Edge
+{
+  size_t destination;
+  eMixGain gain;
+  uint16_t send;
+  unsigned int delay;  // Compensation on this mix alone
+};
+
+/** @struct Node
+ *  @brief A track or bus in the routing graph
+ */
+struct Node
+{
+  Track *track;
+  Bus *bus;
+  std::vector<Edge> outputs;
+  size_t inputs;
+  unsigned int latency;  // Of the node's own effects
+  uint64_t arrival;      // When its output would reach its destinations uncompensated
+  uint64_t target;       // When its latest input arrives
+  unsigned int delay;    // Compensation on every output
+};
+
+}  // namespace
+
+/** @brief Compile the routing into a flat plan. Not on the audio thread.
+ *  Every track feeds the master bus and every send bus, since send levels
+ *  change without an edit. Every bus returns to the master bus.
+ *  @param tracks The tracks, rendered in this order
+ *  @param buses The send buses, indexed by track send index
+ *  @param spec The stream the scratch slots are allocated for
+ *  @return The compiled plan
+ *  @throws std::logic_error if the routing has a cycle
+ */
+std::unique_ptr<RenderPlan> RenderPlan::compile(const std::vector<std::shared_ptr<Track>> &tracks,
+                                                const std::vector<std::shared_ptr<Bus>> &buses,
+                                                const Dsp::ProcessSpec &spec)
+{
+  std::vector<Node> nodes;
+  nodes.reserve(tracks.size() + buses.size());
+
+  for (const auto &track : tracks)
+  {
+    Node node{track.get(), nullptr, {}, 0, track->get_latency(), 0, 0, 0};
+    node.outputs.push_back(Edge{kMasterNode, eMixGain::Unity, 0, 0});
+    for (size_t b = 0; b < buses.size(); ++b)
+    {
+      node.outputs.push_back(Edge{tracks.size() + b, eMixGain::Send, static_cast<uint16_t>(b), 0});
+    }
+    nodes.push_back(std::move(node));
+  }
+
+  for (const auto &bus : buses)
+  {
+    Node node{nullptr, bus.get(), {}, 0, bus->get_latency(), 0, 0, 0};
+    node.outputs.push_back(Edge{kMasterNode, eMixGain::Return, 0, 0});
+    nodes.push_back(std::move(node));
+  }
+
+  for (const auto &node : nodes)
+  {
+    for (const auto &edge : node.outputs)
+    {
+      if (edge.destination != kMasterNode)
+        ++nodes[edge.destination].inputs;
+    }
+  }
+
+  // Kahn's algorithm, keeping the given order among nodes that are ready together
+  std::vector<size_t> order;
+  std::vector<size_t> ready;
+  for (size_t i = nodes.size(); i-- > 0;)
+  {
+    if (nodes[i].inputs == 0)
+      ready.push_back(i);
+  }
+
+  std::vector<size_t> remaining(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i)
+    remaining[i] = nodes[i].inputs;
+
+  while (!ready.empty())
+  {
+    const size_t index = ready.back();
+    ready.pop_back();
+    order.push_back(index);
+
+    for (auto it = nodes[index].outputs.rbegin(); it != nodes[index].outputs.rend(); ++it)
+    {
+      if (it->destination != kMasterNode && --remaining[it->destination] == 0)
+        ready.push_back(it->destination);
+    }
+  }
+
+  if (order.size() != nodes.size())
+  {
+    throw std::logic_error("RenderPlan: Routing has a cycle");
+  }
+
+  // Latest arrival at each destination, then the delay that brings every path in line with it
+  uint64_t master_target = 0;
+  for (const size_t index : order)
+  {
+    Node &node = nodes[index];
+    node.arrival = node.target + node.latency;
+    for (const auto &edge : node.outputs)
+    {
+      uint64_t &target = edge.destination == kMasterNode ? master_target : nodes[edge.destination].target;
+      target = std::max(target, node.arrival);
+    }
+  }
+
+  for (auto &node : nodes)
+  {
+    uint64_t shared = std::numeric_limits<uint64_t>::max();
+    for (auto &edge : node.outputs)
+    {
+      const uint64_t target = edge.destination == kMasterNode ? master_target : nodes[edge.destination].target;
+      edge.delay = static_cast<unsigned int>(target - node.arrival);
+      shared = std::min<uint64_t>(shared, edge.delay);
+    }
+
+    node.delay = node.outputs.empty() ? 0 : static_cast<unsigned int>(shared);
+    for (auto &edge : node.outputs)
+    {
+      edge.delay -= node.delay;
+    }
+  }
+
+  // Walk the order once. A node's slot is taken when it or its first input
+  // runs and returned once its output has been mixed onward.
+  auto plan = std::unique_ptr<RenderPlan>(new RenderPlan());
+  plan->m_latency = static_cast<unsigned int>(master_target);
+
+  auto add_line = [&](const unsigned int delay) -> uint16_t
+  {
+    plan->m_lines.emplace_back(spec.channels, delay, spec.max_frames, spec.resource);
+    return static_cast<uint16_t>(plan->m_lines.size() - 1);
+  };
+
+  std::vector<uint16_t> slot_of(nodes.size(), kMasterSlot);
+  std::vector<uint16_t> free_slots;
+  uint16_t slot_count = 0;
+
+  auto acquire = [&]() -> uint16_t
+  {
+    if (free_slots.empty())
+      return slot_count++;
+
+    const uint16_t slot = free_slots.back();
+    free_slots.pop_back();
+    return slot;
+  };
+
+  for (const size_t index : order)
+  {
+    const Node &node = nodes[index];
+
+    if (slot_of[index] == kMasterSlot)
+    {
+      slot_of[index] = acquire();
+      if (node.bus)
+        plan->m_steps.push_back(RenderStep{eRenderOp::Clear, eMixGain::Unity, 0, slot_of[index], 0, 0, nullptr,
+                                           nullptr});
+    }
+
+    const uint16_t slot = slot_of[index];
+    if (node.track)
+      plan->m_steps.push_back(RenderStep{eRenderOp::RenderTrack, eMixGain::Unity, static_cast<uint16_t>(index), slot,
+                                         0, 0, node.track, nullptr});
+    else
+      plan->m_steps.push_back(RenderStep{eRenderOp::ProcessBus, eMixGain::Unity, 0, slot, 0, 0, nullptr, node.bus});
+
+    if (node.delay > 0)
+      plan->m_steps.push_back(RenderStep{eRenderOp::Delay, eMixGain::Unity, 0, slot, 0, add_line(node.delay),
+                                         nullptr, nullptr});
+
+    for (const auto &edge : node.outputs)
+    {
+      uint16_t destination = kMasterSlot;
+      if (edge.destination != kMasterNode)
+      {
+        if (slot_of[edge.destination] == kMasterSlot)
+        {
+          slot_of[edge.destination] = acquire();
+          plan->m_steps.push_back(RenderStep{eRenderOp::Clear, eMixGain::Unity, 0, slot_of[edge.destination], 0, 0,
+                                             nullptr, nullptr});
+        }
+        destination = slot_of[edge.destination];
+      }
+
+      if (edge.delay > 0)
+        plan->m_steps.push_back(RenderStep{eRenderOp::DelayMix, edge.gain, slot, destination, edge.send,
+                                           add_line(edge.delay), node.track, node.bus});
+      else
+        plan->m_steps.push_back(RenderStep{eRenderOp::Mix, edge.gain, slot, destination, edge.send, 0, node.track,
+                                           node.bus});
+    }
+
+    free_slots.push_back(slot);
+  }
+
+  plan->m_channels = spec.channels;
+  plan->p_kernels = &Kernels::select_kernels(spec.channels);
+  for (uint16_t i = 0; i < slot_count; ++i)
+  {
+    plan->m_slots.emplace_back(spec.channels, spec.max_frames, spec.resource);
+  }
+  plan->m_silent.assign(slot_count, true);
+
+  plan->m_tracks = tracks;
+  plan->m_buses = buses;
+  for (const auto &node : nodes)
+  {
+    plan->m_node_latencies.push_back(node.latency);
+  }
+
+  return plan;
+}
+
+/** @brief Compile the routing of the tracks in a slot map, which mute and solo them while the plan runs.
+ *  The map must outlive the plan.
+ *  @param tracks The tracks, rendered in the map's order
+ *  @param buses The send buses, indexed by track send index
+ *  @param spec The stream the scratch slots are allocated for
+ *  @return The compiled plan
+ */
+std::unique_ptr<RenderPlan> RenderPlan::compile(const TrackSlotMap &tracks,
+                                                const std::vector<std::shared_ptr<Bus>> &buses,
+                                                const Dsp::ProcessSpec &spec)
+{
+  auto plan = compile(tracks.get_tracks(), buses, spec);
+  plan->p_track_slots = &tracks;
+  plan->m_track_slots = tracks.get_slots();
+  plan->m_audible.assign(tracks.size(), true);
+  return plan;
+}
+
+/** @brief Whether the tracks and buses still have the latencies the plan was compiled for.
+ *  Inserting, removing or bypassing an effect with latency makes the plan stale.
+ */
+bool RenderPlan::is_latency_current() const
+{
+  for (size_t t = 0; t < m_tracks.size(); ++t)
+  {
+    if (m_tracks[t]->get_latency() != m_node_latencies[t])
+      return false;
+  }
+
+  for (size_t b = 0; b < m_buses.size(); ++b)
+  {
+    if (m_buses[b]->get_latency() != m_node_latencies[m_tracks.size() + b])
+      return false;
+  }
+
+  return true;
+}
+
+/** @brief Run every step in order, summing into the master bus. Audio thread only.
+ *  @param master The master bus
+ *  @param transport Transport state for the chunk
+ *  @param n_frames Number of frames to render, at most the prepared max_frames
+ *  @return The number of tracks that rendered signal
+ */
+unsigned int RenderPlan::run(AudioBuffer &master, const Audio::TransportState &transport,
+                             const unsigned int n_frames) const noexcept
+{
+  if (master.get_channels() != m_channels)
+    return 0;
+
+  const unsigned int channels = m_channels;
+  unsigned int active_tracks = 0;
+
+  if (p_track_slots)
+  {
+    for (size_t t = 0; t < m_track_slots.size(); ++t)
+    {
+      m_audible[t] = p_track_slots->is_audible(m_track_slots[t]);
+    }
+  }
+
+  for (const RenderStep &step : m_steps)
+  {
+    switch (step.op)
+    {
+      case eRenderOp::Clear:
+        m_slots[step.destination].clear(n_frames);
+        m_silent[step.destination] = true;
+        break;
+
+      case eRenderOp::RenderTrack:
+        if (p_track_slots && !m_audible[step.source])
+        {
+          m_silent[step.destination] = step.track->render_muted(m_slots[step.destination], n_frames);
+          break;
+        }
+
+        m_silent[step.destination] = step.track->render(m_slots[step.destination], transport, n_frames);
+        active_tracks += !m_silent[step.destination];
+        break;
+
+      case eRenderOp::ProcessBus:
+        m_silent[step.destination] = step.bus->process(m_slots[step.destination], n_frames,
+                                                       m_silent[step.destination]);
+        break;
+
+      case eRenderOp::Delay:
+        m_silent[step.destination] = m_lines[step.line].process(m_slots[step.destination], n_frames,
+                                                                m_silent[step.destination]);
+        break;
+
+      case eRenderOp::Mix:
+      case eRenderOp::DelayMix:
+      {
+        float gain = 1.0f;
+        if (step.gain == eMixGain::Send)
+          gain = step.track->get_send_level_unchecked(step.send);
+        else if (step.gain == eMixGain::Return)
+          gain = step.bus->get_return_level();
+
+        AudioBuffer &destination = step.destination == kMasterSlot ? master : m_slots[step.destination];
+        const bool silent = m_silent[step.source];
+
+        // A delayed mix keeps its line current while the gain is 0
+        if (step.op == eRenderOp::DelayMix)
+        {
+          const bool delayed_silent = m_lines[step.line].mix(m_slots[step.source], destination, gain, n_frames, silent);
+          if (!delayed_silent && gain != 0.0f && step.destination != kMasterSlot)
+            m_silent[step.destination] = false;
+          break;
+        }
+
+        if (gain == 0.0f || silent)
+          break;
+
+        p_kernels->mix(m_slots[step.source].get_channel_pointers(), destination.get_channel_pointers(), gain,
+                       channels, n_frames);
+        if (step.destination != kMasterSlot)
+          m_silent[step.destination] = false;
+        break;
+      }
+    }
+  }
+
+  return active_tracks;
+}
+
+/** @brief Scratch memory held by the plan's slots.
+ */
+size_t RenderPlan::get_scratch_bytes() const noexcept
+{
+  size_t bytes = 0;
+  for (const auto &slot : m_slots)
+  {
+    bytes += static_cast<size_t>(slot.get_channels()) * slot.get_frames() * sizeof(float);
+  }
+  for (const auto &line : m_lines)
+  {
+    bytes += line.get_bytes();
+  }
+  return bytes;
+}
@@ -1,16 +1,65 @@
 #include "track.h"
 
 #include "devicemanager.h"
+#include "audiostream.h"
 #include "wavfile.h"
 #include "midifile.h"
+#include "wavwriter.h"
 #include "audioengine.h"
+#include "audiokernels.h"
+#include "denormals.h"
+#include "parameterstore.h"
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
 #include <iostream>
 #include <stdexcept>
 #include <memory>
+#include <string>
+#include <unistd.h>
 
 using namespace Tracks;
 
+namespace
+{
+
+uint64_t thread_cpu_ns() noexcept
+{
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+}
+
+// Numbers the freeze files of this process
+std::atomic<unsigned int> s_freeze_count{0};
+
+}  // namespace
+
+/** @brief Track constructor
+ */
+Track::Track():
+  m_midi_events(kMidiQueueCapacity),
+  m_midi_received(0),
+  m_midi_dropped(0),
+  m_midi_drained(0),
+  m_midi_largest_batch(0),
+  p_meter(std::make_shared<Dsp::MeterTap>("Track")),
+  m_freeze_statistics{}
+{
+  for (auto &level : m_send_levels)
+  {
+    level.store(0.0f, std::memory_order_relaxed);
+  }
+}
+
+/** @brief Track destructor, deletes the render of a frozen track.
+ */
+Track::~Track()
+{
+  unfreeze_locked();
+}
+
 /** @brief Adds an audio input to the track.
  *  @param device_id The ID of the audio input device. Defaults to 0 (the default input device).
  */
@@ -55,7 +104,8 @@ void Track::add_audio_file_input(const std::shared_ptr<Files::WavFile> &wav_file
            ", Channels: ", wav_file->get_channels(),
            ", Format: ", wav_file->get_format());
 
-  Audio::AudioEngine::instance().set_stream_parameters(wav_file->get_channels(), wav_file->get_sample_rate(), 512);
+  auto &engine = Audio::AudioEngine::instance();
+  engine.set_stream_parameters(wav_file->get_channels(), wav_file->get_sample_rate(), engine.get_buffer_frames());
 }
 
 /** @brief Adds a MIDI file input to the track.
@@ -97,12 +147,17 @@ void Track::stop()
 
 /** @brief Updates the track with a new MIDI message.
  *  This function is called by the MidiEngine when a new MIDI message is received.
- *  @param message The MIDI message to process.
+ *  Lock-free, the only producer of the track's MIDI queue. A message that does not fit is dropped and counted.
+ *  @param message The MIDI message to queue.
  */
 void Track::update(const Midi::MidiMessage& message)
 {
-  std::lock_guard<std::mutex> lock(m_queue_mutex);
-  m_message_queue.push(message);
+  const Midi::MidiEvent event{message.deltatime, message.status, message.type, message.channel, message.data1,
+                              message.data2};
+
+  m_midi_received.fetch_add(1, std::memory_order_relaxed);
+  if (m_midi_events.write(&event, 1) == 0)
+    m_midi_dropped.fetch_add(1, std::memory_order_relaxed);
 }
 
 /** @brief Updates the track with a new audio message.
@@ -114,50 +169,445 @@ void Track::update(const Audio::AudioMessage &message)
   (void)message;
 }
 
-/** @brief Handles a MIDI message.
- *  This function processes the MIDI message received from the MidiEngine.
- *  @param message The MIDI message to handle.
+/** @brief Take every pending MIDI event, up to max_events, oldest first.
+ *  Consumer only, one thread at a time. Lock-free and allocation-free, so it
+ *  may be called once per block from the audio thread.
+ *  @param events Where the events are copied
+ *  @param max_events Room in events, kMidiQueueCapacity takes everything
+ *  @return The number of events taken
+ */
+size_t Track::drain_midi_events(Midi::MidiEvent *events, const size_t max_events) noexcept
+{
+  const size_t count = m_midi_events.read(events, max_events);
+  if (count == 0)
+    return 0;
+
+  m_midi_drained.fetch_add(count, std::memory_order_relaxed);
+  if (count > m_midi_largest_batch.load(std::memory_order_relaxed))
+    m_midi_largest_batch.store(count, std::memory_order_relaxed);
+
+  return count;
+}
+
+/** @brief Handles the pending MIDI messages.
+ *  Drains everything the MidiEngine has queued since the last call, so one
+ *  call keeps up with any burst the queue can hold. Takes the consumer side
+ *  of the queue, see drain_midi_events().
+ *  @return The number of messages handled
+ */
+size_t Track::handle_midi_messages()
+{
+  std::array<Midi::MidiEvent, 64> events;
+  size_t handled = 0;
+
+  size_t count;
+  while ((count = drain_midi_events(events.data(), events.size())) > 0)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      const Midi::MidiEvent &event = events[i];
+      switch (event.type)
+      {
+        case Midi::eMidiMessageType::NoteOn:
+          LOG_INFO("Track: Note On - Channel: ", static_cast<int>(event.channel),
+                   ", Note: ", static_cast<int>(event.data1),
+                   ", Velocity: ", static_cast<int>(event.data2));
+          break;
+        case Midi::eMidiMessageType::NoteOff:
+          LOG_INFO("Track: Note Off - Channel: ", static_cast<int>(event.channel),
+                   ", Note: ", static_cast<int>(event.data1));
+          break;
+        case Midi::eMidiMessageType::ControlChange:
+          LOG_INFO("Track: Control Change - Channel: ", static_cast<int>(event.channel),
+                   ", Controller: ", static_cast<int>(event.data1),
+                   ", Value: ", static_cast<int>(event.data2));
+          break;
+        default:
+        {
+          auto it = Midi::midi_message_type_names.find(event.type);
+          LOG_INFO("Track: Unknown MIDI Message Type - ",
+                   it != Midi::midi_message_type_names.end() ? it->second : "Unknown MIDI Message");
+          break;
+        }
+      }
+    }
+    handled += count;
+  }
+
+  return handled;
+}
+
+/** @brief Counters of the MIDI input queue. Safe from any thread.
+ */
+MidiQueueStatistics Track::get_midi_statistics() const noexcept
+{
+  MidiQueueStatistics statistics;
+  statistics.received = m_midi_received.load(std::memory_order_relaxed);
+  statistics.dropped = m_midi_dropped.load(std::memory_order_relaxed);
+  statistics.drained = m_midi_drained.load(std::memory_order_relaxed);
+  statistics.largest_batch = m_midi_largest_batch.load(std::memory_order_relaxed);
+  statistics.pending = m_midi_events.get_read_available();
+  statistics.capacity = m_midi_events.get_capacity();
+  return statistics;
+}
+
+/** @brief Prepare the effect chain, fader and meter for a stream.
+ *  Must not be called while the track can be rendered.
+ *  @param spec The stream configuration
+ */
+void Track::prepare(const Dsp::ProcessSpec &spec)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_freeze_mutex);
+    if (p_frozen && p_frozen->get_sample_rate() != static_cast<unsigned int>(spec.sample_rate))
+    {
+      LOG_INFO("Track: Sample rate changed, unfreezing");
+      unfreeze_locked();
+    }
+  }
+
+  m_effect_chain.prepare(spec);
+  m_fader.prepare(spec);
+  p_meter->prepare(spec);
+}
+
+/** @brief Render the next block of the track. Audio thread only.
+ *  @param output Buffer to render into, overwritten. The render plan passes a shared scratch slot.
+ *  @param transport Transport state for the block, clips play while it is playing
+ *  @param n_frames Number of frames to render, at most the prepared max_frames
+ *  @return Whether the block is silent, so it need not be mixed. A silent block is zeros and is not faded.
+ */
+bool Track::render(AudioBuffer &output, const Audio::TransportState &transport, const unsigned int n_frames) noexcept
+{
+  bool silent;
+  if (p_frozen)
+  {
+    output.clear(n_frames);
+    silent = !transport.playing || p_frozen->mix(output, 0, transport.position, n_frames, 1.0f) == 0 ||
+             Kernels::is_silent(output.get_channel_pointers(), output.get_channels(), n_frames);
+  }
+  else
+  {
+    silent = render_live(output, transport, n_frames);
+  }
+
+  if (silent)
+  {
+    output.clear(n_frames);
+    p_meter->push_silence(n_frames);
+    return true;
+  }
+
+  m_fader.process(output, n_frames);
+  p_meter->push(output, n_frames);
+  return false;
+}
+
+/** @brief Stand in for render() while the track is muted. Audio thread only.
+ *  Nothing is rendered, so the effects hold their state, and the meter falls as it does for silence.
+ *  @return True, the block is silent
+ */
+bool Track::render_muted(AudioBuffer &output, const unsigned int n_frames) noexcept
+{
+  output.clear(n_frames);
+  p_meter->push_silence(n_frames);
+  return true;
+}
+
+/** @brief Render the clips through the insert effects, the part of the track a freeze replaces.
+ *  Blocks under no clip are silent without being scanned, and the effects stop once their tails end.
+ *  @return Whether the block is silent
+ */
+bool Track::render_live(AudioBuffer &output, const Audio::TransportState &transport, const unsigned int n_frames) noexcept
+{
+  output.clear(n_frames);
+
+  bool silent = true;
+  if (transport.playing && render_clips(output, transport.position, n_frames))
+    silent = Kernels::is_silent(output.get_channel_pointers(), output.get_channels(), n_frames);
+
+  return m_effect_chain.process(output, n_frames, silent);
+}
+
+/** @brief Sum the audio clips overlapping the block into the track buffer.
+ *  Only the clips under the playhead are visited, however long the arrangement.
+ *  MIDI clips are indexed but produce no audio until the track hosts an instrument.
+ *  @return Whether any audio clip overlapped the block
  */
-void Track::handle_midi_message()
+bool Track::render_clips(AudioBuffer &output, const uint64_t position, const unsigned int n_frames) noexcept
 {
-  Midi::MidiMessage message;
+  auto index = m_timeline.read();
+  if (!index)
+    return false;
+
+  bool mixed = false;
+  const uint64_t block_end = position + n_frames;
+  const unsigned int channels = output.get_channels();
+
+  index->for_each_overlapping(position, block_end, [&](const Clip &clip)
   {
-    std::lock_guard<std::mutex> lock(m_queue_mutex);
-    if (m_message_queue.empty())
+    if (clip.type != eClipType::Audio)
       return;
-  
-    message = m_message_queue.front();
-    m_message_queue.pop();
-  }
-
-  // Process the MIDI message here
-  switch (message.type)
-  {
-    case Midi::eMidiMessageType::NoteOn:
-      LOG_INFO("Track: Note On - Channel: ", static_cast<int>(message.channel),
-               ", Note: ", static_cast<int>(message.data1),
-               ", Velocity: ", static_cast<int>(message.data2));
-      break;
-    case Midi::eMidiMessageType::NoteOff:
-      LOG_INFO("Track: Note Off - Channel: ", static_cast<int>(message.channel),
-               ", Note: ", static_cast<int>(message.data1));
-      break;
-    case Midi::eMidiMessageType::ControlChange:
-      LOG_INFO("Track: Control Change - Channel: ", static_cast<int>(message.channel),
-               ", Controller: ", static_cast<int>(message.data1),
-               ", Value: ", static_cast<int>(message.data2));
-      break;
-    default:
-      LOG_INFO("Track: Unknown MIDI Message Type - ", message.type_name);
-      break;
-  }
-}
-
-/** @brief Fill the audio output buffer with the next available data
+
+    mixed = true;
+    const uint64_t begin = std::max(position, clip.start);
+    const uint64_t end = std::min(block_end, clip.get_end());
+    const unsigned int frames = static_cast<unsigned int>(end - begin);
+    const unsigned int destination = static_cast<unsigned int>(begin - position);
+    const uint64_t source = clip.offset + (begin - clip.start);
+    const float gain = clip.gain;
+
+    if (!clip.audio)
+    {
+      clip.stream->mix(output, destination, source, frames, gain);
+      return;
+    }
+
+    const unsigned int source_channels = clip.audio->get_channels();
+
+    // Mono sources feed every channel, wider sources wrap onto the track's channels
+    for (unsigned int ch = 0; ch < channels; ++ch)
+    {
+      const float *__restrict in = clip.audio->get_channel(ch % source_channels) + source;
+      float *__restrict out = output.get_channel(ch) + destination;
+      for (unsigned int frame = 0; frame < frames; ++frame)
+        out[frame] += gain * in[frame];
+    }
+  });
+
+  return mixed;
+}
+
+/** @brief Render the clips and insert effects to a file and play that instead.
+ *
+ *  The track is rendered from the start of the timeline to the end of its last
+ *  clip, faster than real time, at the sample rate and channel count it was
+ *  prepared for. From then on the render is streamed from disk, so the clips
+ *  and effects cost nothing on the audio thread. The fader, meter and sends
+ *  stay live. Edits to the clips and effects are not heard until the track is
+ *  unfrozen, and automation of the effects is baked into the render. The
+ *  effects' latency is taken out of the render, so a frozen track has none.
+ *
+ *  Must not be called while the track can be rendered, see TrackManager::freeze_track().
+ *  @param options Where the render is written and how long its tail is
+ *  @throws std::logic_error if the track is already frozen, unprepared or empty
+ *  @throws std::runtime_error if the render cannot be written or read back
+ */
+void Track::freeze(const FreezeOptions &options)
+{
+  std::lock_guard<std::mutex> lock(m_freeze_mutex);
+
+  if (p_frozen)
+  {
+    throw std::logic_error("Track: Already frozen");
+  }
+
+  const Dsp::ProcessSpec spec = m_fader.get_spec();
+  if (spec.channels == 0 || spec.sample_rate <= 0.0)
+  {
+    throw std::logic_error("Track: Cannot freeze before the track is prepared");
+  }
+
+  if (options.block_frames == 0)
+  {
+    throw std::invalid_argument("Track: Invalid freeze block size");
+  }
+
+  const uint64_t length = m_timeline.get_end() + options.tail_frames;
+  if (length == 0)
+  {
+    throw std::logic_error("Track: Nothing to freeze");
+  }
+
+  const std::filesystem::path directory = options.directory.empty()
+                                            ? std::filesystem::temp_directory_path()
+                                            : options.directory;
+  std::filesystem::create_directories(directory);
+  const std::filesystem::path path = directory / ("freeze-" + std::to_string(getpid()) + "-" +
+                                                  std::to_string(s_freeze_count.fetch_add(1)) + ".wav");
+
+  const unsigned int channels = spec.channels;
+  const unsigned int sample_rate = static_cast<unsigned int>(spec.sample_rate);
+  Dsp::ProcessSpec render_spec = spec;
+  render_spec.max_frames = options.block_frames;
+
+  uint64_t render_ns = 0;
+  const auto started = std::chrono::steady_clock::now();
+  std::shared_ptr<Files::AudioStream> stream;
+
+  try
+  {
+    // Latency can follow the block size, so it is read once prepared for the render
+    m_effect_chain.prepare(render_spec);
+    const unsigned int latency = m_effect_chain.get_latency();
+
+    {
+      Files::WavWriter writer(path, channels, sample_rate, Files::eWavSampleFormat::Float32);
+      AudioBuffer buffer(channels, options.block_frames);
+      std::vector<float> interleaved(static_cast<size_t>(options.block_frames) * channels);
+
+      Audio::TransportState transport{};
+      transport.playing = true;
+      transport.sample_rate = spec.sample_rate;
+
+      Dsp::ParameterStore &parameters = Dsp::ParameterStore::instance();
+      Dsp::ParameterStore::OfflineAutomation automation = parameters.capture_automation();
+
+      Files::OfflineScope offline;
+      DenormalScope denormal_scope;
+
+      // The first frames out of the effects are their latency, dropped so the render lines up with the timeline
+      while (transport.position < length + latency)
+      {
+        const unsigned int frames = static_cast<unsigned int>(std::min<uint64_t>(options.block_frames,
+                                                                                  length + latency - transport.position));
+        parameters.process_automation(transport.position, automation);
+
+        const uint64_t block_started = thread_cpu_ns();
+        if (render_live(buffer, transport, frames))
+          buffer.clear(frames);
+        render_ns += thread_cpu_ns() - block_started;
+
+        const unsigned int skip = static_cast<unsigned int>(std::min<uint64_t>(
+          frames, transport.position < latency ? latency - transport.position : 0));
+        if (skip < frames)
+        {
+          Kernels::interleave(buffer.get_channel_pointers(), interleaved.data(), channels, frames);
+          writer.write(interleaved.data() + static_cast<size_t>(skip) * channels, frames - skip);
+        }
+        transport.position += frames;
+      }
+
+      writer.close();
+    }
+
+    // The effects start from silence again when the track is unfrozen
+    m_effect_chain.prepare(spec);
+    stream = Files::AudioStream::open(path);
+  }
+  catch (...)
+  {
+    m_effect_chain.prepare(spec);
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    throw;
+  }
+
+  const double audio_seconds = static_cast<double>(length) / spec.sample_rate;
+
+  p_frozen = std::move(stream);
+  m_freeze_statistics = FreezeStatistics{};
+  m_freeze_statistics.frozen = true;
+  m_freeze_statistics.frames = length;
+  m_freeze_statistics.sample_rate = sample_rate;
+  m_freeze_statistics.render_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  m_freeze_statistics.realtime_factor = m_freeze_statistics.render_seconds > 0.0
+                                          ? audio_seconds / m_freeze_statistics.render_seconds
+                                          : 0.0;
+  m_freeze_statistics.live_load = static_cast<double>(render_ns) / 1e9 / audio_seconds;
+  m_freeze_statistics.filepath = path;
+
+  LOG_INFO("Track: Froze ", length, " frames to ", path.string(), " at ", m_freeze_statistics.realtime_factor,
+           "x real time");
+}
+
+/** @brief Samples the track output lags the timeline.
+ *  0 while frozen, since the render is written already lined up.
+ */
+unsigned int Track::get_latency() const
+{
+  std::lock_guard<std::mutex> lock(m_freeze_mutex);
+  return p_frozen ? 0 : m_effect_chain.get_latency();
+}
+
+/** @brief Go back to rendering the clips and effects live, and delete the render.
+ *  Must not be called while the track can be rendered, see TrackManager::unfreeze_track().
+ */
+void Track::unfreeze()
+{
+  std::lock_guard<std::mutex> lock(m_freeze_mutex);
+  unfreeze_locked();
+}
+
+void Track::unfreeze_locked()
+{
+  if (!p_frozen)
+    return;
+
+  const std::filesystem::path path = p_frozen->get_filepath();
+  p_frozen.reset();
+  m_freeze_statistics = FreezeStatistics{};
+
+  std::error_code error;
+  std::filesystem::remove(path, error);
+
+  LOG_INFO("Track: Unfroze, removed ", path.string());
+}
+
+/** @brief Whether the track plays a render in place of its clips and effects.
+ */
+bool Track::is_frozen() const
+{
+  std::lock_guard<std::mutex> lock(m_freeze_mutex);
+  return p_frozen != nullptr;
+}
+
+/** @brief The cost of the track live against the cost of streaming its render.
+ *  All zero while the track is not frozen.
+ */
+FreezeStatistics Track::get_freeze_statistics() const
+{
+  std::lock_guard<std::mutex> lock(m_freeze_mutex);
+
+  FreezeStatistics statistics = m_freeze_statistics;
+  if (p_frozen)
+  {
+    statistics.frozen_load = p_frozen->get_statistics().cpu_load;
+    statistics.reclaimed_load = std::max(0.0, statistics.live_load - statistics.frozen_load);
+  }
+
+  return statistics;
+}
+
+/** @brief Set how much of the track output is sent to a send bus.
+ *  @param bus_index The index of the send bus in the TrackManager.
+ *  @param level Linear send level, 0 to stop sending.
+ *  @throws std::out_of_range if the index is not below kMaxSends.
+ */
+void Track::set_send_level(const size_t bus_index, const float level)
+{
+  if (bus_index >= kMaxSends)
+  {
+    throw std::out_of_range("Send bus index out of range");
+  }
+
+  m_send_levels[bus_index].store(level, std::memory_order_relaxed);
+}
+
+/** @brief Get the send level for a send bus.
+ *  @throws std::out_of_range if the index is not below kMaxSends.
+ */
+float Track::get_send_level(const size_t bus_index) const
+{
+  if (bus_index >= kMaxSends)
+  {
+    throw std::out_of_range("Send bus index out of range");
+  }
+
+  return m_send_levels[bus_index].load(std::memory_order_relaxed);
+}
+
+/** @brief Fill the audio output buffer with the next available data.
+ *  Allocates a block buffer, so it is not for the audio thread.
  *  @param output_buffer Pointer to the output buffer where audio data will be written.
  *  @param n_frames Number of frames to fill in the output buffer.
  */
 void Track::get_next_audio_frame(float *output_buffer, unsigned int n_frames)
 {
-  
+  const Dsp::ProcessSpec &spec = m_fader.get_spec();
+  const unsigned int frames = std::min(n_frames, spec.max_frames);
+
+  AudioBuffer buffer(spec.channels, frames);
+  render(buffer, Audio::AudioEngine::instance().get_transport().get_state(), frames);
+  Kernels::interleave(buffer.get_channel_pointers(), output_buffer, buffer.get_channels(), frames);
 }
@@ -1,50 +1,408 @@
 #include "trackmanager.h"
+#include "filemanager.h"
+#include "wavfile.h"
+#include "convolutionreverb.h"
+#include "meteranalyzer.h"
+#include "parameterstore.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
 
 using namespace Tracks;
 
-/** @brief Add a Track to the TrackManager.
- *  @return The index of the newly added track.
+/** @brief TrackManager constructor
+ *  Registers the TrackManager as the source of the AudioEngine master bus,
+ *  and the master meter with the MeterAnalyzer. The ParameterStore is created
+ *  first so it outlives the track parameters.
+ */
+TrackManager::TrackManager():
+  p_master_meter(std::make_shared<Dsp::MeterTap>("Master")),
+  m_active_tracks(0),
+  m_latency(0)
+{
+  Dsp::ParameterStore::instance();
+  Dsp::MeterAnalyzer::instance().add_tap(p_master_meter);
+  Audio::AudioEngine::instance().set_renderer(this);
+}
+
+/** @brief TrackManager destructor
  */
-size_t TrackManager::add_track()
+TrackManager::~TrackManager()
 {
+  Audio::AudioEngine::instance().set_renderer(nullptr);
+}
+
+/** @brief Add a Track to the TrackManager, at the end of the render order.
+ *  @return The handle of the newly added track.
+ *  @throws std::length_error if TrackSlotMap::kMaxTracks tracks already exist.
+ */
+TrackHandle TrackManager::add_track()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
   auto new_track = std::make_shared<Track>();
-  m_tracks.push_back(new_track);
-  return m_tracks.size() - 1; // Return the index of the newly added track
+  if (m_spec)
+  {
+    new_track->prepare(*m_spec);
+  }
+
+  const TrackHandle handle = m_tracks.insert(new_track);
+  publish_locked();
+
+  Dsp::MeterAnalyzer::instance().add_tap(new_track->get_meter());
+
+  return handle;
+}
+
+/** @brief Remove a Track from the TrackManager. The handles of the other tracks stay valid.
+ *  @param handle The handle of the track to remove.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+void TrackManager::remove_track(const TrackHandle handle)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const std::shared_ptr<Track> track = m_tracks.get(handle);
+  Dsp::MeterAnalyzer::instance().remove_tap(track->get_meter());
+
+  m_tracks.erase(handle);
+  publish_locked();
+}
+
+/** @brief Get a Track from the TrackManager by handle.
+ *  @param handle The handle of the track to retrieve.
+ *  @return A shared pointer to the Track.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+std::shared_ptr<Track> TrackManager::get_track(const TrackHandle handle)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tracks.get(handle);
+}
+
+/** @brief Whether a handle names a track that has not been removed.
+ */
+bool TrackManager::contains_track(const TrackHandle handle) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tracks.contains(handle);
 }
 
-/** @brief Remove a Track from the TrackManager by index.
- *  @param index The index of the track to remove.
+/** @brief Handle of the track at a position in the render order, as listed to the user.
  *  @throws std::out_of_range if the index is invalid.
  */
-void TrackManager::remove_track(size_t index)
+TrackHandle TrackManager::get_track_handle(size_t index) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tracks.get_handle(index);
+}
+
+/** @brief Position of a track in the render order. It moves up as earlier tracks are removed.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+size_t TrackManager::get_track_index(const TrackHandle handle) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tracks.get_position(handle);
+}
+
+/** @brief Clear all tracks from the TrackManager.
+ *  Every handle handed out so far becomes invalid.
+ */
+void TrackManager::clear_tracks()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (const auto &track : m_tracks.get_tracks())
+  {
+    Dsp::MeterAnalyzer::instance().remove_tap(track->get_meter());
+  }
+
+  m_tracks.clear();
+  publish_locked();
+}
+
+/** @brief Mute or unmute a track. Takes effect from the next block without recompiling the plan.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+void TrackManager::set_track_mute(const TrackHandle handle, const bool mute)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_tracks.set_mute(handle, mute);
+}
+
+bool TrackManager::is_track_muted(const TrackHandle handle) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tracks.is_muted(handle);
+}
+
+/** @brief Solo a track or take it out of solo. While any track is soloed, only soloed tracks are heard.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+void TrackManager::set_track_solo(const TrackHandle handle, const bool solo)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_tracks.set_solo(handle, solo);
+}
+
+bool TrackManager::is_track_soloed(const TrackHandle handle) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tracks.is_soloed(handle);
+}
+
+/** @brief Add a send bus that tracks can feed with Track::set_send_level().
+ *  @param name Display name of the bus
+ *  @return The index of the new bus, used as the track send index.
+ *  @throws std::length_error if Track::kMaxSends buses already exist.
+ */
+size_t TrackManager::add_send_bus(const std::string &name)
 {
-  if (index >= m_tracks.size())
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_buses.size() >= Track::kMaxSends)
   {
-    throw std::out_of_range("Track index out of range");
+    throw std::length_error("Too many send buses");
   }
 
-  m_tracks.erase(m_tracks.begin() + index);
+  auto bus = std::make_shared<Bus>(name);
+  if (m_spec)
+  {
+    bus->prepare(*m_spec);
+  }
+
+  m_buses.push_back(bus);
+  publish_locked();
+
+  return m_buses.size() - 1;
+}
+
+/** @brief Add a send bus with a convolution reverb.
+ *  @param impulse_response Path to a WAV file holding the impulse response
+ *  @return The index of the new bus
+ */
+size_t TrackManager::add_reverb_bus(const std::filesystem::path &impulse_response)
+{
+  auto wav_file = Files::FileManager::instance().read_wav_file(impulse_response);
+
+  const unsigned int frames = static_cast<unsigned int>(wav_file->get_frames());
+  AudioBuffer buffer(wav_file->get_channels(), frames);
+  const unsigned int frames_read = wav_file->read(buffer, frames);
+
+  auto reverb = std::make_shared<Dsp::ConvolutionReverb>();
+  reverb->set_impulse_response(buffer, frames_read, wav_file->get_sample_rate());
+
+  const size_t index = add_send_bus("Reverb");
+  get_send_bus(index)->get_effect_chain().add(reverb);
+
+  LOG_INFO("TrackManager: Added reverb bus with impulse response: ", wav_file->get_filename(),
+           ", length: ", frames_read, " frames");
+
+  return index;
 }
 
-/** @brief Get a Track from the TrackManager by index.
- *  @param index The index of the track to retrieve.
- *  @return A shared pointer to the Track at the specified index.
+/** @brief Get a send bus by index.
  *  @throws std::out_of_range if the index is invalid.
  */
-std::shared_ptr<Track> TrackManager::get_track(size_t index)
+std::shared_ptr<Bus> TrackManager::get_send_bus(size_t index)
 {
-  if (index >= m_tracks.size())
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (index >= m_buses.size())
   {
-    throw std::out_of_range("Track index out of range");
+    throw std::out_of_range("Send bus index out of range");
   }
 
-  return m_tracks[index];
+  return m_buses[index];
 }
 
-/** @brief Clear all tracks from the TrackManager.
- *  This function removes all tracks from the internal vector, effectively resetting the TrackManager.
+/** @brief Remove every send bus.
  */
-void TrackManager::clear_tracks()
+void TrackManager::clear_send_buses()
 {
-  m_tracks.clear();
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_buses.clear();
+  publish_locked();
+}
+
+/** @brief Prepare every track for a new stream configuration.
+ *  Called by the AudioEngine while the audio callback cannot run.
+ */
+void TrackManager::prepare(const unsigned int channels, const unsigned int sample_rate,
+                           const unsigned int max_frames, std::pmr::memory_resource *resource)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_spec = Dsp::ProcessSpec{static_cast<double>(sample_rate), channels, max_frames, resource};
+
+  prepare_locked();
+  publish_locked();
+}
+
+/** @brief Render the session to a WAV file on every core. See bounce_session().
+ *  The tracks are taken off the audio thread while the bounce runs, so live
+ *  output is silent, and edits and stream changes wait until it has finished.
+ *  Muted tracks, and tracks left out by a solo, are left out of the file.
+ *  @param path The WAV file to write
+ *  @param options Format, range and thread count. The progress callback must not call the TrackManager, except get_latency().
+ *  @return The frames written and the time taken
+ */
+BounceResult TrackManager::bounce(const std::filesystem::path &path, const BounceOptions &options)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  retire_plan_locked();
+
+  BounceResult result;
+  try
+  {
+    result = bounce_session(m_tracks.get_audible_tracks(), m_buses, path, options);
+  }
+  catch (...)
+  {
+    prepare_locked();
+    publish_locked();
+    throw;
+  }
+
+  prepare_locked();
+  publish_locked();
+
+  return result;
+}
+
+/** @brief Freeze a track to a render of its clips and effects. See Track::freeze().
+ *  The tracks are taken off the audio thread while the track renders, so live
+ *  output is silent until it has finished.
+ *  @param handle The track to freeze
+ *  @param options Where the render is written and how long its tail is
+ *  @return What the freeze cost and the load it reclaimed
+ *  @throws std::out_of_range if the handle names no track
+ */
+FreezeStatistics TrackManager::freeze_track(const TrackHandle handle, const FreezeOptions &options)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const std::shared_ptr<Track> track = m_tracks.get(handle);
+
+  retire_plan_locked();
+  try
+  {
+    track->freeze(options);
+  }
+  catch (...)
+  {
+    publish_locked();
+    throw;
+  }
+  publish_locked();
+
+  return track->get_freeze_statistics();
+}
+
+/** @brief Unfreeze a track, so its clips and effects render live again.
+ *  @throws std::out_of_range if the handle names no track
+ */
+void TrackManager::unfreeze_track(const TrackHandle handle)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const std::shared_ptr<Track> track = m_tracks.get(handle);
+
+  retire_plan_locked();
+  track->unfreeze();
+  publish_locked();
+}
+
+/** @brief Recompile the render plan if a track or bus latency has changed.
+ *  Call after inserting, removing or bypassing an effect with latency, so the
+ *  paths line up again at the master bus. Until then the affected path plays
+ *  early or late by the difference.
+ *  @return True if the plan was recompiled
+ */
+bool TrackManager::update_latency_compensation()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const RenderPlan *plan = m_plan.peek();
+  if (!plan || plan->is_latency_current())
+    return false;
+
+  publish_locked();
+  return true;
+}
+
+/** @brief Samples the master bus lags the timeline, the longest path's latency.
+ *  Lock-free, so polling it does not wait for a bounce or freeze. 0 while no plan is published.
+ */
+unsigned int TrackManager::get_latency() const
+{
+  return m_latency.load(std::memory_order_relaxed);
+}
+
+/** @brief Render every track and sum it into the master bus. Audio thread only.
+ *  @param bus The master bus
+ *  @param transport Transport state for the chunk, automation follows its position
+ *  @param n_frames Number of frames to render
+ */
+void TrackManager::render(AudioBuffer &bus, const Audio::TransportState &transport,
+                          const unsigned int n_frames) noexcept
+{
+  // While the plan is retired an offline render owns the parameters
+  auto plan = m_plan.read();
+  if (!plan)
+    return;
+
+  Dsp::ParameterStore::instance().process_automation(transport.position);
+  m_active_tracks.store(plan->run(bus, transport, n_frames), std::memory_order_relaxed);
+  p_master_meter->push(bus, n_frames);
+}
+
+/** @brief Take the render plan off the audio thread and wait until it has let go of it.
+ */
+void TrackManager::retire_plan_locked()
+{
+  m_plan.publish(nullptr);
+  m_latency.store(0, std::memory_order_relaxed);
+  while (m_plan.get_retired_count() > 0)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    m_plan.collect();
+  }
+}
+
+/** @brief Prepare every track and bus for the current stream, if there is one.
+ */
+void TrackManager::prepare_locked()
+{
+  if (!m_spec)
+    return;
+
+  for (const auto &track : m_tracks.get_tracks())
+  {
+    track->prepare(*m_spec);
+  }
+
+  for (auto &bus : m_buses)
+  {
+    bus->prepare(*m_spec);
+  }
+
+  p_master_meter->prepare(*m_spec);
+}
+
+/** @brief Compile the routing into a new render plan and hand it to the audio thread.
+ *  Nothing is published until a stream has been prepared.
+ */
+void TrackManager::publish_locked()
+{
+  if (!m_spec)
+    return;
+
+  auto plan = RenderPlan::compile(m_tracks, m_buses, *m_spec);
+  const unsigned int latency = plan->get_latency();
+  m_plan.publish(std::move(plan));
+  m_latency.store(latency, std::memory_order_relaxed);
 }
@@ -0,0 +1,188 @@
+#include "trackslots.h"
+#include "track.h"
+
+#include <stdexcept>
+
+using namespace Tracks;
+
+/** @brief TrackSlotMap constructor
+ *  Reserves the mute and solo flags of every slot up front so the audio thread never sees them move.
+ */
+TrackSlotMap::TrackSlotMap():
+  p_mute(std::make_unique<std::atomic<uint8_t>[]>(kMaxTracks)),
+  p_solo(std::make_unique<std::atomic<uint8_t>[]>(kMaxTracks)),
+  m_solo_count(0)
+{
+  for (size_t i = 0; i < kMaxTracks; ++i)
+  {
+    p_mute[i].store(false, std::memory_order_relaxed);
+    p_solo[i].store(false, std::memory_order_relaxed);
+  }
+}
+
+/** @brief Add a track at the end of the render order, unmuted and not soloed.
+ *  @param track The track to add
+ *  @return The track's handle, stable until it is erased
+ *  @throws std::length_error if kMaxTracks tracks already exist.
+ */
+TrackHandle TrackSlotMap::insert(std::shared_ptr<Track> track)
+{
+  if (m_tracks.size() >= kMaxTracks)
+  {
+    throw std::length_error("Too many tracks");
+  }
+
+  uint32_t slot;
+  if (m_free_slots.empty())
+  {
+    slot = static_cast<uint32_t>(m_generations.size());
+    m_generations.push_back(1);
+    m_position.push_back(kNoPosition);
+  }
+  else
+  {
+    slot = m_free_slots.back();
+    m_free_slots.pop_back();
+  }
+
+  p_mute[slot].store(false, std::memory_order_relaxed);
+  p_solo[slot].store(false, std::memory_order_relaxed);
+
+  m_position[slot] = static_cast<uint32_t>(m_tracks.size());
+  m_tracks.push_back(std::move(track));
+  m_slot_of.push_back(slot);
+
+  return TrackHandle{slot, m_generations[slot]};
+}
+
+/** @brief Remove a track. The tracks after it move up one place in the render order.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+void TrackSlotMap::erase(const TrackHandle handle)
+{
+  const uint32_t slot = check(handle);
+  const uint32_t position = m_position[slot];
+
+  if (p_solo[slot].exchange(false, std::memory_order_relaxed))
+    m_solo_count.fetch_sub(1, std::memory_order_relaxed);
+  p_mute[slot].store(false, std::memory_order_relaxed);
+
+  m_tracks.erase(m_tracks.begin() + position);
+  m_slot_of.erase(m_slot_of.begin() + position);
+  for (size_t i = position; i < m_slot_of.size(); ++i)
+  {
+    m_position[m_slot_of[i]] = static_cast<uint32_t>(i);
+  }
+
+  m_position[slot] = kNoPosition;
+  ++m_generations[slot];
+  m_free_slots.push_back(slot);
+}
+
+/** @brief Remove every track. Handles handed out so far all become stale.
+ */
+void TrackSlotMap::clear()
+{
+  while (!m_slot_of.empty())
+  {
+    const uint32_t slot = m_slot_of.back();
+    erase(TrackHandle{slot, m_generations[slot]});
+  }
+}
+
+/** @brief Whether the handle names a track that has not been removed.
+ */
+bool TrackSlotMap::contains(const TrackHandle handle) const noexcept
+{
+  return handle.index < m_generations.size() && m_generations[handle.index] == handle.generation &&
+         m_position[handle.index] != kNoPosition;
+}
+
+/** @brief The track a handle names.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+const std::shared_ptr<Track> &TrackSlotMap::get(const TrackHandle handle) const
+{
+  return m_tracks[m_position[check(handle)]];
+}
+
+/** @brief Handle of the track at a position in the render order.
+ *  @throws std::out_of_range if the position is past the last track.
+ */
+TrackHandle TrackSlotMap::get_handle(const size_t position) const
+{
+  if (position >= m_slot_of.size())
+  {
+    throw std::out_of_range("Track index out of range");
+  }
+
+  const uint32_t slot = m_slot_of[position];
+  return TrackHandle{slot, m_generations[slot]};
+}
+
+/** @brief Position of a track in the render order.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+size_t TrackSlotMap::get_position(const TrackHandle handle) const
+{
+  return m_position[check(handle)];
+}
+
+/** @brief Mute or unmute a track. A muted track is not rendered at all.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+void TrackSlotMap::set_mute(const TrackHandle handle, const bool mute)
+{
+  p_mute[check(handle)].store(mute, std::memory_order_relaxed);
+}
+
+bool TrackSlotMap::is_muted(const TrackHandle handle) const
+{
+  return p_mute[check(handle)].load(std::memory_order_relaxed);
+}
+
+/** @brief Solo a track or take it out of solo. While any track is soloed, only soloed tracks are heard.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+void TrackSlotMap::set_solo(const TrackHandle handle, const bool solo)
+{
+  const uint32_t slot = check(handle);
+  if (p_solo[slot].exchange(solo, std::memory_order_relaxed) == static_cast<uint8_t>(solo))
+    return;
+
+  if (solo)
+    m_solo_count.fetch_add(1, std::memory_order_relaxed);
+  else
+    m_solo_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool TrackSlotMap::is_soloed(const TrackHandle handle) const
+{
+  return p_solo[check(handle)].load(std::memory_order_relaxed);
+}
+
+/** @brief The tracks heard with the current mute and solo settings, in render order.
+ */
+std::vector<std::shared_ptr<Track>> TrackSlotMap::get_audible_tracks() const
+{
+  std::vector<std::shared_ptr<Track>> tracks;
+  for (size_t i = 0; i < m_tracks.size(); ++i)
+  {
+    if (is_audible(m_slot_of[i]))
+      tracks.push_back(m_tracks[i]);
+  }
+  return tracks;
+}
+
+/** @brief The slot a handle names.
+ *  @throws std::out_of_range if the handle names no track.
+ */
+uint32_t TrackSlotMap::check(const TrackHandle handle) const
+{
+  if (!contains(handle))
+  {
+    throw std::out_of_range("Track handle is not valid");
+  }
+
+  return handle.index;
+}
@@ -0,0 +1,66 @@
+#include "benchmark.h"
+#include "biquad.h"
+#include "bounce.h"
+#include "bus.h"
+#include "track.h"
+
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static constexpr unsigned int kBounceTracks = 32;
+static constexpr unsigned int kBounceSampleRate = 48000;
+static constexpr uint64_t kBounceSourceFrames = kBounceSampleRate * 10;
+static constexpr uint64_t kBounceSessionFrames = kBounceSampleRate * 60 * 10;
+
+/** @brief Offline bounce of a 10 minute, 32 track session with an EQ on every track, serial and on every core.
+ */
+BENCHMARK_CASE(Bounce)
+{
+  auto audio = std::make_shared<AudioBuffer>(1, static_cast<unsigned int>(kBounceSourceFrames));
+  for (unsigned int frame = 0; frame < kBounceSourceFrames; ++frame)
+    audio->get_channel(0)[frame] = 0.1f * std::sin(0.01f * static_cast<float>(frame));
+
+  std::vector<std::shared_ptr<Tracks::Track>> tracks;
+  for (unsigned int i = 0; i < kBounceTracks; ++i)
+  {
+    auto track = std::make_shared<Tracks::Track>();
+    track->get_effect_chain().add(std::make_shared<Dsp::Biquad>(Dsp::eBiquadType::Peak, 1000.0f, 1.0f, 3.0f));
+
+    std::vector<Tracks::Clip> clips;
+    for (uint64_t start = 0; start < kBounceSessionFrames; start += kBounceSourceFrames)
+    {
+      Tracks::Clip clip;
+      clip.start = start;
+      clip.length = kBounceSourceFrames;
+      clip.audio = audio;
+      clips.push_back(clip);
+    }
+    track->get_timeline().add_clips(std::move(clips));
+    track->set_send_level(0, 0.2f);
+    tracks.push_back(track);
+  }
+
+  std::vector<std::shared_ptr<Tracks::Bus>> buses{std::make_shared<Tracks::Bus>("Send")};
+
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "bench_bounce.wav";
+
+  auto run = [&](const unsigned int threads)
+  {
+    Tracks::BounceOptions options;
+    options.sample_rate = kBounceSampleRate;
+    options.threads = threads;
+    const Tracks::BounceResult result = Tracks::bounce_session(tracks, buses, path, options);
+
+    const std::string name = std::to_string(result.threads) + (result.threads == 1 ? " thread" : " threads");
+    Benchmark::report("10 min, 32 tracks, " + name, result.seconds, "s");
+    Benchmark::report("10 min, 32 tracks, " + name + " speed", result.realtime_factor, "x real time");
+  };
+
+  run(1);
+  run(std::thread::hardware_concurrency());
+
+  std::filesystem::remove(path);
+}
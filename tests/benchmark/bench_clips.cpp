@@ -0,0 +1,54 @@
+#include "benchmark.h"
+#include "cliptimeline.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+static constexpr unsigned int kClipBlockFrames = 256;
+static constexpr uint64_t kClipArrangementFrames = 48000ull * 60 * 10;
+
+/** @brief Per-block cost of finding the active clips, sparse against dense arrangements.
+ */
+BENCHMARK_CASE(ClipIndex)
+{
+  auto audio = std::make_shared<AudioBuffer>(1, 48000);
+
+  for (const size_t clip_count : {100, 1000, 50000})
+  {
+    // Clips of up to a second scattered over ten minutes
+    std::mt19937 random(1);
+    std::uniform_int_distribution<uint64_t> start(0, kClipArrangementFrames);
+    std::uniform_int_distribution<uint64_t> length(1, 48000);
+
+    std::vector<Tracks::Clip> clips(clip_count);
+    for (size_t i = 0; i < clip_count; ++i)
+    {
+      clips[i].id = static_cast<Tracks::ClipId>(i + 1);
+      clips[i].start = start(random);
+      clips[i].length = length(random);
+      clips[i].audio = audio;
+    }
+
+    Tracks::ClipIndex index(std::move(clips));
+
+    uint64_t position = 0;
+    size_t active = 0;
+    size_t blocks = 0;
+    const double ns = Benchmark::measure_ns([&]()
+    {
+      index.for_each_overlapping(position, position + kClipBlockFrames, [&active](const Tracks::Clip &clip)
+      {
+        active += clip.length > 0;
+      });
+      position = (position + kClipBlockFrames) % kClipArrangementFrames;
+      ++blocks;
+    }, 20000);
+    Benchmark::do_not_optimize(active);
+
+    const std::string label = std::to_string(clip_count) + " clips";
+    Benchmark::report(label + " query", ns, "ns/block");
+    Benchmark::report(label + " active", static_cast<double>(active) / static_cast<double>(blocks), "clips/block");
+  }
+}
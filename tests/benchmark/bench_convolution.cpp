@@ -0,0 +1,57 @@
+#include "benchmark.h"
+#include "audiobuffer.h"
+#include "convolutionreverb.h"
+
+#include <cmath>
+#include <string>
+
+static constexpr unsigned int kReverbBlockFrames = 256;
+static constexpr double kReverbSampleRate = 48000.0;
+
+/** @brief Partitioned convolution cost per block against impulse response length.
+ */
+BENCHMARK_CASE(ConvolutionReverb)
+{
+  const Dsp::ProcessSpec spec{kReverbSampleRate, 2, kReverbBlockFrames, std::pmr::get_default_resource()};
+  const double block_ns = kReverbBlockFrames / kReverbSampleRate * 1e9;
+
+  AudioBuffer source(2, kReverbBlockFrames);
+  AudioBuffer buffer(2, kReverbBlockFrames);
+  for (unsigned int ch = 0; ch < 2; ++ch)
+  {
+    for (unsigned int frame = 0; frame < kReverbBlockFrames; ++frame)
+      source.get_channel(ch)[frame] = 0.5f * std::sin(0.05f * static_cast<float>(frame));
+  }
+
+  for (const double seconds : {0.25, 0.5, 1.0, 2.0})
+  {
+    // Decaying noise stands in for a measured room
+    const unsigned int length = static_cast<unsigned int>(seconds * kReverbSampleRate);
+    AudioBuffer impulse(2, length);
+    unsigned int seed = 1;
+    for (unsigned int ch = 0; ch < 2; ++ch)
+    {
+      for (unsigned int frame = 0; frame < length; ++frame)
+      {
+        seed = seed * 1664525u + 1013904223u;
+        const float noise = static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) - 0.5f;
+        impulse.get_channel(ch)[frame] = noise * std::exp(-6.0f * frame / static_cast<float>(length));
+      }
+    }
+
+    Dsp::ConvolutionReverb reverb;
+    reverb.set_impulse_response(impulse, length, kReverbSampleRate);
+    reverb.prepare(spec);
+
+    const double ns = Benchmark::measure_ns([&]()
+    {
+      buffer.copy_from(source, kReverbBlockFrames);
+      reverb.process(buffer, kReverbBlockFrames);
+      Benchmark::do_not_optimize(buffer.get_channel(0)[0]);
+    }, 500);
+
+    const std::string name = "stereo IR " + std::to_string(static_cast<int>(seconds * 1000)) + " ms";
+    Benchmark::report(name, ns, "ns/block");
+    Benchmark::report(name + " DSP load", 100.0 * ns / block_ns, "%");
+  }
+}
@@ -0,0 +1,67 @@
+#include "benchmark.h"
+#include "audiobuffer.h"
+#include "biquad.h"
+#include "denormals.h"
+
+#include <cmath>
+#include <limits>
+
+static constexpr unsigned int kDenormalBlockFrames = 512;
+static constexpr double kDenormalSampleRate = 48000.0;
+
+/** @brief Worst case of a feedback filter decaying into denormals, with and without flush to zero.
+ *  The input stays in the denormal range, as at the end of a reverb or delay tail.
+ */
+BENCHMARK_CASE(Denormals)
+{
+  const Dsp::ProcessSpec spec{kDenormalSampleRate, 2, kDenormalBlockFrames, std::pmr::get_default_resource()};
+  const double block_ns = kDenormalBlockFrames / kDenormalSampleRate * 1e9;
+
+  AudioBuffer tail(2, kDenormalBlockFrames);
+  AudioBuffer normal(2, kDenormalBlockFrames);
+  for (unsigned int ch = 0; ch < 2; ++ch)
+  {
+    for (unsigned int frame = 0; frame < kDenormalBlockFrames; ++frame)
+    {
+      tail.get_channel(ch)[frame] = std::numeric_limits<float>::denorm_min() * static_cast<float>(1 + frame % 64);
+      normal.get_channel(ch)[frame] = 0.5f * std::sin(0.05f * static_cast<float>(frame));
+    }
+  }
+
+  AudioBuffer buffer(2, kDenormalBlockFrames);
+  auto measure = [&](const AudioBuffer &source, size_t *denormals)
+  {
+    Dsp::Biquad biquad(Dsp::eBiquadType::Peak, 1000.0f, 1.0f, 6.0f);
+    biquad.prepare(spec);
+    const double ns = Benchmark::measure_ns([&]()
+    {
+      buffer.copy_from(source, kDenormalBlockFrames);
+      biquad.process(buffer, kDenormalBlockFrames);
+      Benchmark::do_not_optimize(buffer.get_channel(0)[0]);
+    }, 1000);
+
+    *denormals = count_denormals(buffer.get_channel(0), kDenormalBlockFrames);
+    return ns;
+  };
+
+  size_t denormals = 0;
+  const double normal_ns = measure(normal, &denormals);
+  const double tail_ns = measure(tail, &denormals);
+  const size_t tail_denormals = denormals;
+
+  double flushed_ns = 0.0;
+  size_t flushed_denormals = 0;
+  {
+    DenormalScope denormal_scope;
+    flushed_ns = measure(tail, &flushed_denormals);
+  }
+
+  Benchmark::report("biquad, normal signal", normal_ns, "ns/block");
+  Benchmark::report("biquad, denormal tail", tail_ns, "ns/block");
+  Benchmark::report("biquad, denormal tail DSP load", 100.0 * tail_ns / block_ns, "%");
+  Benchmark::report("biquad, denormal tail, flush to zero", flushed_ns, "ns/block");
+  Benchmark::report("biquad, denormal tail, flush to zero DSP load", 100.0 * flushed_ns / block_ns, "%");
+  Benchmark::report("Slowdown without flush to zero", tail_ns / flushed_ns, "x");
+  Benchmark::report("Denormal output samples", static_cast<double>(tail_denormals), "samples");
+  Benchmark::report("Denormal output samples, flush to zero", static_cast<double>(flushed_denormals), "samples");
+}
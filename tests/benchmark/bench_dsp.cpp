@@ -0,0 +1,58 @@
+#include "benchmark.h"
+#include "audiobuffer.h"
+#include "processorchain.h"
+#include "gain.h"
+#include "biquad.h"
+#include "compressor.h"
+#include "delay.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+static constexpr unsigned int kDspBlockFrames = 512;
+static constexpr double kDspSampleRate = 48000.0;
+
+/** @brief Cost of each insert processor on a stereo block, to budget effects per track.
+ */
+BENCHMARK_CASE(InsertProcessors)
+{
+  const Dsp::ProcessSpec spec{kDspSampleRate, 2, kDspBlockFrames, std::pmr::get_default_resource()};
+  const double block_ns = kDspBlockFrames / kDspSampleRate * 1e9;
+
+  AudioBuffer source(2, kDspBlockFrames);
+  AudioBuffer buffer(2, kDspBlockFrames);
+  for (unsigned int ch = 0; ch < 2; ++ch)
+  {
+    for (unsigned int frame = 0; frame < kDspBlockFrames; ++frame)
+      source.get_channel(ch)[frame] = 0.5f * std::sin(0.05f * static_cast<float>(frame));
+  }
+
+  auto measure = [&](const std::string &name, Dsp::IProcessor &processor)
+  {
+    processor.prepare(spec);
+    const double ns = Benchmark::measure_ns([&]()
+    {
+      // Refill so feedback paths do not decay into denormals
+      buffer.copy_from(source, kDspBlockFrames);
+      processor.process(buffer, kDspBlockFrames);
+      Benchmark::do_not_optimize(buffer.get_channel(0)[0]);
+    }, 1000);
+
+    Benchmark::report(name, ns, "ns/block");
+    Benchmark::report(name + " DSP load", 100.0 * ns / block_ns, "%");
+  };
+
+  Dsp::Gain gain;
+  gain.set_gain_db(-3.0f);
+  measure("gain", gain);
+
+  Dsp::Biquad biquad(Dsp::eBiquadType::Peak, 1000.0f, 1.0f, 6.0f);
+  measure("biquad", biquad);
+
+  Dsp::Compressor compressor;
+  measure("compressor", compressor);
+
+  Dsp::Delay delay;
+  measure("delay", delay);
+}
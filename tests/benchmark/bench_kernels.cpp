@@ -0,0 +1,72 @@
+#include "benchmark.h"
+#include "audiobuffer.h"
+#include "audiokernels.h"
+
+#include <string>
+#include <vector>
+
+static constexpr unsigned int kBlockFrames = 512;
+
+/** @brief Compare the channel-count specializations against the generic kernels.
+ */
+BENCHMARK_CASE(ChannelKernels)
+{
+  for (const unsigned int channels : {1u, 2u, 4u, 8u})
+  {
+    const Kernels::KernelTable &specialized = Kernels::select_kernels(channels);
+    const Kernels::KernelTable &generic = Kernels::generic_kernels();
+
+    AudioBuffer source(channels, kBlockFrames);
+    AudioBuffer destination(channels, kBlockFrames);
+    std::vector<float> interleaved(static_cast<size_t>(kBlockFrames) * channels, 0.25f);
+
+    for (unsigned int ch = 0; ch < channels; ++ch)
+    {
+      for (unsigned int frame = 0; frame < kBlockFrames; ++frame)
+        source.get_channel(ch)[frame] = static_cast<float>(frame % 17) * 0.01f;
+    }
+
+    auto compare = [&](const std::string &kernel, auto &&run_generic, auto &&run_specialized)
+    {
+      const double generic_ns = Benchmark::measure_ns(run_generic);
+      const double specialized_ns = Benchmark::measure_ns(run_specialized);
+      const std::string prefix = kernel + " " + std::to_string(channels) + "ch";
+
+      Benchmark::report(prefix + " generic", generic_ns, "ns/block");
+      Benchmark::report(prefix + " specialized", specialized_ns, "ns/block");
+      Benchmark::report(prefix + " speedup", generic_ns / specialized_ns, "x");
+    };
+
+    compare("interleave",
+      [&] { generic.interleave(source.get_channel_pointers(), interleaved.data(), channels, kBlockFrames);
+            Benchmark::do_not_optimize(interleaved[0]); },
+      [&] { specialized.interleave(source.get_channel_pointers(), interleaved.data(), channels, kBlockFrames);
+            Benchmark::do_not_optimize(interleaved[0]); });
+
+    compare("deinterleave",
+      [&] { generic.deinterleave(interleaved.data(), destination.get_channel_pointers(), channels, kBlockFrames);
+            Benchmark::do_not_optimize(destination.get_channel(0)[0]); },
+      [&] { specialized.deinterleave(interleaved.data(), destination.get_channel_pointers(), channels, kBlockFrames);
+            Benchmark::do_not_optimize(destination.get_channel(0)[0]); });
+
+    compare("mix",
+      [&] { generic.mix(source.get_channel_pointers(), destination.get_channel_pointers(), 0.5f, channels, kBlockFrames);
+            Benchmark::do_not_optimize(destination.get_channel(0)[0]); },
+      [&] { specialized.mix(source.get_channel_pointers(), destination.get_channel_pointers(), 0.5f, channels, kBlockFrames);
+            Benchmark::do_not_optimize(destination.get_channel(0)[0]); });
+
+    // Unity gain and centre pan keep the data stable across iterations, so
+    // repeated scaling does not decay into denormals and skew the timings
+    compare("gain",
+      [&] { generic.apply_gain(destination.get_channel_pointers(), 1.0f, channels, kBlockFrames);
+            Benchmark::do_not_optimize(destination.get_channel(0)[0]); },
+      [&] { specialized.apply_gain(destination.get_channel_pointers(), 1.0f, channels, kBlockFrames);
+            Benchmark::do_not_optimize(destination.get_channel(0)[0]); });
+
+    compare("pan",
+      [&] { generic.pan(destination.get_channel_pointers(), 0.0f, channels, kBlockFrames);
+            Benchmark::do_not_optimize(destination.get_channel(0)[0]); },
+      [&] { specialized.pan(destination.get_channel_pointers(), 0.0f, channels, kBlockFrames);
+            Benchmark::do_not_optimize(destination.get_channel(0)[0]); });
+  }
+}
@@ -0,0 +1,64 @@
+#include "benchmark.h"
+#include "filemanager.h"
+#include "libraryscanner.h"
+#include "wavfile.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+static constexpr unsigned int kLibraryDirectories = 100;
+static constexpr unsigned int kLibraryFilesPerDirectory = 100;
+
+/** @brief Scan of a 10k file sample library: one open per file with libsndfile, a cold scan and a rescan.
+ */
+BENCHMARK_CASE(LibraryScan)
+{
+  auto &fs = Files::FileManager::instance();
+  const std::filesystem::path library = std::filesystem::temp_directory_path() / "bench_library";
+  std::filesystem::remove_all(library);
+
+  const std::vector<float> samples(256, 0.0f);
+  for (unsigned int d = 0; d < kLibraryDirectories; ++d)
+  {
+    const std::filesystem::path directory = library / ("pack_" + std::to_string(d / 10)) / ("kit_" + std::to_string(d));
+    std::filesystem::create_directories(directory);
+    for (unsigned int f = 0; f < kLibraryFilesPerDirectory; ++f)
+    {
+      fs.save_to_wav_file(samples, directory / ("hit_" + std::to_string(f) + ".wav"));
+    }
+  }
+
+  const double files = static_cast<double>(kLibraryDirectories) * kLibraryFilesPerDirectory;
+
+  // Before the scanner: list every directory and open each file to read its format
+  auto started = std::chrono::steady_clock::now();
+  uint64_t frames = 0;
+  std::vector<std::filesystem::path> directories{library};
+  while (!directories.empty())
+  {
+    const std::filesystem::path directory = directories.back();
+    directories.pop_back();
+    for (const auto &sub : fs.list_directory(directory, Files::PathType::Directory))
+      directories.push_back(sub);
+    for (const auto &file : fs.list_wav_files_in_directory(directory))
+      frames += static_cast<uint64_t>(fs.read_wav_file(file)->get_frames());
+  }
+  Benchmark::do_not_optimize(frames);
+  const double listed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  Files::LibraryScanner scanner;
+  Files::LibraryIndex index;
+  const Files::LibraryScanReport cold = scanner.scan(library, index);
+  const Files::LibraryScanReport rescan = scanner.scan(library, index);
+
+  Benchmark::report("10k files, list and open", listed * 1e3, "ms");
+  const std::string threads = std::to_string(cold.threads) + (cold.threads == 1 ? " thread" : " threads");
+  Benchmark::report("10k files, cold scan on " + threads, cold.seconds * 1e3, "ms");
+  Benchmark::report("10k files, rescan", rescan.seconds * 1e3, "ms");
+  Benchmark::report("Rescan files/s", files / rescan.seconds, "files/s");
+  Benchmark::report("Rescan headers read", static_cast<double>(rescan.probed), "files");
+
+  std::filesystem::remove_all(library);
+}
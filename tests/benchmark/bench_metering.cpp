@@ -0,0 +1,66 @@
+#include "benchmark.h"
+#include "audiobuffer.h"
+#include "metertap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+static constexpr unsigned int kMeterBlockFrames = 256;
+static constexpr double kMeterSampleRate = 48000.0;
+static constexpr unsigned int kMeterTracks = 64;
+
+/** @brief Audio-thread cost of metering every track plus the master, against the 1% budget.
+ */
+BENCHMARK_CASE(MeteringTaps)
+{
+  const Dsp::ProcessSpec spec{kMeterSampleRate, 2, kMeterBlockFrames, std::pmr::get_default_resource()};
+  const double block_ns = kMeterBlockFrames / kMeterSampleRate * 1e9;
+
+  AudioBuffer buffer(2, kMeterBlockFrames);
+  for (unsigned int ch = 0; ch < 2; ++ch)
+  {
+    for (unsigned int frame = 0; frame < kMeterBlockFrames; ++frame)
+      buffer.get_channel(ch)[frame] = 0.5f * std::sin(0.05f * static_cast<float>(frame));
+  }
+
+  std::vector<std::unique_ptr<Dsp::MeterTap>> taps;
+  for (unsigned int i = 0; i < kMeterTracks + 1; ++i)
+  {
+    taps.push_back(std::make_unique<Dsp::MeterTap>("Track"));
+    taps.back()->prepare(spec);
+  }
+
+  auto push_all = [&]()
+  {
+    for (auto &tap : taps)
+      tap->push(buffer, kMeterBlockFrames);
+  };
+
+  auto analyze_all = [&]()
+  {
+    for (auto &tap : taps)
+      tap->analyze();
+  };
+
+  // Time the audio thread in bursts that fit the rings, draining them in
+  // between the way the analyzer thread would
+  double ns = std::numeric_limits<double>::max();
+  for (int burst = 0; burst < 20; ++burst)
+  {
+    analyze_all();
+    ns = std::min(ns, Benchmark::measure_ns(push_all, 32, 1));
+  }
+
+  const double analyze_ns = Benchmark::measure_ns([&]()
+  {
+    push_all();
+    analyze_all();
+  }, 200) - ns;
+
+  Benchmark::report("64 tracks + master push", ns, "ns/block");
+  Benchmark::report("64 tracks + master DSP load", 100.0 * ns / block_ns, "%");
+  Benchmark::report("analysis per block", analyze_ns, "ns/block");
+}
@@ -0,0 +1,62 @@
+#include "benchmark.h"
+#include "parameterstore.h"
+#include "smoothedvalue.h"
+
+#include <memory>
+#include <vector>
+
+static constexpr unsigned int kParameterCount = 4096;
+static constexpr unsigned int kParameterBlockFrames = 256;
+static constexpr double kParameterSampleRate = 48000.0;
+
+/** @brief Per-block cost of reading, smoothing and automating thousands of parameters.
+ */
+BENCHMARK_CASE(ParameterStore)
+{
+  Dsp::ParameterStore &store = Dsp::ParameterStore::instance();
+  const double block_ns = kParameterBlockFrames / kParameterSampleRate * 1e9;
+
+  std::vector<Dsp::ParameterId> ids;
+  std::vector<Dsp::SmoothedValue> smoothers(kParameterCount);
+  for (unsigned int i = 0; i < kParameterCount; ++i)
+  {
+    ids.push_back(store.add(Dsp::ParameterInfo{"Parameter", 0.0f, 1.0f, 0.5f}));
+    smoothers[i].prepare(kParameterSampleRate, 20.0f, Dsp::eSmoothing::Linear);
+  }
+
+  // Every parameter read once and advanced one block, as processors do
+  const double read_ns = Benchmark::measure_ns([&]()
+  {
+    for (unsigned int i = 0; i < kParameterCount; ++i)
+    {
+      smoothers[i].set_target(store.get(ids[i]));
+      smoothers[i].skip(kParameterBlockFrames);
+    }
+    Benchmark::do_not_optimize(smoothers[0]);
+  }, 500);
+
+  Benchmark::report("4096 parameters read + smoothed", read_ns, "ns/block");
+  Benchmark::report("4096 parameters DSP load", 100.0 * read_ns / block_ns, "%");
+
+  // Every parameter automated by a lane with a breakpoint every 10 ms
+  for (unsigned int i = 0; i < kParameterCount; ++i)
+  {
+    auto lane = std::make_shared<Dsp::AutomationLane>();
+    for (uint64_t position = 0; position < 48000 * 60; position += 480)
+      lane->add_point(position, static_cast<float>((position / 480 + i) % 2));
+    store.set_automation(ids[i], lane);
+  }
+
+  uint64_t position = 0;
+  const double automation_ns = Benchmark::measure_ns([&]()
+  {
+    store.process_automation(position);
+    position = (position + kParameterBlockFrames) % (48000 * 60);
+  }, 500);
+
+  Benchmark::report("4096 automation lanes", automation_ns, "ns/block");
+  Benchmark::report("4096 automation lanes DSP load", 100.0 * automation_ns / block_ns, "%");
+
+  for (const Dsp::ParameterId id : ids)
+    store.remove(id);
+}
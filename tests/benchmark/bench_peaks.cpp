@@ -0,0 +1,80 @@
+#include "benchmark.h"
+#include "peakfile.h"
+#include "wavfile.h"
+#include "wavwriter.h"
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+static constexpr unsigned int kPeaksSampleRate = 48000;
+static constexpr uint64_t kPeaksFrames = uint64_t{kPeaksSampleRate} * 60 * 30;
+static constexpr unsigned int kPeaksPixels = 1920;
+
+/** @brief Drawing a full width overview of a 30 minute recording, from the samples and from its peak file.
+ */
+BENCHMARK_CASE(PeakFile)
+{
+  const std::filesystem::path source = std::filesystem::temp_directory_path() / "bench_peaks.wav";
+  const std::filesystem::path peaks_path = Files::PeakFile::get_path(source);
+
+  {
+    Files::WavWriter writer(source, 1, kPeaksSampleRate, Files::eWavSampleFormat::Pcm16);
+    std::vector<float> block(kPeaksSampleRate);
+    for (uint64_t frame = 0; frame < kPeaksFrames; frame += block.size())
+    {
+      for (size_t i = 0; i < block.size(); ++i)
+        block[i] = 0.5f * std::sin(0.03f * static_cast<float>(i)) * static_cast<float>(frame % 7) / 7.0f;
+      writer.write(block.data(), static_cast<sf_count_t>(block.size()));
+    }
+  }
+
+  // Without peaks: read every sample and reduce it per pixel
+  auto started = std::chrono::steady_clock::now();
+  {
+    auto file = Files::FileManager::instance().read_wav_file(source);
+    AudioBuffer buffer(1, 65536);
+    const uint64_t frames_per_pixel = kPeaksFrames / kPeaksPixels;
+    std::vector<float> maxima(kPeaksPixels, 0.0f);
+    uint64_t position = 0;
+    while (const unsigned int n_frames = file->read(buffer, 65536))
+    {
+      for (unsigned int i = 0; i < n_frames; ++i, ++position)
+      {
+        float &maximum = maxima[std::min<uint64_t>(position / frames_per_pixel, kPeaksPixels - 1)];
+        maximum = std::max(maximum, buffer.get_channel(0)[i]);
+      }
+    }
+    Benchmark::do_not_optimize(maxima[0]);
+  }
+  const double from_samples = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  started = std::chrono::steady_clock::now();
+  Files::PeakFile::build(source, peaks_path);
+  const double build = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  auto peaks = Files::PeakFile::open(peaks_path);
+  std::vector<Files::WaveformPoint> points(kPeaksPixels);
+  const double overview_ns = Benchmark::measure_ns([&]()
+  {
+    peaks->read(0, 0, kPeaksFrames, points);
+    Benchmark::do_not_optimize(points[0]);
+  }, 200);
+
+  // Zoomed in on one second
+  const double zoomed_ns = Benchmark::measure_ns([&]()
+  {
+    peaks->read(0, kPeaksFrames / 2, kPeaksFrames / 2 + kPeaksSampleRate, points);
+    Benchmark::do_not_optimize(points[0]);
+  }, 200);
+
+  Benchmark::report("30 min overview, 1920 px, from samples", from_samples * 1e3, "ms");
+  Benchmark::report("30 min overview, 1920 px, from peak file", overview_ns / 1e3, "us");
+  Benchmark::report("1 s zoom, 1920 px, from peak file", zoomed_ns / 1e3, "us");
+  Benchmark::report("Peak file build", build * 1e3, "ms");
+  Benchmark::report("Peak file size", static_cast<double>(std::filesystem::file_size(peaks_path)) / 1024.0, "KB");
+
+  std::filesystem::remove(source);
+  std::filesystem::remove(peaks_path);
+}
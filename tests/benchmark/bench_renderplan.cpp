@@ -0,0 +1,69 @@
+#include "benchmark.h"
+#include "bus.h"
+#include "renderplan.h"
+#include "track.h"
+#include "transport.h"
+
+#include <memory>
+#include <vector>
+
+static constexpr unsigned int kPlanTracks = 64;
+static constexpr unsigned int kPlanBuses = 4;
+static constexpr unsigned int kPlanBlockFrames = 256;
+static constexpr double kPlanSampleRate = 48000.0;
+static constexpr uint64_t kPlanClipFrames = 48000 * 10;
+
+/** @brief Per-block cost and scratch footprint of the compiled plan for a 64 track session.
+ */
+BENCHMARK_CASE(RenderPlan)
+{
+  const Dsp::ProcessSpec spec{kPlanSampleRate, 2, kPlanBlockFrames, std::pmr::get_default_resource()};
+  const double block_ns = kPlanBlockFrames / kPlanSampleRate * 1e9;
+
+  auto audio = std::make_shared<AudioBuffer>(1, static_cast<unsigned int>(kPlanClipFrames));
+
+  std::vector<std::shared_ptr<Tracks::Track>> tracks;
+  for (unsigned int i = 0; i < kPlanTracks; ++i)
+  {
+    auto track = std::make_shared<Tracks::Track>();
+    track->prepare(spec);
+
+    Tracks::Clip clip;
+    clip.length = kPlanClipFrames;
+    clip.audio = audio;
+    track->get_timeline().add_clip(clip);
+    track->set_send_level(i % kPlanBuses, 0.25f);
+    tracks.push_back(track);
+  }
+
+  std::vector<std::shared_ptr<Tracks::Bus>> buses;
+  for (unsigned int i = 0; i < kPlanBuses; ++i)
+  {
+    auto bus = std::make_shared<Tracks::Bus>("Send");
+    bus->prepare(spec);
+    buses.push_back(bus);
+  }
+
+  auto plan = Tracks::RenderPlan::compile(tracks, buses, spec);
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+
+  AudioBuffer master(2, kPlanBlockFrames);
+  const double ns = Benchmark::measure_ns([&]()
+  {
+    master.clear(kPlanBlockFrames);
+    plan->run(master, transport, kPlanBlockFrames);
+    transport.position = (transport.position + kPlanBlockFrames) % (kPlanClipFrames - kPlanBlockFrames);
+    Benchmark::do_not_optimize(master.get_channel(0)[0]);
+  }, 2000);
+
+  // One buffer per track and bus, as before the plan
+  const double per_node_bytes = static_cast<double>(kPlanTracks + kPlanBuses) * 2 * kPlanBlockFrames * sizeof(float);
+
+  Benchmark::report("64 tracks, 4 sends", ns, "ns/block");
+  Benchmark::report("64 tracks, 4 sends DSP load", 100.0 * ns / block_ns, "%");
+  Benchmark::report("Plan steps", static_cast<double>(plan->get_steps().size()), "steps");
+  Benchmark::report("Scratch, compiled plan", static_cast<double>(plan->get_scratch_bytes()) / 1024.0, "KB");
+  Benchmark::report("Scratch, buffer per node", per_node_bytes / 1024.0, "KB");
+}
@@ -0,0 +1,70 @@
+#include "audiostream.h"
+#include "benchmark.h"
+#include "wavwriter.h"
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+static constexpr unsigned int kStreamSampleRate = 48000;
+static constexpr unsigned int kStreamFrames = kStreamSampleRate * 60;
+static constexpr unsigned int kStreamCount = 16;
+static constexpr unsigned int kStreamBlockFrames = 256;
+
+/** @brief Decode cost per stream and audio thread cost per block of 16 streamed one minute stems.
+ *  Only WAV is measured here; FLAC, Ogg and MP3 report their own cost through the same statistics.
+ */
+BENCHMARK_CASE(AudioStream)
+{
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "bench_streams.wav";
+  {
+    Files::WavWriter writer(path, 2, kStreamSampleRate, Files::eWavSampleFormat::Pcm16);
+    std::vector<float> block(2 * kStreamSampleRate);
+    for (unsigned int second = 0; second < kStreamFrames / kStreamSampleRate; ++second)
+    {
+      for (size_t i = 0; i < block.size(); ++i)
+        block[i] = 0.5f * std::sin(0.01f * static_cast<float>(i));
+      writer.write(block.data(), kStreamSampleRate);
+    }
+  }
+
+  std::vector<std::shared_ptr<Files::AudioStream>> streams;
+  for (unsigned int i = 0; i < kStreamCount; ++i)
+    streams.push_back(Files::AudioStream::open(path));
+
+  // Offline, so the audio thread side measures mixing rather than waiting
+  Files::StreamDecoder::instance().set_offline(true);
+
+  AudioBuffer output(2, kStreamBlockFrames);
+  const auto started = std::chrono::steady_clock::now();
+  uint64_t blocks = 0;
+  for (uint64_t frame = 0; frame < kStreamFrames; frame += kStreamBlockFrames, ++blocks)
+  {
+    output.clear();
+    for (auto &stream : streams)
+      stream->mix(output, 0, frame, kStreamBlockFrames, 0.1f);
+    Benchmark::do_not_optimize(output.get_channel(0)[0]);
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  Files::StreamDecoder::instance().set_offline(false);
+
+  double cpu_load = 0.0;
+  uint64_t underruns = 0;
+  for (const auto &stream : streams)
+  {
+    const Files::AudioStreamStatistics statistics = stream->get_statistics();
+    cpu_load += statistics.cpu_load;
+    underruns += statistics.underruns;
+  }
+
+  Benchmark::report("PCM16 decode per stream", 100.0 * cpu_load / kStreamCount, "% of a core");
+  Benchmark::report("16 streams, 1 min, offline", seconds * 1e3, "ms");
+  Benchmark::report("16 streams, per 256 frame block", seconds * 1e9 / static_cast<double>(blocks), "ns");
+  Benchmark::report("Underruns", static_cast<double>(underruns), "reads");
+
+  streams.clear();
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,88 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+/** Minimal benchmark harness. Each case registers itself with BENCHMARK_CASE
+ *  and prints its own results with Benchmark::report().
+ */
+namespace Benchmark
+{
+
+struct Case
+{
+  std::string name;
+  std::function<void()> run;
+};
+
+inline std::vector<Case> &registry()
+{
+  static std::vector<Case> cases;
+  return cases;
+}
+
+inline bool register_case(const std::string &name, std::function<void()> run)
+{
+  registry().push_back({name, std::move(run)});
+  return true;
+}
+
+/** @brief Keep a value alive so the optimizer cannot remove the work producing it.
+ */
+template <typename T>
+inline void do_not_optimize(const T &value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** @brief Measure the best mean time of a callable over several runs.
+ *  @param fn The work to measure
+ *  @param iterations Calls per run
+ *  @param runs Number of runs, the fastest is kept
+ *  @return Nanoseconds per call
+ */
+template <typename Fn>
+double measure_ns(Fn &&fn, const unsigned int iterations = 2000, const unsigned int runs = 5)
+{
+  // Warm up caches and branch predictors
+  for (unsigned int i = 0; i < iterations / 10 + 1; ++i)
+    fn();
+
+  double best = std::numeric_limits<double>::max();
+  for (unsigned int run = 0; run < runs; ++run)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; ++i)
+      fn();
+    const auto end = std::chrono::steady_clock::now();
+
+    const double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    best = std::min(best, ns);
+  }
+  return best;
+}
+
+/** @brief Print one result row.
+ */
+inline void report(const std::string &name, const double value, const std::string &unit)
+{
+  std::cout << "  " << std::left << std::setw(52) << name
+            << std::right << std::setw(14) << std::fixed << std::setprecision(2) << value
+            << " " << unit << "\n";
+}
+
+}  // namespace Benchmark
+
+#define BENCHMARK_CASE(name)                                                          \
+  static void name();                                                                 \
+  [[maybe_unused]] static const bool name##_registered = Benchmark::register_case(#name, &name); \
+  static void name()
+
+#endif  // __BENCHMARK_H__
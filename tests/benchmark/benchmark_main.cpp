@@ -0,0 +1,24 @@
+#include "benchmark.h"
+
+#include <cstring>
+
+/** @brief Run every registered benchmark, or only those whose name contains argv[1].
+ */
+int main(int argc, char **argv)
+{
+  const char *filter = argc > 1 ? argv[1] : nullptr;
+
+  std::cout << "Embedded Audio Engine Benchmarks" << std::endl;
+  std::cout << "--------------------------------" << std::endl;
+
+  for (const auto &benchmark : Benchmark::registry())
+  {
+    if (filter && benchmark.name.find(filter) == std::string::npos)
+      continue;
+
+    std::cout << benchmark.name << std::endl;
+    benchmark.run();
+  }
+
+  return 0;
+}
@@ -24,12 +24,12 @@ TEST(AudioInputIntegrationTest, AudioInput)
 
   // Add a track
   ASSERT_EQ(TrackManager::instance().get_track_count(), 0);
-  size_t track_index = TrackManager::instance().add_track();
+  TrackHandle track_handle = TrackManager::instance().add_track();
   ASSERT_EQ(TrackManager::instance().get_track_count(), 1);
 
-  auto track = TrackManager::instance().get_track(track_index);
+  auto track = TrackManager::instance().get_track(track_handle);
 
-  LOG_INFO("Track added with index: ", track_index);
+  LOG_INFO("Track added in slot: ", track_handle.index);
 
   AudioEngineStatistics stats = AudioEngine::instance().get_statistics();
   LOG_INFO("Tracks playing: ", stats.tracks_playing);
@@ -61,8 +61,8 @@ TEST(AudioInputIntegrationTest, AudioInput)
 
   track->stop();
 
-  // Wait until AudioEngine stops streaming
-  while (AudioEngine::instance().get_state() != eAudioEngineState::Idle)
+  // Wait until the transport stops, the stream stays open
+  while (AudioEngine::instance().get_transport().is_playing())
   {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
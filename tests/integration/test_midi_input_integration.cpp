@@ -4,7 +4,7 @@
 #include "midiengine.h"
 #include "devicemanager.h"
 #include "trackmanager.h"
-#include "filesystem.h"
+#include "filemanager.h"
 #include "midifile.h"
 #include "logger.h"
 
@@ -21,19 +21,19 @@ TEST(MidiInputIntegrationTest, MidiInput)
 
   // Add a track
   ASSERT_EQ(TrackManager::instance().get_track_count(), 0);
-  size_t track_index = TrackManager::instance().add_track();
+  TrackHandle track_handle = TrackManager::instance().add_track();
   ASSERT_EQ(TrackManager::instance().get_track_count(), 1);
 
-  auto track = TrackManager::instance().get_track(track_index);
+  auto track = TrackManager::instance().get_track(track_handle);
 
-  LOG_INFO("Track added with index: ", track_index);
+  LOG_INFO("Track added in slot: ", track_handle.index);
 
   // Open a test MIDI file and load it into the track
   std::string test_midi_file = "samples/midi_c_major_monophonic.mid";
 
-  MidiFile midi_file = FileSystem::instance().read_midi_file(test_midi_file);
-  ASSERT_EQ(midi_file.get_filepath(), FileSystem::instance().convert_to_absolute(test_midi_file));
-  ASSERT_EQ(midi_file.get_filename(), FileSystem::instance().convert_to_absolute(test_midi_file).filename().string());
+  MidiFile midi_file = FileManager::instance().read_midi_file(test_midi_file);
+  ASSERT_EQ(midi_file.get_filepath(), FileManager::instance().convert_to_absolute(test_midi_file));
+  ASSERT_EQ(midi_file.get_filename(), FileManager::instance().convert_to_absolute(test_midi_file).filename().string());
 
   LOG_INFO("MIDI file loaded: ", midi_file.get_filepath());
 
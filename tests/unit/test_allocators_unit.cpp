@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "allocators.h"
+#include "audiobuffer.h"
+
+/** @brief Locked Memory Pool - Allocate DSP buffers
+ */
+TEST(AllocatorsTest, LockedMemoryPool)
+{
+  LockedMemoryPool pool(1024 * 1024);
+
+  std::pmr::vector<float> left(4096, 0.0f, &pool);
+  std::pmr::vector<float> right(4096, 0.0f, &pool);
+
+  EXPECT_EQ(left.size(), 4096);
+  EXPECT_NE(left.data(), right.data());
+
+  void *aligned = pool.allocate(1024, 64);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+  pool.deallocate(aligned, 1024, 64);
+
+  void *page = pool.allocate(100, 4096);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(page) % 4096, 0);
+  pool.deallocate(page, 100, 4096);
+}
+
+/** @brief Locked Memory Pool - Buffers of every size are reused, and freed neighbours merge back into one chunk
+ */
+TEST(AllocatorsTest, LockedMemoryPoolReuse)
+{
+  LockedMemoryPool pool(4 * 1024 * 1024);
+  const size_t largest = pool.get_largest_free();
+  EXPECT_EQ(pool.get_used(), 0);
+
+  // Far more than the pool holds in total, in sizes above and below a page
+  for (unsigned int cycle = 0; cycle < 2000; ++cycle)
+  {
+    AudioBuffer buffer(2, 1024, &pool);
+    std::pmr::vector<float> small(64 + cycle % 100, &pool);
+    std::pmr::vector<float> large(100000 + cycle, &pool);
+    ASSERT_GT(pool.get_used(), 0) << "cycle " << cycle;
+  }
+  EXPECT_EQ(pool.get_used(), 0);
+  EXPECT_EQ(pool.get_largest_free(), largest);
+
+  // Freed out of order, the chunks still merge
+  std::vector<void *> blocks;
+  for (unsigned int i = 0; i < 8; ++i)
+    blocks.push_back(pool.allocate(100000, 64));
+  for (const unsigned int i : {3u, 1u, 7u, 0u, 5u, 2u, 6u, 4u})
+    pool.deallocate(blocks[i], 100000, 64);
+  EXPECT_EQ(pool.get_largest_free(), largest);
+
+  EXPECT_THROW((void)pool.allocate(largest + 1, 64), std::bad_alloc);
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "audiobuffer.h"
+#include "audiokernels.h"
+
+/** @brief Audio Buffer - Channels are aligned and cleared
+ */
+TEST(AudioBufferTest, Layout)
+{
+  AudioBuffer buffer(3, 100);
+
+  EXPECT_EQ(buffer.get_channels(), 3);
+  EXPECT_EQ(buffer.get_frames(), 100);
+
+  for (unsigned int ch = 0; ch < buffer.get_channels(); ++ch)
+  {
+    const float *data = buffer.get_channel(ch);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % AudioBuffer::kAlignment, 0);
+    for (unsigned int frame = 0; frame < buffer.get_frames(); ++frame)
+    {
+      ASSERT_EQ(data[frame], 0.0f);
+    }
+  }
+}
+
+/** @brief Audio Buffer - Copy between buffers
+ */
+TEST(AudioBufferTest, CopyFrom)
+{
+  AudioBuffer source(2, 64);
+  AudioBuffer destination(2, 64);
+
+  for (unsigned int frame = 0; frame < 64; ++frame)
+  {
+    source.get_channel(0)[frame] = static_cast<float>(frame);
+    source.get_channel(1)[frame] = -static_cast<float>(frame);
+  }
+
+  destination.copy_from(source, 32);
+  EXPECT_EQ(destination.get_channel(0)[31], 31.0f);
+  EXPECT_EQ(destination.get_channel(1)[31], -31.0f);
+  EXPECT_EQ(destination.get_channel(0)[32], 0.0f);
+}
+
+/** @brief Kernels - Silence detection sees a single sample above the threshold anywhere in the block
+ */
+TEST(AudioBufferTest, IsSilent)
+{
+  AudioBuffer buffer(2, 67);
+  EXPECT_TRUE(Kernels::is_silent(buffer.get_channel_pointers(), 2, 67));
+
+  for (unsigned int frame = 0; frame < 67; ++frame)
+  {
+    buffer.get_channel(1)[frame] = -Kernels::kSilenceThreshold;
+    EXPECT_TRUE(Kernels::is_silent(buffer.get_channel_pointers(), 2, 67)) << "frame " << frame;
+
+    buffer.get_channel(1)[frame] = -2.0f * Kernels::kSilenceThreshold;
+    EXPECT_FALSE(Kernels::is_silent(buffer.get_channel_pointers(), 2, 67)) << "frame " << frame;
+    EXPECT_TRUE(Kernels::is_silent(buffer.get_channel(0), 67));
+    buffer.get_channel(1)[frame] = 0.0f;
+  }
+
+  buffer.get_channel(0)[66] = std::numeric_limits<float>::quiet_NaN();
+  EXPECT_FALSE(Kernels::is_silent(buffer.get_channel(0), 67));
+}
+
+class InterleaveTest : public ::testing::TestWithParam<unsigned int> {};
+
+/** @brief Kernels - Interleave and deinterleave round trip
+ */
+TEST_P(InterleaveTest, RoundTrip)
+{
+  const unsigned int channels = GetParam();
+  const unsigned int n_frames = 67;  // Not a multiple of the vector width
+
+  AudioBuffer planar(channels, n_frames);
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    for (unsigned int frame = 0; frame < n_frames; ++frame)
+    {
+      planar.get_channel(ch)[frame] = static_cast<float>(frame * 10 + ch);
+    }
+  }
+
+  std::vector<float> interleaved(n_frames * channels);
+  Kernels::interleave(planar.get_channel_pointers(), interleaved.data(), channels, n_frames);
+
+  for (unsigned int frame = 0; frame < n_frames; ++frame)
+  {
+    for (unsigned int ch = 0; ch < channels; ++ch)
+    {
+      ASSERT_EQ(interleaved[frame * channels + ch], static_cast<float>(frame * 10 + ch));
+    }
+  }
+
+  AudioBuffer result(channels, n_frames);
+  Kernels::deinterleave(interleaved.data(), result.get_channel_pointers(), channels, n_frames);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    for (unsigned int frame = 0; frame < n_frames; ++frame)
+    {
+      ASSERT_EQ(result.get_channel(ch)[frame], planar.get_channel(ch)[frame]);
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Channels, InterleaveTest, ::testing::Values(1u, 2u, 3u, 4u, 8u));
+
+class ChannelKernelsTest : public ::testing::TestWithParam<unsigned int> {};
+
+/** @brief Kernels - Specializations match the generic kernels
+ */
+TEST_P(ChannelKernelsTest, MatchesGeneric)
+{
+  const unsigned int channels = GetParam();
+  const unsigned int n_frames = 67;
+
+  const Kernels::KernelTable &specialized = Kernels::select_kernels(channels);
+  const Kernels::KernelTable &generic = Kernels::generic_kernels();
+
+  AudioBuffer source(channels, n_frames);
+  AudioBuffer expected(channels, n_frames);
+  AudioBuffer actual(channels, n_frames);
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    for (unsigned int frame = 0; frame < n_frames; ++frame)
+    {
+      source.get_channel(ch)[frame] = static_cast<float>(frame) * 0.01f - static_cast<float>(ch);
+    }
+  }
+
+  generic.mix(source.get_channel_pointers(), expected.get_channel_pointers(), 0.5f, channels, n_frames);
+  generic.apply_gain(expected.get_channel_pointers(), 0.8f, channels, n_frames);
+  generic.pan(expected.get_channel_pointers(), -0.3f, channels, n_frames);
+
+  specialized.mix(source.get_channel_pointers(), actual.get_channel_pointers(), 0.5f, channels, n_frames);
+  specialized.apply_gain(actual.get_channel_pointers(), 0.8f, channels, n_frames);
+  specialized.pan(actual.get_channel_pointers(), -0.3f, channels, n_frames);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    for (unsigned int frame = 0; frame < n_frames; ++frame)
+    {
+      ASSERT_FLOAT_EQ(actual.get_channel(ch)[frame], expected.get_channel(ch)[frame]);
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Channels, ChannelKernelsTest, ::testing::Values(1u, 2u, 3u, 4u, 8u));
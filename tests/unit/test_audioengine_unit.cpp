@@ -64,11 +64,35 @@ TEST_F(AudioEngineTest, Stop)
   auto state = engine.get_state();
   EXPECT_EQ(state, eAudioEngineState::Running);
 
+  EXPECT_TRUE(engine.get_transport().is_playing());
+
+  // Stopping the transport leaves the stream open
   engine.stop();
 
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(engine.get_state(), eAudioEngineState::Running);
+  EXPECT_FALSE(engine.get_transport().is_playing());
+
+  const uint64_t position = engine.get_transport().get_position();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(engine.get_transport().get_position(), position);
+}
+
+/** @brief Close
+ */
+TEST_F(AudioEngineTest, Close)
+{
+  auto &engine = AudioEngine::instance();
+
+  engine.play();
+
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  EXPECT_EQ(engine.get_state(), eAudioEngineState::Running);
+
+  engine.close();
+
   std::this_thread::sleep_for(std::chrono::seconds(1));
-  state = engine.get_state();
-  EXPECT_EQ(state, eAudioEngineState::Idle);
+  EXPECT_EQ(engine.get_state(), eAudioEngineState::Idle);
 }
 
 /** @brief Set Output Device
@@ -99,3 +123,130 @@ TEST_F(AudioEngineTest, SetStreamParameters)
   EXPECT_EQ(engine.get_sample_rate(), sample_rate);
   EXPECT_EQ(engine.get_buffer_frames(), buffer_frames);
 }
+
+/** @brief Hot Swap - Stream parameters change while running without stopping the transport
+ */
+TEST_F(AudioEngineTest, HotSwapStreamParameters)
+{
+  auto &engine = AudioEngine::instance();
+  engine.set_stream_parameters(2, 48000, 512);
+  engine.play();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  ASSERT_EQ(engine.get_state(), eAudioEngineState::Running);
+  ASSERT_TRUE(engine.get_transport().is_playing());
+
+  const StreamSwapStatistics before = engine.get_swap_statistics();
+  const uint64_t position = engine.get_transport().get_position();
+
+  // Same rate, smaller blocks
+  engine.set_stream_parameters(2, 48000, 128);
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  StreamSwapStatistics after = engine.get_swap_statistics();
+  EXPECT_EQ(engine.get_state(), eAudioEngineState::Running);
+  EXPECT_EQ(engine.get_buffer_frames(), 128);
+  EXPECT_EQ(after.swaps, before.swaps + 1);
+  EXPECT_EQ(after.parallel_swaps, before.parallel_swaps + 1);
+  EXPECT_GT(after.last_dropout_ms, 0.0);
+  EXPECT_GE(after.max_dropout_ms, after.last_dropout_ms);
+
+  // The transport kept playing from where it was
+  EXPECT_TRUE(engine.get_transport().is_playing());
+  EXPECT_GT(engine.get_transport().get_position(), position);
+
+  // A rate change keeps the playhead at the same time
+  engine.stop();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const uint64_t stopped_at = engine.get_transport().get_position();
+
+  engine.set_stream_parameters(2, 96000, 128);
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  EXPECT_EQ(engine.get_state(), eAudioEngineState::Running);
+  EXPECT_EQ(engine.get_swap_statistics().swaps, before.swaps + 2);
+  EXPECT_EQ(engine.get_transport().get_position(), stopped_at * 2);
+
+  engine.set_stream_parameters(2, 48000, 512);
+}
+
+/** @brief BufferSizeControllerTest - An xrun doubles the buffer at once
+ */
+TEST(BufferSizeControllerTest, StepUpOnXrun)
+{
+  BufferSizeController controller;
+  const auto now = BufferSizeController::Clock::now();
+
+  EXPECT_EQ(controller.update(AudioLoadStatistics{0.2f, 0.1f, 100, 1}, 256, now), 512);
+  EXPECT_EQ(controller.update(AudioLoadStatistics{0.9f, 0.5f, 100, 0}, 512, now), 1024);
+  EXPECT_EQ(controller.update(AudioLoadStatistics{0.5f, 0.4f, 100, 0}, 1024, now), 1024);
+
+  // Opened above max_frames, an xrun keeps the buffer rather than shrinking it
+  BufferSizeControllerConfig config;
+  config.max_frames = 1024;
+  BufferSizeController capped(config);
+  EXPECT_EQ(capped.update(AudioLoadStatistics{0.2f, 0.1f, 100, 1}, 4096, now), 4096);
+}
+
+/** @brief BufferSizeControllerTest - The buffer halves only after headroom holds for down_hold
+ */
+TEST(BufferSizeControllerTest, HoldThenStepDown)
+{
+  BufferSizeControllerConfig config;
+  config.down_hold = std::chrono::milliseconds(1000);
+  BufferSizeController controller(config);
+
+  const AudioLoadStatistics idle{0.1f, 0.05f, 100, 0};
+  const auto start = BufferSizeController::Clock::now();
+
+  EXPECT_EQ(controller.update(idle, 1024, start), 1024);
+  EXPECT_EQ(controller.update(idle, 1024, start + std::chrono::milliseconds(500)), 1024);
+  EXPECT_EQ(controller.update(idle, 1024, start + std::chrono::milliseconds(1000)), 512);
+
+  // The hold restarts at the new size, and a busy window breaks it
+  const auto later = start + std::chrono::milliseconds(1500);
+  EXPECT_EQ(controller.update(idle, 512, later), 512);
+  EXPECT_EQ(controller.update(AudioLoadStatistics{0.4f, 0.3f, 100, 0}, 512, later + std::chrono::milliseconds(500)), 512);
+  EXPECT_EQ(controller.update(idle, 512, later + std::chrono::milliseconds(1500)), 512);
+  EXPECT_EQ(controller.update(idle, 512, later + std::chrono::milliseconds(2500)), 256);
+}
+
+/** @brief BufferSizeControllerTest - A size that underran is avoided for xrun_penalty
+ */
+TEST(BufferSizeControllerTest, AvoidFailedSize)
+{
+  BufferSizeControllerConfig config;
+  config.down_hold = std::chrono::milliseconds(0);
+  config.xrun_penalty = std::chrono::milliseconds(5000);
+  BufferSizeController controller(config);
+
+  const AudioLoadStatistics idle{0.1f, 0.05f, 100, 0};
+  const auto start = BufferSizeController::Clock::now();
+
+  EXPECT_EQ(controller.update(AudioLoadStatistics{0.1f, 0.05f, 100, 2}, 256, start), 512);
+  EXPECT_EQ(controller.update(idle, 512, start + std::chrono::milliseconds(1000)), 512);
+  EXPECT_EQ(controller.update(idle, 512, start + std::chrono::milliseconds(2000)), 512);
+
+  // Once the penalty is over the smaller size is tried again
+  EXPECT_EQ(controller.update(idle, 512, start + std::chrono::milliseconds(5000)), 256);
+}
+
+/** @brief BufferSizeControllerTest - The buffer stays within min_frames and max_frames
+ */
+TEST(BufferSizeControllerTest, ClampToLimits)
+{
+  BufferSizeControllerConfig config;
+  config.min_frames = 128;
+  config.max_frames = 1024;
+  config.down_hold = std::chrono::milliseconds(0);
+  BufferSizeController controller(config);
+
+  const auto now = BufferSizeController::Clock::now();
+  const AudioLoadStatistics idle{0.1f, 0.05f, 100, 0};
+
+  EXPECT_EQ(controller.update(AudioLoadStatistics{0.95f, 0.9f, 100, 0}, 1024, now), 1024);
+  EXPECT_EQ(controller.update(idle, 128, now), 128);
+  EXPECT_EQ(controller.update(idle, 128, now + std::chrono::milliseconds(1)), 128);
+
+  // No callbacks says nothing about the load
+  EXPECT_EQ(controller.update(AudioLoadStatistics{0.0f, 0.0f, 0, 0}, 512, now), 512);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+#include "batchprocessor.h"
+#include "filemanager.h"
+#include "wavfile.h"
+
+using namespace Batch;
+
+namespace
+{
+
+/** @brief A fresh directory under the system temp directory, removed at the end of the test
+ */
+class TempDirectory
+{
+public:
+  explicit TempDirectory(const std::string &name):
+    m_path(std::filesystem::temp_directory_path() / name)
+  {
+    std::filesystem::remove_all(m_path);
+    std::filesystem::create_directories(m_path);
+  }
+
+  ~TempDirectory() { std::filesystem::remove_all(m_path); }
+
+  const std::filesystem::path &path() const { return m_path; }
+
+private:
+  std::filesystem::path m_path;
+};
+
+}  // namespace
+
+/** @brief Batch Processor - Chains parse in order, with defaults and errors
+ */
+TEST(BatchProcessorTest, ParseChain)
+{
+  const auto chain = parse_chain("highpass=80, gain=-3,resample=44100,normalize");
+  ASSERT_EQ(chain.size(), 4u);
+  EXPECT_EQ(chain[0].op, eBatchOp::HighPass);
+  EXPECT_DOUBLE_EQ(chain[0].value, 80.0);
+  EXPECT_EQ(chain[1].op, eBatchOp::Gain);
+  EXPECT_DOUBLE_EQ(chain[1].value, -3.0);
+  EXPECT_EQ(chain[2].op, eBatchOp::Resample);
+  EXPECT_EQ(chain[3].op, eBatchOp::Normalize);
+  EXPECT_DOUBLE_EQ(chain[3].value, -1.0);
+
+  EXPECT_TRUE(parse_chain("").empty());
+  EXPECT_THROW(parse_chain("reverse"), std::invalid_argument);
+  EXPECT_THROW(parse_chain("gain"), std::invalid_argument);
+  EXPECT_THROW(parse_chain("gain=loud"), std::invalid_argument);
+  EXPECT_THROW(parse_chain("resample=0"), std::invalid_argument);
+  EXPECT_THROW(parse_chain("normalize,normalize=-3"), std::invalid_argument);
+
+  EXPECT_EQ(parse_format("pcm24"), Files::eWavSampleFormat::Pcm24);
+  EXPECT_FALSE(parse_format("keep").has_value());
+  EXPECT_THROW(parse_format("mp3"), std::invalid_argument);
+}
+
+/** @brief Batch Processor - Every file in a directory is normalized, resampled and converted
+ */
+TEST(BatchProcessorTest, ProcessDirectory)
+{
+  TempDirectory input("batch_processor_input");
+  TempDirectory output("batch_processor_output");
+
+  auto &fs = Files::FileManager::instance();
+  const unsigned int file_count = 5;
+  for (unsigned int i = 0; i < file_count; ++i)
+  {
+    // Stereo tones at different levels and lengths
+    const unsigned int frames = 10000 + 3000 * i;
+    const float level = 0.1f * static_cast<float>(i + 1);
+    std::vector<float> samples;
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+      const float sample = level * static_cast<float>(std::sin(2.0 * M_PI * 440.0 * frame / 48000.0));
+      samples.push_back(sample);
+      samples.push_back(0.5f * sample);
+    }
+    fs.save_to_wav_file(samples, input.path() / ("tone_" + std::to_string(i) + ".wav"), 2, 48000);
+  }
+
+  // Not a WAV file, ignored
+  fs.save_to_wav_file({0.0f}, input.path() / "ignored.wav.txt.wav", 1, 48000);
+  std::filesystem::rename(input.path() / "ignored.wav.txt.wav", input.path() / "ignored.txt");
+
+  BatchOptions options;
+  options.chain = parse_chain("gain=-6,resample=24000,normalize=-1");
+  options.format = Files::eWavSampleFormat::Pcm16;
+  options.threads = 3;
+  options.block_frames = 1000;
+
+  const BatchReport report = BatchProcessor(options).run(input.path(), output.path());
+  ASSERT_EQ(report.files.size(), file_count);
+  EXPECT_EQ(report.get_failed_count(), 0u);
+  EXPECT_EQ(report.threads, 3u);
+  EXPECT_GT(report.get_bytes_in(), 0u);
+
+  const float target = static_cast<float>(std::pow(10.0, -1.0 / 20.0));
+  for (const auto &file : report.files)
+  {
+    ASSERT_TRUE(file.succeeded) << file.error;
+    EXPECT_EQ(file.frames_out, (file.frames_in + 1) / 2);
+
+    auto wav = fs.read_wav_file(file.output);
+    EXPECT_EQ(wav->get_sample_rate(), 24000u);
+    EXPECT_EQ(wav->get_channels(), 2u);
+    EXPECT_EQ(wav->get_format() & SF_FORMAT_SUBMASK, SF_FORMAT_PCM_16);
+
+    AudioBuffer buffer(2, static_cast<unsigned int>(wav->get_frames()));
+    wav->read(buffer, buffer.get_frames());
+    float peak = 0.0f;
+    for (unsigned int frame = 0; frame < buffer.get_frames(); ++frame)
+      peak = std::max(peak, std::abs(buffer.get_channel(0)[frame]));
+    EXPECT_NEAR(peak, target, 1e-3f) << file.input.filename();
+  }
+
+  // A file that cannot be read fails on its own
+  std::filesystem::resize_file(input.path() / "tone_0.wav", 20);
+  const BatchReport broken = BatchProcessor(options).run(input.path(), output.path());
+  EXPECT_EQ(broken.get_failed_count(), 1u);
+
+  EXPECT_THROW(BatchProcessor(options).run(input.path(), input.path()), std::invalid_argument);
+}
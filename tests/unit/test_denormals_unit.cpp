@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <limits>
+#include <vector>
+
+#include "denormals.h"
+
+/** @brief DenormalScope - Denormal results are flushed in scope and the mode is restored after
+ */
+TEST(DenormalScopeTest, FlushAndRestore)
+{
+  if (!DenormalScope::is_supported())
+    GTEST_SKIP() << "No flush to zero mode on this target";
+
+  volatile float smallest_normal = std::numeric_limits<float>::min();
+  volatile float half = 0.5f;
+
+  const bool active_before = DenormalScope::is_active();
+  {
+    DenormalScope denormal_scope;
+    EXPECT_TRUE(DenormalScope::is_active());
+    EXPECT_EQ(smallest_normal * half, 0.0f);
+
+    {
+      DenormalScope nested_scope;
+      EXPECT_TRUE(DenormalScope::is_active());
+    }
+    EXPECT_TRUE(DenormalScope::is_active());
+  }
+  EXPECT_EQ(DenormalScope::is_active(), active_before);
+
+  if (!active_before)
+  {
+    EXPECT_NE(smallest_normal * half, 0.0f);
+  }
+}
+
+/** @brief count_denormals - Only denormal values are counted
+ */
+TEST(DenormalScopeTest, CountDenormals)
+{
+  const std::vector<float> samples{
+    0.0f,
+    -0.0f,
+    1.0f,
+    std::numeric_limits<float>::min(),
+    std::numeric_limits<float>::denorm_min(),
+    -std::numeric_limits<float>::denorm_min() * 100.0f,
+    std::numeric_limits<float>::infinity(),
+  };
+
+  EXPECT_EQ(count_denormals(samples.data(), samples.size()), 2u);
+  EXPECT_EQ(count_denormals(samples.data(), 0), 0u);
+}
@@ -0,0 +1,483 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "audiobuffer.h"
+#include "processorchain.h"
+#include "gain.h"
+#include "biquad.h"
+#include "compressor.h"
+#include "delay.h"
+#include "delayline.h"
+#include "fft.h"
+#include "convolver.h"
+#include "convolutionreverb.h"
+#include "resampler.h"
+#include "realtimecheck.h"
+
+using namespace Dsp;
+
+static constexpr double kSampleRate = 48000.0;
+static constexpr unsigned int kFrames = 256;
+
+static ProcessSpec make_spec(const unsigned int channels)
+{
+  return ProcessSpec{kSampleRate, channels, kFrames, std::pmr::get_default_resource()};
+}
+
+static void fill_sine(AudioBuffer &buffer, const double frequency, const float amplitude, double &phase)
+{
+  const double increment = 2.0 * M_PI * frequency / kSampleRate;
+  for (unsigned int frame = 0; frame < buffer.get_frames(); ++frame)
+  {
+    const float sample = amplitude * static_cast<float>(std::sin(phase));
+    for (unsigned int ch = 0; ch < buffer.get_channels(); ++ch)
+      buffer.get_channel(ch)[frame] = sample;
+    phase += increment;
+  }
+}
+
+static float peak(const AudioBuffer &buffer, const unsigned int channel)
+{
+  float value = 0.0f;
+  for (unsigned int frame = 0; frame < buffer.get_frames(); ++frame)
+    value = std::max(value, std::fabs(buffer.get_channel(channel)[frame]));
+  return value;
+}
+
+/** @brief Gain - Level and pan
+ */
+TEST(DspTest, Gain)
+{
+  Gain gain;
+  gain.set_gain_db(-6.0f);
+  gain.prepare(make_spec(2));
+
+  AudioBuffer buffer(2, kFrames);
+  for (unsigned int ch = 0; ch < 2; ++ch)
+    std::fill(buffer.get_channel(ch), buffer.get_channel(ch) + kFrames, 1.0f);
+
+  gain.process(buffer, kFrames);
+  EXPECT_NEAR(buffer.get_channel(0)[kFrames - 1], 0.501f, 1e-3f);
+  EXPECT_NEAR(buffer.get_channel(1)[kFrames - 1], 0.501f, 1e-3f);
+
+  // Hard left pan ramps the right channel to silence over one block
+  gain.set_gain_db(0.0f);
+  gain.set_pan(-1.0f);
+  for (unsigned int ch = 0; ch < 2; ++ch)
+    std::fill(buffer.get_channel(ch), buffer.get_channel(ch) + kFrames, 1.0f);
+
+  gain.process(buffer, kFrames);
+  EXPECT_GT(buffer.get_channel(1)[0], 0.0f);
+  EXPECT_NEAR(buffer.get_channel(1)[kFrames - 1], 0.0f, 1e-5f);
+  EXPECT_NEAR(buffer.get_channel(0)[kFrames - 1], std::sqrt(2.0f), 1e-4f);
+}
+
+/** @brief Biquad - Low pass passes low frequencies and attenuates high ones
+ */
+TEST(DspTest, BiquadLowPass)
+{
+  Biquad filter(eBiquadType::LowPass, 1000.0f, 0.707f);
+  filter.prepare(make_spec(1));
+
+  AudioBuffer buffer(1, kFrames);
+  double phase = 0.0;
+  for (int block = 0; block < 20; ++block)
+  {
+    fill_sine(buffer, 100.0, 1.0f, phase);
+    filter.process(buffer, kFrames);
+  }
+  EXPECT_GT(peak(buffer, 0), 0.95f);
+
+  filter.reset();
+  phase = 0.0;
+  for (int block = 0; block < 20; ++block)
+  {
+    fill_sine(buffer, 12000.0, 1.0f, phase);
+    filter.process(buffer, kFrames);
+  }
+  EXPECT_LT(peak(buffer, 0), 0.02f);
+}
+
+/** @brief Compressor - Loud signals are reduced above the threshold
+ */
+TEST(DspTest, Compressor)
+{
+  Compressor compressor;
+  compressor.set_threshold_db(-20.0f);
+  compressor.set_ratio(4.0f);
+  compressor.set_attack_ms(1.0f);
+  compressor.prepare(make_spec(2));
+
+  AudioBuffer buffer(2, kFrames);
+  double phase = 0.0;
+  for (int block = 0; block < 40; ++block)
+  {
+    fill_sine(buffer, 440.0, 1.0f, phase);
+    compressor.process(buffer, kFrames);
+  }
+
+  // 0 dB in, 20 dB over the threshold at 4:1 leaves 15 dB of gain reduction
+  EXPECT_NEAR(compressor.get_gain_reduction_db(), -15.0f, 1.0f);
+  EXPECT_LT(peak(buffer, 0), 0.25f);
+  EXPECT_FLOAT_EQ(peak(buffer, 0), peak(buffer, 1));
+}
+
+/** @brief Delay - An impulse is repeated after the delay time
+ */
+TEST(DspTest, Delay)
+{
+  Delay delay(100.0f);
+  delay.set_time_ms(2.0f);  // 96 samples
+  delay.set_feedback(0.5f);
+  delay.set_mix(1.0f);
+  delay.prepare(make_spec(1));
+
+  AudioBuffer buffer(1, kFrames);
+  buffer.get_channel(0)[0] = 1.0f;
+  delay.process(buffer, kFrames);
+
+  EXPECT_FLOAT_EQ(buffer.get_channel(0)[0], 0.0f);
+  EXPECT_FLOAT_EQ(buffer.get_channel(0)[96], 1.0f);
+  EXPECT_FLOAT_EQ(buffer.get_channel(0)[192], 0.5f);
+}
+
+/** @brief Delay Line - Blocks come out whole samples later, in place or mixed, across the wrap
+ */
+TEST(DspTest, DelayLine)
+{
+  DelayLine line(2, 100, 64);
+  DelayLine mixer(2, 100, 64);
+  EXPECT_EQ(line.get_delay(), 100);
+  EXPECT_EQ(line.get_bytes(), 2 * 256 * sizeof(float));
+
+  AudioBuffer buffer(2, 64);
+  AudioBuffer mixed(2, 64);
+  for (unsigned int block = 0; block < 20; ++block)
+  {
+    for (unsigned int frame = 0; frame < 64; ++frame)
+    {
+      buffer.get_channel(0)[frame] = static_cast<float>(block * 64 + frame);
+      buffer.get_channel(1)[frame] = -static_cast<float>(block * 64 + frame);
+    }
+
+    std::fill(mixed.get_channel(0), mixed.get_channel(0) + 64, 1.0f);
+    std::fill(mixed.get_channel(1), mixed.get_channel(1) + 64, 1.0f);
+    mixer.mix(buffer, mixed, 0.5f, 64);
+    line.process(buffer, 64);
+
+    for (unsigned int frame = 0; frame < 64; ++frame)
+    {
+      const unsigned int position = block * 64 + frame;
+      const float expected = position < 100 ? 0.0f : static_cast<float>(position - 100);
+      ASSERT_EQ(buffer.get_channel(0)[frame], expected) << "frame " << position;
+      ASSERT_EQ(buffer.get_channel(1)[frame], -expected) << "frame " << position;
+      ASSERT_EQ(mixed.get_channel(0)[frame], 1.0f + 0.5f * expected) << "frame " << position;
+    }
+  }
+}
+
+/** @brief Processor Chain - Processors run in order and bypass skips them
+ */
+TEST(DspTest, ChainBypass)
+{
+  ProcessorChain chain;
+  chain.prepare(make_spec(1));
+
+  auto first = std::make_shared<Gain>();
+  auto second = std::make_shared<Gain>();
+  first->set_gain_db(-6.0f);
+  second->set_gain_db(-6.0f);
+  chain.add(first);
+  chain.add(second);
+  EXPECT_EQ(chain.size(), 2);
+
+  AudioBuffer buffer(1, kFrames);
+  std::fill(buffer.get_channel(0), buffer.get_channel(0) + kFrames, 1.0f);
+  chain.process(buffer, kFrames);
+  EXPECT_NEAR(buffer.get_channel(0)[0], 0.251f, 1e-3f);
+
+  second->set_bypassed(true);
+  std::fill(buffer.get_channel(0), buffer.get_channel(0) + kFrames, 1.0f);
+  chain.process(buffer, kFrames);
+  EXPECT_NEAR(buffer.get_channel(0)[0], 0.501f, 1e-3f);
+
+  auto statistics = chain.get_statistics();
+  ASSERT_EQ(statistics.size(), 2);
+  EXPECT_EQ(statistics[0].blocks_processed, 2);
+  EXPECT_EQ(statistics[1].blocks_processed, 1);
+  EXPECT_TRUE(statistics[1].bypassed);
+  EXPECT_GT(statistics[0].dsp_load, 0.0);
+
+  chain.remove(0);
+  EXPECT_EQ(chain.get(0), second);
+  EXPECT_THROW(chain.remove(1), std::out_of_range);
+}
+
+/** @brief Processor Chain - Silent input runs until the declared tails have rung out, then is skipped
+ */
+TEST(DspTest, ChainSilence)
+{
+  ProcessorChain chain;
+  chain.prepare(make_spec(1));
+
+  auto gain = std::make_shared<Gain>();
+  auto delay = std::make_shared<Delay>();
+  delay->set_time_ms(1.0f);
+  delay->set_feedback(0.0f);
+  chain.add(gain);
+  chain.add(delay);
+  const unsigned int tail = gain->get_tail_frames() + delay->get_tail_frames();
+  EXPECT_EQ(gain->get_tail_frames(), 0);
+  EXPECT_GT(delay->get_tail_frames(), 0);
+  EXPECT_LT(tail, kFrames);
+
+  // Signal is processed and never reported silent
+  AudioBuffer buffer(1, kFrames);
+  std::fill(buffer.get_channel(0), buffer.get_channel(0) + kFrames, 1.0f);
+  EXPECT_FALSE(chain.process(buffer, kFrames));
+
+  // The echo of the last block still comes out of silent input
+  buffer.clear();
+  EXPECT_FALSE(chain.process(buffer, kFrames));
+  EXPECT_GT(std::fabs(buffer.get_channel(0)[0]), 0.0f);
+
+  // Once the tail has rung out, silent blocks skip the chain
+  buffer.clear();
+  EXPECT_TRUE(chain.process(buffer, kFrames, true));
+  const uint64_t processed = chain.get_statistics()[1].blocks_processed;
+  buffer.clear();
+  EXPECT_TRUE(chain.process(buffer, kFrames, true));
+  EXPECT_EQ(chain.get_statistics()[1].blocks_processed, processed);
+  EXPECT_EQ(buffer.get_channel(0)[0], 0.0f);
+
+  // Signal wakes it again
+  buffer.get_channel(0)[0] = 1.0f;
+  EXPECT_FALSE(chain.process(buffer, kFrames));
+  EXPECT_EQ(chain.get_statistics()[1].blocks_processed, processed + 1);
+}
+
+/** @brief Processor Chain - No heap traffic or locks while processing
+ */
+TEST(DspTest, ChainRealtimeClean)
+{
+  if (!RealtimeChecker::hooks_installed())
+  {
+    GTEST_SKIP() << "realtimecheck_hooks is not linked into this binary";
+  }
+
+  ProcessorChain chain;
+  chain.prepare(make_spec(2));
+  chain.add(std::make_shared<Biquad>(eBiquadType::HighShelf, 8000.0f, 0.707f, 3.0f));
+  chain.add(std::make_shared<Compressor>());
+  chain.add(std::make_shared<Delay>());
+  chain.add(std::make_shared<Gain>());
+
+  AudioBuffer buffer(2, kFrames);
+  double phase = 0.0;
+  fill_sine(buffer, 440.0, 0.5f, phase);
+
+  RealtimeChecker::instance().reset();
+  {
+    RealtimeScope scope;
+    for (int block = 0; block < 8; ++block)
+      chain.process(buffer, kFrames);
+  }
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_TRUE(report.is_clean()) << realtime_violation_to_string(report.first_violation);
+}
+
+/** @brief FFT - Forward transform matches a direct DFT and inverts back to the input
+ */
+TEST(DspTest, FftRoundTrip)
+{
+  constexpr size_t size = 64;
+  FftPlan fft(size);
+  EXPECT_EQ(fft.get_bins(), size / 2 + 1);
+  EXPECT_THROW(FftPlan(48), std::invalid_argument);
+
+  // Smallest plan, a single butterfly after the real split
+  FftPlan small(4);
+  const float impulse[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+  float small_re[3];
+  float small_im[3];
+  small.forward(impulse, small_re, small_im);
+  EXPECT_FLOAT_EQ(small_re[0], 10.0f);
+  EXPECT_FLOAT_EQ(small_re[1], -2.0f);
+  EXPECT_FLOAT_EQ(small_im[1], 2.0f);
+  EXPECT_FLOAT_EQ(small_re[2], -2.0f);
+
+  std::vector<float> input(size);
+  for (size_t n = 0; n < size; ++n)
+    input[n] = std::sin(0.3f * static_cast<float>(n)) + 0.25f * std::cos(1.7f * static_cast<float>(n));
+
+  std::vector<float> re(fft.get_bins());
+  std::vector<float> im(fft.get_bins());
+  fft.forward(input.data(), re.data(), im.data());
+
+  for (size_t k = 0; k < fft.get_bins(); ++k)
+  {
+    double dft_re = 0.0;
+    double dft_im = 0.0;
+    for (size_t n = 0; n < size; ++n)
+    {
+      const double angle = -2.0 * M_PI * static_cast<double>(k * n) / static_cast<double>(size);
+      dft_re += input[n] * std::cos(angle);
+      dft_im += input[n] * std::sin(angle);
+    }
+    EXPECT_NEAR(re[k], dft_re, 1e-3);
+    EXPECT_NEAR(im[k], dft_im, 1e-3);
+  }
+
+  std::vector<float> output(size);
+  fft.inverse(re.data(), im.data(), output.data());
+  for (size_t n = 0; n < size; ++n)
+    EXPECT_NEAR(output[n], input[n], 1e-5);
+}
+
+/** @brief Convolver - Matches direct convolution delayed by one partition
+ */
+TEST(DspTest, ConvolverMatchesDirect)
+{
+  constexpr unsigned int partition = 32;
+  constexpr size_t ir_length = 200;
+  constexpr size_t length = 1000;
+
+  std::vector<float> ir(ir_length);
+  for (size_t i = 0; i < ir_length; ++i)
+    ir[i] = std::exp(-0.02f * static_cast<float>(i)) * std::cos(0.9f * static_cast<float>(i));
+
+  std::vector<float> input(length);
+  for (size_t i = 0; i < length; ++i)
+    input[i] = std::sin(0.11f * static_cast<float>(i)) * (i % 7 == 0 ? 1.0f : 0.5f);
+
+  Convolver convolver;
+  convolver.prepare(ir.data(), ir.size(), partition);
+  EXPECT_EQ(convolver.get_latency(), partition);
+  EXPECT_EQ(convolver.get_partition_count(), 7);
+  EXPECT_THROW(convolver.prepare(ir.data(), ir.size(), 24), std::invalid_argument);
+
+  // Odd block sizes exercise partial partitions; processed in place
+  std::vector<float> output(input);
+  size_t offset = 0;
+  const unsigned int blocks[] = {1, 17, 64, 5, 100};
+  for (size_t i = 0; offset < length; ++i)
+  {
+    const unsigned int count = std::min<unsigned int>(blocks[i % 5], static_cast<unsigned int>(length - offset));
+    convolver.process(output.data() + offset, output.data() + offset, count);
+    offset += count;
+  }
+
+  for (size_t n = 0; n < length; ++n)
+  {
+    double expected = 0.0;
+    if (n >= partition)
+    {
+      const size_t m = n - partition;
+      for (size_t k = 0; k < ir_length && k <= m; ++k)
+        expected += ir[k] * input[m - k];
+    }
+    ASSERT_NEAR(output[n], expected, 1e-4) << "at sample " << n;
+  }
+}
+
+/** @brief Convolution Reverb - Latency follows the block size and the wet signal is the IR
+ */
+TEST(DspTest, ConvolutionReverb)
+{
+  AudioBuffer impulse(1, 1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+    impulse.get_channel(0)[i] = (i == 10) ? 1.0f : 0.0f;
+
+  ConvolutionReverb reverb;
+  reverb.set_impulse_response(impulse, 1000, kSampleRate);
+  EXPECT_EQ(reverb.get_impulse_length(), 1000);
+  EXPECT_EQ(reverb.get_latency(), 0);
+
+  reverb.prepare(make_spec(2));
+  EXPECT_EQ(reverb.get_latency(), kFrames);
+
+  AudioBuffer buffer(2, kFrames);
+  buffer.clear();
+  buffer.get_channel(0)[0] = 1.0f;
+  buffer.get_channel(1)[0] = 0.5f;
+  reverb.process(buffer, kFrames);
+  EXPECT_NEAR(buffer.get_channel(0)[10], 0.0f, 1e-6);
+
+  buffer.clear();
+  reverb.process(buffer, kFrames);
+  EXPECT_NEAR(buffer.get_channel(0)[10], 1.0f, 1e-4);
+  EXPECT_NEAR(buffer.get_channel(1)[10], 0.5f, 1e-4);
+  EXPECT_NEAR(buffer.get_channel(0)[11], 0.0f, 1e-4);
+}
+
+/** @brief DSP - Resampler keeps a tone's level and frequency, streamed in uneven blocks
+ */
+TEST(DspTest, Resampler)
+{
+  const unsigned int input_rate = 48000;
+  const unsigned int output_rate = 44100;
+  const unsigned int input_frames = 48000;
+  const double frequency = 1000.0;
+
+  Resampler resampler;
+  resampler.prepare(2, input_rate, output_rate, 1000);
+
+  AudioBuffer input(2, 1000);
+  AudioBuffer output(2, resampler.get_max_output_frames(1000));
+  std::vector<float> resampled;
+
+  unsigned int position = 0;
+  unsigned int block = 1;
+  while (position < input_frames)
+  {
+    const unsigned int frames = std::min({block, 1000u, input_frames - position});
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+      const float sample = static_cast<float>(std::sin(2.0 * M_PI * frequency * (position + frame) / input_rate));
+      input.get_channel(0)[frame] = sample;
+      input.get_channel(1)[frame] = -sample;
+    }
+    position += frames;
+    block = block * 3 % 997 + 1;
+
+    const unsigned int written = resampler.process(input, frames, output);
+    ASSERT_LE(written, output.get_frames());
+    for (unsigned int frame = 0; frame < written; ++frame)
+    {
+      resampled.push_back(output.get_channel(0)[frame]);
+      ASSERT_EQ(output.get_channel(1)[frame], -output.get_channel(0)[frame]);
+    }
+  }
+
+  const unsigned int flushed = resampler.flush(output);
+  for (unsigned int frame = 0; frame < flushed; ++frame)
+    resampled.push_back(output.get_channel(0)[frame]);
+
+  ASSERT_EQ(resampled.size(), 44100u);
+
+  // Away from the edges, the output is the same tone sampled at the new rate
+  double max_error = 0.0;
+  for (size_t i = 100; i < resampled.size() - 100; ++i)
+  {
+    const double expected = std::sin(2.0 * M_PI * frequency * static_cast<double>(i) / output_rate);
+    max_error = std::max(max_error, std::abs(resampled[i] - expected));
+  }
+  EXPECT_LT(max_error, 1e-2);
+
+  // Downsampling filters content above the new Nyquist frequency
+  Resampler down;
+  down.prepare(1, 48000, 16000, 4800);
+  AudioBuffer high(1, 4800);
+  for (unsigned int frame = 0; frame < 4800; ++frame)
+    high.get_channel(0)[frame] = static_cast<float>(std::sin(2.0 * M_PI * 12000.0 * frame / 48000.0));
+
+  AudioBuffer low(1, down.get_max_output_frames(4800));
+  const unsigned int written = down.process(high, 4800, low);
+  float peak = 0.0f;
+  for (unsigned int frame = 100; frame + 100 < written; ++frame)
+    peak = std::max(peak, std::abs(low.get_channel(0)[frame]));
+  EXPECT_LT(peak, 0.01f);
+}
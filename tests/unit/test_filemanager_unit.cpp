@@ -5,8 +5,17 @@
 #include "filemanager.h"
 #include "wavfile.h"
 #include "midifile.h"
+#include "audiostream.h"
+#include "libraryscanner.h"
+#include "peakfile.h"
+#include "peakgenerator.h"
+#include "wavwriter.h"
 #include "logger.h"
 
+#include <cmath>
+#include <fstream>
+#include <thread>
+
 using namespace Files;
 
 
@@ -131,7 +140,38 @@ TEST(FileSystemTest, ListMidiFilesInDirectory)
 
 TEST(FileSystemTest, SaveToWavFile)
 {
-  ASSERT_EQ(1, 0) << "This is a placeholder test for saving to a WAV file.";
+  FileManager& fs = FileManager::instance();
+
+  std::filesystem::path wav_file_path = std::filesystem::temp_directory_path() / "save_to_wav_file_test.wav";
+
+  // Two channels, a ramp on the left and its negative on the right
+  std::vector<float> samples;
+  for (unsigned int frame = 0; frame < 1000; ++frame)
+  {
+    samples.push_back(static_cast<float>(frame) / 1000.0f);
+    samples.push_back(-static_cast<float>(frame) / 1000.0f);
+  }
+
+  fs.save_to_wav_file(samples, wav_file_path, 2, 44100);
+  ASSERT_TRUE(fs.is_wav_file(wav_file_path)) << "Saved file should be a WAV file.";
+
+  std::shared_ptr<WavFile> file = fs.read_wav_file(wav_file_path);
+  ASSERT_EQ(file->get_channels(), 2);
+  ASSERT_EQ(file->get_sample_rate(), 44100);
+  ASSERT_EQ(file->get_frames(), 1000);
+
+  AudioBuffer buffer(2, 1000);
+  ASSERT_EQ(file->read(buffer, 1000), 1000);
+  for (unsigned int frame = 0; frame < 1000; ++frame)
+  {
+    ASSERT_EQ(buffer.get_channel(0)[frame], samples[frame * 2]);
+    ASSERT_EQ(buffer.get_channel(1)[frame], samples[frame * 2 + 1]);
+  }
+
+  EXPECT_THROW(fs.save_to_wav_file(samples, wav_file_path, 3, 44100), std::invalid_argument);
+  EXPECT_THROW(fs.save_to_wav_file(samples, "not_a_wav_file.txt", 2, 44100), std::invalid_argument);
+
+  std::filesystem::remove(wav_file_path);
 }
 
 TEST(FileSystemTest, LoadWavFile)
@@ -157,7 +197,405 @@ TEST(FileSystemTest, LoadWavFile)
   ASSERT_TRUE(fs.is_wav_file(file->get_filepath())) << "Loaded file should be a WAV file.";
 }
 
+TEST(FileSystemTest, ReadWavFile)
+{
+  FileManager& fs = FileManager::instance();
+
+  std::shared_ptr<WavFile> file = fs.read_wav_file("./samples/test.wav");
+  ASSERT_GT(file->get_frames(), 0);
+
+  AudioBuffer buffer(file->get_channels(), 512);
+
+  unsigned int frames_read = file->read(buffer, 512);
+  EXPECT_EQ(frames_read, 512);
+
+  // The sample starts at silence and rises, so it is not all zero
+  bool has_signal = false;
+  for (unsigned int frame = 0; frame < frames_read; ++frame)
+  {
+    has_signal |= buffer.get_channel(0)[frame] != 0.0f;
+  }
+  EXPECT_TRUE(has_signal);
+
+  // Reading past the end returns only the remaining frames
+  file->seek(file->get_frames() - 100);
+  EXPECT_EQ(file->read(buffer, 512), 100);
+  EXPECT_EQ(file->read(buffer, 512), 0);
+}
+
 TEST(FileSystemTest, LoadMidiFile)
 {
   ASSERT_EQ(1, 0) << "This is a placeholder test for loading a MIDI file.";
-}
\ No newline at end of file
+}
+
+TEST(FileSystemTest, ProbeSampleHeaders)
+{
+  const std::filesystem::path directory = std::filesystem::temp_directory_path() / "probe_sample_headers_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  const std::vector<float> silence(3 * 1500, 0.0f);
+  const std::pair<eWavSampleFormat, eSampleEncoding> formats[] = {
+    {eWavSampleFormat::Pcm16, eSampleEncoding::Pcm16},
+    {eWavSampleFormat::Pcm24, eSampleEncoding::Pcm24},
+    {eWavSampleFormat::Float32, eSampleEncoding::Float32},
+  };
+
+  for (const auto &[format, encoding] : formats)
+  {
+    const std::string path = (directory / "tone.wav").string();
+    {
+      WavWriter writer(path, 3, 96000, format);
+      writer.write(silence.data(), 1500);
+    }
+
+    SampleInfo info;
+    ASSERT_TRUE(LibraryScanner::probe(path, info)) << to_string(encoding);
+    EXPECT_EQ(info.container, eAudioContainer::Wav);
+    EXPECT_EQ(info.encoding, encoding);
+    EXPECT_EQ(info.sample_rate, 96000);
+    EXPECT_EQ(info.channels, 3);
+    EXPECT_EQ(info.frames, 1500);
+  }
+
+  // A big-endian AIFF header: stereo, 44100 frames of 24 bit at 44.1 kHz
+  {
+    const unsigned char aiff[] = {
+      'F', 'O', 'R', 'M', 0, 0, 0, 46, 'A', 'I', 'F', 'F',
+      'C', 'O', 'M', 'M', 0, 0, 0, 18, 0, 2, 0, 0, 0xAC, 0x44, 0, 24,
+      0x40, 0x0E, 0xAC, 0x44, 0, 0, 0, 0, 0, 0,
+      'S', 'S', 'N', 'D', 0, 0, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0,
+    };
+    std::ofstream file(directory / "tone.aiff", std::ios::binary);
+    file.write(reinterpret_cast<const char*>(aiff), sizeof(aiff));
+  }
+
+  SampleInfo info;
+  ASSERT_TRUE(LibraryScanner::probe((directory / "tone.aiff").string(), info));
+  EXPECT_EQ(info.container, eAudioContainer::Aiff);
+  EXPECT_EQ(info.encoding, eSampleEncoding::Pcm24);
+  EXPECT_EQ(info.sample_rate, 44100);
+  EXPECT_EQ(info.channels, 2);
+  EXPECT_EQ(info.frames, 44100);
+  EXPECT_DOUBLE_EQ(info.get_seconds(), 1.0);
+
+  // Not audio at all
+  std::ofstream(directory / "notes.wav") << "Not a RIFF file";
+  EXPECT_FALSE(LibraryScanner::probe((directory / "notes.wav").string(), info));
+  EXPECT_FALSE(info.is_readable());
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST(FileSystemTest, ScanLibrary)
+{
+  FileManager& fs = FileManager::instance();
+
+  const std::filesystem::path library = std::filesystem::temp_directory_path() / "scan_library_test";
+  const std::filesystem::path index_path = std::filesystem::temp_directory_path() / "scan_library_test.index";
+  std::filesystem::remove_all(library);
+
+  // 4 directories deep, 3 files per directory, plus files the scan skips
+  unsigned int count = 0;
+  std::filesystem::path directory = library;
+  for (unsigned int depth = 0; depth < 4; ++depth)
+  {
+    directory /= "level_" + std::to_string(depth);
+    std::filesystem::create_directories(directory);
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      fs.save_to_wav_file(std::vector<float>(100 * (count + 1), 0.0f), directory / ("sample_" + std::to_string(i) + ".wav"));
+      ++count;
+    }
+    std::ofstream(directory / "readme.txt") << "Not a sample";
+  }
+  std::filesystem::create_directories(library / "empty");
+
+  LibraryScanOptions options;
+  options.threads = 4;
+  LibraryScanner scanner(options);
+
+  LibraryIndex index;
+  LibraryScanReport report = scanner.scan(library, index);
+  EXPECT_EQ(report.directories, 6);
+  EXPECT_EQ(report.files, count);
+  EXPECT_EQ(report.probed, count);
+  EXPECT_EQ(report.unchanged, 0);
+  EXPECT_EQ(report.unreadable, 0);
+  ASSERT_EQ(index.size(), count);
+
+  for (const SampleInfo *info : index.get_entries())
+  {
+    EXPECT_TRUE(info->is_readable()) << info->path;
+    EXPECT_EQ(info->channels, 1);
+    EXPECT_EQ(info->sample_rate, 48000);
+    EXPECT_EQ(info->encoding, eSampleEncoding::Float32);
+    EXPECT_EQ(info->size, std::filesystem::file_size(info->path));
+  }
+
+  index.save(index_path);
+
+  // A second process picks the index up and rescans after one edit, one addition and one removal
+  const std::filesystem::path first = library / "level_0" / "sample_0.wav";
+  const std::filesystem::path last = directory / "sample_2.wav";
+  fs.save_to_wav_file(std::vector<float>(12345, 0.0f), first);
+  fs.save_to_wav_file(std::vector<float>(10, 0.0f), library / "empty" / "new.wav");
+  std::filesystem::remove(last);
+
+  LibraryIndex reloaded;
+  ASSERT_TRUE(reloaded.load(index_path));
+  ASSERT_EQ(reloaded.size(), count);
+
+  // Entries outside the scanned root are kept
+  SampleInfo elsewhere;
+  elsewhere.path = library.string() + "_other/sample.wav";
+  reloaded.insert(elsewhere);
+
+  report = scanner.scan(library, reloaded);
+  EXPECT_EQ(report.files, count);
+  EXPECT_EQ(report.probed, 2);
+  EXPECT_EQ(report.unchanged, count - 2);
+  EXPECT_EQ(report.removed, 1);
+  EXPECT_EQ(reloaded.size(), count + 1);
+
+  ASSERT_NE(reloaded.find(first.string()), nullptr);
+  EXPECT_EQ(reloaded.find(first.string())->frames, 12345);
+  EXPECT_EQ(reloaded.find(last.string()), nullptr);
+  EXPECT_NE(reloaded.find(elsewhere.path), nullptr);
+
+  // Not an index
+  std::ofstream(index_path, std::ios::trunc) << "garbage";
+  EXPECT_FALSE(reloaded.load(index_path));
+  EXPECT_TRUE(reloaded.empty());
+
+  EXPECT_THROW(scanner.scan(library / "missing", reloaded), std::runtime_error);
+
+  std::filesystem::remove_all(library);
+  std::filesystem::remove(index_path);
+}
+
+TEST(FileSystemTest, PeakFiles)
+{
+  FileManager& fs = FileManager::instance();
+
+  const std::filesystem::path cache = std::filesystem::temp_directory_path() / "peak_files_test";
+  const std::filesystem::path source = std::filesystem::temp_directory_path() / "peak_files_test.wav";
+  std::filesystem::remove_all(cache);
+
+  // Stereo: a sine whose level rises across the file, and a constant on the right
+  const unsigned int frames = 48000 * 5 + 123;
+  std::vector<float> samples;
+  for (unsigned int frame = 0; frame < frames; ++frame)
+  {
+    const float level = static_cast<float>(frame) / frames;
+    samples.push_back(level * static_cast<float>(std::sin(0.05 * frame)));
+    samples.push_back(-0.25f);
+  }
+  fs.save_to_wav_file(samples, source, 2, 48000);
+
+  PeakGenerator generator(2, cache);
+  auto first = generator.request(source);
+  auto second = generator.request(source);
+  const std::filesystem::path path = first.get();
+  EXPECT_EQ(second.get(), path);
+  EXPECT_EQ(path.parent_path(), cache);
+  EXPECT_EQ(path, PeakFile::get_path(source, cache));
+
+  auto peaks = PeakFile::open(path);
+  EXPECT_TRUE(peaks->is_current(source));
+  EXPECT_EQ(peaks->get_channels(), 2);
+  EXPECT_EQ(peaks->get_sample_rate(), 48000);
+  EXPECT_EQ(peaks->get_frames(), frames);
+
+  // 256, 1024, ... frames per peak, up to one peak for the whole file
+  ASSERT_GT(peaks->get_level_count(), 1);
+  for (size_t i = 0; i < peaks->get_level_count(); ++i)
+  {
+    const PeakLevel level = peaks->get_level(i);
+    EXPECT_EQ(level.frames_per_peak, PeakFile::kBaseFramesPerPeak << (2 * i));
+    EXPECT_EQ(level.count, (frames + level.frames_per_peak - 1) / level.frames_per_peak);
+  }
+  EXPECT_EQ(peaks->get_level(peaks->get_level_count() - 1).count, 1);
+
+  // Every level agrees with the samples it covers
+  const float tolerance = 1.5f / 32767.0f;
+  for (size_t i = 0; i < peaks->get_level_count(); ++i)
+  {
+    const PeakLevel level = peaks->get_level(i);
+    for (uint64_t peak = 0; peak < level.count; peak += std::max<uint64_t>(1, level.count / 7))
+    {
+      const uint64_t begin = peak * level.frames_per_peak;
+      const uint64_t end = std::min<uint64_t>(frames, begin + level.frames_per_peak);
+      float min = 1.0f;
+      float max = -1.0f;
+      double sum_of_squares = 0.0;
+      for (uint64_t frame = begin; frame < end; ++frame)
+      {
+        min = std::min(min, samples[frame * 2]);
+        max = std::max(max, samples[frame * 2]);
+        sum_of_squares += samples[frame * 2] * samples[frame * 2];
+      }
+      const float rms = static_cast<float>(std::sqrt(sum_of_squares / static_cast<double>(end - begin)));
+
+      const PeakValue &left = level.peaks[peak * 2];
+      EXPECT_NEAR(left.min / 32767.0f, min, tolerance) << "level " << i << " peak " << peak;
+      EXPECT_NEAR(left.max / 32767.0f, max, tolerance) << "level " << i << " peak " << peak;
+      EXPECT_NEAR(left.rms / 32767.0f, rms, tolerance) << "level " << i << " peak " << peak;
+
+      const PeakValue &right = level.peaks[peak * 2 + 1];
+      EXPECT_NEAR(right.min / 32767.0f, -0.25f, tolerance);
+      EXPECT_NEAR(right.max / 32767.0f, -0.25f, tolerance);
+    }
+  }
+
+  // An overview of the whole file, and past its end
+  std::vector<WaveformPoint> points(300);
+  EXPECT_EQ(peaks->read(0, 0, frames * 2, points), 150);
+  EXPECT_LT(points[0].max, 0.05f);
+  EXPECT_GT(points[149].max, 0.9f);
+  EXPECT_GT(points[149].rms, 0.6f);
+  EXPECT_EQ(points[299].max, 0.0f);
+
+  for (size_t point = 0; point < 150; ++point)
+  {
+    EXPECT_LE(points[point].min, points[point].max);
+    EXPECT_LE(points[point].rms, points[point].max);
+  }
+
+  EXPECT_EQ(peaks->read(1, 1000, 1100, points), 300);
+  EXPECT_NEAR(points[10].min, -0.25f, tolerance);
+  EXPECT_EQ(peaks->read(2, 0, frames, points), 0);
+
+  // A current peak file is not rebuilt, a changed source is
+  const auto built = std::filesystem::last_write_time(path);
+  EXPECT_EQ(generator.request(source).get(), path);
+  EXPECT_EQ(std::filesystem::last_write_time(path), built);
+
+  samples.resize(2000);
+  fs.save_to_wav_file(samples, source, 2, 48000);
+  EXPECT_FALSE(peaks->is_current(source));
+  generator.request(source).get();
+  EXPECT_EQ(PeakFile::open(path)->get_frames(), 1000);
+
+  // Next to the source when there is no cache directory
+  PeakGenerator beside(1);
+  const std::filesystem::path local = beside.request(source).get();
+  EXPECT_EQ(local, std::filesystem::path(source.string() + ".peaks"));
+
+  EXPECT_THROW(beside.request(cache / "missing.wav").get(), std::runtime_error);
+  EXPECT_THROW(PeakFile::open(source), std::runtime_error);
+
+  std::filesystem::remove_all(cache);
+  std::filesystem::remove(source);
+  std::filesystem::remove(local);
+}
+
+TEST(FileSystemTest, ReadAudioFile)
+{
+  FileManager& fs = FileManager::instance();
+
+  EXPECT_TRUE(fs.is_audio_file("./samples/test.wav"));
+  EXPECT_FALSE(fs.is_audio_file("./README.md"));
+  EXPECT_TRUE(fs.has_audio_extension("stem.FLAC"));
+  EXPECT_TRUE(fs.has_audio_extension("stem.ogg"));
+  EXPECT_TRUE(fs.has_audio_extension("stem.mp3"));
+  EXPECT_FALSE(fs.has_audio_extension("stem.mid"));
+
+  std::shared_ptr<AudioFile> file = fs.read_audio_file("./samples/test.wav");
+  std::shared_ptr<WavFile> wav = fs.read_wav_file("./samples/test.wav");
+  EXPECT_EQ(file->get_frames(), wav->get_frames());
+  EXPECT_EQ(file->get_channels(), wav->get_channels());
+  EXPECT_FALSE(file->is_compressed());
+
+  const std::vector<std::filesystem::path> files = fs.list_audio_files_in_directory("./samples");
+  EXPECT_GE(files.size(), fs.list_wav_files_in_directory("./samples").size());
+
+  EXPECT_THROW(fs.read_audio_file("./README.md"), std::runtime_error);
+}
+
+TEST(FileSystemTest, AudioStream)
+{
+  FileManager& fs = FileManager::instance();
+
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "audio_stream_test.wav";
+  const unsigned int frames = 48000 * 3;
+  std::vector<float> samples;
+  for (unsigned int frame = 0; frame < frames; ++frame)
+  {
+    samples.push_back(static_cast<float>(frame) / frames);
+    samples.push_back(-static_cast<float>(frame) / frames);
+  }
+  fs.save_to_wav_file(samples, path, 2, 48000);
+
+  AudioStreamConfig config;
+  config.block_frames = 1024;
+  config.blocks = 8;
+  config.preload_frames = 2000;
+  auto stream = AudioStream::open(path, 5000, config);
+  EXPECT_EQ(stream->get_frames(), frames);
+  EXPECT_EQ(stream->get_channels(), 2);
+  EXPECT_GE(StreamDecoder::instance().get_stream_count(), 1);
+
+  AudioBuffer buffer(2, 256);
+
+  // Reads what the stream has, waiting between tries as a slow audio thread would
+  auto read = [&](const uint64_t frame, const unsigned int n_frames)
+  {
+    const unsigned int wanted = static_cast<unsigned int>(std::min<uint64_t>(n_frames, frames - frame));
+    unsigned int got = 0;
+    for (int attempt = 0; attempt < 1000 && got < wanted; ++attempt)
+    {
+      buffer.clear();
+      got = stream->mix(buffer, 0, frame, n_frames, 0.5f);
+      if (got < wanted)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (unsigned int i = 0; i < got; ++i)
+    {
+      const float expected = 0.5f * samples[(frame + i) * 2];
+      if (buffer.get_channel(0)[i] != expected || buffer.get_channel(1)[i] != -expected)
+      {
+        ADD_FAILURE() << "Frame " << frame + i << " does not match the file";
+        break;
+      }
+    }
+    return got;
+  };
+
+  // The cue plays from the preload at once
+  buffer.clear();
+  EXPECT_EQ(stream->mix(buffer, 0, 5000, 256, 0.5f), 256);
+  EXPECT_EQ(buffer.get_channel(0)[10], 0.5f * samples[5010 * 2]);
+
+  // Straight on from the preload into decoded blocks, several times the read-ahead
+  for (uint64_t frame = 5256; frame < 5000 + 40000; frame += 256)
+  {
+    ASSERT_EQ(read(frame, 256), 256) << frame;
+  }
+
+  // Jumps either way, and the end of the file
+  EXPECT_EQ(read(100000, 256), 256);
+  EXPECT_EQ(read(1000, 256), 256);
+  EXPECT_EQ(read(frames - 100, 256), 100);
+  EXPECT_EQ(stream->mix(buffer, 0, frames, 256, 1.0f), 0);
+
+  const AudioStreamStatistics statistics = stream->get_statistics();
+  EXPECT_GE(statistics.frames_decoded, 40000);
+  EXPECT_GE(statistics.seeks, 3);
+  EXPECT_GT(statistics.decode_seconds, 0.0);
+  EXPECT_GT(statistics.cpu_load, 0.0);
+  EXPECT_FALSE(stream->is_compressed());
+
+  // Offline reads wait for the decoder instead of returning short
+  StreamDecoder::instance().set_offline(true);
+  buffer.clear();
+  EXPECT_EQ(stream->mix(buffer, 0, 70000, 256, 1.0f), 256);
+  EXPECT_EQ(buffer.get_channel(0)[0], samples[70000 * 2]);
+  StreamDecoder::instance().set_offline(false);
+
+  EXPECT_THROW(AudioStream::open(path, frames), std::invalid_argument);
+
+  stream.reset();
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ringbuffer.h"
+#include "seqlock.h"
+#include "metertap.h"
+#include "meteranalyzer.h"
+#include "realtimecheck.h"
+
+using namespace Dsp;
+
+static constexpr double kSampleRate = 48000.0;
+static constexpr unsigned int kFrames = 256;
+
+/** @brief Ring Buffer - Writes wrap around and are truncated when full
+ */
+TEST(MeteringTest, RingBufferWrap)
+{
+  RingBuffer<int> ring(6);
+  EXPECT_EQ(ring.get_capacity(), 8);
+
+  const int first[] = {1, 2, 3, 4, 5, 6};
+  EXPECT_EQ(ring.write(first, 6), 6);
+
+  int out[8] = {};
+  EXPECT_EQ(ring.read(out, 4), 4);
+  EXPECT_EQ(out[3], 4);
+
+  // Wraps past the end of the storage, and the last value does not fit
+  const int second[] = {7, 8, 9, 10, 11, 12, 13};
+  EXPECT_EQ(ring.write(second, 7), 6);
+  EXPECT_EQ(ring.get_write_available(), 0);
+
+  EXPECT_EQ(ring.read(out, 8), 8);
+  const int expected[] = {5, 6, 7, 8, 9, 10, 11, 12};
+  for (int i = 0; i < 8; ++i)
+    EXPECT_EQ(out[i], expected[i]);
+  EXPECT_EQ(ring.get_read_available(), 0);
+}
+
+/** @brief Seqlock - Readers never see a value that is half written
+ */
+TEST(MeteringTest, SeqLockConsistent)
+{
+  struct Value
+  {
+    std::array<uint32_t, 64> words;
+  };
+
+  SeqLock<Value> lock;
+  std::atomic<bool> done{false};
+  std::atomic<int> torn{0};
+
+  std::thread reader([&]()
+  {
+    while (!done.load())
+    {
+      const Value value = lock.load();
+      for (uint32_t word : value.words)
+      {
+        if (word != value.words[0])
+          ++torn;
+      }
+    }
+  });
+
+  for (uint32_t i = 1; i <= 20000; ++i)
+  {
+    Value value;
+    value.words.fill(i);
+    lock.store(value);
+  }
+  done = true;
+  reader.join();
+
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(lock.get_version(), 20000);
+  EXPECT_EQ(lock.load().words[0], 20000);
+}
+
+/** @brief Meter Tap - Levels and spectrum of a sine wave
+ */
+TEST(MeteringTest, MeterTapSine)
+{
+  MeterTap tap("Test");
+  tap.prepare(ProcessSpec{kSampleRate, 2, kFrames, std::pmr::get_default_resource()});
+
+  // 3 kHz sits exactly on bin 64 of the analysis FFT
+  const double frequency = 64.0 * kSampleRate / kSpectrumFftSize;
+  AudioBuffer buffer(2, kFrames);
+  double phase = 0.0;
+  for (int block = 0; block < 40; ++block)
+  {
+    for (unsigned int frame = 0; frame < kFrames; ++frame)
+    {
+      buffer.get_channel(0)[frame] = 0.5f * static_cast<float>(std::sin(phase));
+      buffer.get_channel(1)[frame] = 0.0f;
+      phase += 2.0 * M_PI * frequency / kSampleRate;
+    }
+    tap.push(buffer, kFrames);
+  }
+
+  tap.analyze();
+
+  const MeterLevels levels = tap.get_levels();
+  EXPECT_EQ(levels.channels, 2);
+  EXPECT_NEAR(levels.peak_db[0], 20.0f * std::log10(0.5f), 0.1f);
+  EXPECT_LT(levels.rms_db[0], levels.peak_db[0]);
+  EXPECT_LT(levels.peak_db[1], -100.0f);
+
+  // The channel sum is 0.25 at full scale
+  const SpectrumFrame spectrum = tap.get_spectrum();
+  EXPECT_GT(tap.get_spectrum_version(), 1);
+  EXPECT_NEAR(spectrum.magnitude_db[64], 20.0f * std::log10(0.25f), 0.5f);
+  EXPECT_LT(spectrum.magnitude_db[200], spectrum.magnitude_db[64] - 60.0f);
+  EXPECT_EQ(tap.get_overrun_count(), 0);
+}
+
+/** @brief Meter Analyzer - Registered taps are analyzed on each pass
+ */
+TEST(MeteringTest, AnalyzerProcessesTaps)
+{
+  auto tap = std::make_shared<MeterTap>("Analyzer");
+  tap->prepare(ProcessSpec{kSampleRate, 1, kFrames, std::pmr::get_default_resource()});
+
+  // Apply registrations queued by other tests first
+  MeterAnalyzer::instance().process();
+  const size_t initial = MeterAnalyzer::instance().get_tap_count();
+  MeterAnalyzer::instance().add_tap(tap);
+  MeterAnalyzer::instance().process();
+  EXPECT_EQ(MeterAnalyzer::instance().get_tap_count(), initial + 1);
+
+  AudioBuffer buffer(1, kFrames);
+  std::fill(buffer.get_channel(0), buffer.get_channel(0) + kFrames, 0.25f);
+  tap->push(buffer, kFrames);
+  MeterAnalyzer::instance().process();
+  EXPECT_NEAR(tap->get_levels().peak_db[0], 20.0f * std::log10(0.25f), 0.1f);
+
+  MeterAnalyzer::instance().remove_tap(tap);
+  MeterAnalyzer::instance().process();
+  EXPECT_EQ(MeterAnalyzer::instance().get_tap_count(), initial);
+}
+
+/** @brief Meter Tap - No heap traffic or locks on the audio thread
+ */
+TEST(MeteringTest, PushRealtimeClean)
+{
+  if (!RealtimeChecker::hooks_installed())
+  {
+    GTEST_SKIP() << "realtimecheck_hooks is not linked into this binary";
+  }
+
+  MeterTap tap("Realtime");
+  tap.prepare(ProcessSpec{kSampleRate, 2, kFrames, std::pmr::get_default_resource()});
+  AudioBuffer buffer(2, kFrames);
+
+  RealtimeChecker::instance().reset();
+  {
+    RealtimeScope scope;
+    for (int block = 0; block < 8; ++block)
+      tap.push(buffer, kFrames);
+  }
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_TRUE(report.is_clean()) << realtime_violation_to_string(report.first_violation);
+}
@@ -0,0 +1,228 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "parameterstore.h"
+#include "automation.h"
+#include "smoothedvalue.h"
+#include "gain.h"
+#include "realtimecheck.h"
+
+using namespace Dsp;
+
+/** @brief Parameter Store - Values are clamped to the range and IDs are reused after removal
+ */
+TEST(ParameterTest, StoreAddSetRemove)
+{
+  ParameterStore &store = ParameterStore::instance();
+  const size_t initial = store.get_count();
+
+  ParameterId id = store.add(ParameterInfo{"Cutoff", 20.0f, 20000.0f, 1000.0f});
+  EXPECT_TRUE(store.contains(id));
+  EXPECT_EQ(store.get_count(), initial + 1);
+  EXPECT_FLOAT_EQ(store.get(id), 1000.0f);
+  EXPECT_EQ(store.get_info(id).name, "Cutoff");
+
+  store.set(id, 50000.0f);
+  EXPECT_FLOAT_EQ(store.get(id), 20000.0f);
+  store.set_normalized(id, 0.0f);
+  EXPECT_FLOAT_EQ(store.get(id), 20.0f);
+  store.reset_to_default(id);
+  EXPECT_FLOAT_EQ(store.get(id), 1000.0f);
+
+  EXPECT_THROW(store.add(ParameterInfo{"Bad", 1.0f, 0.0f, 0.5f}), std::invalid_argument);
+
+  store.remove(id);
+  EXPECT_FALSE(store.contains(id));
+  EXPECT_THROW(store.set(id, 1.0f), std::out_of_range);
+  EXPECT_THROW(store.remove(id), std::out_of_range);
+
+  ParameterId reused = store.add(ParameterInfo{"Resonance", 0.1f, 10.0f, 0.707f});
+  EXPECT_EQ(reused, id);
+  EXPECT_FLOAT_EQ(store.get(reused), 0.707f);
+  store.remove(reused);
+  EXPECT_EQ(store.get_count(), initial);
+}
+
+/** @brief Smoothed Value - Linear and exponential ramps reach the target in the smoothing time
+ */
+TEST(ParameterTest, Smoothing)
+{
+  SmoothedValue linear;
+  linear.prepare(1000.0, 10.0f, eSmoothing::Linear);
+  linear.reset(0.0f);
+  linear.set_target(1.0f);
+
+  std::vector<float> ramp;
+  for (int i = 0; i < 12; ++i)
+    ramp.push_back(linear.next());
+
+  EXPECT_FLOAT_EQ(ramp[0], 0.1f);
+  EXPECT_NEAR(ramp[4], 0.5f, 1e-6f);
+  EXPECT_FLOAT_EQ(ramp[9], 1.0f);
+  EXPECT_FLOAT_EQ(ramp[11], 1.0f);
+  EXPECT_FALSE(linear.is_smoothing());
+
+  SmoothedValue exponential;
+  exponential.prepare(1000.0, 10.0f, eSmoothing::Exponential);
+  exponential.reset(0.0f);
+  exponential.set_target(1.0f);
+
+  float previous = 0.0f;
+  for (int i = 0; i < 9; ++i)
+  {
+    const float value = exponential.next();
+    EXPECT_GT(value, previous);
+    EXPECT_LT(value, 1.0f);
+    previous = value;
+  }
+  EXPECT_GT(previous, 0.95f);
+  EXPECT_FLOAT_EQ(exponential.next(), 1.0f);
+
+  // Skipping matches stepping
+  SmoothedValue stepped;
+  SmoothedValue skipped;
+  for (SmoothedValue *value : {&stepped, &skipped})
+  {
+    value->prepare(1000.0, 10.0f, eSmoothing::Exponential);
+    value->reset(0.0f);
+    value->set_target(1.0f);
+  }
+  for (int i = 0; i < 4; ++i)
+    stepped.next();
+  skipped.skip(4);
+  EXPECT_NEAR(stepped.get_current(), skipped.get_current(), 1e-6f);
+}
+
+/** @brief Automation Lane - Incremental evaluation matches a search, including seeks
+ */
+TEST(ParameterTest, AutomationLane)
+{
+  AutomationLane lane({{1000, 1.0f}, {0, 0.0f}, {2000, 0.0f}, {4000, 0.5f}});
+  EXPECT_EQ(lane.get_points().front().position, 0);
+
+  EXPECT_FLOAT_EQ(lane.value_at(500), 0.5f);
+  EXPECT_FLOAT_EQ(lane.value_at(1500), 0.5f);
+  EXPECT_FLOAT_EQ(lane.value_at(3000), 0.25f);
+  EXPECT_FLOAT_EQ(lane.value_at(10000), 0.5f);
+
+  size_t cursor = 0;
+  for (uint64_t position = 0; position < 5000; position += 64)
+  {
+    EXPECT_FLOAT_EQ(lane.value_at(position, cursor), lane.value_at(position)) << "at " << position;
+  }
+
+  // Seek backwards and far forwards
+  EXPECT_FLOAT_EQ(lane.value_at(250, cursor), 0.25f);
+  EXPECT_FLOAT_EQ(lane.value_at(3500, cursor), lane.value_at(3500));
+
+  AutomationLane empty;
+  EXPECT_FLOAT_EQ(empty.value_at(100, cursor), 0.0f);
+}
+
+/** @brief Parameter Store - Automation drives parameter values per block
+ */
+TEST(ParameterTest, ProcessAutomation)
+{
+  ParameterStore &store = ParameterStore::instance();
+  ParameterId id = store.add(ParameterInfo{"Level", 0.0f, 1.0f, 0.0f});
+
+  auto lane = std::make_shared<AutomationLane>();
+  lane->add_point(0, 0.0f);
+  lane->add_point(1000, 2.0f);
+  store.set_automation(id, lane);
+  EXPECT_TRUE(store.has_automation(id));
+
+  store.process_automation(250);
+  EXPECT_FLOAT_EQ(store.get(id), 0.5f);
+
+  // Clamped to the parameter range
+  store.process_automation(900);
+  EXPECT_FLOAT_EQ(store.get(id), 1.0f);
+
+  store.clear_automation(id);
+  store.set(id, 0.2f);
+  store.process_automation(250);
+  EXPECT_FLOAT_EQ(store.get(id), 0.2f);
+
+  store.remove(id);
+}
+
+/** @brief Parameter Store - Offline automation keeps the lanes and cursors it was captured with
+ */
+TEST(ParameterTest, OfflineAutomation)
+{
+  ParameterStore &store = ParameterStore::instance();
+  ParameterId id = store.add(ParameterInfo{"Level", 0.0f, 1.0f, 0.0f});
+
+  auto lane = std::make_shared<AutomationLane>();
+  lane->add_point(0, 0.0f);
+  lane->add_point(1000, 1.0f);
+  store.set_automation(id, lane);
+
+  ParameterStore::OfflineAutomation automation = store.capture_automation();
+
+  auto replaced = std::make_shared<AutomationLane>();
+  replaced->add_point(0, 1.0f);
+  store.set_automation(id, replaced);
+
+  store.process_automation(750, automation);
+  EXPECT_FLOAT_EQ(store.get(id), 0.75f);
+
+  // The live lanes move their own cursors, the offline copy can still go back
+  store.process_automation(100);
+  EXPECT_FLOAT_EQ(store.get(id), 1.0f);
+  store.process_automation(250, automation);
+  EXPECT_FLOAT_EQ(store.get(id), 0.25f);
+
+  store.clear_automation(id);
+  store.process_automation(500, automation);
+  EXPECT_FLOAT_EQ(store.get(id), 0.5f);
+
+  store.remove(id);
+}
+
+/** @brief Gain - Parameters come from the store and automation runs without locks or allocation
+ */
+TEST(ParameterTest, GainAutomationRealtimeClean)
+{
+  Gain gain;
+  ParameterStore &store = ParameterStore::instance();
+  EXPECT_TRUE(store.contains(gain.get_gain_parameter()));
+  EXPECT_TRUE(store.contains(gain.get_pan_parameter()));
+
+  gain.prepare(Dsp::ProcessSpec{48000.0, 2, 256, std::pmr::get_default_resource()});
+
+  auto lane = std::make_shared<AutomationLane>();
+  lane->add_point(0, 0.0f);
+  lane->add_point(48000, -12.0f);
+  store.set_automation(gain.get_gain_parameter(), lane);
+
+  AudioBuffer buffer(2, 256);
+  if (RealtimeChecker::hooks_installed())
+    RealtimeChecker::instance().reset();
+
+  {
+    RealtimeScope scope;
+    for (uint64_t block = 0; block < 150; ++block)
+    {
+      store.process_automation(block * 256);
+      gain.process(buffer, 256);
+    }
+  }
+
+  if (RealtimeChecker::hooks_installed())
+  {
+    auto report = RealtimeChecker::instance().get_report();
+    EXPECT_TRUE(report.is_clean()) << realtime_violation_to_string(report.first_violation);
+  }
+
+  EXPECT_NEAR(gain.get_gain_db(), -12.0f * 149.0f * 256.0f / 48000.0f, 1e-3f);
+
+  const ParameterId gain_id = gain.get_gain_parameter();
+  {
+    Gain other;
+    EXPECT_NE(other.get_gain_parameter(), gain_id);
+  }
+}
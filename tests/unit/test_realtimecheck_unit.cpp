@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+#include "realtimecheck.h"
+#include "audioengine.h"
+
+using namespace Audio;
+
+class RealtimeCheckTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    if (!RealtimeChecker::hooks_installed())
+    {
+      GTEST_SKIP() << "realtimecheck_hooks is not linked into this binary";
+    }
+
+    RealtimeChecker::instance().set_policy(eRealtimeViolationPolicy::Record);
+    RealtimeChecker::instance().reset();
+  }
+};
+
+/** @brief Realtime Check - Clean section records nothing
+ */
+TEST_F(RealtimeCheckTest, CleanSection)
+{
+  float sum = 0.0f;
+  {
+    RealtimeScope scope;
+    for (int i = 0; i < 64; ++i)
+    {
+      sum += static_cast<float>(i);
+    }
+  }
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_TRUE(report.is_clean());
+  EXPECT_GT(sum, 0.0f);
+}
+
+/** @brief Realtime Check - Allocation outside a section is ignored
+ */
+TEST_F(RealtimeCheckTest, AllocationOutsideSection)
+{
+  auto value = std::make_unique<int>(42);
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_TRUE(report.is_clean());
+}
+
+/** @brief Realtime Check - Detect allocation
+ */
+TEST_F(RealtimeCheckTest, DetectAllocation)
+{
+  std::unique_ptr<int> value;
+  {
+    RealtimeScope scope;
+    value = std::make_unique<int>(42);
+  }
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_FALSE(report.is_clean());
+  EXPECT_EQ(report.violations[static_cast<size_t>(eRealtimeViolation::OperatorNew)], 1);
+  EXPECT_EQ(report.first_violation, eRealtimeViolation::OperatorNew);
+  EXPECT_FALSE(report.first_stack_trace.empty());
+}
+
+/** @brief Realtime Check - Detect mutex lock
+ */
+TEST_F(RealtimeCheckTest, DetectMutexLock)
+{
+  std::mutex mutex;
+  {
+    RealtimeScope scope;
+    std::lock_guard<std::mutex> lock(mutex);
+  }
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_EQ(report.violations[static_cast<size_t>(eRealtimeViolation::MutexLock)], 1);
+}
+
+/** @brief Realtime Check - Detect file and device I/O
+ */
+TEST_F(RealtimeCheckTest, DetectFileIo)
+{
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  char byte = 1;
+
+  {
+    RealtimeScope scope;
+    EXPECT_EQ(write(fds[1], &byte, 1), 1);
+    EXPECT_EQ(read(fds[0], &byte, 1), 1);
+    const int fd = open("/dev/null", O_RDONLY);
+    if (fd >= 0)
+      close(fd);
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_EQ(report.violations[static_cast<size_t>(eRealtimeViolation::FileIo)], 3);
+  EXPECT_EQ(report.first_violation, eRealtimeViolation::FileIo);
+  EXPECT_STREQ(realtime_violation_to_string(eRealtimeViolation::FileIo), "file or device I/O");
+}
+
+/** @brief Realtime Check - Detect blocking waits that have a timeout
+ */
+TEST_F(RealtimeCheckTest, DetectBlockingWaits)
+{
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  sem_t semaphore;
+  ASSERT_EQ(sem_init(&semaphore, 0, 1), 0);
+
+  {
+    RealtimeScope scope;
+    condition.wait_for(lock, std::chrono::microseconds(1));
+    sem_wait(&semaphore);
+    poll(nullptr, 0, 0);
+  }
+
+  sem_destroy(&semaphore);
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_GE(report.violations[static_cast<size_t>(eRealtimeViolation::BlockingCall)], 3);
+}
+
+/** @brief Realtime Check - A full AudioEngine render cycle is real-time clean
+ */
+TEST_F(RealtimeCheckTest, AudioEngineRenderCycle)
+{
+  auto &engine = AudioEngine::instance();
+
+  const unsigned int n_frames = engine.get_buffer_frames();
+  std::vector<float> buffer(static_cast<size_t>(n_frames) * engine.get_channels());
+
+  RealtimeChecker::instance().reset();
+  engine.render(buffer.data(), n_frames);
+
+  auto report = RealtimeChecker::instance().get_report();
+  EXPECT_TRUE(report.is_clean()) << "First violation: "
+                                 << realtime_violation_to_string(report.first_violation);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "snapshot.h"
+
+struct CountedValue
+{
+  explicit CountedValue(int value, std::atomic<int> &live): value(value), live(live) { ++live; }
+  ~CountedValue() { --live; }
+
+  int value;
+  std::atomic<int> &live;
+};
+
+/** @brief Snapshot Publisher - Retired snapshots outlive their readers
+ */
+TEST(SnapshotTest, RetireAfterRead)
+{
+  std::atomic<int> live{0};
+  SnapshotPublisher<CountedValue> publisher;
+
+  publisher.publish(std::make_unique<CountedValue>(1, live));
+  {
+    auto guard = publisher.read();
+    ASSERT_TRUE(guard);
+    EXPECT_EQ(guard->value, 1);
+
+    // The reader still holds the first snapshot
+    publisher.publish(std::make_unique<CountedValue>(2, live));
+    EXPECT_EQ(guard->value, 1);
+    EXPECT_EQ(live.load(), 2);
+    EXPECT_EQ(publisher.get_retired_count(), 1);
+  }
+
+  publisher.collect();
+  EXPECT_EQ(live.load(), 1);
+  EXPECT_EQ(publisher.read()->value, 2);
+}
+
+/** @brief Snapshot Publisher - Concurrent reader and writer
+ */
+TEST(SnapshotTest, ConcurrentReadWrite)
+{
+  std::atomic<int> live{0};
+  std::atomic<bool> done{false};
+  SnapshotPublisher<CountedValue> publisher;
+  publisher.publish(std::make_unique<CountedValue>(0, live));
+
+  std::thread reader([&]() {
+    int last = 0;
+    while (!done.load())
+    {
+      auto guard = publisher.read();
+      ASSERT_TRUE(guard);
+      EXPECT_GE(guard->value, last);
+      last = guard->value;
+    }
+  });
+
+  for (int i = 1; i <= 5000; ++i)
+    publisher.publish(std::make_unique<CountedValue>(i, live));
+
+  done.store(true);
+  reader.join();
+  publisher.collect();
+
+  EXPECT_EQ(live.load(), 1);
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <sched.h>
+
+#include "threadconfig.h"
+#include "engine.h"
+
+namespace
+{
+
+/** @brief Runs a config on a fresh thread so the test thread keeps its scheduling
+ */
+ThreadReport apply_on_thread(const ThreadConfig &config)
+{
+  ThreadReport report{};
+  std::thread thread([&]()
+  {
+    report = apply_thread_config(config);
+  });
+  thread.join();
+  return report;
+}
+
+struct TestMessage
+{
+  int value;
+};
+
+class TestEngine : public IEngine<TestMessage>
+{
+public:
+  TestEngine(): IEngine<TestMessage>("TestEngine") {}
+
+protected:
+  void run() override
+  {
+    while (is_running())
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  void handle_messages() override {}
+};
+
+}  // namespace
+
+/** @brief ThreadConfigTest - Normal scheduling is always granted
+ */
+TEST(ThreadConfigTest, NormalPolicy)
+{
+  const ThreadReport report = apply_on_thread(ThreadConfig{});
+
+  EXPECT_TRUE(report.applied);
+  EXPECT_TRUE(report.is_granted());
+  EXPECT_EQ(report.policy, eSchedulingPolicy::Normal);
+  EXPECT_EQ(report.priority, 0);
+  EXPECT_NE(report.cpu_mask, 0u);
+}
+
+/** @brief ThreadConfigTest - A real-time request reports what was granted, whether or not the kernel allowed it
+ */
+TEST(ThreadConfigTest, RealtimePolicyReported)
+{
+  ThreadConfig config;
+  config.policy = eSchedulingPolicy::Fifo;
+  config.priority = 1000;  // Clamped to the policy's maximum
+  const ThreadReport report = apply_on_thread(config);
+
+  EXPECT_EQ(report.requested.priority, 1000);
+  if (report.scheduling_error == 0)
+  {
+    EXPECT_EQ(report.policy, eSchedulingPolicy::Fifo);
+    EXPECT_EQ(report.priority, sched_get_priority_max(SCHED_FIFO));
+  }
+  else
+  {
+    EXPECT_EQ(report.policy, eSchedulingPolicy::Normal);
+    EXPECT_FALSE(report.is_granted());
+    EXPECT_NE(thread_report_to_string(report).find("requested SCHED_FIFO"), std::string::npos);
+  }
+}
+
+/** @brief ThreadConfigTest - Affinity to one allowed CPU and stack prefault are granted
+ */
+TEST(ThreadConfigTest, AffinityAndPrefault)
+{
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+
+  unsigned int cpu = 0;
+  while (cpu < 64 && !CPU_ISSET(cpu, &allowed))
+    ++cpu;
+  ASSERT_LT(cpu, 64u);
+
+  ThreadConfig config;
+  config.cpu_mask = uint64_t{1} << cpu;
+  config.prefault_stack_bytes = 128 * 1024;
+  const ThreadReport report = apply_on_thread(config);
+
+  EXPECT_EQ(report.affinity_error, 0);
+  EXPECT_EQ(report.cpu_mask, config.cpu_mask);
+  EXPECT_EQ(report.prefaulted_bytes, config.prefault_stack_bytes);
+}
+
+/** @brief ThreadConfigTest - IEngine applies its config when the thread starts
+ */
+TEST(ThreadConfigTest, EngineThreadReport)
+{
+  TestEngine engine;
+  EXPECT_FALSE(engine.get_thread_report().applied);
+
+  ThreadConfig config;
+  config.prefault_stack_bytes = 32 * 1024;
+  engine.set_thread_config(config);
+  engine.start_thread();
+  engine.stop_thread();
+
+  const ThreadReport report = engine.get_thread_report();
+  EXPECT_TRUE(report.applied);
+  EXPECT_EQ(report.policy, eSchedulingPolicy::Normal);
+  EXPECT_EQ(report.prefaulted_bytes, config.prefault_stack_bytes);
+}
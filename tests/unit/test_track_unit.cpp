@@ -1,12 +1,21 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include "trackmanager.h"
 #include "track.h"
 #include "audioengine.h"
 #include "filemanager.h"
+#include "audiostream.h"
 #include "wavfile.h"
+#include "gain.h"
+#include "delay.h"
+#include "convolutionreverb.h"
+#include "cliptimeline.h"
 
 using namespace Tracks;
 
@@ -15,8 +24,8 @@ TEST(TrackTest, Setup)
   TrackManager::instance().clear_tracks();
 
   // Create a new track
-  size_t index = TrackManager::instance().add_track();
-  auto track = TrackManager::instance().get_track(index);
+  TrackHandle handle = TrackManager::instance().add_track();
+  auto track = TrackManager::instance().get_track(handle);
 
   EXPECT_NE(track, nullptr) << "Track should not be null after creation";
   EXPECT_EQ(TrackManager::instance().get_track_count(), 1) << "Track count should be 1 after adding a track";
@@ -26,7 +35,7 @@ TEST(TrackTest, Setup)
  */
 TEST(TrackTest, AddAudioInput)
 {
-  auto track = TrackManager::instance().get_track(0);
+  auto track = TrackManager::instance().get_track(TrackManager::instance().get_track_handle(0));
 
   // Add audio input to the track
   track->add_audio_input();
@@ -40,7 +49,7 @@ TEST(TrackTest, AddAudioInput)
  */
 TEST(TrackTest, AddMidiInput)
 {
-  auto track = TrackManager::instance().get_track(0);
+  auto track = TrackManager::instance().get_track(TrackManager::instance().get_track_handle(0));
 
   // Add MIDI input to the track
   track->add_midi_input();
@@ -54,7 +63,7 @@ TEST(TrackTest, AddMidiInput)
  */
 TEST(TrackTest, AddAudioOutput)
 {
-  auto track = TrackManager::instance().get_track(0);
+  auto track = TrackManager::instance().get_track(TrackManager::instance().get_track_handle(0));
 
   // Add audio output to the track
   track->add_audio_output();
@@ -68,11 +77,416 @@ TEST(TrackTest, AddAudioOutput)
  */
 TEST(TrackTest, AddWavFileInput)
 {
-  auto track = TrackManager::instance().get_track(0);
+  auto track = TrackManager::instance().get_track(TrackManager::instance().get_track_handle(0));
 
   // Open a test WAV file and load it into the track
   std::string test_wav_file = "samples/test.wav";
 
   std::shared_ptr<Files::WavFile> wav_file = Files::FileManager::instance().read_wav_file(test_wav_file);
   track->add_audio_file_input(wav_file);
-}
\ No newline at end of file
+}
+
+/** @brief Track - Effect chain runs when the AudioEngine renders
+ */
+TEST(TrackTest, EffectChain)
+{
+  auto &engine = Audio::AudioEngine::instance();
+  auto track = TrackManager::instance().get_track(TrackManager::instance().get_track_handle(0));
+
+  auto delay = std::make_shared<Dsp::Delay>();
+  track->get_effect_chain().add(delay);
+  EXPECT_EQ(track->get_effect_chain().size(), 1);
+
+  std::vector<float> output(engine.get_buffer_frames() * engine.get_channels(), 1.0f);
+  engine.render(output.data(), engine.get_buffer_frames());
+
+  // Tracks have no sources yet, so the bus is silent, but the chain ran within the delay's tail
+  EXPECT_EQ(output[0], 0.0f);
+  EXPECT_EQ(TrackManager::instance().get_active_track_count(), 0);
+  auto statistics = track->get_effect_statistics();
+  ASSERT_EQ(statistics.size(), 1);
+  EXPECT_EQ(statistics[0].name, "Delay");
+  EXPECT_GE(statistics[0].blocks_processed, 1);
+
+  track->get_effect_chain().clear();
+}
+
+/** @brief Track - MIDI input is drained in batches, oldest first, and overflow is counted rather than waited for
+ */
+TEST(TrackTest, MidiQueue)
+{
+  auto track = std::make_shared<Track>();
+
+  Midi::MidiMessage message{};
+  message.type = Midi::eMidiMessageType::ControlChange;
+  message.status = 0xB0;
+  for (unsigned int i = 0; i < Track::kMidiQueueCapacity + 100; ++i)
+  {
+    message.data2 = static_cast<unsigned char>(i & 0x7F);
+    track->update(message);
+  }
+
+  MidiQueueStatistics statistics = track->get_midi_statistics();
+  EXPECT_EQ(statistics.received, Track::kMidiQueueCapacity + 100);
+  EXPECT_EQ(statistics.dropped, 100);
+  EXPECT_EQ(statistics.pending, Track::kMidiQueueCapacity);
+
+  std::vector<Midi::MidiEvent> events(Track::kMidiQueueCapacity);
+  ASSERT_EQ(track->drain_midi_events(events.data(), events.size()), Track::kMidiQueueCapacity);
+  for (unsigned int i = 0; i < Track::kMidiQueueCapacity; ++i)
+  {
+    ASSERT_EQ(events[i].data2, i & 0x7F) << "event " << i;
+  }
+  EXPECT_EQ(track->drain_midi_events(events.data(), events.size()), 0);
+
+  // A sweep from another thread is taken in batches until nothing is left
+  std::thread producer([&]()
+  {
+    for (unsigned int i = 0; i < 100000; ++i)
+      track->update(message);
+  });
+
+  uint64_t drained = 0;
+  bool finished = false;
+  while (!finished)
+  {
+    finished = track->get_midi_statistics().received == Track::kMidiQueueCapacity + 100 + 100000;
+    drained += track->drain_midi_events(events.data(), events.size());
+  }
+  producer.join();
+  drained += track->drain_midi_events(events.data(), events.size());
+
+  statistics = track->get_midi_statistics();
+  EXPECT_EQ(statistics.drained, Track::kMidiQueueCapacity + drained);
+  EXPECT_EQ(statistics.received, statistics.drained + statistics.dropped);
+  EXPECT_EQ(statistics.pending, 0);
+  EXPECT_EQ(statistics.largest_batch, Track::kMidiQueueCapacity);
+  EXPECT_EQ(track->handle_midi_messages(), 0);
+}
+
+/** @brief Track - Clip index finds exactly the clips a brute force scan finds
+ */
+TEST(TrackTest, ClipIndex)
+{
+  auto audio = std::make_shared<AudioBuffer>(1, 100000);
+
+  std::mt19937 random(7);
+  std::uniform_int_distribution<uint64_t> start_dist(0, 1000000);
+  std::uniform_int_distribution<uint64_t> length_dist(1, 100000);
+
+  std::vector<Clip> clips;
+  for (ClipId id = 1; id <= 5000; ++id)
+  {
+    Clip clip;
+    clip.id = id;
+    clip.start = start_dist(random);
+    clip.length = id % 100 == 0 ? 100000 : length_dist(random) % 2000 + 1;
+    clip.audio = audio;
+    clips.push_back(clip);
+  }
+
+  ClipIndex index(clips);
+  ASSERT_EQ(index.size(), clips.size());
+
+  for (int query = 0; query < 500; ++query)
+  {
+    const uint64_t begin = start_dist(random);
+    const uint64_t end = begin + 1 + length_dist(random) % 4096;
+
+    std::set<ClipId> expected;
+    for (const auto &clip : clips)
+    {
+      if (clip.start < end && begin < clip.get_end())
+        expected.insert(clip.id);
+    }
+
+    std::set<ClipId> found;
+    index.for_each_overlapping(begin, end, [&found](const Clip &clip) { found.insert(clip.id); });
+    EXPECT_EQ(found, expected) << "Query [" << begin << ", " << end << ")";
+  }
+}
+
+/** @brief Track - Audio clips play at their timeline position while the transport runs
+ */
+TEST(TrackTest, AudioClipTimeline)
+{
+  Track track;
+  track.prepare(Dsp::ProcessSpec{48000.0, 2, 64, std::pmr::get_default_resource()});
+
+  auto audio = std::make_shared<AudioBuffer>(1, 32);
+  for (unsigned int i = 0; i < 32; ++i)
+    audio->get_channel(0)[i] = static_cast<float>(i + 1);
+
+  Clip clip;
+  clip.start = 100;
+  clip.length = 16;
+  clip.offset = 8;
+  clip.gain = 0.5f;
+  clip.audio = audio;
+
+  auto &timeline = track.get_timeline();
+  const ClipId id = timeline.add_clip(clip);
+  EXPECT_EQ(timeline.get_clip_count(), 1);
+  EXPECT_EQ(timeline.find_clips(90, 110), std::vector<ClipId>{id});
+  EXPECT_TRUE(timeline.find_clips(116, 200).empty());
+
+  // Block [96, 160) holds the clip at frames 4 to 19, from source frame 8
+  Audio::TransportState transport{};
+  transport.playing = true;
+  transport.position = 96;
+
+  AudioBuffer output(2, 64);
+  track.render(output, transport, 64);
+  for (unsigned int ch = 0; ch < 2; ++ch)
+  {
+    EXPECT_EQ(output.get_channel(ch)[3], 0.0f);
+    EXPECT_NEAR(output.get_channel(ch)[4], 0.5f * 9.0f, 1e-4f);
+    EXPECT_NEAR(output.get_channel(ch)[19], 0.5f * 24.0f, 1e-4f);
+    EXPECT_EQ(output.get_channel(ch)[20], 0.0f);
+  }
+
+  // Stopped transport plays nothing
+  transport.playing = false;
+  track.render(output, transport, 64);
+  EXPECT_EQ(output.get_channel(0)[4], 0.0f);
+
+  timeline.move_clip(id, 0);
+  transport.playing = true;
+  transport.position = 0;
+  track.render(output, transport, 64);
+  EXPECT_NEAR(output.get_channel(0)[0], 0.5f * 9.0f, 1e-4f);
+
+  clip.length = 32;
+  EXPECT_THROW(timeline.add_clip(clip), std::invalid_argument);
+  EXPECT_THROW(timeline.remove_clip(id + 1), std::out_of_range);
+
+  timeline.remove_clip(id);
+  EXPECT_EQ(timeline.get_clip_count(), 0);
+}
+
+/** @brief Track - Clips from one WAV file share a single decoded copy
+ */
+TEST(TrackTest, WavFileClips)
+{
+  auto wav_file = Files::FileManager::instance().read_wav_file("samples/test.wav");
+
+  ClipTimeline timeline;
+  const ClipId first = timeline.add_audio_clip(wav_file, 0);
+  const ClipId second = timeline.add_audio_clip(wav_file, 48000, 100, 1000);
+
+  const Clip a = timeline.get_clip(first);
+  const Clip b = timeline.get_clip(second);
+  EXPECT_EQ(a.length, static_cast<uint64_t>(wav_file->get_frames()));
+  EXPECT_EQ(b.length, 1000);
+  EXPECT_EQ(a.audio, b.audio);
+
+  EXPECT_THROW(timeline.add_audio_clip(wav_file, 0, wav_file->get_frames()), std::invalid_argument);
+}
+
+/** @brief Track - A streamed clip renders the same audio as the decoded clip of the same file
+ */
+TEST(TrackTest, StreamedClips)
+{
+  const Dsp::ProcessSpec spec{48000.0, 2, 256, std::pmr::get_default_resource()};
+
+  auto wav_file = Files::FileManager::instance().read_wav_file("samples/test.wav");
+  const uint64_t length = std::min<uint64_t>(static_cast<uint64_t>(wav_file->get_frames()) - 100, 48000 * 4);
+
+  Track decoded;
+  decoded.prepare(spec);
+  decoded.get_timeline().add_audio_clip(wav_file, 1000, 100, length);
+
+  Track streamed;
+  streamed.prepare(spec);
+  const ClipId id = streamed.get_timeline().add_streamed_clip("samples/test.wav", 1000, 100, length);
+  const Clip clip = streamed.get_timeline().get_clip(id);
+  ASSERT_TRUE(clip.stream);
+  EXPECT_FALSE(clip.audio);
+  EXPECT_EQ(clip.length, length);
+  EXPECT_EQ(clip.stream->get_cue_frame(), 100);
+
+  // Offline, so reads wait for the decoder as in a bounce
+  Files::StreamDecoder::instance().set_offline(true);
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+
+  AudioBuffer expected(2, 256);
+  AudioBuffer actual(2, 256);
+  for (transport.position = 0; transport.position < length + 2000; transport.position += 256)
+  {
+    decoded.render(expected, transport, 256);
+    streamed.render(actual, transport, 256);
+    for (unsigned int ch = 0; ch < 2; ++ch)
+    {
+      for (unsigned int frame = 0; frame < 256; ++frame)
+      {
+        ASSERT_EQ(actual.get_channel(ch)[frame], expected.get_channel(ch)[frame])
+          << "position " << transport.position + frame;
+      }
+    }
+  }
+
+  Files::StreamDecoder::instance().set_offline(false);
+  EXPECT_EQ(clip.stream->get_statistics().underruns, 0);
+
+  EXPECT_THROW(streamed.get_timeline().add_streamed_clip("samples/test.wav", 0, wav_file->get_frames()),
+               std::invalid_argument);
+}
+
+/** @brief Track - A frozen track plays its render, the same audio as its live clips and effects
+ */
+TEST(TrackTest, Freeze)
+{
+  const Dsp::ProcessSpec spec{48000.0, 2, 256, std::pmr::get_default_resource()};
+
+  auto wav_file = Files::FileManager::instance().read_wav_file("samples/test.wav");
+  const uint64_t length = std::min<uint64_t>(static_cast<uint64_t>(wav_file->get_frames()), 48000 * 2);
+
+  auto make_track = [&]()
+  {
+    auto track = std::make_shared<Track>();
+    auto gain = std::make_shared<Dsp::Gain>();
+    gain->set_gain_db(-6.0f);
+    track->get_effect_chain().insert(0, gain);
+    track->prepare(spec);
+    track->get_timeline().add_audio_clip(wav_file, 500, 0, length);
+    return track;
+  };
+
+  auto live = make_track();
+  auto frozen = make_track();
+
+  EXPECT_FALSE(frozen->is_frozen());
+  EXPECT_FALSE(frozen->get_freeze_statistics().frozen);
+
+  FreezeOptions options;
+  options.directory = std::filesystem::temp_directory_path() / "eae_freeze_test";
+  options.tail_frames = 1000;
+  frozen->freeze(options);
+
+  const FreezeStatistics statistics = frozen->get_freeze_statistics();
+  ASSERT_TRUE(frozen->is_frozen());
+  EXPECT_TRUE(statistics.frozen);
+  EXPECT_EQ(statistics.frames, 500 + length + 1000);
+  EXPECT_TRUE(std::filesystem::exists(statistics.filepath));
+  EXPECT_GT(statistics.realtime_factor, 1.0);
+  EXPECT_GE(statistics.reclaimed_load, 0.0);
+  EXPECT_EQ(statistics.sample_rate, 48000u);
+  EXPECT_THROW(frozen->freeze(options), std::logic_error);
+
+  // A bounce at another rate would unfreeze the track, so it is refused
+  BounceOptions bounce_options;
+  bounce_options.sample_rate = 44100;
+  EXPECT_THROW(bounce_session({frozen}, {}, options.directory / "bounce.wav", bounce_options),
+               std::invalid_argument);
+  EXPECT_TRUE(frozen->is_frozen());
+
+  Files::StreamDecoder::instance().set_offline(true);
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+
+  AudioBuffer expected(2, 256);
+  AudioBuffer actual(2, 256);
+  for (transport.position = 0; transport.position < statistics.frames + 512; transport.position += 256)
+  {
+    live->render(expected, transport, 256);
+    frozen->render(actual, transport, 256);
+    for (unsigned int ch = 0; ch < 2; ++ch)
+    {
+      for (unsigned int frame = 0; frame < 256; ++frame)
+      {
+        ASSERT_EQ(actual.get_channel(ch)[frame], expected.get_channel(ch)[frame])
+          << "position " << transport.position + frame;
+      }
+    }
+  }
+
+  Files::StreamDecoder::instance().set_offline(false);
+
+  // Unfrozen, the effects run live again and the render is deleted
+  frozen->get_effect_chain().remove(0);
+  frozen->unfreeze();
+  EXPECT_FALSE(frozen->is_frozen());
+  EXPECT_FALSE(std::filesystem::exists(statistics.filepath));
+
+  transport.position = 500 + 4096;
+  live->render(expected, transport, 256);
+  frozen->render(actual, transport, 256);
+  for (unsigned int frame = 0; frame < 256; ++frame)
+  {
+    EXPECT_NEAR(expected.get_channel(0)[frame], actual.get_channel(0)[frame] * 0.5012f, 1e-4f);
+  }
+
+  std::filesystem::remove_all(options.directory);
+
+  Track empty;
+  empty.prepare(spec);
+  EXPECT_THROW(empty.freeze(), std::logic_error);
+}
+
+/** @brief Track - A frozen latent effect lines up with the timeline, whatever block size it renders at
+ */
+TEST(TrackTest, FreezeLatentEffect)
+{
+  // The reverb's latency is the block size rounded up, 256 live and 1024 for the freeze
+  const Dsp::ProcessSpec spec{48000.0, 2, 256, std::pmr::get_default_resource()};
+  const unsigned int live_latency = 256;
+
+  auto wav_file = Files::FileManager::instance().read_wav_file("samples/test.wav");
+  const uint64_t length = std::min<uint64_t>(static_cast<uint64_t>(wav_file->get_frames()), 48000);
+
+  AudioBuffer impulse(1, 100);
+  impulse.clear();
+  impulse.get_channel(0)[0] = 0.5f;
+  impulse.get_channel(0)[40] = 0.25f;
+
+  auto make_track = [&]()
+  {
+    auto track = std::make_shared<Track>();
+    auto reverb = std::make_shared<Dsp::ConvolutionReverb>();
+    reverb->set_impulse_response(impulse, 100, 48000.0);
+    track->get_effect_chain().insert(0, reverb);
+    track->prepare(spec);
+    track->get_timeline().add_audio_clip(wav_file, 300, 0, length);
+    return track;
+  };
+
+  auto live = make_track();
+  auto frozen = make_track();
+  ASSERT_EQ(live->get_latency(), live_latency);
+
+  FreezeOptions options;
+  options.directory = std::filesystem::temp_directory_path() / "eae_freeze_latency_test";
+  options.block_frames = 1024;
+  options.tail_frames = 200;
+  frozen->freeze(options);
+  const uint64_t frames = frozen->get_freeze_statistics().frames;
+
+  Files::StreamDecoder::instance().set_offline(true);
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+
+  std::vector<float> expected;
+  std::vector<float> actual;
+  AudioBuffer buffer(2, 256);
+  for (transport.position = 0; transport.position < frames + live_latency; transport.position += 256)
+  {
+    live->render(buffer, transport, 256);
+    expected.insert(expected.end(), buffer.get_channel(0), buffer.get_channel(0) + 256);
+    frozen->render(buffer, transport, 256);
+    actual.insert(actual.end(), buffer.get_channel(0), buffer.get_channel(0) + 256);
+  }
+
+  Files::StreamDecoder::instance().set_offline(false);
+
+  for (uint64_t frame = 0; frame < frames; ++frame)
+  {
+    ASSERT_NEAR(actual[frame], expected[frame + live_latency], 1e-4f) << "frame " << frame;
+  }
+
+  frozen->unfreeze();
+  std::filesystem::remove_all(options.directory);
+}
@@ -1,10 +1,64 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include "trackmanager.h"
+#include "bounce.h"
+#include "wavfile.h"
+#include "renderplan.h"
+#include "transport.h"
+#include "delayline.h"
+#include "delay.h"
+#include "compressor.h"
+#include "allocators.h"
 
 using namespace Tracks;
 
+namespace
+{
+
+/** @class LatentProcessor
+ *  @brief Passes audio through late by a fixed latency, as a lookahead effect would
+ */
+class LatentProcessor : public Dsp::IProcessor
+{
+public:
+  explicit LatentProcessor(const unsigned int latency):
+    IProcessor("Latent"),
+    m_latency(latency)
+  {
+  }
+
+  unsigned int get_latency() const noexcept override { return m_latency; }
+  void reset() noexcept override
+  {
+    if (m_line)
+      m_line->reset();
+  }
+
+protected:
+  void do_prepare(const Dsp::ProcessSpec &spec) override
+  {
+    m_line.emplace(spec.channels, m_latency, spec.max_frames, spec.resource);
+  }
+
+  void do_process(AudioBuffer &buffer, const unsigned int n_frames) noexcept override
+  {
+    m_line->process(buffer, n_frames);
+  }
+
+private:
+  unsigned int m_latency;
+  std::optional<Dsp::DelayLine> m_line;
+};
+
+}  // namespace
+
 
 /** @brief Track Manager - Add a Track 
  */
@@ -16,10 +70,10 @@ TEST(TrackManagerTest, AddTrack)
   EXPECT_EQ(TrackManager::instance().get_track_count(), 0);
 
   // Add a new track
-  size_t index = TrackManager::instance().add_track();
+  TrackHandle handle = TrackManager::instance().add_track();
 
   // Get the track
-  auto track = TrackManager::instance().get_track(index);
+  auto track = TrackManager::instance().get_track(handle);
 
   // Verify the track was added successfully
   EXPECT_NE(track, nullptr);
@@ -33,17 +87,493 @@ TEST(TrackManagerTest, RemoveTrack)
   TrackManager::instance().clear_tracks();
 
   // Add a new track
-  size_t index = TrackManager::instance().add_track();
+  TrackHandle handle = TrackManager::instance().add_track();
   EXPECT_EQ(TrackManager::instance().get_track_count(), 1);
 
   // Remove the track
-  TrackManager::instance().remove_track(index);
+  TrackManager::instance().remove_track(handle);
 
   // Attempt to get the removed track
   EXPECT_ANY_THROW(
-    TrackManager::instance().get_track(index)
+    TrackManager::instance().get_track(handle)
   );
   
   // Verify the track was removed successfully
   EXPECT_EQ(TrackManager::instance().get_track_count(), 0);
-}
\ No newline at end of file
+}
+
+/** @brief Track Manager - Handles stay valid as other tracks come and go, and stale handles are refused
+ */
+TEST(TrackManagerTest, TrackHandles)
+{
+  TrackSlotMap slots;
+  const TrackHandle first = slots.insert(std::make_shared<Track>());
+  const TrackHandle second = slots.insert(std::make_shared<Track>());
+  const TrackHandle third = slots.insert(std::make_shared<Track>());
+  const auto third_track = slots.get(third);
+
+  slots.erase(second);
+  EXPECT_FALSE(slots.contains(second));
+  EXPECT_THROW(slots.get(second), std::out_of_range);
+  EXPECT_EQ(slots.get(third), third_track);
+  EXPECT_EQ(slots.get_position(third), 1);
+  EXPECT_EQ(slots.get_handle(1), third);
+
+  // The freed slot is reused under a new generation, the old handle still names nothing
+  const TrackHandle fourth = slots.insert(std::make_shared<Track>());
+  EXPECT_EQ(fourth.index, second.index);
+  EXPECT_NE(fourth, second);
+  EXPECT_FALSE(slots.contains(second));
+  EXPECT_EQ(slots.get_position(fourth), 2);
+  EXPECT_FALSE(TrackHandle{}.is_valid());
+  EXPECT_FALSE(slots.contains(TrackHandle{}));
+
+  slots.clear();
+  EXPECT_EQ(slots.size(), 0);
+  EXPECT_FALSE(slots.contains(first));
+  EXPECT_THROW(slots.get_handle(0), std::out_of_range);
+
+  for (size_t i = 0; i < TrackSlotMap::kMaxTracks; ++i)
+    slots.insert(nullptr);
+  EXPECT_THROW(slots.insert(nullptr), std::length_error);
+}
+
+/** @brief Track Manager - Muted tracks and tracks left out by a solo are not rendered
+ */
+TEST(TrackManagerTest, MuteSolo)
+{
+  const Dsp::ProcessSpec spec{48000.0, 2, 64, std::pmr::get_default_resource()};
+
+  TrackSlotMap slots;
+  std::vector<TrackHandle> handles;
+  for (const float level : {1.0f, 2.0f, 4.0f})
+  {
+    auto audio = std::make_shared<AudioBuffer>(1, 64);
+    std::fill(audio->get_channel(0), audio->get_channel(0) + 64, level);
+
+    auto track = std::make_shared<Track>();
+    track->prepare(spec);
+    Clip clip;
+    clip.length = 64;
+    clip.audio = audio;
+    track->get_timeline().add_clip(clip);
+    handles.push_back(slots.insert(track));
+  }
+
+  auto plan = RenderPlan::compile(slots, {}, spec);
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+  AudioBuffer master(2, 64);
+  auto expect_render = [&](const float level, const unsigned int active)
+  {
+    master.clear(64);
+    EXPECT_EQ(plan->run(master, transport, 64), active);
+    EXPECT_NEAR(master.get_channel(0)[0], level, 1e-5f);
+  };
+
+  expect_render(7.0f, 3);
+
+  slots.set_mute(handles[1], true);
+  EXPECT_TRUE(slots.is_muted(handles[1]));
+  expect_render(5.0f, 2);
+
+  // Solo leaves out everything not soloed, a muted solo is still muted
+  slots.set_solo(handles[2], true);
+  expect_render(4.0f, 1);
+  slots.set_solo(handles[1], true);
+  expect_render(4.0f, 1);
+  slots.set_mute(handles[1], false);
+  expect_render(6.0f, 2);
+
+  // Removing the soloed track releases its solo
+  slots.set_solo(handles[2], false);
+  slots.erase(handles[1]);
+  EXPECT_EQ(slots.get_audible_tracks().size(), 2);
+  EXPECT_THROW(slots.set_mute(handles[1], true), std::out_of_range);
+}
+
+/** @brief Track Manager - Preparing and reconfiguring again and again fits in the engine's locked buffer pool
+ */
+TEST(TrackManagerTest, ReconfigureInBufferPool)
+{
+  LockedMemoryPool pool(Audio::AudioEngine::kBufferPoolBytes);
+
+  std::vector<std::shared_ptr<Track>> tracks;
+  for (unsigned int i = 0; i < 4; ++i)
+  {
+    auto track = std::make_shared<Track>();
+    if (i == 0)
+      track->get_effect_chain().add(std::make_shared<Dsp::Delay>(500.0f));
+    track->get_effect_chain().add(std::make_shared<Dsp::Compressor>());
+    track->get_effect_chain().add(std::make_shared<LatentProcessor>(10 * i));
+    tracks.push_back(track);
+  }
+
+  std::vector<std::shared_ptr<Bus>> buses;
+  buses.push_back(std::make_shared<Bus>("Lookahead"));
+  buses[0]->get_effect_chain().add(std::make_shared<LatentProcessor>(64));
+
+  const unsigned int block_sizes[] = {64, 128, 256, 512, 1024, 2048};
+  const unsigned int sample_rates[] = {44100, 48000, 96000};
+
+  size_t first_used = 0;
+  for (unsigned int cycle = 0; cycle < 500; ++cycle)
+  {
+    const Dsp::ProcessSpec spec{static_cast<double>(sample_rates[cycle % 3]), 2, block_sizes[cycle % 6], &pool};
+    for (auto &track : tracks)
+      track->prepare(spec);
+    for (auto &bus : buses)
+      bus->prepare(spec);
+
+    auto plan = RenderPlan::compile(tracks, buses, spec);
+    ASSERT_GT(plan->get_delay_line_count(), 0);
+
+    Audio::TransportState transport{};
+    AudioBuffer master(2, spec.max_frames, &pool);
+    plan->run(master, transport, spec.max_frames);
+
+    if (cycle == 0)
+    {
+      first_used = pool.get_used();
+    }
+    else if (cycle % 6 == 0)
+    {
+      EXPECT_EQ(pool.get_used(), first_used) << "cycle " << cycle;
+    }
+  }
+}
+
+/** @brief Track Manager - Add a reverb send bus and route a track to it
+ */
+TEST(TrackManagerTest, ReverbSendBus)
+{
+  TrackManager::instance().clear_tracks();
+  TrackManager::instance().clear_send_buses();
+
+  size_t bus_index = TrackManager::instance().add_reverb_bus("samples/test.wav");
+  EXPECT_EQ(TrackManager::instance().get_send_bus_count(), 1);
+
+  auto bus = TrackManager::instance().get_send_bus(bus_index);
+  EXPECT_EQ(bus->get_effect_chain().size(), 1);
+
+  auto track = TrackManager::instance().get_track(TrackManager::instance().add_track());
+  track->set_send_level(bus_index, 0.5f);
+  EXPECT_FLOAT_EQ(track->get_send_level(bus_index), 0.5f);
+  EXPECT_THROW(track->set_send_level(Track::kMaxSends, 1.0f), std::out_of_range);
+
+  EXPECT_ANY_THROW(TrackManager::instance().get_send_bus(bus_index + 1));
+
+  TrackManager::instance().clear_send_buses();
+  TrackManager::instance().clear_tracks();
+  EXPECT_EQ(TrackManager::instance().get_send_bus_count(), 0);
+}
+
+/** @brief Track Manager - Render plan shares scratch slots and sums tracks, sends and returns
+ */
+TEST(TrackManagerTest, RenderPlan)
+{
+  const Dsp::ProcessSpec spec{48000.0, 2, 64, std::pmr::get_default_resource()};
+
+  // A full scale clip at the start of the timeline
+  auto audio = std::make_shared<AudioBuffer>(1, 64);
+  std::fill(audio->get_channel(0), audio->get_channel(0) + 64, 1.0f);
+
+  std::vector<std::shared_ptr<Track>> tracks;
+  for (int i = 0; i < 16; ++i)
+  {
+    auto track = std::make_shared<Track>();
+    track->prepare(spec);
+
+    Clip clip;
+    clip.length = 64;
+    clip.audio = audio;
+    track->get_timeline().add_clip(clip);
+    tracks.push_back(track);
+  }
+
+  std::vector<std::shared_ptr<Bus>> buses;
+  for (int i = 0; i < 2; ++i)
+  {
+    auto bus = std::make_shared<Bus>("Send");
+    bus->prepare(spec);
+    buses.push_back(bus);
+  }
+
+  tracks[0]->set_send_level(0, 0.5f);
+  tracks[1]->set_send_level(1, 0.25f);
+  buses[1]->set_return_level(2.0f);
+
+  auto plan = RenderPlan::compile(tracks, buses, spec);
+
+  // One slot shared by every track, one per bus
+  EXPECT_EQ(plan->get_slot_count(), buses.size() + 1);
+  EXPECT_EQ(plan->get_delay_line_count(), 0);
+  EXPECT_EQ(plan->get_latency(), 0);
+  EXPECT_EQ(plan->get_scratch_bytes(), (buses.size() + 1) * 2 * 64 * sizeof(float));
+
+  // Every track renders before any bus processes
+  size_t last_track = 0;
+  size_t first_bus = plan->get_steps().size();
+  for (size_t i = 0; i < plan->get_steps().size(); ++i)
+  {
+    const RenderStep &step = plan->get_steps()[i];
+    if (step.op == eRenderOp::RenderTrack)
+      last_track = i;
+    if (step.op == eRenderOp::ProcessBus)
+      first_bus = std::min(first_bus, i);
+  }
+  EXPECT_LT(last_track, first_bus);
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+
+  AudioBuffer master(2, 64);
+  plan->run(master, transport, 64);
+
+  // 16 tracks direct, plus 0.5 through bus 0 and 0.25 * 2 through bus 1
+  EXPECT_NEAR(master.get_channel(0)[0], 17.0f, 1e-3f);
+  EXPECT_NEAR(master.get_channel(1)[63], 17.0f, 1e-3f);
+}
+
+/** @brief Track Manager - Tracks and buses with different latencies reach the master bus together
+ */
+TEST(TrackManagerTest, LatencyCompensation)
+{
+  const Dsp::ProcessSpec spec{48000.0, 2, 64, std::pmr::get_default_resource()};
+
+  // An impulse at the start of the timeline on every track
+  auto audio = std::make_shared<AudioBuffer>(1, 1);
+  audio->get_channel(0)[0] = 1.0f;
+
+  const unsigned int track_latencies[] = {100, 30, 0};
+  std::vector<std::shared_ptr<Track>> tracks;
+  std::vector<std::shared_ptr<LatentProcessor>> processors;
+  for (const unsigned int latency : track_latencies)
+  {
+    auto track = std::make_shared<Track>();
+    if (latency > 0)
+    {
+      processors.push_back(std::make_shared<LatentProcessor>(latency));
+      track->get_effect_chain().add(processors.back());
+    }
+    track->prepare(spec);
+
+    Clip clip;
+    clip.length = 1;
+    clip.audio = audio;
+    track->get_timeline().add_clip(clip);
+    tracks.push_back(track);
+  }
+  EXPECT_EQ(tracks[0]->get_latency(), 100);
+
+  std::vector<std::shared_ptr<Bus>> buses;
+  buses.push_back(std::make_shared<Bus>("Lookahead"));
+  buses.push_back(std::make_shared<Bus>("Plain"));
+  buses[0]->get_effect_chain().add(std::make_shared<LatentProcessor>(50));
+  for (auto &bus : buses)
+    bus->prepare(spec);
+  EXPECT_EQ(buses[0]->get_latency(), 50);
+
+  tracks[2]->set_send_level(0, 1.0f);
+  tracks[1]->set_send_level(1, 1.0f);
+
+  auto plan = RenderPlan::compile(tracks, buses, spec);
+  EXPECT_EQ(plan->get_latency(), 150);
+  EXPECT_TRUE(plan->is_latency_current());
+
+  // Tracks 1 and 2 and the plain bus are delayed once each, the direct paths by the lookahead bus
+  size_t delays = 0;
+  size_t delayed_mixes = 0;
+  for (const RenderStep &step : plan->get_steps())
+  {
+    delays += step.op == eRenderOp::Delay;
+    delayed_mixes += step.op == eRenderOp::DelayMix;
+  }
+  EXPECT_EQ(delays, 3);
+  EXPECT_EQ(delayed_mixes, 3);
+  EXPECT_EQ(plan->get_delay_line_count(), 6);
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+  AudioBuffer master(2, 64);
+
+  // Three direct impulses and two through the buses, all at the plan latency
+  for (transport.position = 0; transport.position < 320; transport.position += 64)
+  {
+    master.clear(64);
+    plan->run(master, transport, 64);
+    for (unsigned int frame = 0; frame < 64; ++frame)
+    {
+      const float expected = transport.position + frame == 150 ? 5.0f : 0.0f;
+      ASSERT_NEAR(master.get_channel(0)[frame], expected, 1e-5f) << "frame " << transport.position + frame;
+    }
+  }
+
+  // A bounce lines up the same way, and drops the latency
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "bounce_latency_test.wav";
+  BounceOptions options;
+  options.block_frames = 64;
+  options.length = 300;
+  bounce_session(tracks, buses, path, options);
+
+  auto file = Files::FileManager::instance().read_wav_file(path);
+  ASSERT_EQ(file->get_frames(), 300);
+  AudioBuffer bounced(2, 300);
+  file->read(bounced, 300);
+  EXPECT_NEAR(bounced.get_channel(0)[0], 5.0f, 1e-5f);
+  EXPECT_NEAR(*std::max_element(bounced.get_channel(0) + 1, bounced.get_channel(0) + 300), 0.0f, 1e-5f);
+  std::filesystem::remove(path);
+
+  // Bypassing an effect with latency makes the plan stale
+  processors[0]->set_bypassed(true);
+  EXPECT_FALSE(plan->is_latency_current());
+  EXPECT_EQ(RenderPlan::compile(tracks, buses, spec)->get_latency(), 80);
+}
+
+/** @brief Track Manager - Bounce a session to WAV, bit-identical whatever the thread count
+ */
+TEST(TrackManagerTest, Bounce)
+{
+  // Clips of different lengths and levels, so every track contributes differently
+  std::vector<std::shared_ptr<Track>> tracks;
+  for (int i = 0; i < 12; ++i)
+  {
+    auto audio = std::make_shared<AudioBuffer>(1, 3000 + 100 * i);
+    for (unsigned int frame = 0; frame < audio->get_frames(); ++frame)
+      audio->get_channel(0)[frame] = 0.01f * static_cast<float>((frame * (i + 3)) % 97) / 97.0f;
+
+    auto track = std::make_shared<Track>();
+    Clip clip;
+    clip.start = 50 * i;
+    clip.length = audio->get_frames();
+    clip.audio = audio;
+    track->get_timeline().add_clip(clip);
+    track->set_send_level(i % 2, 0.3f);
+    tracks.push_back(track);
+  }
+
+  std::vector<std::shared_ptr<Bus>> buses;
+  for (int i = 0; i < 2; ++i)
+    buses.push_back(std::make_shared<Bus>("Send"));
+  buses[1]->set_return_level(0.5f);
+
+  const std::filesystem::path serial_path = std::filesystem::temp_directory_path() / "bounce_serial_test.wav";
+  const std::filesystem::path parallel_path = std::filesystem::temp_directory_path() / "bounce_parallel_test.wav";
+
+  BounceOptions options;
+  options.block_frames = 256;
+  options.tail_frames = 100;
+  options.threads = 1;
+  double progress = 0.0;
+  options.progress = [&progress](double value) { progress = value; };
+  const BounceResult serial = bounce_session(tracks, buses, serial_path, options);
+
+  options.threads = 4;
+  options.progress = nullptr;
+  const BounceResult parallel = bounce_session(tracks, buses, parallel_path, options);
+
+  // The last clip ends at 550 + 4100, then the tail
+  const uint64_t expected_frames = 550 + 4100 + 100;
+  EXPECT_EQ(serial.frames, expected_frames);
+  EXPECT_EQ(parallel.frames, expected_frames);
+  EXPECT_EQ(serial.threads, 1u);
+  EXPECT_EQ(parallel.threads, 4u);
+  EXPECT_DOUBLE_EQ(progress, 1.0);
+
+  auto serial_file = Files::FileManager::instance().read_wav_file(serial_path);
+  auto parallel_file = Files::FileManager::instance().read_wav_file(parallel_path);
+  ASSERT_EQ(serial_file->get_frames(), static_cast<sf_count_t>(expected_frames));
+  ASSERT_EQ(parallel_file->get_frames(), static_cast<sf_count_t>(expected_frames));
+
+  AudioBuffer serial_audio(2, expected_frames);
+  AudioBuffer parallel_audio(2, expected_frames);
+  serial_file->read(serial_audio, expected_frames);
+  parallel_file->read(parallel_audio, expected_frames);
+
+  // The same sums as the live render plan, block by block
+  const Dsp::ProcessSpec spec{48000.0, 2, 256, std::pmr::get_default_resource()};
+  for (auto &track : tracks)
+    track->prepare(spec);
+  for (auto &bus : buses)
+    bus->prepare(spec);
+  auto plan = RenderPlan::compile(tracks, buses, spec);
+
+  Audio::TransportState transport{};
+  transport.playing = true;
+  AudioBuffer master(2, 256);
+
+  bool any_signal = false;
+  for (uint64_t position = 0; position < expected_frames; position += 256)
+  {
+    const unsigned int frames = static_cast<unsigned int>(std::min<uint64_t>(256, expected_frames - position));
+    transport.position = position;
+    master.clear(frames);
+    plan->run(master, transport, frames);
+
+    for (unsigned int ch = 0; ch < 2; ++ch)
+    {
+      for (unsigned int frame = 0; frame < frames; ++frame)
+      {
+        const float expected = master.get_channel(ch)[frame];
+        ASSERT_EQ(serial_audio.get_channel(ch)[position + frame], expected);
+        ASSERT_EQ(parallel_audio.get_channel(ch)[position + frame], expected);
+        any_signal = any_signal || expected != 0.0f;
+      }
+    }
+  }
+  EXPECT_TRUE(any_signal);
+
+  std::filesystem::remove(serial_path);
+  std::filesystem::remove(parallel_path);
+}
+
+/** @brief Track Manager - Engine statistics do not wait for a bounce to finish
+ */
+TEST(TrackManagerTest, LatencyDuringBounce)
+{
+  TrackManager &manager = TrackManager::instance();
+  manager.clear_tracks();
+  manager.get_track(manager.add_track())->get_effect_chain().insert(0, std::make_shared<LatentProcessor>(100));
+  manager.prepare(2, 48000, 256, std::pmr::get_default_resource());
+  EXPECT_EQ(manager.get_latency(), 100);
+
+  std::atomic<bool> started{false};
+  std::atomic<bool> polled{false};
+  std::atomic<bool> finished{false};
+
+  // The first block holds the bounce until the statistics have been read, or for 2 s
+  BounceOptions options;
+  options.block_frames = 256;
+  options.length = 48000;
+  options.threads = 1;
+  options.progress = [&](double)
+  {
+    if (started.exchange(true))
+      return;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!polled.load() && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  };
+
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "bounce_statistics_test.wav";
+  std::thread bouncer([&]()
+  {
+    manager.bounce(path, options);
+    finished.store(true);
+  });
+
+  while (!started.load())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  const Audio::AudioEngineStatistics statistics = Audio::AudioEngine::instance().get_statistics();
+  EXPECT_FALSE(finished.load());
+  EXPECT_EQ(statistics.latency, 0);
+  polled.store(true);
+
+  bouncer.join();
+  EXPECT_EQ(manager.get_latency(), 100);
+
+  manager.clear_tracks();
+  std::filesystem::remove(path);
+}
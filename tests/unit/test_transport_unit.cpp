@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "transport.h"
+
+using namespace Audio;
+
+static constexpr double kSampleRate = 48000.0;
+static constexpr unsigned int kBlock = 256;
+
+/** @brief Run one block the way AudioEngine does, returning the chunk sizes
+ */
+static std::vector<unsigned int> run_block(Transport &transport, const unsigned int n_frames,
+                                           std::vector<TransportState> *states = nullptr)
+{
+  std::vector<unsigned int> chunks;
+  unsigned int offset = 0;
+  while (offset < n_frames)
+  {
+    const unsigned int chunk = transport.begin_chunk(n_frames - offset);
+    if (states)
+      states->push_back(transport.get_chunk_state());
+    transport.advance(chunk);
+    chunks.push_back(chunk);
+    offset += chunk;
+  }
+  transport.publish();
+  return chunks;
+}
+
+/** @brief Tempo Map - Beats and seconds convert across tempo changes
+ */
+TEST(TransportTest, TempoMap)
+{
+  TempoMap map(120.0);
+  EXPECT_DOUBLE_EQ(map.get_seconds_at_beat(4.0), 2.0);
+
+  map.add_tempo_change(4.0, 60.0);
+  EXPECT_DOUBLE_EQ(map.get_seconds_at_beat(6.0), 4.0);
+  EXPECT_DOUBLE_EQ(map.get_beat_at_seconds(4.0), 6.0);
+  EXPECT_DOUBLE_EQ(map.get_beat_at_seconds(1.0), 2.0);
+  EXPECT_DOUBLE_EQ(map.get_tempo_at_beat(3.9), 120.0);
+  EXPECT_DOUBLE_EQ(map.get_tempo_at_seconds(2.5), 60.0);
+
+  EXPECT_THROW(map.add_tempo_change(8.0, 0.0), std::invalid_argument);
+}
+
+/** @brief Transport - Play starts on the exact stream frame requested
+ */
+TEST(TransportTest, SampleAccuratePlay)
+{
+  Transport transport;
+  transport.prepare(kSampleRate);
+
+  run_block(transport, kBlock);
+  EXPECT_FALSE(transport.is_playing());
+  EXPECT_EQ(transport.get_state().stream_frame, kBlock);
+
+  // Start 100 frames into the next block, stop 10 frames into the one after
+  transport.play(kBlock + 100);
+  transport.stop(2 * kBlock + 10);
+
+  std::vector<TransportState> states;
+  auto chunks = run_block(transport, kBlock, &states);
+  ASSERT_EQ(chunks.size(), 2);
+  EXPECT_EQ(chunks[0], 100);
+  EXPECT_FALSE(states[0].playing);
+  EXPECT_TRUE(states[1].playing);
+  EXPECT_EQ(transport.get_position(), kBlock - 100);
+
+  chunks = run_block(transport, kBlock);
+  ASSERT_EQ(chunks.size(), 2);
+  EXPECT_EQ(chunks[0], 10);
+  EXPECT_FALSE(transport.is_playing());
+  EXPECT_EQ(transport.get_position(), kBlock - 100 + 10);
+}
+
+/** @brief Transport - Loop jumps back to the loop start on the exact sample
+ */
+TEST(TransportTest, Loop)
+{
+  Transport transport;
+  transport.prepare(kSampleRate);
+
+  transport.set_loop(1000, 1300);
+  transport.set_looping(true);
+  transport.locate(900);
+  transport.play();
+
+  std::vector<TransportState> states;
+  auto chunks = run_block(transport, kBlock, &states);
+  ASSERT_EQ(chunks.size(), 1);
+  EXPECT_EQ(transport.get_position(), 900 + kBlock);
+
+  // 1156 -> 1300 wraps to 1000 after 144 frames
+  states.clear();
+  chunks = run_block(transport, kBlock, &states);
+  ASSERT_EQ(chunks.size(), 2);
+  EXPECT_EQ(chunks[0], 1300 - (900 + kBlock));
+  EXPECT_EQ(states[1].position, 1000);
+  EXPECT_EQ(transport.get_position(), 1000 + kBlock - chunks[0]);
+
+  transport.set_looping(false);
+  run_block(transport, kBlock);
+  run_block(transport, kBlock);
+  EXPECT_GT(transport.get_position(), 1300);
+}
+
+/** @brief Transport - Locate moves the position and the beat follows the tempo map
+ */
+TEST(TransportTest, LocateAndTempo)
+{
+  Transport transport;
+  transport.prepare(kSampleRate);
+
+  TempoMap map(90.0);
+  transport.set_tempo_map(map);
+
+  transport.locate(static_cast<uint64_t>(kSampleRate * 2));
+  run_block(transport, kBlock);
+
+  const TransportState state = transport.get_state();
+  EXPECT_FALSE(state.playing);
+  EXPECT_EQ(state.position, static_cast<uint64_t>(kSampleRate * 2));
+  EXPECT_DOUBLE_EQ(state.tempo, 90.0);
+  EXPECT_DOUBLE_EQ(state.beat, 3.0);
+
+  EXPECT_THROW(transport.set_loop(10, 10), std::invalid_argument);
+}